@@ -17,6 +17,22 @@
 #define POS_SPEED_MODE 0x100
 #define SPEED_MODE     0x200
 
+#if DM_CTRL_TX_SYNC
+/* 控制帧写入同步窗口, 同一窗口内同一 ID 的旧帧被新帧覆盖 */
+#define dm_ctrl_send(can, ide, id, len, msg, priority)                         \
+    can_sync_stage(can, ide, id, len, msg)
+#elif DM_CTRL_TX_COALESCE
+/* 控制帧使用发送槽, 同一电机同一模式未发出的旧帧被新帧覆盖 */
+#define dm_ctrl_send can_send_message_slot
+#else /* DM_CTRL_TX_SYNC */
+#define dm_ctrl_send can_send_message_prio
+#endif /* DM_CTRL_TX_SYNC */
+
+/* 已初始化的电机 */
+static dm_handle_t *dm_motor_list[DM_MOTOR_MAX_NUMBER];
+/* 各 CAN 是否处于 bus-off */
+static uint8_t dm_bus_off[CAN_LIST_MAX_CAN_NUMBER];
+
 /**
  * @brief CAN 回调函数
  *
@@ -32,7 +48,8 @@ static void can_callback(void *node_obj, can_rx_header_t *can_rx_header,
 
     dm_handle_t *motor = (dm_handle_t *)node_obj;
 
-    if (can_rx_header->id != motor->master_id) {
+    if ((can_rx_header->id != motor->master_id) ||
+        (can_rx_header->data_length < 8)) {
         return;
     }
 
@@ -53,6 +70,43 @@ static void can_callback(void *node_obj, can_rx_header_t *can_rx_header,
     motor->motor_temperature = (float)can_msg[7];
 }
 
+/**
+ * @brief CAN 错误状态回调, 在 CAN 的 SCE/TX 中断中, 或在调用
+ *        `can_get_error_stats` 的任务中调用 (先发现状态变化的一方).
+ *        总线从 bus-off 恢复后, 电机可能因通信丢失而失能, 清除错误并重新
+ *        使能之前已使能的电机. 发送函数在中断与任务中均可调用
+ *
+ * @param can_select 发生变化的 CAN
+ * @param state 新的错误状态
+ */
+static void can_error_callback(can_selected_t can_select,
+                               can_error_state_t state) {
+    if (can_select >= CAN_LIST_MAX_CAN_NUMBER) {
+        return;
+    }
+
+    if (state == can_error_bus_off) {
+        dm_bus_off[can_select] = 1;
+        return;
+    }
+
+    if ((dm_bus_off[can_select] == 0) || (state >= can_error_passive)) {
+        return;
+    }
+
+    dm_bus_off[can_select] = 0;
+
+    for (uint32_t i = 0; i < DM_MOTOR_MAX_NUMBER; ++i) {
+        dm_handle_t *motor = dm_motor_list[i];
+
+        if ((motor != NULL) && (motor->can_select == can_select) &&
+            motor->enabled) {
+            dm_clear_error(motor);
+            dm_motor_enable(motor);
+        }
+    }
+}
+
 /**
  * @brief 达妙电机初始化
  *
@@ -69,6 +123,9 @@ static void can_callback(void *node_obj, can_rx_header_t *can_rx_header,
  * @retval - 0: 成功
  * @retval - 1: `motor`指针为空
  * @retval - 2: 添加 CAN 接收表错误
+ * @retval - 3: 电机数量超过 `DM_MOTOR_MAX_NUMBER`
+ * @retval - 4: 注册 CAN 错误回调失败, 例如该 CAN 未开启 SCE 或 TX 中断,
+ *              无法在 bus-off 恢复后自动重新使能电机
  */
 uint8_t dm_motor_init(dm_handle_t *motor, uint32_t master_id,
                       uint32_t device_id, dm_mode_t mode, dm_model_t model,
@@ -86,12 +143,35 @@ uint8_t dm_motor_init(dm_handle_t *motor, uint32_t master_id,
     motor->spd_limit = spd_limit;
     motor->torq_limit = torq_limit;
     motor->can_select = can_select;
+    motor->enabled = 0;
+
+    uint32_t index = DM_MOTOR_MAX_NUMBER;
+    for (uint32_t i = 0; i < DM_MOTOR_MAX_NUMBER; ++i) {
+        if (dm_motor_list[i] == motor) {
+            index = i;
+            break;
+        }
+
+        if ((dm_motor_list[i] == NULL) && (index == DM_MOTOR_MAX_NUMBER)) {
+            index = i;
+        }
+    }
+
+    if (index == DM_MOTOR_MAX_NUMBER) {
+        return 3;
+    }
+
+    if (can_error_register(can_select, can_error_callback) != 0) {
+        return 4;
+    }
 
     if (can_list_add_new_node(can_select, (void *)motor, master_id, 0x7FF,
                               CAN_ID_STD, can_callback) != 0) {
         return 2;
     }
 
+    dm_motor_list[index] = motor;
+
     return 0;
 }
 
@@ -109,11 +189,18 @@ uint8_t dm_motor_deinit(dm_handle_t *motor) {
         return 1;
     }
 
-    if (can_list_del_node_by_id(motor->can_select, CAN_ID_STD,
-                                motor->master_id) != 0) {
+    if (can_list_del_subscriber(motor->can_select, CAN_ID_STD,
+                                motor->master_id, (void *)motor,
+                                can_callback) != 0) {
         return 2;
     }
 
+    for (uint32_t i = 0; i < DM_MOTOR_MAX_NUMBER; ++i) {
+        if (dm_motor_list[i] == motor) {
+            dm_motor_list[i] = NULL;
+        }
+    }
+
     return 0;
 }
 
@@ -128,6 +215,7 @@ void dm_motor_enable(dm_handle_t *motor) {
     }
 
     uint8_t send_msg[8] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFC};
+    motor->enabled = 1;
     uint32_t id = motor->device_id;
 
     switch (motor->mode) {
@@ -161,6 +249,7 @@ void dm_motor_disable(dm_handle_t *motor) {
     }
 
     uint8_t send_msg[8] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFD};
+    motor->enabled = 0;
     uint32_t id = motor->device_id;
 
     switch (motor->mode) {
@@ -248,7 +337,7 @@ void dm_clear_error(dm_handle_t *motor) {
 }
 
 /**
- * @brief MIT 模式控制电机
+ * @brief 打包 MIT 模式控制数据, 不发送. 多个电机的数据可以拼接到一个 FD 帧中
  *
  * @param motor 电机指针
  * @param position 位置
@@ -256,11 +345,10 @@ void dm_clear_error(dm_handle_t *motor) {
  * @param kp 位置比例系数
  * @param kd 位置微分系数
  * @param torque 扭矩
+ * @param[out] send_msg 8 字节数据
  */
-void dm_mit_ctrl(dm_handle_t *motor, float position, float speed, float kp,
-                 float kd, float torque) {
-    uint8_t send_msg[8];
-
+void dm_mit_pack(dm_handle_t *motor, float position, float speed, float kp,
+                 float kd, float torque, uint8_t *send_msg) {
     uint16_t pos_tmp, spd_tmp, kp_tmp, kd_tmp, torq_tmp;
 
     pos_tmp = float_to_uint(position, -motor->pos_limit, motor->pos_limit, 16);
@@ -277,9 +365,25 @@ void dm_mit_ctrl(dm_handle_t *motor, float position, float speed, float kp,
     send_msg[5] = (kd_tmp >> 4);
     send_msg[6] = ((kd_tmp & 0xF) << 4) | (torq_tmp >> 8);
     send_msg[7] = torq_tmp;
+}
+
+/**
+ * @brief MIT 模式控制电机
+ *
+ * @param motor 电机指针
+ * @param position 位置
+ * @param speed 速度
+ * @param kp 位置比例系数
+ * @param kd 位置微分系数
+ * @param torque 扭矩
+ */
+void dm_mit_ctrl(dm_handle_t *motor, float position, float speed, float kp,
+                 float kd, float torque) {
+    uint8_t send_msg[8];
 
-    can_send_message(motor->can_select, CAN_ID_STD, motor->device_id + MIT_MODE,
-                    8, send_msg);
+    dm_mit_pack(motor, position, speed, kp, kd, torque, send_msg);
+    dm_ctrl_send(motor->can_select, CAN_ID_STD, motor->device_id + MIT_MODE, 8,
+                 send_msg, DM_CTRL_TX_PRIORITY);
 }
 
 /**
@@ -298,8 +402,9 @@ void dm_pos_speed_ctrl(dm_handle_t *motor, float position, float speed) {
     memcpy(&send_msg[0], &position, sizeof(float));
     memcpy(&send_msg[4], &speed, sizeof(float));
 
-    can_send_message(motor->can_select, CAN_ID_STD,
-                    motor->device_id + POS_SPEED_MODE, 8, send_msg);
+    dm_ctrl_send(motor->can_select, CAN_ID_STD,
+                 motor->device_id + POS_SPEED_MODE, 8, send_msg,
+                 DM_CTRL_TX_PRIORITY);
 }
 
 /**
@@ -316,6 +421,6 @@ void dm_speed_ctrl(dm_handle_t *motor, float speed) {
     uint8_t send_msg[4];
     memcpy(send_msg, &speed, sizeof(float));
 
-    can_send_message(motor->can_select, CAN_ID_STD,
-                    motor->device_id + SPEED_MODE, 4, send_msg);
+    dm_ctrl_send(motor->can_select, CAN_ID_STD, motor->device_id + SPEED_MODE,
+                 4, send_msg, DM_CTRL_TX_PRIORITY);
 }
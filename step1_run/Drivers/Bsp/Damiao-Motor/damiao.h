@@ -40,6 +40,18 @@ typedef enum {
 #define DM_KD_MIN 0.0f
 #define DM_KD_MAX 5.0f
 
+/* 控制帧的发送优先级, 比参数、使能等帧先发送 */
+#define DM_CTRL_TX_PRIORITY 0
+/* 控制帧只保留最新值: 上一帧还在发送队列中时直接覆盖, 队列中每个电机每种
+   模式最多一帧 */
+#define DM_CTRL_TX_COALESCE 1
+/* 控制帧写入 CSP 的同步窗口, 由定时器中断同时发到所有总线, 需先调用
+   `can_sync_start`. 开启后 `DM_CTRL_TX_COALESCE` 无效 */
+#define DM_CTRL_TX_SYNC 0
+
+/* 最多管理的电机数量, CAN 总线从 bus-off 恢复后重新使能这些电机 */
+#define DM_MOTOR_MAX_NUMBER 8
+
 /**
  * @brief 故障信息
  */
@@ -80,6 +92,7 @@ typedef struct {
     float mos_temperature;   /*!< MOS 温度 */
     float motor_temperature; /*!< 电机线圈温度 */
     dm_error_t error;        /*!< 错误信息 */
+    uint8_t enabled;         /*!< 是否已发送使能, 总线恢复后重新使能 */
 
     /* 以下参数需要与上位机设定值一致, 否则会导致回传与控制的值发送错误 */
 
@@ -98,6 +111,8 @@ void dm_motor_disable(dm_handle_t *motor);
 void dm_save_zero(dm_handle_t *motor);
 void dm_clear_error(dm_handle_t *motor);
 
+void dm_mit_pack(dm_handle_t *motor, float position, float speed, float kp,
+                 float kd, float torque, uint8_t *send_msg);
 void dm_mit_ctrl(dm_handle_t *motor, float position, float speed, float kp,
                  float kd, float torque);
 void dm_pos_speed_ctrl(dm_handle_t *motor, float position, float speed);
@@ -17,10 +17,17 @@ extern "C" {
 
 #include "./core/bsp_core.h"
 #include "./core/core_delay.h"
+#include "./core/core_crc.h"
+#include "./core/retarget_io.h"
 #include "./key/key.h"
 #include "./led/led.h"
 #include "./can_list/can_list.h"
+#include "./can_selftest/can_selftest.h"
+#include "./can_poll/can_poll.h"
+#include "./can_trace/can_trace.h"
 #include "./Damiao-Motor/damiao.h"
+#include "./telemetry/telemetry.h"
+#include "./host_cmd/host_cmd.h"
 
 
 void bsp_init(void);
@@ -7,8 +7,10 @@
  */
 
 #include "can_list/can_list.h"
+#include "can_list/can_list_port.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 #define STD_ID_TABLE 0
 #define EXT_ID_TABLE 1
@@ -18,40 +20,103 @@
 #include "semphr.h"
 #include "task.h"
 
-static QueueHandle_t can_list_queue_handle;
-static TaskHandle_t can_list_task_handle;
+#if (CAN_LIST_RING_LENGTH & (CAN_LIST_RING_LENGTH - 1)) != 0
+#error "CAN_LIST_RING_LENGTH must be power of 2. "
+#endif /* CAN_LIST_RING_LENGTH */
+
+#if CAN_LIST_USE_BACKGROUND_TASK
+#define CAN_LIST_WORKER_NUMBER 2
+#else /* CAN_LIST_USE_BACKGROUND_TASK */
+#define CAN_LIST_WORKER_NUMBER 1
+#endif /* CAN_LIST_USE_BACKGROUND_TASK */
+
+/* Execution classes used, the interrupt and each worker. */
+#define CAN_LIST_EXEC_NUMBER (CAN_LIST_WORKER_NUMBER + 1)
+
+/* Worker index of the execution class, the interrupt has no worker. */
+#define CAN_LIST_WORKER_INDEX(exec_class) ((exec_class) - can_list_exec_high)
+
+#if !CAN_LIST_TASK_PER_CAN
+static TaskHandle_t can_list_worker_handle[CAN_LIST_WORKER_NUMBER];
+#endif /* !CAN_LIST_TASK_PER_CAN */
+
+static SemaphoreHandle_t can_list_writer_mutex;
 void can_list_polling_task(void *args);
 
-/**
- * @brief Queue message data type.
- */
-typedef struct {
-#if CAN_LIST_USE_FDCAN
-    FDCAN_HandleTypeDef *hcan; /*!< The handle of FDCAN.     */
-#else                          /* CAN_LIST_USE_FDCAN */
-    CAN_HandleTypeDef *hcan; /*!< The handle of CAN.         */
-#endif                         /* CAN_LIST_USE_FDCAN */
-    uint32_t rx_fifo;          /*!< The FIFO which received. */
-} queue_msg_t;
+/* Serialize the writers, readers never take it. */
+#define CAN_LIST_WRITER_LOCK()                                                 \
+    xSemaphoreTake(can_list_writer_mutex, portMAX_DELAY)
+#define CAN_LIST_WRITER_UNLOCK() xSemaphoreGive(can_list_writer_mutex)
+/* Let the preempted reader task run while waiting grace period. */
+#define CAN_LIST_GRACE_WAIT()    vTaskDelay(1)
+
+/* The execution class of the subscriber. */
+#if CAN_LIST_USE_BACKGROUND_TASK
+#define CAN_LIST_EXEC_CLASS(priority)                                          \
+    (((priority) < CAN_LIST_ISR_PRIORITY_LIMIT)          ? can_list_exec_isr   \
+     : ((priority) < CAN_LIST_BACKGROUND_PRIORITY_LIMIT) ? can_list_exec_high  \
+                                                  : can_list_exec_background)
+#else /* CAN_LIST_USE_BACKGROUND_TASK */
+#define CAN_LIST_EXEC_CLASS(priority)                                          \
+    (((priority) < CAN_LIST_ISR_PRIORITY_LIMIT) ? can_list_exec_isr            \
+                                                : can_list_exec_high)
+#endif /* CAN_LIST_USE_BACKGROUND_TASK */
+
+#else /* CAN_LIST_USE_RTOS */
+
+/* All the subscribers are called in the interrupt. */
+#define CAN_LIST_EXEC_CLASS(priority) can_list_exec_isr
+#define CAN_LIST_EXEC_NUMBER          1
 
-static queue_msg_t send_msg_from_isr;
+/* Writers are called from the main loop only. */
+#define CAN_LIST_WRITER_LOCK()
+#define CAN_LIST_WRITER_UNLOCK()
+#define CAN_LIST_GRACE_WAIT()
 
 #endif /* CAN_LIST_USE_RTOS */
 
+/* The frames are counted by the interrupt, which sees every frame even if
+   the rings are full. */
+#define CAN_LIST_COUNT_CLASS can_list_exec_isr
+
 /*****************************************************************************
  * @defgroup Private type and variables.
  * @{
  */
 
+/**
+ * @brief Subscriber of a CAN ID.
+ */
+typedef struct {
+    void *can_data;          /*!< The CAN data of this subscriber.   */
+    can_callback_t callback; /*!< CAN callback function.             */
+    uint8_t priority;        /*!< Lower value is called earlier.     */
+} can_subscriber_t;
+
+/**
+ * @brief Subscribers of a CAN ID, stored contiguously and ordered by
+ *        priority. It is replaced as a whole when adding or deleting.
+ */
+typedef struct {
+    uint32_t count;          /*!< Number of subscribers. */
+    can_subscriber_t subs[]; /*!< Subscriber array.      */
+} subscriber_list_t;
+
 /**
  * @brief CAN list node type.
  */
 typedef struct can_node {
-    void *can_data;          /*!< The CAN data of this node.    */
-    uint32_t id;             /*!< CAN ID.                       */
-    uint32_t id_mask;        /*!< CAN ID mask.                  */
-    can_callback_t callback; /*!< CAN callback function.        */
-    struct can_node *next;   /*!< Next CAN list node.           */
+    uint32_t id;                    /*!< CAN ID.                       */
+    uint32_t id_mask;               /*!< CAN ID mask.                  */
+    subscriber_list_t *subscribers; /*!< Subscribers of this ID.       */
+    uint32_t rx_count;              /*!< Frames dispatched.            */
+    uint32_t last_timestamp;        /*!< Timestamp of the last frame.  */
+    /* Callback time of the subscribers, by execution class. Kept in the node,
+       the subscriber list is copied when adding or deleting. */
+    uint32_t max_cycles[CAN_LIST_EXEC_NUMBER];
+    uint64_t total_cycles[CAN_LIST_EXEC_NUMBER];
+    uint8_t fifo0_filter;           /*!< Routed to FIFO0 by a filter.  */
+    struct can_node *next;          /*!< Next CAN list node.           */
 } can_node_t;
 
 /**
@@ -62,16 +127,205 @@ typedef struct {
     uint32_t len;       /*!< Table size.                  */
 } hash_table_t;
 
+/**
+ * @brief The frame received, header and data are read in the interrupt.
+ */
+typedef struct {
+    can_rx_header_t header;           /*!< The rx header of this frame. */
+    uint8_t data[CAN_LIST_DATA_SIZE]; /*!< The rx data of this frame.   */
+} can_list_frame_t;
+
+#if CAN_LIST_USE_RTOS
+
+/**
+ * @brief Single producer (interrupt) single consumer (task) frame ring.
+ *        `head` and `tail` are free running, index is `& (length - 1)`.
+ */
+typedef struct {
+    volatile uint32_t head;                        /*!< Read by the task.   */
+    volatile uint32_t tail;                        /*!< Written by the ISR. */
+    can_list_frame_t frames[CAN_LIST_RING_LENGTH]; /*!< Frame buffer.       */
+} frame_ring_t;
+
+#endif /* CAN_LIST_USE_RTOS */
+
+/**
+ * @brief Receive state of a hardware FIFO, only written by the interrupt of
+ *        this FIFO. RX0 may preempt RX1, so nothing here is shared between
+ *        the FIFOs.
+ */
+typedef struct {
+#if CAN_LIST_USE_RTOS
+    frame_ring_t ring[CAN_LIST_WORKER_NUMBER]; /*!< Frames for each task.  */
+#endif /* CAN_LIST_USE_RTOS */
+    uint32_t rx_total;     /*!< Frames received.                     */
+    uint32_t rx_unmatched; /*!< Frames without a matched node.       */
+    uint32_t ring_dropped; /*!< Frames dropped because ring is full. */
+    uint32_t fifo_overrun; /*!< Hardware FIFO overrun times.         */
+} can_list_fifo_t;
+
+/* Index of `can_list_fifo_t` of the hardware FIFO. */
+#define CAN_LIST_FIFO_INDEX(rx_fifo) (((rx_fifo) == CAN_LIST_RX_FIFO0) ? 0 : 1)
+
+/**
+ * @brief Index entry of a static node, the node itself is in flash.
+ */
+typedef struct {
+    const can_list_static_node_t *node; /*!< The static node.      */
+    can_list_node_stats_t stats;        /*!< Receive statistics.   */
+} can_static_entry_t;
+
 /**
  * @brief The CAN table struct, each ID type has an independent table.
  */
 typedef struct {
     hash_table_t id_table[2]; /*!< Std and Ext ID table.   */
+    /* Static nodes of this CAN. The first `static_exact` nodes match the
+       whole ID and are sorted by ID type and ID, the others have a mask. */
+    can_static_entry_t *static_nodes;
+    uint32_t static_exact;
+    uint32_t static_count;
+    /* Receive state of FIFO0 and FIFO1. */
+    can_list_fifo_t fifo[2];
+#if CAN_LIST_USE_RTOS
+    /* The tasks process the frames of this CAN. */
+    TaskHandle_t worker[CAN_LIST_WORKER_NUMBER];
+#endif /* CAN_LIST_USE_RTOS */
 } can_table_t;
 
 /* The CAN instance, each CAN has an independent table. */
 can_table_t *can_table[CAN_LIST_MAX_CAN_NUMBER];
 
+/* Bounds of the static node section, NULL if no static node registered. */
+#if defined(__ARMCC_VERSION)
+extern const can_list_static_node_t can_list_static$$Base[]
+    __attribute__((weak));
+extern const can_list_static_node_t can_list_static$$Limit[]
+    __attribute__((weak));
+#define CAN_LIST_STATIC_BEGIN can_list_static$$Base
+#define CAN_LIST_STATIC_END   can_list_static$$Limit
+#elif defined(__GNUC__)
+extern const can_list_static_node_t __start_can_list_static[]
+    __attribute__((weak));
+extern const can_list_static_node_t __stop_can_list_static[]
+    __attribute__((weak));
+#define CAN_LIST_STATIC_BEGIN __start_can_list_static
+#define CAN_LIST_STATIC_END   __stop_can_list_static
+#endif /* __ARMCC_VERSION */
+
+/* Readers are counted in two groups, new readers enter `reader_group`. */
+static volatile uint32_t reader_group;
+static volatile uint32_t reader_count[2];
+
+/**
+ * @}
+ */
+
+/*****************************************************************************
+ * @defgroup Reader and writer synchronization.
+ * @{
+ *
+ * Readers (the interrupt and the task) walk the table without any lock.
+ * Writers build the new node or subscriber list completely, then publish it
+ * with a single pointer store. The memory unlinked is freed only after all
+ * the readers which may still see it have left, no interrupt is disabled.
+ */
+
+/**
+ * @brief Enter the read side. Readers may nest (interrupt preempts the task),
+ *        and a reader task may be preempted by another reader task or block
+ *        in the callback, so the count is changed by atomic add only. A
+ *        blocked reader holds the writer in `can_list_synchronize` until it
+ *        leaves.
+ *
+ * @return The reader group entered, pass to `can_list_read_unlock`.
+ */
+static inline uint32_t can_list_read_lock(void) {
+    uint32_t group;
+
+    while (1) {
+        group = reader_group;
+        can_list_port_atomic_add(&reader_count[group], 1);
+        CAN_LIST_DMB();
+
+        /* The writer switched the group before we entered, retry. */
+        if (reader_group == group) {
+            return group;
+        }
+
+        can_list_port_atomic_add(&reader_count[group], (uint32_t)-1);
+    }
+}
+
+/**
+ * @brief Leave the read side.
+ *
+ * @param group The reader group returned by `can_list_read_lock`.
+ */
+static inline void can_list_read_unlock(uint32_t group) {
+    CAN_LIST_DMB();
+    can_list_port_atomic_add(&reader_count[group], (uint32_t)-1);
+}
+
+/**
+ * @brief Wait for all the readers which may see the unlinked memory to leave.
+ *        Call it with writer lock held, after unlinking and before freeing.
+ */
+static void can_list_synchronize(void) {
+    uint32_t group = reader_group;
+
+    CAN_LIST_DMB();
+    reader_group = group ^ 1;
+    CAN_LIST_DMB();
+
+    while (reader_count[group] != 0) {
+        CAN_LIST_GRACE_WAIT();
+    }
+}
+
+/**
+ * @brief Check whether the writer may run here. The interrupt can not wait
+ *        for the writer lock, and a subscriber callback holds a read count,
+ *        `can_list_synchronize` would wait for itself.
+ *
+ * @return 1 if allowed, 0 if called in interrupt or in a worker task.
+ */
+static uint8_t can_list_writer_allowed(void) {
+    if (CAN_LIST_IN_ISR()) {
+        return 0;
+    }
+
+#if CAN_LIST_USE_RTOS
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+
+    for (uint8_t i = 0; i < CAN_LIST_MAX_CAN_NUMBER; i++) {
+        if (can_table[i] == NULL) {
+            continue;
+        }
+
+        for (uint8_t j = 0; j < CAN_LIST_WORKER_NUMBER; j++) {
+            if (can_table[i]->worker[j] == self) {
+                return 0;
+            }
+        }
+    }
+#endif /* CAN_LIST_USE_RTOS */
+
+    return 1;
+}
+
+/**
+ * @brief Publish a pointer after the object it points to is initialized.
+ *
+ * @param ptr The pointer to store.
+ * @param value The value to store.
+ */
+#define CAN_LIST_PUBLISH(ptr, value)                                           \
+    do {                                                                       \
+        CAN_LIST_DMB();                                                        \
+        (ptr) = (value);                                                       \
+    } while (0)
+
 /**
  * @}
  */
@@ -99,6 +353,166 @@ static can_node_t *can_list_find_node_by_id(const hash_table_t *table,
     return node;
 }
 
+#if CAN_LIST_USE_RTOS
+
+/**
+ * @brief Create a task to process the frames.
+ *
+ * @param can_select Which CAN served, `CAN_LIST_MAX_CAN_NUMBER` for all.
+ * @param worker Worker index, 0: high priority task, 1: background task.
+ * @return The task handle, `NULL` if create failed.
+ */
+static TaskHandle_t can_list_create_worker(uint8_t can_select,
+                                           uint8_t worker) {
+    TaskHandle_t handle = NULL;
+    void *args = (void *)(uintptr_t)((can_select << 8) | worker);
+
+#if CAN_LIST_USE_BACKGROUND_TASK
+    if (worker == CAN_LIST_WORKER_INDEX(can_list_exec_background)) {
+        xTaskCreate(can_list_polling_task, CAN_LIST_BACKGROUND_TASK_NAME,
+                    CAN_LIST_BACKGROUND_TASK_STK_SIZE, args,
+                    CAN_LIST_BACKGROUND_TASK_PRIORITY, &handle);
+        return handle;
+    }
+#endif /* CAN_LIST_USE_BACKGROUND_TASK */
+
+    xTaskCreate(can_list_polling_task, CAN_LIST_TASK_NAME,
+                CAN_LSIT_TASK_STK_SIZE, args, CAN_LIST_TASK_PRIORITY, &handle);
+    return handle;
+}
+
+#endif /* CAN_LIST_USE_RTOS */
+
+/**
+ * @brief Whether the static node matches the whole ID, which is looked up by
+ *        binary search.
+ *
+ * @param node The static node.
+ * @return 1 if the mask covers all the bits of the ID type.
+ */
+static inline uint8_t can_list_static_is_exact(
+    const can_list_static_node_t *node) {
+    uint32_t full = (node->id_type == CAN_ID_STD) ? 0x7FFU : 0x1FFFFFFFU;
+
+    return (node->id_mask & full) == full;
+}
+
+/**
+ * @brief Compare the static node with the ID.
+ *
+ * @param node The static node.
+ * @param id_type The ID type.
+ * @param id The ID.
+ * @return Less than, equal to or greater than 0.
+ */
+static inline int32_t can_list_static_compare(
+    const can_list_static_node_t *node, uint32_t id_type, uint32_t id) {
+    if (node->id_type != id_type) {
+        return (node->id_type < id_type) ? -1 : 1;
+    }
+
+    if (node->id != id) {
+        return (node->id < id) ? -1 : 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Binary search the first static node matching the whole ID.
+ *
+ * @param table The CAN table.
+ * @param id_type The ID type.
+ * @param id The ID.
+ * @return Index of the first node not less than the ID, `static_exact` if
+ *         all the nodes are less.
+ */
+static inline uint32_t can_list_static_find(const can_table_t *table,
+                                            uint32_t id_type, uint32_t id) {
+    uint32_t low = 0, high = table->static_exact, mid;
+
+    while (low < high) {
+        mid = (low + high) / 2;
+
+        if (can_list_static_compare(table->static_nodes[mid].node, id_type,
+                                    id) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+/**
+ * @brief Collect the static nodes of the CAN from the linker section. The
+ *        nodes matching the whole ID are sorted (stable, so the link order
+ *        of the same ID is kept), the masked nodes follow in link order.
+ *
+ * @param table The CAN table.
+ * @param can_select Which CAN.
+ * @return Build status:
+ * @retval - 0: Success.
+ * @retval - 1: Memory allocated failed.
+ */
+static uint8_t can_list_build_static_index(can_table_t *table,
+                                           can_selected_t can_select) {
+    uint32_t count = 0, exact = 0;
+
+    table->static_nodes = NULL;
+    table->static_exact = 0;
+    table->static_count = 0;
+
+    for (const can_list_static_node_t *node = CAN_LIST_STATIC_BEGIN;
+         node < CAN_LIST_STATIC_END; ++node) {
+        if (node->can_select == can_select) {
+            ++count;
+            exact += can_list_static_is_exact(node);
+        }
+    }
+
+    if (count == 0) {
+        return 0;
+    }
+
+    can_static_entry_t *entries = (can_static_entry_t *)CAN_LIST_CALLOC(
+        count, sizeof(can_static_entry_t));
+    if (entries == NULL) {
+        return 1;
+    }
+
+    uint32_t sorted = 0, masked = exact;
+
+    for (const can_list_static_node_t *node = CAN_LIST_STATIC_BEGIN;
+         node < CAN_LIST_STATIC_END; ++node) {
+        if (node->can_select != can_select) {
+            continue;
+        }
+
+        if (!can_list_static_is_exact(node)) {
+            entries[masked++].node = node;
+            continue;
+        }
+
+        /* Insertion sort, only once when adding the CAN. */
+        uint32_t i = sorted++;
+        while ((i > 0) && (can_list_static_compare(entries[i - 1].node,
+                                                   node->id_type,
+                                                   node->id) > 0)) {
+            entries[i].node = entries[i - 1].node;
+            --i;
+        }
+        entries[i].node = node;
+    }
+
+    table->static_nodes = entries;
+    table->static_exact = exact;
+    table->static_count = count;
+
+    return 0;
+}
+
 /**
  * @brief Create a CAN table to receive and process the CAN message.
  *
@@ -109,7 +523,8 @@ static can_node_t *can_list_find_node_by_id(const hash_table_t *table,
  * @retval - 0: Success.
  * @retval - 1: This CAN does not exist.
  * @retval - 2: This CAN had created.
- * @retval - 3: Memory allocated failed.
+ * @retval - 3: Memory allocated failed, or the task (mutex) of RTOS created
+ *               failed.
  */
 uint8_t can_list_add_can(can_selected_t can_select, uint32_t std_len,
                          uint32_t ext_len) {
@@ -121,63 +536,677 @@ uint8_t can_list_add_can(can_selected_t can_select, uint32_t std_len,
         return 2;
     }
 
-    can_table[can_select] = (can_table_t *)CAN_LIST_MALLOC(sizeof(can_table_t));
-    if (can_table[can_select] == NULL) {
+    can_table_t *new_table =
+        (can_table_t *)CAN_LIST_MALLOC(sizeof(can_table_t));
+    if (new_table == NULL) {
         return 3;
     }
 
-    can_table[can_select]->id_table[STD_ID_TABLE].table =
+    new_table->id_table[STD_ID_TABLE].table =
         (can_node_t **)CAN_LIST_CALLOC(std_len, sizeof(can_node_t *));
-    if (can_table[can_select]->id_table[STD_ID_TABLE].table == NULL) {
-        CAN_LIST_FREE(can_table[can_select]);
-        can_table[can_select] = NULL;
+    if (new_table->id_table[STD_ID_TABLE].table == NULL) {
+        CAN_LIST_FREE(new_table);
         return 3;
     }
-    can_table[can_select]->id_table[STD_ID_TABLE].len = std_len;
+    new_table->id_table[STD_ID_TABLE].len = std_len;
 
-    can_table[can_select]->id_table[EXT_ID_TABLE].table =
+    new_table->id_table[EXT_ID_TABLE].table =
         (can_node_t **)CAN_LIST_CALLOC(ext_len, sizeof(can_node_t *));
-    if (can_table[can_select]->id_table[EXT_ID_TABLE].table == NULL) {
-        CAN_LIST_FREE(can_table[can_select]->id_table[STD_ID_TABLE].table);
-        CAN_LIST_FREE(can_table[can_select]);
-        can_table[can_select] = NULL;
+    if (new_table->id_table[EXT_ID_TABLE].table == NULL) {
+        CAN_LIST_FREE(new_table->id_table[STD_ID_TABLE].table);
+        CAN_LIST_FREE(new_table);
         return 3;
     }
-    can_table[can_select]->id_table[EXT_ID_TABLE].len = ext_len;
+    new_table->id_table[EXT_ID_TABLE].len = ext_len;
+
+    if (can_list_build_static_index(new_table, can_select) != 0) {
+        CAN_LIST_FREE(new_table->id_table[EXT_ID_TABLE].table);
+        CAN_LIST_FREE(new_table->id_table[STD_ID_TABLE].table);
+        CAN_LIST_FREE(new_table);
+        return 3;
+    }
+
+    memset(new_table->fifo, 0, sizeof(new_table->fifo));
+    CAN_LIST_TIMESTAMP_INIT();
 
 #if CAN_LIST_USE_RTOS
-    if (can_list_queue_handle == NULL) {
-        can_list_queue_handle =
-            xQueueCreate(CAN_LIST_QUEUE_LENGTH, sizeof(queue_msg_t));
-        xTaskCreate(can_list_polling_task, CAN_LIST_TASK_NAME,
-                    CAN_LSIT_TASK_STK_SIZE, NULL, CAN_LIST_TASK_PRIORITY,
-                    &can_list_task_handle);
+    if (can_list_writer_mutex == NULL) {
+        can_list_writer_mutex = xSemaphoreCreateMutex();
+    }
+
+    uint8_t create_failed = (can_list_writer_mutex == NULL);
+
+    for (uint8_t i = 0; i < CAN_LIST_WORKER_NUMBER; ++i) {
+        new_table->worker[i] = NULL;
+
+        if (create_failed) {
+            continue;
+        }
+
+#if CAN_LIST_TASK_PER_CAN
+        new_table->worker[i] = can_list_create_worker(can_select, i);
+#else  /* CAN_LIST_TASK_PER_CAN */
+        if (can_list_worker_handle[i] == NULL) {
+            can_list_worker_handle[i] =
+                can_list_create_worker(CAN_LIST_MAX_CAN_NUMBER, i);
+        }
+        new_table->worker[i] = can_list_worker_handle[i];
+#endif /* CAN_LIST_TASK_PER_CAN */
+
+        create_failed = (new_table->worker[i] == NULL);
+    }
+
+    if (create_failed) {
+#if CAN_LIST_TASK_PER_CAN
+        for (uint8_t i = 0; i < CAN_LIST_WORKER_NUMBER; ++i) {
+            if (new_table->worker[i] != NULL) {
+                vTaskDelete(new_table->worker[i]);
+            }
+        }
+#endif /* CAN_LIST_TASK_PER_CAN */
+        /* The shared tasks and the mutex created are kept for the next call,
+           they only wait for the notification. */
+        CAN_LIST_FREE(new_table->static_nodes);
+        CAN_LIST_FREE(new_table->id_table[EXT_ID_TABLE].table);
+        CAN_LIST_FREE(new_table->id_table[STD_ID_TABLE].table);
+        CAN_LIST_FREE(new_table);
+        return 3;
     }
 #endif /* CAN_LIST_USE_RTOS */
 
+    /* Publish the table after it is initialized, the interrupt may use it. */
+    CAN_LIST_PUBLISH(can_table[can_select], new_table);
+
+#if CAN_LIST_FIFO0_PRIORITY_LIMIT > 0
+    for (uint32_t i = 0; i < new_table->static_count; ++i) {
+        const can_list_static_node_t *node = new_table->static_nodes[i].node;
+
+        if (node->priority < CAN_LIST_FIFO0_PRIORITY_LIMIT) {
+            can_list_port_filter_add(can_select, node->id_type, node->id,
+                                     node->id_mask);
+        }
+    }
+#endif /* CAN_LIST_FIFO0_PRIORITY_LIMIT > 0 */
+
+    return 0;
+}
+
+/**
+ * @brief Create a new subscriber list with one more subscriber inserted.
+ *        Subscribers are ordered by priority, the same priority is ordered by
+ *        the adding order.
+ *
+ * @param list The old subscriber list, may be `NULL`.
+ * @param node_data The data pointer of the subscriber.
+ * @param callback The callback function of the subscriber.
+ * @param priority The priority of the subscriber.
+ * @return The new subscriber list, `NULL` if memory allocated failed.
+ */
+static subscriber_list_t *
+can_list_insert_subscriber(const subscriber_list_t *list, void *node_data,
+                           can_callback_t callback, uint8_t priority) {
+    uint32_t count = (list == NULL) ? 0 : list->count;
+
+    subscriber_list_t *new_list = (subscriber_list_t *)CAN_LIST_MALLOC(
+        sizeof(subscriber_list_t) + (count + 1) * sizeof(can_subscriber_t));
+    if (new_list == NULL) {
+        return NULL;
+    }
+
+    uint32_t pos = 0;
+    while ((pos < count) && (list->subs[pos].priority <= priority)) {
+        ++pos;
+    }
+
+    if (pos > 0) {
+        memcpy(&new_list->subs[0], &list->subs[0],
+               pos * sizeof(can_subscriber_t));
+    }
+
+    if (pos < count) {
+        memcpy(&new_list->subs[pos + 1], &list->subs[pos],
+               (count - pos) * sizeof(can_subscriber_t));
+    }
+
+    new_list->subs[pos].can_data = node_data;
+    new_list->subs[pos].callback = callback;
+    new_list->subs[pos].priority = priority;
+    new_list->count = count + 1;
+
+    return new_list;
+}
+
+/**
+ * @brief Create a new subscriber list without the specific subscriber.
+ *
+ * @param list The old subscriber list, at least 2 subscribers.
+ * @param index The index of subscriber to remove.
+ * @return The new subscriber list, `NULL` if memory allocated failed.
+ */
+static subscriber_list_t *
+can_list_remove_subscriber(const subscriber_list_t *list, uint32_t index) {
+    subscriber_list_t *new_list = (subscriber_list_t *)CAN_LIST_MALLOC(
+        sizeof(subscriber_list_t) +
+        (list->count - 1) * sizeof(can_subscriber_t));
+    if (new_list == NULL) {
+        return NULL;
+    }
+
+    if (index > 0) {
+        memcpy(&new_list->subs[0], &list->subs[0],
+               index * sizeof(can_subscriber_t));
+    }
+
+    if (index < list->count - 1) {
+        memcpy(&new_list->subs[index], &list->subs[index + 1],
+               (list->count - 1 - index) * sizeof(can_subscriber_t));
+    }
+
+    new_list->count = list->count - 1;
+
+    return new_list;
+}
+
+/**
+ * @brief Unlink the node from the table. Readers walking on the node can still
+ *        go on, free it after `can_list_synchronize`.
+ *
+ * @param table The table which the node in.
+ * @param node The node to unlink.
+ */
+static void can_list_unlink_node(hash_table_t *table, can_node_t *node) {
+    can_node_t **link = &table->table[node->id % table->len];
+
+    while ((*link != NULL) && (*link != node)) {
+        link = &(*link)->next;
+    }
+
+    if (*link == NULL) {
+        return;
+    }
+
+    /* Single store, readers see either the old or the new chain. */
+    *link = node->next;
+}
+
+/**
+ * @brief Unlink the node, wait for the readers and free it.
+ *
+ * @param table The table which the node in.
+ * @param node The node to delete.
+ */
+static void can_list_free_node(hash_table_t *table, can_node_t *node) {
+    can_list_unlink_node(table, node);
+    can_list_synchronize();
+
+    CAN_LIST_FREE(node->subscribers);
+    CAN_LIST_FREE(node);
+}
+
+/**
+ * @brief Insert the subscriber to the table, call with writer lock held.
+ *
+ * @param table The table to insert.
+ * @param node_data The data pointer of this subscriber.
+ * @param id The id to subscribe.
+ * @param id_mask The id mask.
+ * @param callback The callback function of this subscriber.
+ * @param priority The priority of this subscriber.
+ * @return Operational status, same as `can_list_add_subscriber`.
+ */
+static uint8_t can_list_insert_node(hash_table_t *table, void *node_data,
+                                    uint32_t id, uint32_t id_mask,
+                                    can_callback_t callback,
+                                    uint8_t priority) {
+    can_node_t *node = can_list_find_node_by_id(table, id);
+    subscriber_list_t *new_list;
+
+    if (node != NULL) {
+        if (node->id_mask != id_mask) {
+            return 3;
+        }
+
+        subscriber_list_t *old_list = node->subscribers;
+
+        for (uint32_t i = 0; i < old_list->count; ++i) {
+            if ((old_list->subs[i].callback == callback) &&
+                (old_list->subs[i].can_data == node_data)) {
+                return 4;
+            }
+        }
+
+        new_list = can_list_insert_subscriber(old_list, node_data, callback,
+                                              priority);
+        if (new_list == NULL) {
+            return 5;
+        }
+
+        CAN_LIST_PUBLISH(node->subscribers, new_list);
+        can_list_synchronize();
+        CAN_LIST_FREE(old_list);
+
+        return 0;
+    }
+
+    can_node_t *new_node = (can_node_t *)CAN_LIST_MALLOC(sizeof(can_node_t));
+    if (new_node == NULL) {
+        return 5;
+    }
+
+    new_list = can_list_insert_subscriber(NULL, node_data, callback, priority);
+    if (new_list == NULL) {
+        CAN_LIST_FREE(new_node);
+        return 5;
+    }
+
+    new_node->id = id;
+    new_node->id_mask = id_mask;
+    new_node->subscribers = new_list;
+    new_node->rx_count = 0;
+    new_node->last_timestamp = 0;
+    memset(new_node->max_cycles, 0, sizeof(new_node->max_cycles));
+    memset(new_node->total_cycles, 0, sizeof(new_node->total_cycles));
+    new_node->fifo0_filter = 0;
+
+    /* Calculate the table index to insert. */
+    can_node_t **table_head = &(table->table[id % table->len]);
+
+    new_node->next = *table_head;
+    CAN_LIST_PUBLISH(*table_head, new_node);
+
+    return 0;
+}
+
+/**
+ * @brief Remove the subscriber from the table, call with writer lock held.
+ *
+ * @param table The table to remove.
+ * @param id The id subscribed.
+ * @param node_data The data pointer of the subscriber.
+ * @param callback The callback function of the subscriber.
+ * @return Operational status, same as `can_list_del_subscriber`.
+ */
+static uint8_t can_list_remove_node(hash_table_t *table, uint32_t id,
+                                    void *node_data, can_callback_t callback) {
+    can_node_t *node = can_list_find_node_by_id(table, id);
+
+    if (node == NULL) {
+        return 4;
+    }
+
+    subscriber_list_t *old_list = node->subscribers;
+    uint32_t index = 0;
+
+    while ((index < old_list->count) &&
+           ((old_list->subs[index].callback != callback) ||
+            (old_list->subs[index].can_data != node_data))) {
+        ++index;
+    }
+
+    if (index == old_list->count) {
+        return 4;
+    }
+
+    if (old_list->count == 1) {
+        can_list_free_node(table, node);
+        return 0;
+    }
+
+    subscriber_list_t *new_list = can_list_remove_subscriber(old_list, index);
+    if (new_list == NULL) {
+        return 5;
+    }
+
+    CAN_LIST_PUBLISH(node->subscribers, new_list);
+    can_list_synchronize();
+    CAN_LIST_FREE(old_list);
+
+    return 0;
+}
+
+#if CAN_LIST_FIFO0_PRIORITY_LIMIT > 0
+
+/* Convert the table index to the ID type. */
+#define CAN_LIST_TABLE_ID_TYPE(index)                                          \
+    (((index) == STD_ID_TABLE) ? CAN_ID_STD : CAN_ID_EXT)
+
+/**
+ * @brief Add or remove the FIFO0 filter of the node by the priority of its
+ *        most urgent subscriber, call with writer lock held.
+ *
+ * @param can_select Which CAN the node belongs to.
+ * @param table_index `STD_ID_TABLE` or `EXT_ID_TABLE`.
+ * @param node The node to update.
+ */
+static void can_list_update_filter(can_selected_t can_select,
+                                   uint32_t table_index, can_node_t *node) {
+    /* Subscribers are ordered by priority. */
+    uint8_t urgent = (node->subscribers->subs[0].priority <
+                      CAN_LIST_FIFO0_PRIORITY_LIMIT);
+
+    if (urgent && (node->fifo0_filter == 0)) {
+        if (can_list_port_filter_add(can_select,
+                                     CAN_LIST_TABLE_ID_TYPE(table_index),
+                                     node->id, node->id_mask) == 0) {
+            node->fifo0_filter = 1;
+        }
+    } else if (!urgent && (node->fifo0_filter != 0)) {
+        can_list_port_filter_remove(can_select,
+                                    CAN_LIST_TABLE_ID_TYPE(table_index),
+                                    node->id, node->id_mask);
+        node->fifo0_filter = 0;
+    }
+}
+
+#endif /* CAN_LIST_FIFO0_PRIORITY_LIMIT > 0 */
+
+/**
+ * @brief Adding a node to the CAN table with the default priority. If the ID
+ *        already exists, this node is added as another subscriber of the ID.
+ *
+ * @param can_select Specific which CAN will be added.
+ * @param node_data The data pointer of this node.
+ * @param id The id of this node.
+ * @param id_mask The id mask of this node.
+ * @param id_type The id type of this node.
+ * @param callback The callback function of this node.
+ * @return Operational status:
+ * @retval - 0: Success.
+ * @retval - 1: This CAN does not exists.
+ * @retval - 2: The specific CAN table is not created.
+ * @retval - 3: Parameter invaild.
+ * @retval - 4: This node already subscribed this ID.
+ * @retval - 5: Memroy allocated failed.
+ * @retval - 6: Called in interrupt or subscriber callback.
+ */
+uint8_t can_list_add_new_node(can_selected_t can_select, void *node_data,
+                              uint32_t id, uint32_t id_mask, uint32_t id_type,
+                              can_callback_t callback) {
+    return can_list_add_subscriber(can_select, node_data, id, id_mask, id_type,
+                                   callback, CAN_LIST_DEFAULT_PRIORITY);
+}
+
+/**
+ * @brief Adding a subscriber of the ID to the CAN table. All subscribers of
+ *        an ID are called by priority when the message received.
+ *
+ * @param can_select Specific which CAN will be added.
+ * @param node_data The data pointer of this subscriber.
+ * @param id The id to subscribe.
+ * @param id_mask The id mask, must be same as other subscribers of this ID.
+ * @param id_type The id type.
+ * @param callback The callback function of this subscriber.
+ * @param priority The priority of this subscriber, lower value is called
+ *        earlier.
+ * @return Operational status:
+ * @retval - 0: Success.
+ * @retval - 1: This CAN does not exists.
+ * @retval - 2: The specific CAN table is not created.
+ * @retval - 3: Parameter invaild.
+ * @retval - 4: This subscriber already exists.
+ * @retval - 5: Memroy allocated failed.
+ * @retval - 6: Called in interrupt or subscriber callback.
+ */
+uint8_t can_list_add_subscriber(can_selected_t can_select, void *node_data,
+                                uint32_t id, uint32_t id_mask,
+                                uint32_t id_type, can_callback_t callback,
+                                uint8_t priority) {
+    if (can_select >= CAN_LIST_MAX_CAN_NUMBER) {
+        return 1;
+    }
+
+    if (can_table[can_select] == NULL) {
+        return 2;
+    }
+
+    if (id_type == CAN_ID_STD) {
+        id_type = STD_ID_TABLE;
+    } else if (id_type == CAN_ID_EXT) {
+        id_type = EXT_ID_TABLE;
+    } else {
+        return 3;
+    }
+
+    if (callback == NULL) {
+        return 3;
+    }
+
+    /* Specific hash table to insert. */
+    hash_table_t *table = &can_table[can_select]->id_table[id_type];
+
+    if (!can_list_writer_allowed()) {
+        return 6;
+    }
+
+    CAN_LIST_WRITER_LOCK();
+    uint8_t res = can_list_insert_node(table, node_data, id, id_mask,
+                                       callback, priority);
+#if CAN_LIST_FIFO0_PRIORITY_LIMIT > 0
+    if (res == 0) {
+        can_list_update_filter(can_select, id_type,
+                               can_list_find_node_by_id(table, id));
+    }
+#endif /* CAN_LIST_FIFO0_PRIORITY_LIMIT > 0 */
+    CAN_LIST_WRITER_UNLOCK();
+
+    return res;
+}
+
+/**
+ * @brief Delete node by id, all the subscribers of this ID are deleted.
+ *
+ * @param can_select Specific which can to operate.
+ * @param id_type Specific which id table to operate.
+ * @param id Specific which node will be deleted.
+ * @return Operational status:
+ * @retval - 0: Success.
+ * @retval - 1: This CAN does not exists.
+ * @retval - 2: The specific CAN table is not created.
+ * @retval - 3: Parameter invaild.
+ * @retval - 4: Node does not exists.
+ * @retval - 5: Called in interrupt or subscriber callback.
+ */
+uint8_t can_list_del_node_by_id(can_selected_t can_select, uint32_t id_type,
+                                uint32_t id) {
+    if (can_select >= CAN_LIST_MAX_CAN_NUMBER) {
+        return 1;
+    }
+
+    if (can_table[can_select] == NULL) {
+        return 2;
+    }
+
+    if (id_type == CAN_ID_STD) {
+        id_type = STD_ID_TABLE;
+    } else if (id_type == CAN_ID_EXT) {
+        id_type = EXT_ID_TABLE;
+    } else {
+        return 3;
+    }
+
+    hash_table_t *table = &can_table[can_select]->id_table[id_type];
+
+    if (!can_list_writer_allowed()) {
+        return 5;
+    }
+
+    CAN_LIST_WRITER_LOCK();
+    can_node_t *node = can_list_find_node_by_id(table, id);
+
+    if (node == NULL) {
+        /* The node does not exist */
+        CAN_LIST_WRITER_UNLOCK();
+        return 4;
+    }
+
+#if CAN_LIST_FIFO0_PRIORITY_LIMIT > 0
+    if (node->fifo0_filter != 0) {
+        can_list_port_filter_remove(can_select, CAN_LIST_TABLE_ID_TYPE(id_type),
+                                    node->id, node->id_mask);
+    }
+#endif /* CAN_LIST_FIFO0_PRIORITY_LIMIT > 0 */
+
+    can_list_free_node(table, node);
+    CAN_LIST_WRITER_UNLOCK();
+
+    return 0;
+}
+
+/**
+ * @brief Delete one subscriber of the ID. The node is deleted after the last
+ *        subscriber is deleted.
+ *
+ * @param can_select Specific which can to operate.
+ * @param id_type Specific which id table to operate.
+ * @param id Specific which ID the subscriber subscribed.
+ * @param node_data The data pointer of the subscriber.
+ * @param callback The callback function of the subscriber.
+ * @return Operational status:
+ * @retval - 0: Success.
+ * @retval - 1: This CAN does not exists.
+ * @retval - 2: The specific CAN table is not created.
+ * @retval - 3: Parameter invaild.
+ * @retval - 4: Subscriber does not exists.
+ * @retval - 5: Memroy allocated failed.
+ * @retval - 6: Called in interrupt or subscriber callback.
+ */
+uint8_t can_list_del_subscriber(can_selected_t can_select, uint32_t id_type,
+                                uint32_t id, void *node_data,
+                                can_callback_t callback) {
+    if (can_select >= CAN_LIST_MAX_CAN_NUMBER) {
+        return 1;
+    }
+
+    if (can_table[can_select] == NULL) {
+        return 2;
+    }
+
+    if (id_type == CAN_ID_STD) {
+        id_type = STD_ID_TABLE;
+    } else if (id_type == CAN_ID_EXT) {
+        id_type = EXT_ID_TABLE;
+    } else {
+        return 3;
+    }
+
+    hash_table_t *table = &can_table[can_select]->id_table[id_type];
+
+    if (!can_list_writer_allowed()) {
+        return 6;
+    }
+
+    CAN_LIST_WRITER_LOCK();
+#if CAN_LIST_FIFO0_PRIORITY_LIMIT > 0
+    /* The node is freed after the last subscriber is removed, keep its
+       filter. */
+    can_node_t *node = can_list_find_node_by_id(table, id);
+    uint32_t id_mask = (node != NULL) ? node->id_mask : 0;
+    uint8_t fifo0_filter = (node != NULL) ? node->fifo0_filter : 0;
+#endif /* CAN_LIST_FIFO0_PRIORITY_LIMIT > 0 */
+
+    uint8_t res = can_list_remove_node(table, id, node_data, callback);
+
+#if CAN_LIST_FIFO0_PRIORITY_LIMIT > 0
+    if (res == 0) {
+        node = can_list_find_node_by_id(table, id);
+        if (node != NULL) {
+            can_list_update_filter(can_select, id_type, node);
+        } else if (fifo0_filter != 0) {
+            can_list_port_filter_remove(can_select,
+                                        CAN_LIST_TABLE_ID_TYPE(id_type), id,
+                                        id_mask);
+        }
+    }
+#endif /* CAN_LIST_FIFO0_PRIORITY_LIMIT > 0 */
+    CAN_LIST_WRITER_UNLOCK();
+
+    return res;
+}
+
+/**
+ * @brief Change the callback of the node. When the ID has more than one
+ *        subscriber, the subscriber with the highest priority is changed.
+ *
+ * @param can_select Specific which can to operate.
+ * @param id_type Specific which id table to operate.
+ * @param id Specific which node will be changed.
+ * @param new_callback New callback of this node to set.
+ * @return Operational status:
+ * @retval - 0: Success.
+ * @retval - 1: This CAN does not exists.
+ * @retval - 2: The specific CAN table is not created.
+ * @retval - 3: Parameter invaild.
+ * @retval - 4: Node does not exists.
+ * @retval - 5: Called in interrupt or subscriber callback.
+ */
+uint8_t can_list_change_callback(can_selected_t can_select, uint32_t id_type,
+                                 uint32_t id, can_callback_t new_callback) {
+    if (can_select >= CAN_LIST_MAX_CAN_NUMBER) {
+        return 1;
+    }
+
+    if (can_table[can_select] == NULL) {
+        return 2;
+    }
+
+    if (id_type == CAN_ID_STD) {
+        id_type = STD_ID_TABLE;
+    } else if (id_type == CAN_ID_EXT) {
+        id_type = EXT_ID_TABLE;
+    } else {
+        return 3;
+    }
+
+    hash_table_t *table = &can_table[can_select]->id_table[id_type];
+
+    if (!can_list_writer_allowed()) {
+        return 5;
+    }
+
+    CAN_LIST_WRITER_LOCK();
+    can_node_t *node = can_list_find_node_by_id(table, id);
+
+    if (node == NULL) {
+        CAN_LIST_WRITER_UNLOCK();
+        return 4;
+    }
+
+    /* Single store, readers call either the old or the new callback. */
+    node->subscribers->subs[0].callback = new_callback;
+    CAN_LIST_WRITER_UNLOCK();
+
     return 0;
 }
 
+/*
+ * @}
+ */
+
+/*****************************************************************************
+ * @defgroup Statistics functions.
+ * @{
+ */
+
 /**
- * @brief Adding a node to the CAN table.
+ * @brief Get the receive statistics of a node. Each counter is read
+ *        atomically, but the counters may not belong to the same frame. The
+ *        callback time is the maximum and sum of all subscribers. The static
+ *        nodes of the same ID are counted as subscribers of the node.
  *
- * @param can_select Specific which CAN will be added.
- * @param node_data The data pointer of this node.
- * @param id The id of this node.
- * @param id_mask The id mask of this node.
- * @param id_type The id type of this node.
- * @param callback The callback function of this node.
+ * @param can_select Specific which can to operate.
+ * @param id_type Specific which id table to operate.
+ * @param id Specific which node to read.
+ * @param[out] stats The statistics snapshot.
  * @return Operational status:
  * @retval - 0: Success.
  * @retval - 1: This CAN does not exists.
  * @retval - 2: The specific CAN table is not created.
  * @retval - 3: Parameter invaild.
- * @retval - 4: This ID already exists in the table.
- * @retval - 5: Memroy allocated failed.
+ * @retval - 4: Node does not exists.
+ * @retval - 5: Called in interrupt or subscriber callback.
  */
-uint8_t can_list_add_new_node(can_selected_t can_select, void *node_data,
-                              uint32_t id, uint32_t id_mask, uint32_t id_type,
-                              can_callback_t callback) {
+uint8_t can_list_get_node_stats(can_selected_t can_select, uint32_t id_type,
+                                uint32_t id, can_list_node_stats_t *stats) {
     if (can_select >= CAN_LIST_MAX_CAN_NUMBER) {
         return 1;
     }
@@ -194,51 +1223,72 @@ uint8_t can_list_add_new_node(can_selected_t can_select, void *node_data,
         return 3;
     }
 
-    if (callback == NULL) {
+    if (stats == NULL) {
         return 3;
     }
 
-    /* Specific hash table to insert. */
-    hash_table_t *table = &can_table[can_select]->id_table[id_type];
+    can_table_t *can = can_table[can_select];
+    uint32_t static_type = (id_type == STD_ID_TABLE) ? CAN_ID_STD : CAN_ID_EXT;
+    uint8_t found = 0;
+    can_static_entry_t *entry;
 
-    if (can_list_find_node_by_id(table, id) != NULL) {
-        return 4;
+    memset(stats, 0, sizeof(can_list_node_stats_t));
+
+    /* Static nodes never change, no lock is needed. */
+    for (uint32_t i = 0; i < can->static_count; ++i) {
+        entry = &can->static_nodes[i];
+
+        if ((entry->node->id_type != static_type) || (entry->node->id != id)) {
+            continue;
+        }
+
+        found = 1;
+        stats->rx_count = entry->stats.rx_count;
+        stats->last_timestamp = entry->stats.last_timestamp;
+        stats->total_cycles += entry->stats.total_cycles;
+        if (entry->stats.max_cycles > stats->max_cycles) {
+            stats->max_cycles = entry->stats.max_cycles;
+        }
     }
 
-    can_node_t *new_node = (can_node_t *)CAN_LIST_MALLOC(sizeof(can_node_t));
-    if (new_node == NULL) {
+    if (!can_list_writer_allowed()) {
         return 5;
     }
 
-    new_node->can_data = node_data;
-    new_node->id = id;
-    new_node->id_mask = id_mask;
-    new_node->callback = callback;
+    CAN_LIST_WRITER_LOCK();
+    can_node_t *node = can_list_find_node_by_id(&can->id_table[id_type], id);
 
-    /* Calculate the table index to insert. */
-    can_node_t **table_head = &(table->table[id % table->len]);
+    if (node != NULL) {
+        found = 1;
+        stats->rx_count = node->rx_count;
+        stats->last_timestamp = node->last_timestamp;
 
-    new_node->next = *table_head;
-    *table_head = new_node;
+        for (uint32_t i = 0; i < CAN_LIST_EXEC_NUMBER; ++i) {
+            stats->total_cycles += node->total_cycles[i];
+            if (node->max_cycles[i] > stats->max_cycles) {
+                stats->max_cycles = node->max_cycles[i];
+            }
+        }
+    }
+    CAN_LIST_WRITER_UNLOCK();
 
-    return 0;
+    return found ? 0 : 4;
 }
 
 /**
- * @brief Delete node by data pointer.
+ * @brief Get the receive statistics of a CAN. The error counters are read
+ *        from the CAN error status register.
  *
- * @param can_select Specific which can to operate.
- * @param id_type Specific which id table to operate.
- * @param id Specific which node will be deleted.
+ * @param can_select Specific which can to read.
+ * @param[out] stats The statistics snapshot.
  * @return Operational status:
  * @retval - 0: Success.
  * @retval - 1: This CAN does not exists.
  * @retval - 2: The specific CAN table is not created.
  * @retval - 3: Parameter invaild.
- * @retval - 4: Node does not exists.
  */
-uint8_t can_list_del_node_by_id(can_selected_t can_select, uint32_t id_type,
-                                uint32_t id) {
+uint8_t can_list_get_bus_stats(can_selected_t can_select,
+                               can_list_bus_stats_t *stats) {
     if (can_select >= CAN_LIST_MAX_CAN_NUMBER) {
         return 1;
     }
@@ -247,57 +1297,35 @@ uint8_t can_list_del_node_by_id(can_selected_t can_select, uint32_t id_type,
         return 2;
     }
 
-    if (id_type == CAN_ID_STD) {
-        id_type = STD_ID_TABLE;
-    } else if (id_type == CAN_ID_EXT) {
-        id_type = EXT_ID_TABLE;
-    } else {
+    if (stats == NULL) {
         return 3;
     }
 
-    hash_table_t *table = &can_table[can_select]->id_table[id_type];
-    can_node_t **list_head = &table->table[id % table->len];
-
-    can_node_t *current_node = *list_head;
-    can_node_t *previous_node = *list_head;
-
-    while ((current_node != NULL) && (current_node->id != id)) {
-        previous_node = current_node;
-        current_node = current_node->next;
-    }
-
-    if (current_node == NULL) {
-        /* The node does not exist */
-        return 4;
-    }
+    memset(stats, 0, sizeof(can_list_bus_stats_t));
 
-    if (previous_node == current_node) {
-        *list_head = previous_node->next;
+    for (uint8_t i = 0; i < 2; ++i) {
+        stats->rx_total += can_table[can_select]->fifo[i].rx_total;
+        stats->rx_unmatched += can_table[can_select]->fifo[i].rx_unmatched;
+        stats->ring_dropped += can_table[can_select]->fifo[i].ring_dropped;
+        stats->fifo_overrun += can_table[can_select]->fifo[i].fifo_overrun;
     }
 
-    previous_node->next = current_node->next;
-
-    CAN_LIST_FREE(current_node);
+    can_list_port_get_error(can_select, stats);
 
     return 0;
 }
 
 /**
- * @brief Delete node by data pointer.
+ * @brief Clear the receive statistics of a CAN and all its nodes.
  *
- * @param can_select Specific which can to operate.
- * @param id_type Specific which id table to operate.
- * @param id Specific which node will be deleted.
- * @param new_callback New callback of this node to set.
+ * @param can_select Specific which can to clear.
  * @return Operational status:
  * @retval - 0: Success.
  * @retval - 1: This CAN does not exists.
  * @retval - 2: The specific CAN table is not created.
- * @retval - 3: Parameter invaild.
- * @retval - 4: Node does not exists.
+ * @retval - 3: Called in interrupt or subscriber callback.
  */
-uint8_t can_list_change_callback(can_selected_t can_select, uint32_t id_type,
-                                 uint32_t id, can_callback_t new_callback) {
+uint8_t can_list_clear_stats(can_selected_t can_select) {
     if (can_select >= CAN_LIST_MAX_CAN_NUMBER) {
         return 1;
     }
@@ -306,28 +1334,42 @@ uint8_t can_list_change_callback(can_selected_t can_select, uint32_t id_type,
         return 2;
     }
 
-    if (id_type == CAN_ID_STD) {
-        id_type = STD_ID_TABLE;
-    } else if (id_type == CAN_ID_EXT) {
-        id_type = EXT_ID_TABLE;
-    } else {
-        return 3;
+    for (uint8_t i = 0; i < 2; ++i) {
+        can_table[can_select]->fifo[i].rx_total = 0;
+        can_table[can_select]->fifo[i].rx_unmatched = 0;
+        can_table[can_select]->fifo[i].ring_dropped = 0;
+        can_table[can_select]->fifo[i].fifo_overrun = 0;
     }
 
-    hash_table_t *table = &can_table[can_select]->id_table[id_type];
-
-    can_node_t *node = can_list_find_node_by_id(table, id);
+    for (uint32_t i = 0; i < can_table[can_select]->static_count; ++i) {
+        memset(&can_table[can_select]->static_nodes[i].stats, 0,
+               sizeof(can_list_node_stats_t));
+    }
 
-    if (node == NULL) {
-        return 4;
+    if (!can_list_writer_allowed()) {
+        return 3;
     }
 
-    node->callback = new_callback;
+    CAN_LIST_WRITER_LOCK();
+    for (uint8_t i = 0; i < 2; ++i) {
+        hash_table_t *table = &can_table[can_select]->id_table[i];
+
+        for (uint32_t j = 0; j < table->len; ++j) {
+            for (can_node_t *node = table->table[j]; node != NULL;
+                 node = node->next) {
+                node->rx_count = 0;
+                node->last_timestamp = 0;
+                memset(node->max_cycles, 0, sizeof(node->max_cycles));
+                memset(node->total_cycles, 0, sizeof(node->total_cycles));
+            }
+        }
+    }
+    CAN_LIST_WRITER_UNLOCK();
 
     return 0;
 }
 
-/*
+/**
  * @}
  */
 
@@ -336,306 +1378,374 @@ uint8_t can_list_change_callback(can_selected_t can_select, uint32_t id_type,
  * @{
  */
 
-#if CAN_LIST_USE_RTOS
-
 /**
- * @brief CAN list polling task.
+ * @brief Read a frame from the hardware FIFO and take the timestamp.
  *
- * @param args Start arguments.
+ * @param hcan The handle of CAN.
+ * @param rx_fifo Specific which FIFO will read.
+ * @param[out] frame The frame read from the CAN.
+ * @return Read status:
+ * @retval - 0: Success.
+ * @retval - 1: Read failed.
  */
-void can_list_polling_task(void *args) {
-    UNUSED(args);
-#if CAN_LIST_USE_FDCAN
-    /* The rx header read from the CAN. */
-    static FDCAN_RxHeaderTypeDef rx_header;
-    /* The rx data read from the CAN. */
-    static uint8_t rx_data[64];
-#else  /* CAN_LIST_USE_FDCAN */
-    /* The rx header read from the CAN. */
-    static CAN_RxHeaderTypeDef rx_header;
-    /* The rx data read from the CAN. */
-    static uint8_t rx_data[8];
-#endif /* CAN_LIST_USE_FDCAN */
+static inline uint8_t can_list_read_frame(can_list_handle_t *hcan,
+                                          uint32_t rx_fifo,
+                                          can_list_frame_t *frame) {
+    uint32_t timestamp = CAN_LIST_GET_TIMESTAMP();
+
+    if (can_list_port_read(hcan, rx_fifo, &frame->header, frame->data) != 0) {
+        return 1;
+    }
 
-    /* The rx header to callback function. */
-    static can_rx_header_t call_rx_header;
+    frame->header.timestamp = timestamp;
 
-    uint32_t id = 0x00;
-    hash_table_t *table = NULL;
-    can_node_t *node = NULL;
+    return 0;
+}
 
-    can_selected_t can_received;
+/**
+ * @brief Find the node by CAN ID.
+ *
+ * @param can_received Which CAN received the frame.
+ * @param header The header of frame received.
+ * @return The node matched, `NULL` if not found.
+ */
+static can_node_t *can_list_lookup(uint8_t can_received,
+                                   const can_rx_header_t *header) {
+    hash_table_t *table;
+    uint32_t id = header->id;
 
-    queue_msg_t recv_msg;
+    if (header->id_type == CAN_LIST_RX_ID_STD) {
+        table = &can_table[can_received]->id_table[STD_ID_TABLE];
+    } else {
+        table = &can_table[can_received]->id_table[EXT_ID_TABLE];
+    }
 
-    while (1) {
-        xQueueReceive(can_list_queue_handle, &recv_msg, portMAX_DELAY);
+    can_node_t *node = table->table[id % table->len];
 
-#if CAN_LIST_USE_FDCAN
+    while ((node != NULL) && (node->id) != (id & node->id_mask)) {
+        node = node->next;
+    }
 
-        switch ((uintptr_t)(recv_msg.hcan->Instance)) {
-#if FDCAN1_ENABLE
-            case FDCAN1_BASE: {
-                can_received = can1_selected;
-            } break;
-#endif /* FDCAN1_ENABLE */
-
-#if FDCAN2_ENABLE
-            case FDCAN2_BASE: {
-                can_received = can2_selected;
-            } break;
-#endif /* FDCAN2_ENABLE */
-
-#if FDCAN3_ENABLE
-            case FDCAN3_BASE: {
-                can_received = can3_selected;
-            } break;
-#endif /* FDCAN3_ENABLE */
-
-            default:
-                continue;
-        }
+    return node;
+}
 
-        if (HAL_FDCAN_GetRxMessage(recv_msg.hcan, recv_msg.rx_fifo, &rx_header,
-                                   rx_data) != HAL_OK) {
+/**
+ * @brief Call the subscribers of the node in priority order.
+ *
+ * @param node The node matched.
+ * @param frame The frame received.
+ * @param exec_class Only call the subscribers of this execution class.
+ */
+static void can_list_call_subscribers(can_node_t *node,
+                                      can_list_frame_t *frame,
+                                      can_list_exec_t exec_class) {
+    subscriber_list_t *list = node->subscribers;
+    can_subscriber_t *sub;
+    uint32_t start, cycles;
+
+    for (uint32_t i = 0; i < list->count; ++i) {
+        sub = &list->subs[i];
+
+        if ((CAN_LIST_EXEC_CLASS(sub->priority) != exec_class) ||
+            (sub->callback == NULL)) {
             continue;
         }
 
-        if (rx_header.IdType == FDCAN_STANDARD_ID) {
-            table = &can_table[can_received]->id_table[STD_ID_TABLE];
-        } else {
-            table = &can_table[can_received]->id_table[EXT_ID_TABLE];
+        start = CAN_LIST_GET_TIMESTAMP();
+        sub->callback(sub->can_data, &frame->header, frame->data);
+        cycles = CAN_LIST_GET_TIMESTAMP() - start;
+
+        node->total_cycles[exec_class] += cycles;
+        if (cycles > node->max_cycles[exec_class]) {
+            node->max_cycles[exec_class] = cycles;
         }
-        id = rx_header.Identifier;
+    }
+}
+
+/**
+ * @brief Call a static node, and count the frame by `CAN_LIST_COUNT_CLASS`.
+ *
+ * @param entry The static node matched.
+ * @param frame The frame received.
+ * @param exec_class Only call the node of this execution class.
+ */
+static inline void can_list_call_static_entry(can_static_entry_t *entry,
+                                              can_list_frame_t *frame,
+                                              can_list_exec_t exec_class) {
+    const can_list_static_node_t *node = entry->node;
+    uint32_t start, cycles;
+
+    if (exec_class == CAN_LIST_COUNT_CLASS) {
+        ++entry->stats.rx_count;
+        entry->stats.last_timestamp = frame->header.timestamp;
+    }
 
-        node = table->table[id % table->len];
+    if (CAN_LIST_EXEC_CLASS(node->priority) != exec_class) {
+        return;
+    }
 
-        while ((node != NULL) && (node->id) != (id & node->id_mask)) {
-            node = node->next;
-        }
+    start = CAN_LIST_GET_TIMESTAMP();
+    node->callback(node->can_data, &frame->header, frame->data);
+    cycles = CAN_LIST_GET_TIMESTAMP() - start;
 
-        if (node == NULL || node->callback == NULL) {
-            continue;
+    entry->stats.total_cycles += cycles;
+    if (cycles > entry->stats.max_cycles) {
+        entry->stats.max_cycles = cycles;
+    }
+}
+
+/**
+ * @brief Call the static nodes matched the frame. The nodes matching the
+ *        whole ID are found by binary search, then the masked nodes are
+ *        checked one by one.
+ *
+ * @param can_received Which CAN received the frame.
+ * @param frame The frame received.
+ * @param exec_class Only call the nodes of this execution class.
+ * @return Whether any static node matched:
+ * @retval - 0: Not matched.
+ * @retval - 1: Matched.
+ */
+static uint8_t can_list_call_static(uint8_t can_received,
+                                    can_list_frame_t *frame,
+                                    can_list_exec_t exec_class) {
+    can_table_t *table = can_table[can_received];
+    uint8_t matched = 0;
+    uint32_t id = frame->header.id;
+    uint32_t id_type = frame->header.id_type;
+    can_static_entry_t *entry;
+
+    for (uint32_t i = can_list_static_find(table, id_type, id);
+         i < table->static_exact; ++i) {
+        entry = &table->static_nodes[i];
+
+        if (can_list_static_compare(entry->node, id_type, id) != 0) {
+            break;
         }
 
-        call_rx_header.id_type = rx_header.IdType;
-        call_rx_header.frame_type = rx_header.RxFrameType;
-        call_rx_header.data_length = rx_header.DataLength;
+        matched = 1;
+        can_list_call_static_entry(entry, frame, exec_class);
+    }
 
-#else /* CAN_LIST_USE_FDCAN */
-        switch ((uintptr_t)(recv_msg.hcan->Instance)) {
-#if CAN1_ENABLE
-            case CAN1_BASE: {
-                can_received = can1_selected;
-            } break;
-#endif /* CAN1_ENABLE */
-
-#if CAN2_ENABLE
-            case CAN2_BASE: {
-                can_received = can2_selected;
-            } break;
-#endif /* CAN2_ENABLE */
-
-#if CAN3_ENABLE
-            case CAN3_BASE: {
-                can_received = can3_selected;
-            } break;
-#endif /* CAN3_ENABLE */
-
-            default:
-                continue;
-        }
+    for (uint32_t i = table->static_exact; i < table->static_count; ++i) {
+        entry = &table->static_nodes[i];
 
-        if (HAL_CAN_GetRxMessage(recv_msg.hcan, recv_msg.rx_fifo, &rx_header,
-                                 rx_data) != HAL_OK) {
+        if ((entry->node->id_type != id_type) ||
+            (entry->node->id != (id & entry->node->id_mask))) {
             continue;
         }
 
-        /* Enable the notification. */
-        if (recv_msg.rx_fifo == CAN_RX_FIFO0) {
-            HAL_CAN_ActivateNotification(recv_msg.hcan,
-                                         CAN_IT_RX_FIFO0_MSG_PENDING);
-        } else {
-            HAL_CAN_ActivateNotification(recv_msg.hcan,
-                                         CAN_IT_RX_FIFO1_MSG_PENDING);
-        }
+        matched = 1;
+        can_list_call_static_entry(entry, frame, exec_class);
+    }
 
-        if (rx_header.IDE == CAN_ID_STD) {
-            table = &can_table[can_received]->id_table[STD_ID_TABLE];
-            id = rx_header.StdId;
-        } else {
-            table = &can_table[can_received]->id_table[EXT_ID_TABLE];
-            id = rx_header.ExtId;
+    return matched;
+}
+
+/**
+ * @brief Find the node by CAN ID and call the subscribers. The node is
+ *        counted only by `CAN_LIST_COUNT_CLASS`.
+ *
+ * @param can_received Which CAN received the frame.
+ * @param frame The frame received.
+ * @param exec_class Only call the subscribers of this execution class.
+ * @return Whether any node matched:
+ * @retval - 0: Not matched.
+ * @retval - 1: Matched.
+ */
+static uint8_t can_list_dispatch(uint8_t can_received,
+                                 can_list_frame_t *frame,
+                                 can_list_exec_t exec_class) {
+    uint8_t matched = can_list_call_static(can_received, frame, exec_class);
+    uint32_t group = can_list_read_lock();
+    can_node_t *node = can_list_lookup(can_received, &frame->header);
+
+    if (node != NULL) {
+        if (exec_class == CAN_LIST_COUNT_CLASS) {
+            ++node->rx_count;
+            node->last_timestamp = frame->header.timestamp;
         }
 
-        node = table->table[id % table->len];
+        can_list_call_subscribers(node, frame, exec_class);
+        matched = 1;
+    }
 
-        while ((node != NULL) && (node->id) != (id & node->id_mask)) {
-            node = node->next;
-        }
+    can_list_read_unlock(group);
 
-        if (node == NULL || node->callback == NULL) {
-            continue;
-        }
+    return matched;
+}
 
-        call_rx_header.id_type = rx_header.IDE;
-        call_rx_header.frame_type = rx_header.RTR;
-        call_rx_header.data_length = rx_header.DLC;
+#if CAN_LIST_USE_RTOS
 
-#endif /* CAN_LIST_USE_FDCAN */
+/**
+ * @brief CAN list polling task. Process all the frames in the rings after
+ *        notified by the interrupt, the ring of FIFO0 first.
+ *
+ * @param args Start arguments, `(can_select << 8) | worker`. `can_select` is
+ *        `CAN_LIST_MAX_CAN_NUMBER` when this task serves all the CANs.
+ */
+void can_list_polling_task(void *args) {
+    uint8_t can_select = (uint8_t)((uintptr_t)args >> 8);
+    uint8_t worker = (uint8_t)((uintptr_t)args & 0xFF);
+    can_list_exec_t exec_class = (can_list_exec_t)(worker + can_list_exec_high);
 
-        call_rx_header.id = id;
+    uint8_t first = (can_select < CAN_LIST_MAX_CAN_NUMBER) ? can_select : 0;
+    uint8_t last = (can_select < CAN_LIST_MAX_CAN_NUMBER)
+                       ? can_select
+                       : (CAN_LIST_MAX_CAN_NUMBER - 1);
 
-        node->callback(node->can_data, &call_rx_header, rx_data);
+    frame_ring_t *ring;
+    uint32_t head;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        for (uint8_t i = first; i <= last; ++i) {
+            if (can_table[i] == NULL) {
+                continue;
+            }
+
+            for (uint8_t j = 0; j < 2; ++j) {
+                ring = &can_table[i]->fifo[j].ring[worker];
+                head = ring->head;
+
+                while (head != ring->tail) {
+                    /* Read the frame after the tail index is observed. */
+                    CAN_LIST_DMB();
+                    can_list_dispatch(
+                        i, &ring->frames[head & (CAN_LIST_RING_LENGTH - 1)],
+                        exec_class);
+                    ++head;
+                    ring->head = head;
+                }
+            }
+        }
     }
 }
 
-#else /* CAN_LIST_USE_RTOS */
+/**
+ * @brief Get the free slot of frame ring.
+ *
+ * @param ring The frame ring.
+ * @return The free slot, `NULL` if the ring is full.
+ */
+static inline can_list_frame_t *can_list_ring_reserve(frame_ring_t *ring) {
+    uint32_t tail = ring->tail;
 
-#if CAN_LIST_USE_FDCAN
+    if (tail - ring->head >= CAN_LIST_RING_LENGTH) {
+        return NULL;
+    }
+
+    return &ring->frames[tail & (CAN_LIST_RING_LENGTH - 1)];
+}
 
 /**
- * @brief Process the can message and call the function by FDCAN ID.
+ * @brief Publish the slot got by `can_list_ring_reserve`.
  *
- * @param hcan The handle of FDCAN.
- * @param rx_fifo Specific which FIFO will read.
+ * @param ring The frame ring.
  */
-static void can_message_process(FDCAN_HandleTypeDef *hcan, uint32_t rx_fifo) {
+static inline void can_list_ring_commit(frame_ring_t *ring) {
+    /* The frame must be written before the tail index is published. */
+    CAN_LIST_DMB();
+    ring->tail = ring->tail + 1;
+}
 
-#else /* CAN_LIST_USE_FDCAN */
+#endif /* CAN_LIST_USE_RTOS */
 
 /**
- * @brief Process the can message and call the function by CAN ID.
+ * @brief Process the CAN message in the interrupt, called by the port.
+ *        Without RTOS, the callback is called here. With RTOS, the frame is
+ *        pushed into the frame ring and the processing task is notified.
  *
  * @param hcan The handle of CAN.
  * @param rx_fifo Specific which FIFO will read.
  */
-static void can_message_process(CAN_HandleTypeDef *hcan, uint32_t rx_fifo) {
-
-#endif /* CAN_LIST_USE_FDCAN */
+void can_list_rx_process(can_list_handle_t *hcan, uint32_t rx_fifo) {
+    uint8_t can_received = can_list_port_identify(hcan);
 
-    uint8_t can_received = CAN_LIST_MAX_CAN_NUMBER;
+#if CAN_LIST_USE_RTOS
+    /* Frames can not be stored, read to release the hardware FIFO. On the
+       stack, the interrupts of other CANs may preempt this one. */
+    can_list_frame_t discard_frame;
+
+    if ((can_received >= CAN_LIST_MAX_CAN_NUMBER) ||
+        (can_table[can_received] == NULL) ||
+        (can_table[can_received]->worker[0] == NULL)) {
+        can_list_read_frame(hcan, rx_fifo, &discard_frame);
+        return;
+    }
 
-#if CAN_LIST_USE_FDCAN
+    can_table_t *table = can_table[can_received];
+    can_list_fifo_t *fifo = &table->fifo[CAN_LIST_FIFO_INDEX(rx_fifo)];
 
-    switch ((uintptr_t)(hcan->Instance)) {
-#if FDCAN1_ENABLE
-        case FDCAN1_BASE: {
-            can_received = can1_selected;
-        } break;
-#endif /* FDCAN1_ENABLE */
+    if (can_list_port_check_overrun(hcan, rx_fifo)) {
+        ++fifo->fifo_overrun;
+    }
 
-#if FDCAN2_ENABLE
-        case FDCAN2_BASE: {
-            can_received = can2_selected;
-        } break;
-#endif /* FDCAN2_ENABLE */
+    /* Read to the first ring directly, or drop it if the ring is full. */
+    can_list_frame_t *frame = can_list_ring_reserve(&fifo->ring[0]);
+    if (frame == NULL) {
+        frame = &discard_frame;
+    }
 
-#if FDCAN3_ENABLE
-        case FDCAN3_BASE: {
-            can_received = can3_selected;
-        } break;
-#endif /* FDCAN3_ENABLE */
+    if (can_list_read_frame(hcan, rx_fifo, frame) != 0) {
+        return;
+    }
 
-        default:
-            return;
+    /* Count every frame here, even if the rings are full. */
+    ++fifo->rx_total;
+    if (can_list_dispatch(can_received, frame, can_list_exec_isr) == 0) {
+        ++fifo->rx_unmatched;
     }
 
-#else /* CAN_LIST_USE_FDCAN */
+    BaseType_t higher_priority_task_woken = pdFALSE;
+    can_list_frame_t *slot;
 
-    /* Specific which CAN had received message. */
-    switch ((uintptr_t)(hcan->Instance)) {
-#if CAN1_ENABLE
-        case CAN1_BASE: {
-            can_received = can1_selected;
-        } break;
-#endif /* CAN1_ENABLE */
+    for (uint8_t i = 0; i < CAN_LIST_WORKER_NUMBER; ++i) {
+        slot = can_list_ring_reserve(&fifo->ring[i]);
+        if (slot == NULL) {
+            ++fifo->ring_dropped;
+            continue;
+        }
 
-#if CAN2_ENABLE
-        case CAN2_BASE: {
-            can_received = can2_selected;
-        } break;
-#endif /* CAN2_ENABLE */
+        if (slot != frame) {
+            memcpy(slot, frame, sizeof(can_list_frame_t));
+        }
 
-#if CAN3_ENABLE
-        case CAN3_BASE: {
-            can_received = can3_selected;
-        } break;
-#endif /* CAN3_ENABLE */
+        can_list_ring_commit(&fifo->ring[i]);
 
-        default:
-            return;
+        if (table->worker[i] != NULL) {
+            vTaskNotifyGiveFromISR(table->worker[i],
+                                   &higher_priority_task_woken);
+        }
     }
 
-#endif /* CAN_LIST_USE_FDCAN */
-
-    /* The rx header to callback function. */
-    static can_rx_header_t call_rx_header;
-
-    /* Specific hash table will search. */
-    uint32_t id;
-    hash_table_t *table;
+    portYIELD_FROM_ISR(higher_priority_task_woken);
+#else  /* CAN_LIST_USE_RTOS */
+    can_list_frame_t frame;
 
-#if CAN_LIST_USE_FDCAN
-    /* The rx header read from the CAN. */
-    static FDCAN_RxHeaderTypeDef rx_header;
-    /* The rx data read from the CAN. */
-    static uint8_t rx_data[64];
-    if (HAL_FDCAN_GetRxMessage(hcan, rx_fifo, &rx_header, rx_data) != HAL_OK) {
+    if (can_list_read_frame(hcan, rx_fifo, &frame) != 0) {
         return;
     }
 
-    if (rx_header.IdType == FDCAN_STANDARD_ID) {
-        table = &can_table[can_received]->id_table[STD_ID_TABLE];
-
-    } else {
-        table = &can_table[can_received]->id_table[EXT_ID_TABLE];
-    }
-    id = rx_header.Identifier;
-#else  /* CAN_LIST_USE_FDCAN */
-    /* The rx header read from the CAN. */
-    static CAN_RxHeaderTypeDef rx_header;
-    /* The rx data read from the CAN. */
-    static uint8_t rx_data[8];
-    if (HAL_CAN_GetRxMessage(hcan, rx_fifo, &rx_header, rx_data) != HAL_OK) {
+    if ((can_received >= CAN_LIST_MAX_CAN_NUMBER) ||
+        (can_table[can_received] == NULL)) {
         return;
     }
 
-    if (rx_header.IDE == CAN_ID_STD) {
-        table = &can_table[can_received]->id_table[STD_ID_TABLE];
-        id = rx_header.StdId;
-    } else {
-        table = &can_table[can_received]->id_table[EXT_ID_TABLE];
-        id = rx_header.ExtId;
-    }
-#endif /* CAN_LIST_USE_FDCAN */
-
-    can_node_t *node = table->table[id % table->len];
+    can_list_fifo_t *fifo =
+        &can_table[can_received]->fifo[CAN_LIST_FIFO_INDEX(rx_fifo)];
 
-    while ((node != NULL) && (node->id) != (id & node->id_mask)) {
-        node = node->next;
+    if (can_list_port_check_overrun(hcan, rx_fifo)) {
+        ++fifo->fifo_overrun;
     }
 
-    if (node == NULL || node->callback == NULL) {
-        return;
+    ++fifo->rx_total;
+    if (can_list_dispatch(can_received, &frame, can_list_exec_isr) == 0) {
+        ++fifo->rx_unmatched;
     }
-
-    call_rx_header.id = id;
-
-#if CAN_LIST_USE_FDCAN
-    call_rx_header.id_type = rx_header.IdType;
-    call_rx_header.frame_type = rx_header.RxFrameType;
-    call_rx_header.data_length = rx_header.DataLength;
-#else  /* CAN_LIST_USE_FDCAN */
-    call_rx_header.id_type = rx_header.IDE;
-    call_rx_header.frame_type = rx_header.RTR;
-    call_rx_header.data_length = rx_header.DLC;
-#endif /* CAN_LIST_USE_FDCAN */
-
-    node->callback(node->can_data, &call_rx_header, rx_data);
-}
-
 #endif /* CAN_LIST_USE_RTOS */
+}
 
 /**
  * @}
@@ -646,11 +1756,13 @@ static void can_message_process(CAN_HandleTypeDef *hcan, uint32_t rx_fifo) {
  * @{
  */
 
+#if !defined(CAN_LIST_PORT_HOST)
+
 #if CAN_LIST_USE_FDCAN
 
 /**
  * @brief Rx FIFO 0 callback.
- * 
+ *
  * @param hfdcan pointer to an FDCAN_HandleTypeDef structure that contains
  *        the configuration information for the specified FDCAN.
  * @param RxFifo0ITs indicates which Rx FIFO 0 interrupts are signaled.
@@ -662,18 +1774,9 @@ void HAL_FDCAN_RxFifo0Callback(FDCAN_HandleTypeDef *hfdcan,
         return;
     }
 
-#if CAN_LIST_USE_RTOS
-    if (can_list_queue_handle == NULL) {
-        return;
-    }
-
-    send_msg_from_isr.hcan = hfdcan;
-    send_msg_from_isr.rx_fifo = FDCAN_RX_FIFO0;
-    xQueueSendFromISR(can_list_queue_handle, &send_msg_from_isr, NULL);
-#else  /* CAN_LIST_USE_RTOS */
-    can_message_process(hfdcan, FDCAN_RX_FIFO0);
-#endif /* CAN_LIST_USE_RTOS */
+    can_list_rx_process(hfdcan, FDCAN_RX_FIFO0);
 }
+
 /**
  * @brief Rx FIFO 1 callback.
  *
@@ -688,38 +1791,18 @@ void HAL_FDCAN_RxFifo1Callback(FDCAN_HandleTypeDef *hfdcan,
         return;
     }
 
-#if CAN_LIST_USE_RTOS
-    if (can_list_queue_handle == NULL) {
-        return;
-    }
-
-    send_msg_from_isr.hcan = hfdcan;
-    send_msg_from_isr.rx_fifo = FDCAN_RX_FIFO1;
-    xQueueSendFromISR(can_list_queue_handle, &send_msg_from_isr, NULL);
-#else  /* CAN_LIST_USE_RTOS */
-    can_message_process(hfdcan, FDCAN_RX_FIFO1);
-#endif /* CAN_LIST_USE_RTOS */
+    can_list_rx_process(hfdcan, FDCAN_RX_FIFO1);
 }
 
 #else /* CAN_LIST_USE_FDCAN */
+
 /**
  * @brief Rx FIFO 0 message pending callback.
  *
  * @param hcan The handle of CAN.
  */
 void HAL_CAN_RxFifo0MsgPendingCallback(CAN_HandleTypeDef *hcan) {
-#if CAN_LIST_USE_RTOS
-    if (can_list_queue_handle == NULL) {
-        return;
-    }
-
-    send_msg_from_isr.hcan = hcan;
-    send_msg_from_isr.rx_fifo = CAN_RX_FIFO0;
-    xQueueSendFromISR(can_list_queue_handle, &send_msg_from_isr, NULL);
-    HAL_CAN_DeactivateNotification(hcan, CAN_IT_RX_FIFO0_MSG_PENDING);
-#else  /* CAN_LIST_USE_RTOS */
-    can_message_process(hcan, CAN_RX_FIFO0);
-#endif /* CAN_LIST_USE_RTOS */
+    can_list_rx_process(hcan, CAN_RX_FIFO0);
 }
 
 /**
@@ -728,21 +1811,12 @@ void HAL_CAN_RxFifo0MsgPendingCallback(CAN_HandleTypeDef *hcan) {
  * @param hcan The handle of CAN.
  */
 void HAL_CAN_RxFifo1MsgPendingCallback(CAN_HandleTypeDef *hcan) {
-#if CAN_LIST_USE_RTOS
-    if (can_list_queue_handle == NULL) {
-        return;
-    }
-
-    send_msg_from_isr.hcan = hcan;
-    send_msg_from_isr.rx_fifo = CAN_RX_FIFO1;
-    xQueueSendFromISR(can_list_queue_handle, &send_msg_from_isr, NULL);
-    HAL_CAN_DeactivateNotification(hcan, CAN_IT_RX_FIFO1_MSG_PENDING);
-#else  /* CAN_LIST_USE_RTOS */
-    can_message_process(hcan, CAN_RX_FIFO1);
-#endif /* CAN_LIST_USE_RTOS */
+    can_list_rx_process(hcan, CAN_RX_FIFO1);
 }
 
-#endif /* CAN_LIST_USE_RTOS */
+#endif /* CAN_LIST_USE_FDCAN */
+
+#endif /* CAN_LIST_PORT_HOST */
 
 /**
  * @}
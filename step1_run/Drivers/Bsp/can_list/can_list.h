@@ -15,23 +15,49 @@
 extern "C" {
 #endif /* __cplusplus */
 
+#if defined(CAN_LIST_PORT_HOST)
+#include "can_list_port_host.h"
+#else /* CAN_LIST_PORT_HOST */
 #include <CSP_Config.h>
+#endif /* CAN_LIST_PORT_HOST */
 
 /* Use FDCAN or bxCAN2.0. Determined by the chip. */
 #define CAN_LIST_USE_FDCAN      0
 
 #define CAN_LIST_MAX_CAN_NUMBER 3
 
+#ifndef CAN_LIST_MALLOC
 #define CAN_LIST_MALLOC(p)      malloc(p)
 #define CAN_LIST_CALLOC(x, p)   calloc(x, p)
 #define CAN_LIST_FREE(p)        free(p)
+#endif /* CAN_LIST_MALLOC */
+
+/* Priority of the node added by `can_list_add_new_node`, lower value is more
+   urgent. */
+#define CAN_LIST_DEFAULT_PRIORITY 0
+
+/**
+ * Nodes with a subscriber whose priority value is lower than this are routed
+ * to RX FIFO0 by a dedicated hardware filter, the other frames are received
+ * by the accept all filter on FIFO1. So the control feedback never queues
+ * behind the bulk traffic. When the filter banks run out, the node is still
+ * received by FIFO1.
+ *
+ * Each FIFO has its own frame rings and counters, so the RX0 interrupt can
+ * have higher NVIC priority and preempt RX1. The tasks process the frames
+ * of FIFO0 first.
+ *
+ * 0 means all the frames are received by the accept all filter.
+ */
+#define CAN_LIST_FIFO0_PRIORITY_LIMIT 1
 
 /**
  * When disabled, the message is processed in the interrupt.
  *
- * When enabled, a thread will be created to process the message. After
- * receiving the CAN message, a semaphore will be sent to the processing thread
- * to speed up the interrupt exit time.
+ * When enabled, a thread will be created to process the message. The
+ * interrupt reads the whole frame out of the hardware FIFO, pushes it into the
+ * frame ring of this CAN and wakes the processing thread with a task
+ * notification, so the hardware FIFO is released immediately.
  *
  * Attention: Only support FreeRTOS. You should modify the code if you want use
  * other RTOS.
@@ -42,9 +68,57 @@ extern "C" {
 #define CAN_LIST_TASK_NAME     "Can list"
 #define CAN_LIST_TASK_PRIORITY 2
 #define CAN_LSIT_TASK_STK_SIZE 256
-#define CAN_LIST_QUEUE_LENGTH  5
+/* Frame ring length of each CAN, must be power of 2. */
+#define CAN_LIST_RING_LENGTH   16
+
+/**
+ * Execution class of subscriber is determined by its priority value:
+ *  - lower than `CAN_LIST_ISR_PRIORITY_LIMIT`: called in the interrupt.
+ *  - lower than `CAN_LIST_BACKGROUND_PRIORITY_LIMIT`: called in the task
+ *    above (high priority task).
+ *  - others: called in the background task, if it is enabled.
+ *
+ * `CAN_LIST_ISR_PRIORITY_LIMIT` 0 means no subscriber is called in the
+ * interrupt. Each task has its own frame ring, so a slow background
+ * subscriber will not delay the others.
+ */
+#define CAN_LIST_ISR_PRIORITY_LIMIT        0
+#define CAN_LIST_USE_BACKGROUND_TASK       0
+#define CAN_LIST_BACKGROUND_PRIORITY_LIMIT 128
+
+#if CAN_LIST_USE_BACKGROUND_TASK
+#define CAN_LIST_BACKGROUND_TASK_NAME      "Can list bg"
+#define CAN_LIST_BACKGROUND_TASK_PRIORITY  1
+#define CAN_LIST_BACKGROUND_TASK_STK_SIZE  256
+#endif /* CAN_LIST_USE_BACKGROUND_TASK */
+
+/* Create the tasks for each CAN, otherwise the tasks serve all the CANs. */
+#define CAN_LIST_TASK_PER_CAN              0
 #endif /* CAN_LIST_USE_RTOS */
 
+/**
+ * Timestamp of the received message, it is taken in the interrupt and passed
+ * to the callback by `can_rx_header_t`. Default to the DWT cycle counter,
+ * which is enabled when adding a CAN.
+ */
+#ifndef CAN_LIST_GET_TIMESTAMP
+#define CAN_LIST_TIMESTAMP_INIT()                                              \
+    do {                                                                       \
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;                        \
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;                                   \
+    } while (0)
+#define CAN_LIST_GET_TIMESTAMP() (DWT->CYCCNT)
+#endif /* CAN_LIST_GET_TIMESTAMP */
+
+/**
+ * @brief Where the subscriber is called, see `CAN_LIST_ISR_PRIORITY_LIMIT`.
+ */
+typedef enum {
+    can_list_exec_isr = 0U,  /*!< Called in the interrupt.          */
+    can_list_exec_high,      /*!< Called in the high priority task. */
+    can_list_exec_background /*!< Called in the background task.    */
+} can_list_exec_t;
+
 /**
  * @brief Message header type. Compatibility with FDCAN.
  */
@@ -52,9 +126,34 @@ typedef struct {
     uint32_t id;         /*!< Message ID.                                     */
     uint32_t id_type;    /*!< ID type, `CAN_ID_STD` or `CAN_ID_EXT`.          */
     uint32_t frame_type; /*!< Frame type, `CAN_RTR_DATA` or `CAN_RTR_REMOTE`. */
-    uint8_t data_length; /*!< Message Data length.                            */
+    uint8_t data_length; /*!< Message Data length in bytes, 64 at most.       */
+    uint8_t flags;       /*!< `CAN_FRAME_FD`, `CAN_FRAME_BRS`.                */
+    uint32_t timestamp;  /*!< Receive timestamp, `CAN_LIST_GET_TIMESTAMP()`.  */
 } can_rx_header_t;
 
+/**
+ * @brief Receive statistics of a node.
+ */
+typedef struct {
+    uint32_t rx_count;       /*!< Frames dispatched to this node. */
+    uint32_t last_timestamp; /*!< Timestamp of the last frame.    */
+    uint32_t max_cycles;     /*!< Maximum callback time.          */
+    uint64_t total_cycles;   /*!< Accumulated callback time.      */
+} can_list_node_stats_t;
+
+/**
+ * @brief Receive statistics of a CAN.
+ */
+typedef struct {
+    uint32_t rx_total;       /*!< Frames received.                     */
+    uint32_t rx_unmatched;   /*!< Frames without a matched node.       */
+    uint32_t ring_dropped;   /*!< Frames dropped because ring is full. */
+    uint32_t fifo_overrun;   /*!< Hardware FIFO overrun times.         */
+    uint8_t tx_error_count;  /*!< Transmit error counter (TEC).        */
+    uint8_t rx_error_count;  /*!< Receive error counter (REC).         */
+    uint8_t last_error_code; /*!< Last error code (LEC).               */
+} can_list_bus_stats_t;
+
 /**
  * @brief CAN callback function pointer.
  *
@@ -66,17 +165,78 @@ typedef void (*can_callback_t)(void * /* node_obj */,
                                can_rx_header_t * /* can_rx_header */,
                                uint8_t * /* can_msg */);
 
+/**
+ * @brief Node registered at compile time, see `CAN_LIST_STATIC_NODE`.
+ */
+typedef struct {
+    can_selected_t can_select; /*!< Which CAN to receive.                */
+    uint32_t id_type;          /*!< ID type, `CAN_ID_STD` or `CAN_ID_EXT`. */
+    uint32_t id;               /*!< CAN ID.                              */
+    uint32_t id_mask;          /*!< CAN ID mask.                         */
+    can_callback_t callback;   /*!< CAN callback function.               */
+    void *can_data;            /*!< The CAN data of this node.           */
+    uint8_t priority;          /*!< Priority, same as subscriber.        */
+} can_list_static_node_t;
+
+#define CAN_LIST_CONCAT_(a, b) a##b
+#define CAN_LIST_CONCAT(a, b)  CAN_LIST_CONCAT_(a, b)
+
+/**
+ * Register a node at compile time. The node is placed in the linker section
+ * `can_list_static` in flash, no memory is allocated and it can not be
+ * deleted or changed at runtime. Static nodes are matched before the nodes
+ * added at runtime, the nodes of the same ID in link order. They are indexed
+ * by ID when `can_list_add_can` is called, and `can_list_get_node_stats`
+ * reports them as well.
+ *
+ * Example:
+ *   CAN_LIST_STATIC_NODE(can1_selected, 0x00, 0x7FF, CAN_ID_STD,
+ *                        motor_callback, &motor);
+ *
+ * Attention: Keep the section when linking, for armlink add
+ * `--keep=*(can_list_static)`.
+ */
+#define CAN_LIST_STATIC_NODE(can, id, mask, type, cb, obj)                     \
+    CAN_LIST_STATIC_NODE_PRIO(can, id, mask, type, cb, obj,                    \
+                              CAN_LIST_DEFAULT_PRIORITY)
+
+#define CAN_LIST_STATIC_NODE_PRIO(can, id, mask, type, cb, obj, prio)          \
+    __attribute__((used, section("can_list_static"),                          \
+                   aligned(__alignof__(can_list_static_node_t))))              \
+    static const can_list_static_node_t CAN_LIST_CONCAT(                       \
+        can_list_static_node_, __COUNTER__) = {(can), (type), (id), (mask),    \
+                                               (cb),  (obj),  (prio)}
+
 uint8_t can_list_add_can(can_selected_t can_select, uint32_t std_len,
                          uint32_t ext_len);
 
+/*
+ * Attention: The functions below modify the table or take the writer lock,
+ * call them from task (or main loop) context only. They are rejected with an
+ * error if called in an interrupt or in a subscriber callback, which would
+ * wait for itself to leave the table.
+ */
 uint8_t can_list_add_new_node(can_selected_t can_select, void *node_data,
                               uint32_t id, uint32_t id_mask, uint32_t id_type,
                               can_callback_t callback);
+uint8_t can_list_add_subscriber(can_selected_t can_select, void *node_data,
+                                uint32_t id, uint32_t id_mask,
+                                uint32_t id_type, can_callback_t callback,
+                                uint8_t priority);
 uint8_t can_list_del_node_by_id(can_selected_t can_select, uint32_t id_type,
                                 uint32_t id);
+uint8_t can_list_del_subscriber(can_selected_t can_select, uint32_t id_type,
+                                uint32_t id, void *node_data,
+                                can_callback_t callback);
 uint8_t can_list_change_callback(can_selected_t can_select, uint32_t id_type,
                                  uint32_t id, can_callback_t new_callback);
 
+uint8_t can_list_get_node_stats(can_selected_t can_select, uint32_t id_type,
+                                uint32_t id, can_list_node_stats_t *stats);
+uint8_t can_list_get_bus_stats(can_selected_t can_select,
+                               can_list_bus_stats_t *stats);
+uint8_t can_list_clear_stats(can_selected_t can_select);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
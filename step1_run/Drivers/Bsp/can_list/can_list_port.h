@@ -0,0 +1,304 @@
+/**
+ * @file    can_list_port.h
+ * @author  Deadline039
+ * @brief   Hardware port of CAN list, only included by `can_list.c`.
+ * @version 1.0
+ * @date    2024-11-24
+ * @note    The port reads the frame from the hardware, tells which CAN the
+ *          handle belongs to, reports the error state and configures the
+ *          hardware filters. It calls
+ *          `can_list_rx_process` in the receive interrupt.
+ *
+ *          Define `CAN_LIST_PORT_HOST` to use the host port, which is
+ *          implemented by the CAN simulator in `Tools/can_list_host`.
+ */
+
+#ifndef __CAN_LIST_PORT_H
+#define __CAN_LIST_PORT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "can_list/can_list.h"
+
+#if defined(CAN_LIST_PORT_HOST)
+
+#include "can_sim.h"
+
+#else /* CAN_LIST_PORT_HOST */
+
+#if CAN_LIST_USE_FDCAN
+typedef FDCAN_HandleTypeDef can_list_handle_t;
+#define CAN_LIST_DATA_SIZE 64
+#define CAN_LIST_RX_ID_STD FDCAN_STANDARD_ID
+#define CAN_LIST_RX_FIFO0  FDCAN_RX_FIFO0
+#else /* CAN_LIST_USE_FDCAN */
+typedef CAN_HandleTypeDef can_list_handle_t;
+#define CAN_LIST_DATA_SIZE 8
+#define CAN_LIST_RX_ID_STD CAN_ID_STD
+#define CAN_LIST_RX_FIFO0  CAN_RX_FIFO0
+#endif /* CAN_LIST_USE_FDCAN */
+
+/* Memory barrier between the interrupt and the tasks. */
+#define CAN_LIST_DMB() __DMB()
+
+/* Whether running in an interrupt (or fault) handler. */
+#define CAN_LIST_IN_ISR() (__get_IPSR() != 0U)
+
+/**
+ * @brief Atomic add by LDREX/STREX, the store fails and is retried if the
+ *        read-modify-write is interrupted.
+ *
+ * @param ptr The variable to add.
+ * @param value The value to add, `(uint32_t)-1` to subtract.
+ */
+static inline void can_list_port_atomic_add(volatile uint32_t *ptr,
+                                            uint32_t value) {
+    uint32_t old;
+
+    do {
+        old = __LDREXW(ptr);
+    } while (__STREXW(old + value, ptr) != 0);
+}
+
+/**
+ * @brief Specific which CAN had received message.
+ *
+ * @param hcan The handle of CAN.
+ * @return The index of CAN, `CAN_LIST_MAX_CAN_NUMBER` if not exist.
+ */
+static inline uint8_t can_list_port_identify(can_list_handle_t *hcan) {
+    switch ((uintptr_t)(hcan->Instance)) {
+
+#if CAN_LIST_USE_FDCAN
+
+#if FDCAN1_ENABLE
+        case FDCAN1_BASE: {
+            return can1_selected;
+        }
+#endif /* FDCAN1_ENABLE */
+
+#if FDCAN2_ENABLE
+        case FDCAN2_BASE: {
+            return can2_selected;
+        }
+#endif /* FDCAN2_ENABLE */
+
+#if FDCAN3_ENABLE
+        case FDCAN3_BASE: {
+            return can3_selected;
+        }
+#endif /* FDCAN3_ENABLE */
+
+#else /* CAN_LIST_USE_FDCAN */
+
+#if CAN1_ENABLE
+        case CAN1_BASE: {
+            return can1_selected;
+        }
+#endif /* CAN1_ENABLE */
+
+#if CAN2_ENABLE
+        case CAN2_BASE: {
+            return can2_selected;
+        }
+#endif /* CAN2_ENABLE */
+
+#if CAN3_ENABLE
+        case CAN3_BASE: {
+            return can3_selected;
+        }
+#endif /* CAN3_ENABLE */
+
+#endif /* CAN_LIST_USE_FDCAN */
+
+        default: {
+        } break;
+    }
+
+    return CAN_LIST_MAX_CAN_NUMBER;
+}
+
+/**
+ * @brief Read a frame from the hardware FIFO.
+ *
+ * @param hcan The handle of CAN.
+ * @param rx_fifo Specific which FIFO will read.
+ * @param[out] header The header read, except the timestamp.
+ * @param[out] data The data read, `CAN_LIST_DATA_SIZE` bytes at most.
+ * @return Read status:
+ * @retval - 0: Success.
+ * @retval - 1: Read failed.
+ */
+static inline uint8_t can_list_port_read(can_list_handle_t *hcan,
+                                         uint32_t rx_fifo,
+                                         can_rx_header_t *header,
+                                         uint8_t *data) {
+#if CAN_LIST_USE_FDCAN
+    FDCAN_RxHeaderTypeDef rx_header;
+    if (HAL_FDCAN_GetRxMessage(hcan, rx_fifo, &rx_header, data) != HAL_OK) {
+        return 1;
+    }
+
+    /* Older HAL keeps the DLC in bits 16-19. */
+    uint32_t dlc = rx_header.DataLength;
+    if (dlc > 0x0FU) {
+        dlc >>= 16;
+    }
+
+    header->id = rx_header.Identifier;
+    header->id_type = rx_header.IdType;
+    header->frame_type = rx_header.RxFrameType;
+    header->data_length = can_dlc_to_len((uint8_t)dlc);
+    header->flags = 0;
+    if (rx_header.FDFormat == FDCAN_FD_CAN) {
+        header->flags |= CAN_FRAME_FD;
+    }
+    if (rx_header.BitRateSwitch == FDCAN_BRS_ON) {
+        header->flags |= CAN_FRAME_BRS;
+    }
+#else  /* CAN_LIST_USE_FDCAN */
+    CAN_RxHeaderTypeDef rx_header;
+    if (HAL_CAN_GetRxMessage(hcan, rx_fifo, &rx_header, data) != HAL_OK) {
+        return 1;
+    }
+
+    header->id =
+        (rx_header.IDE == CAN_ID_STD) ? rx_header.StdId : rx_header.ExtId;
+    header->id_type = rx_header.IDE;
+    header->frame_type = rx_header.RTR;
+    header->data_length = rx_header.DLC;
+    header->flags = 0;
+
+    can_meter_count_rx((can_selected_t)can_list_port_identify(hcan),
+                       rx_header.IDE, header->id, rx_header.RTR,
+                       (uint8_t)rx_header.DLC, data);
+    can_trace_count_rx((can_selected_t)can_list_port_identify(hcan),
+                       rx_header.IDE, header->id, rx_header.RTR,
+                       (uint8_t)rx_header.DLC, data);
+#endif /* CAN_LIST_USE_FDCAN */
+
+    return 0;
+}
+
+/**
+ * @brief Check and clear the overrun flag of the hardware FIFO.
+ *
+ * @param hcan The handle of CAN.
+ * @param rx_fifo Specific which FIFO will check.
+ * @return Whether the FIFO is overrun:
+ * @retval - 0: No overrun.
+ * @retval - 1: Overrun, some frames had lost.
+ */
+static inline uint8_t can_list_port_check_overrun(can_list_handle_t *hcan,
+                                                  uint32_t rx_fifo) {
+#if CAN_LIST_USE_FDCAN
+    uint32_t flag = (rx_fifo == FDCAN_RX_FIFO0)
+                        ? FDCAN_FLAG_RX_FIFO0_MESSAGE_LOST
+                        : FDCAN_FLAG_RX_FIFO1_MESSAGE_LOST;
+
+    if (__HAL_FDCAN_GET_FLAG(hcan, flag) == RESET) {
+        return 0;
+    }
+
+    __HAL_FDCAN_CLEAR_FLAG(hcan, flag);
+#else  /* CAN_LIST_USE_FDCAN */
+    uint32_t flag = (rx_fifo == CAN_RX_FIFO0) ? CAN_FLAG_FOV0 : CAN_FLAG_FOV1;
+
+    if (__HAL_CAN_GET_FLAG(hcan, flag) == RESET) {
+        return 0;
+    }
+
+    __HAL_CAN_CLEAR_FLAG(hcan, flag);
+#endif /* CAN_LIST_USE_FDCAN */
+
+    return 1;
+}
+
+/**
+ * @brief Read the error counters of the CAN.
+ *
+ * @param can_select Specific which CAN to read.
+ * @param[out] stats `tx_error_count`, `rx_error_count` and `last_error_code`
+ *             are filled.
+ */
+static inline void can_list_port_get_error(can_selected_t can_select,
+                                           can_list_bus_stats_t *stats) {
+#if CAN_LIST_USE_FDCAN
+    UNUSED(can_select);
+    UNUSED(stats);
+#else  /* CAN_LIST_USE_FDCAN */
+    CAN_HandleTypeDef *hcan = can_get_handle(can_select);
+    if (hcan == NULL) {
+        return;
+    }
+
+    uint32_t esr = hcan->Instance->ESR;
+    stats->tx_error_count = (esr & CAN_ESR_TEC) >> CAN_ESR_TEC_Pos;
+    stats->rx_error_count = (esr & CAN_ESR_REC) >> CAN_ESR_REC_Pos;
+    stats->last_error_code = (esr & CAN_ESR_LEC) >> CAN_ESR_LEC_Pos;
+#endif /* CAN_LIST_USE_FDCAN */
+}
+
+/**
+ * @brief Route the frames of the ID to RX FIFO0 by a dedicated filter.
+ *
+ * @param can_select Specific which CAN.
+ * @param id_type `CAN_ID_STD` or `CAN_ID_EXT`.
+ * @param id The ID of the node.
+ * @param id_mask The ID mask of the node.
+ * @return Operational status:
+ * @retval - 0: Success.
+ * @retval - 1: Failed, no filter bank is free or not supported.
+ */
+static inline uint8_t can_list_port_filter_add(can_selected_t can_select,
+                                               uint32_t id_type, uint32_t id,
+                                               uint32_t id_mask) {
+#if CAN_LIST_USE_FDCAN
+    UNUSED(can_select);
+    UNUSED(id_type);
+    UNUSED(id);
+    UNUSED(id_mask);
+
+    return 1;
+#else  /* CAN_LIST_USE_FDCAN */
+    if (can_filter_add(can_select, id_type, id, id_mask, CAN_FILTER_FIFO0) !=
+        0) {
+        return 1;
+    }
+
+    return 0;
+#endif /* CAN_LIST_USE_FDCAN */
+}
+
+/**
+ * @brief Remove the filter added by `can_list_port_filter_add`.
+ *
+ * @param can_select Specific which CAN.
+ * @param id_type `CAN_ID_STD` or `CAN_ID_EXT`.
+ * @param id The ID of the node.
+ * @param id_mask The ID mask of the node.
+ */
+static inline void can_list_port_filter_remove(can_selected_t can_select,
+                                               uint32_t id_type, uint32_t id,
+                                               uint32_t id_mask) {
+#if CAN_LIST_USE_FDCAN
+    UNUSED(can_select);
+    UNUSED(id_type);
+    UNUSED(id);
+    UNUSED(id_mask);
+#else  /* CAN_LIST_USE_FDCAN */
+    can_filter_remove(can_select, id_type, id, id_mask);
+#endif /* CAN_LIST_USE_FDCAN */
+}
+
+#endif /* CAN_LIST_PORT_HOST */
+
+void can_list_rx_process(can_list_handle_t *hcan, uint32_t rx_fifo);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __CAN_LIST_PORT_H */
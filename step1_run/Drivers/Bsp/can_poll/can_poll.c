@@ -0,0 +1,300 @@
+/**
+ * @file    can_poll.c
+ * @author  Deadline039
+ * @brief   CAN 轮询: 周期发送远程帧或查询帧, 匹配应答
+ * @version 1.0
+ * @date    2024-12-09
+ */
+
+#include "can_poll.h"
+
+#include "can_list/can_list.h"
+
+#include <string.h>
+
+/* 已添加的轮询项, 按添加顺序排列发送时刻 */
+static can_poll_t *can_poll_list[CAN_POLL_MAX_NUMBER];
+/* 轮询周期, 单位: ms */
+static uint32_t can_poll_period = CAN_POLL_DEFAULT_PERIOD;
+/* 周期的起点 */
+static uint32_t can_poll_base;
+
+/**
+ * @brief 应答帧接收回调
+ *
+ * @param node_obj 轮询项
+ * @param can_rx_header CAN 消息头
+ * @param can_msg CAN 消息
+ */
+static void can_poll_callback(void *node_obj, can_rx_header_t *can_rx_header,
+                              uint8_t *can_msg) {
+    can_poll_t *poll = (can_poll_t *)node_obj;
+
+    if ((poll == NULL) || (can_rx_header->frame_type != CAN_RTR_DATA)) {
+        return;
+    }
+
+    /* 应答可能在任务中分发, 与超时判定互斥 */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (poll->pending == 0) {
+        ++poll->late;
+        __set_PRIMASK(primask);
+        return;
+    }
+    poll->pending = 0;
+    __set_PRIMASK(primask);
+
+    uint32_t rtt = can_rx_header->timestamp - poll->send_stamp;
+    uint8_t len = can_rx_header->data_length;
+
+    if (len > sizeof(poll->data)) {
+        len = sizeof(poll->data);
+    }
+    memcpy(poll->data, can_msg, len);
+    poll->data_len = len;
+    poll->last_rtt = rtt;
+    if (rtt > poll->max_rtt) {
+        poll->max_rtt = rtt;
+    }
+    ++poll->replied;
+
+    if (poll->callback != NULL) {
+        poll->callback(poll, can_msg, can_rx_header->data_length);
+    }
+}
+
+/**
+ * @brief 检查轮询项是否超时
+ *
+ * @param poll 轮询项
+ * @param now 当前时间, 单位: ms
+ * @param force 1: 不论是否到超时时间, 等待中的都判定为丢失
+ */
+static void can_poll_expire(can_poll_t *poll, uint32_t now, uint8_t force) {
+    if ((poll->pending == 0) ||
+        ((force == 0) && (now - poll->send_tick < poll->timeout))) {
+        return;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint8_t expired = poll->pending;
+    poll->pending = 0;
+    __set_PRIMASK(primask);
+
+    if (expired == 0) {
+        return;
+    }
+
+    ++poll->missed;
+    if (poll->callback != NULL) {
+        poll->callback(poll, NULL, 0);
+    }
+}
+
+/**
+ * @brief 发送请求
+ *
+ * @param poll 轮询项
+ * @param now 当前时间, 单位: ms
+ */
+static void can_poll_send(can_poll_t *poll, uint32_t now) {
+    uint8_t res;
+
+    /* 上一次请求仍未应答 */
+    can_poll_expire(poll, now, 1);
+
+    poll->send_tick = now;
+    poll->send_stamp = CAN_LIST_GET_TIMESTAMP();
+    poll->pending = 1;
+
+    if (poll->remote) {
+        res = can_send_remote(poll->can_select, poll->id_type,
+                              poll->request_id, poll->len, poll->query);
+    } else {
+        res = can_send_message(poll->can_select, poll->id_type,
+                               poll->request_id, poll->len, poll->query);
+    }
+
+    if (res != 0) {
+        poll->pending = 0;
+        ++poll->send_fail;
+        return;
+    }
+
+    ++poll->sent;
+}
+
+/**
+ * @brief 添加轮询项
+ *
+ * @param poll 轮询项
+ * @param can_select 选择那一个 CAN 来通信
+ * @param id_type `CAN_ID_STD` 或 `CAN_ID_EXT`, 请求与应答相同
+ * @param request_id 请求帧 ID
+ * @param reply_id 应答帧 ID, 远程帧的应答一般与请求 ID 相同
+ * @param query 查询帧数据, 为空时发送远程帧
+ * @param len 查询帧数据长度, 或远程帧的 DLC, 8 以内
+ * @param timeout 超时时间, 单位: ms. 应小于 周期 / 轮询项数量, 否则下次发送
+ *                时仍未应答也判定为丢失
+ * @param callback 应答与超时回调, 可以为空
+ * @return 添加状态:
+ * @retval - 0: 成功
+ * @retval - 1: 参数错误
+ * @retval - 2: 添加 CAN 接收表错误
+ * @retval - 3: 轮询项数量超过 `CAN_POLL_MAX_NUMBER`
+ */
+uint8_t can_poll_add(can_poll_t *poll, can_selected_t can_select,
+                     uint32_t id_type, uint32_t request_id, uint32_t reply_id,
+                     const uint8_t *query, uint8_t len, uint32_t timeout,
+                     can_poll_callback_t callback) {
+    if ((poll == NULL) || (len > 8) || (timeout == 0)) {
+        return 1;
+    }
+
+    uint32_t index = CAN_POLL_MAX_NUMBER;
+    uint32_t number = 0;
+    for (uint32_t i = 0; i < CAN_POLL_MAX_NUMBER; ++i) {
+        if (can_poll_list[i] == poll) {
+            return 1;
+        }
+
+        if (can_poll_list[i] != NULL) {
+            ++number;
+        } else if (index == CAN_POLL_MAX_NUMBER) {
+            index = i;
+        }
+    }
+
+    if (index == CAN_POLL_MAX_NUMBER) {
+        return 3;
+    }
+
+    memset(poll, 0, sizeof(can_poll_t));
+    poll->can_select = can_select;
+    poll->id_type = id_type;
+    poll->request_id = request_id;
+    poll->reply_id = reply_id;
+    poll->remote = (query == NULL);
+    poll->len = len;
+    if (query != NULL) {
+        memcpy(poll->query, query, len);
+    }
+    poll->timeout = timeout;
+    poll->callback = callback;
+    poll->cycle = UINT32_MAX;
+
+    if (can_list_add_new_node(can_select, (void *)poll, reply_id,
+                              (id_type == CAN_ID_STD) ? 0x7FF : 0x1FFFFFFF,
+                              id_type, can_poll_callback) != 0) {
+        return 2;
+    }
+
+    if (number == 0) {
+        can_poll_base = HAL_GetTick();
+    }
+    can_poll_list[index] = poll;
+
+    return 0;
+}
+
+/**
+ * @brief 移除轮询项, 在调用 `can_poll_process` 的任务中调用
+ *
+ * @param poll 轮询项
+ * @return 移除状态:
+ * @retval - 0: 成功
+ * @retval - 1: `poll`为空或未添加
+ * @retval - 2: 移除出错
+ */
+uint8_t can_poll_remove(can_poll_t *poll) {
+    if (poll == NULL) {
+        return 1;
+    }
+
+    uint32_t index = CAN_POLL_MAX_NUMBER;
+    for (uint32_t i = 0; i < CAN_POLL_MAX_NUMBER; ++i) {
+        if (can_poll_list[i] == poll) {
+            index = i;
+            break;
+        }
+    }
+
+    if (index == CAN_POLL_MAX_NUMBER) {
+        return 1;
+    }
+
+    can_poll_list[index] = NULL;
+    poll->pending = 0;
+
+    if (can_list_del_subscriber(poll->can_select, poll->id_type,
+                                poll->reply_id, (void *)poll,
+                                can_poll_callback) != 0) {
+        return 2;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief 设置轮询周期, 从当前时刻重新开始计算周期
+ *
+ * @param period 周期, 单位: ms
+ * @return 设置状态:
+ * @retval - 0: 成功
+ * @retval - 1: 周期为 0
+ */
+uint8_t can_poll_set_period(uint32_t period) {
+    if (period == 0) {
+        return 1;
+    }
+
+    can_poll_period = period;
+    can_poll_base = HAL_GetTick();
+
+    for (uint32_t i = 0; i < CAN_POLL_MAX_NUMBER; ++i) {
+        if (can_poll_list[i] != NULL) {
+            can_poll_list[i]->cycle = UINT32_MAX;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief 轮询处理, 在任务中每 1 ms 调用一次. 第 k 个轮询项(共 n 个)在每个
+ *        周期的 k * 周期 / n 处发送, 同时检查超时
+ */
+void can_poll_process(void) {
+    uint32_t now = HAL_GetTick();
+    uint32_t elapsed = now - can_poll_base;
+    uint32_t cycle = elapsed / can_poll_period;
+    uint32_t phase = elapsed % can_poll_period;
+    uint32_t number = 0;
+    uint32_t k = 0;
+
+    for (uint32_t i = 0; i < CAN_POLL_MAX_NUMBER; ++i) {
+        if (can_poll_list[i] != NULL) {
+            ++number;
+        }
+    }
+
+    for (uint32_t i = 0; i < CAN_POLL_MAX_NUMBER; ++i) {
+        can_poll_t *poll = can_poll_list[i];
+
+        if (poll == NULL) {
+            continue;
+        }
+
+        can_poll_expire(poll, now, 0);
+
+        if ((poll->cycle != cycle) &&
+            (phase >= k * can_poll_period / number)) {
+            poll->cycle = cycle;
+            can_poll_send(poll, now);
+        }
+
+        ++k;
+    }
+}
@@ -0,0 +1,78 @@
+/**
+ * @file    can_poll.h
+ * @author  Deadline039
+ * @brief   CAN 轮询: 周期发送远程帧或查询帧, 匹配应答
+ * @version 1.0
+ * @date    2024-12-09
+ * @note    各轮询项在一个周期内均匀错开发送, 避免在周期开始时集中发出一批帧.
+ *          应答通过 can_list 接收, 按轮询项的超时时间判定丢失.
+ */
+
+#ifndef __CAN_POLL_H
+#define __CAN_POLL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <CSP_Config.h>
+
+/* 最多管理的轮询项数量 */
+#define CAN_POLL_MAX_NUMBER     16
+/* 默认轮询周期, 单位: ms */
+#define CAN_POLL_DEFAULT_PERIOD 100
+
+typedef struct can_poll_s can_poll_t;
+
+/**
+ * @brief 应答回调, 收到应答时在 can_list 分发的上下文中调用(可能是中断);
+ *        超时时在 `can_poll_process` 中调用, `msg` 为 `NULL`, `len` 为 0
+ */
+typedef void (*can_poll_callback_t)(can_poll_t * /* poll */,
+                                    const uint8_t * /* msg */,
+                                    uint8_t /* len */);
+
+/**
+ * @brief 轮询项
+ */
+struct can_poll_s {
+    can_selected_t can_select;    /*!< 选择 CAN 通信 */
+    uint32_t id_type;             /*!< `CAN_ID_STD` 或 `CAN_ID_EXT` */
+    uint32_t request_id;          /*!< 请求帧 ID */
+    uint32_t reply_id;            /*!< 应答帧 ID */
+    uint8_t remote;               /*!< 1: 发送远程帧; 0: 发送查询帧 */
+    uint8_t len;                  /*!< 远程帧的 DLC 或查询帧数据长度 */
+    uint8_t query[8];             /*!< 查询帧数据 */
+    uint32_t timeout;             /*!< 超时时间, 单位: ms */
+    can_poll_callback_t callback; /*!< 应答回调, 可以为空 */
+    void *user_data;              /*!< 用户数据, 在添加后设置 */
+
+    volatile uint8_t pending; /*!< 已发送, 等待应答 */
+    uint32_t send_tick;       /*!< 发送时间, 单位: ms */
+    uint32_t send_stamp;      /*!< 发送时间戳, `CAN_LIST_GET_TIMESTAMP()` */
+    uint32_t cycle;           /*!< 上次发送所在的周期 */
+
+    uint8_t data[8];    /*!< 最近一次应答的数据 */
+    uint8_t data_len;   /*!< 最近一次应答的数据长度 */
+    uint32_t sent;      /*!< 发送次数 */
+    uint32_t replied;   /*!< 应答次数 */
+    uint32_t missed;    /*!< 超时或下次发送时仍未应答的次数 */
+    uint32_t late;      /*!< 超时之后才收到的应答 */
+    uint32_t send_fail; /*!< 发送失败次数(发送队列满等) */
+    uint32_t last_rtt;  /*!< 最近一次往返时间, 与时间戳单位相同 */
+    uint32_t max_rtt;   /*!< 最大往返时间 */
+};
+
+uint8_t can_poll_add(can_poll_t *poll, can_selected_t can_select,
+                     uint32_t id_type, uint32_t request_id, uint32_t reply_id,
+                     const uint8_t *query, uint8_t len, uint32_t timeout,
+                     can_poll_callback_t callback);
+uint8_t can_poll_remove(can_poll_t *poll);
+uint8_t can_poll_set_period(uint32_t period);
+void can_poll_process(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __CAN_POLL_H */
@@ -0,0 +1,243 @@
+/**
+ * @file    can_selftest.c
+ * @author  Deadline039
+ * @brief   CAN 回环自测与吞吐测试
+ * @version 1.0
+ * @date    2024-12-08
+ */
+
+#include "can_selftest.h"
+
+#include "can_list/can_list.h"
+
+#include <string.h>
+
+/* 校准空闲循环的次数 */
+#define CAN_SELFTEST_CALIBRATE 1000
+
+/**
+ * @brief 测试回调使用的状态
+ */
+static struct {
+    volatile uint32_t received; /*!< 接收帧数              */
+    uint32_t next_seq;          /*!< 下一帧的序号          */
+    uint32_t disorder;          /*!< 序号不连续的次数      */
+    uint32_t latency_max;       /*!< 最大延迟              */
+    /* 最后 `CAN_SELFTEST_SAMPLE_NUMBER` 帧的延迟 */
+    uint32_t sample[CAN_SELFTEST_SAMPLE_NUMBER];
+} can_selftest_state;
+
+/**
+ * @brief 测试帧接收回调. 数据前 4 字节为序号, 后 4 字节为写入发送队列时的
+ *        时间戳
+ *
+ * @param node_obj 节点数据(未用到)
+ * @param can_rx_header CAN 消息头
+ * @param can_msg CAN 消息
+ */
+static void can_selftest_callback(void *node_obj,
+                                  can_rx_header_t *can_rx_header,
+                                  uint8_t *can_msg) {
+    UNUSED(node_obj);
+
+    /* 在回调中取时间, 包括中断到回调的排队与分发. 帧头的时间戳是接收中断的
+       时间, 不包括这部分 */
+    uint32_t now = CAN_LIST_GET_TIMESTAMP();
+
+    if (can_rx_header->data_length < 8) {
+        return;
+    }
+
+    uint32_t seq, stamp;
+    memcpy(&seq, &can_msg[0], sizeof(uint32_t));
+    memcpy(&stamp, &can_msg[4], sizeof(uint32_t));
+
+    uint32_t latency = now - stamp;
+    uint32_t received = can_selftest_state.received;
+
+    if (seq != can_selftest_state.next_seq) {
+        ++can_selftest_state.disorder;
+    }
+    can_selftest_state.next_seq = seq + 1;
+
+    if (latency > can_selftest_state.latency_max) {
+        can_selftest_state.latency_max = latency;
+    }
+    can_selftest_state.sample[received % CAN_SELFTEST_SAMPLE_NUMBER] = latency;
+    can_selftest_state.received = received + 1;
+}
+
+/**
+ * @brief 空闲循环的一次迭代, 执行时间固定. 测试期间统计迭代次数, 从总时间中
+ *        减去空闲时间即为发送、中断与分发占用的 CPU 时间
+ */
+static void __attribute__((noinline)) can_selftest_idle(void) {
+    for (uint32_t i = 0; i < 16; ++i) {
+        __NOP();
+    }
+}
+
+/**
+ * @brief 读取排序后样本的百分位数
+ *
+ * @param sample 排序后的样本
+ * @param number 样本数
+ * @param permille 千分位
+ * @return 样本值
+ */
+static uint32_t can_selftest_percentile(const uint32_t *sample,
+                                        uint32_t number, uint32_t permille) {
+    uint32_t index = number * permille / 1000;
+
+    if (index >= number) {
+        index = number - 1;
+    }
+
+    return sample[index];
+}
+
+/**
+ * @brief 回环自测. 在任务中调用, 测试期间阻塞. 测试开始时切换到 `mode`,
+ *        结束后恢复为正常模式. 需要先初始化 CAN 并调用 `can_list_add_can`.
+ *        CPU 周期由空闲循环计数估算, 包括发送函数、CAN 中断与 can_list 分发,
+ *        其他任务与中断也会计入, 应在最高优先级任务或调度器启动前调用
+ *
+ * @param can_select 测试的 CAN
+ * @param mode `CAN_MODE_LOOPBACK` 或 `CAN_MODE_SILENT_LOOPBACK`. 回环模式
+ *             的帧仍会发送到总线上, 总线上有其他设备时使用静默回环
+ * @param frames 测试帧数, 测试时间不能超过 2^32 个 CPU 周期(180 MHz 下约
+ *               23 s)
+ * @param[out] result 测试结果
+ * @return 测试状态:
+ * @retval - 0: 成功
+ * @retval - 1: 参数错误
+ * @retval - 2: 切换模式失败
+ * @retval - 3: 添加 CAN 接收表错误
+ * @retval - 4: 超时, `result` 中为超时前的结果
+ */
+uint8_t can_selftest_run(can_selected_t can_select, uint32_t mode,
+                         uint32_t frames, can_selftest_result_t *result) {
+    if ((result == NULL) || (frames == 0) ||
+        ((mode != CAN_MODE_LOOPBACK) && (mode != CAN_MODE_SILENT_LOOPBACK))) {
+        return 1;
+    }
+
+    memset(result, 0, sizeof(can_selftest_result_t));
+    memset(&can_selftest_state, 0, sizeof(can_selftest_state));
+
+    if (can_set_mode(can_select, mode) != 0) {
+        return 2;
+    }
+
+    if (can_list_add_new_node(can_select, NULL, CAN_SELFTEST_ID, 0x1FFFFFFF,
+                              CAN_ID_EXT, can_selftest_callback) != 0) {
+        can_set_mode(can_select, CAN_MODE_NORMAL);
+        return 3;
+    }
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    /* 关中断校准, 得到一次空闲迭代的周期数(乘 256) */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t start = DWT->CYCCNT;
+    for (uint32_t i = 0; i < CAN_SELFTEST_CALIBRATE; ++i) {
+        can_selftest_idle();
+    }
+    uint32_t idle_cycles =
+        (DWT->CYCCNT - start) * 256 / CAN_SELFTEST_CALIBRATE;
+    __set_PRIMASK(primask);
+
+    uint8_t res = 0;
+    uint8_t send_msg[8];
+    uint32_t sent = 0;
+    uint32_t idle = 0;
+    uint32_t last_received = 0;
+    uint32_t last_tick = HAL_GetTick();
+
+    start = DWT->CYCCNT;
+    while (can_selftest_state.received < frames) {
+        uint32_t received = can_selftest_state.received;
+
+        if ((sent < frames) && (sent - received < CAN_SELFTEST_WINDOW)) {
+            uint32_t stamp = CAN_LIST_GET_TIMESTAMP();
+            memcpy(&send_msg[0], &sent, sizeof(uint32_t));
+            memcpy(&send_msg[4], &stamp, sizeof(uint32_t));
+
+            if (can_send_message(can_select, CAN_ID_EXT, CAN_SELFTEST_ID, 8,
+                                 send_msg) == 0) {
+                ++sent;
+                continue;
+            }
+        }
+
+        can_selftest_idle();
+        ++idle;
+
+        if (received != last_received) {
+            last_received = received;
+            last_tick = HAL_GetTick();
+        } else if (HAL_GetTick() - last_tick > CAN_SELFTEST_TIMEOUT) {
+            res = 4;
+            break;
+        }
+    }
+    uint32_t elapsed = DWT->CYCCNT - start;
+
+    /* 超时后等待发送队列清空, 避免切回正常模式后发出测试帧 */
+    can_tx_stats_t tx_stats;
+    last_tick = HAL_GetTick();
+    while ((can_get_tx_stats(can_select, &tx_stats) == 0) &&
+           (tx_stats.queued > 0) &&
+           (HAL_GetTick() - last_tick <= CAN_SELFTEST_TIMEOUT)) {
+    }
+
+    can_list_del_subscriber(can_select, CAN_ID_EXT, CAN_SELFTEST_ID, NULL,
+                            can_selftest_callback);
+    if (can_set_mode(can_select, CAN_MODE_NORMAL) != 0) {
+        res = 2;
+    }
+
+    uint32_t received = can_selftest_state.received;
+    uint32_t core_mhz = SystemCoreClock / 1000000;
+    uint64_t idle_total = (uint64_t)idle * idle_cycles / 256;
+
+    result->sent = sent;
+    result->received = received;
+    result->disorder = can_selftest_state.disorder;
+    result->elapsed_us = elapsed / core_mhz;
+    if (received == 0) {
+        return res;
+    }
+
+    result->frames_per_sec =
+        (uint32_t)((uint64_t)received * SystemCoreClock / elapsed);
+    result->cycles_per_frame =
+        (idle_total < elapsed)
+            ? (uint32_t)((elapsed - idle_total) / received)
+            : 0;
+
+    /* 插入排序, 样本数不多 */
+    uint32_t *sample = can_selftest_state.sample;
+    uint32_t number = (received < CAN_SELFTEST_SAMPLE_NUMBER)
+                          ? received
+                          : CAN_SELFTEST_SAMPLE_NUMBER;
+    for (uint32_t i = 1; i < number; ++i) {
+        uint32_t value = sample[i];
+        uint32_t j = i;
+
+        while ((j > 0) && (sample[j - 1] > value)) {
+            sample[j] = sample[j - 1];
+            --j;
+        }
+        sample[j] = value;
+    }
+
+    result->latency_p50 = can_selftest_percentile(sample, number, 500);
+    result->latency_p90 = can_selftest_percentile(sample, number, 900);
+    result->latency_p99 = can_selftest_percentile(sample, number, 990);
+    result->latency_max = can_selftest_state.latency_max;
+
+    return res;
+}
@@ -0,0 +1,54 @@
+/**
+ * @file    can_selftest.h
+ * @author  Deadline039
+ * @brief   CAN 回环自测与吞吐测试
+ * @version 1.0
+ * @date    2024-12-08
+ * @note    把 CAN 切换到回环或静默回环模式, 帧经过发送队列、邮箱、控制器、
+ *          接收 FIFO 与 can_list 分发, 由测试回调接收. 不需要连接电机或其他
+ *          节点, 用于在裸板上验证驱动的修改.
+ */
+
+#ifndef __CAN_SELFTEST_H
+#define __CAN_SELFTEST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <CSP_Config.h>
+
+/* 测试帧使用的扩展 ID, 不能与总线上的设备冲突 */
+#define CAN_SELFTEST_ID            0x1FFFFFF0U
+/* 已发送未收到的帧数上限, 不超过发送队列长度 */
+#define CAN_SELFTEST_WINDOW        8
+/* 用于计算延迟百分位数的样本数, 保留最后的样本 */
+#define CAN_SELFTEST_SAMPLE_NUMBER 256
+/* 连续多长时间收不到帧判定为超时, 单位: ms */
+#define CAN_SELFTEST_TIMEOUT       100
+
+/**
+ * @brief 测试结果. 延迟与 `CAN_LIST_GET_TIMESTAMP` 单位相同(默认为 CPU 周期),
+ *        从帧写入发送队列开始, 到接收回调为止.
+ */
+typedef struct {
+    uint32_t sent;             /*!< 发送帧数                         */
+    uint32_t received;         /*!< 接收帧数                         */
+    uint32_t disorder;         /*!< 序号不连续的次数(丢帧或乱序)     */
+    uint32_t elapsed_us;       /*!< 测试用时                         */
+    uint32_t frames_per_sec;   /*!< 持续接收帧率                     */
+    uint32_t latency_p50;      /*!< 延迟中位数                       */
+    uint32_t latency_p90;      /*!< 延迟 90% 分位数                  */
+    uint32_t latency_p99;      /*!< 延迟 99% 分位数                  */
+    uint32_t latency_max;      /*!< 最大延迟                         */
+    uint32_t cycles_per_frame; /*!< 每帧占用的 CPU 周期(估算)        */
+} can_selftest_result_t;
+
+uint8_t can_selftest_run(can_selected_t can_select, uint32_t mode,
+                         uint32_t frames, can_selftest_result_t *result);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __CAN_SELFTEST_H */
@@ -0,0 +1,52 @@
+/**
+ * @file    can_trace.c
+ * @author  Deadline039
+ * @brief   CAN 抓包记录通过串口 DMA 发送
+ * @version 1.0
+ * @date    2024-12-10
+ */
+
+#include "can_trace.h"
+
+/**
+ * @brief 发送抓包记录, 在任务中周期调用. 把缓冲区中连续的一段复制到串口的
+ *        DMA 发送环作为一条消息, 与 `uart_printf` 等输出按消息排队, 不会打断
+ *        正在进行的 DMA. 需要开启串口的 DMA 发送与串口中断. 每条消息不超过
+ *        发送环的一半, 发送环满时记录留在缓冲区, 下次再发. 与文本输出共用
+ *        串口时主机端无法解析记录流, 建议使用单独的串口
+ *
+ * @param huart 串口句柄
+ * @return 本次写入发送环的记录数
+ */
+uint32_t can_trace_drain(UART_HandleTypeDef *huart) {
+    if ((huart == NULL) || (huart->hdmatx == NULL)) {
+        return 0;
+    }
+
+    const can_trace_record_t *records;
+    uint32_t number = can_trace_peek(&records);
+    if (number == 0) {
+        return 0;
+    }
+
+    uint32_t limit = uart_damtx_get_buf_szie(huart) / 2 /
+                     sizeof(can_trace_record_t);
+    if (limit > CAN_TRACE_DRAIN_MAX) {
+        limit = CAN_TRACE_DRAIN_MAX;
+    }
+
+    if (number > limit) {
+        number = limit;
+    }
+
+    if ((number == 0) ||
+        (uart_dmatx_write(huart, records,
+                          number * sizeof(can_trace_record_t)) == 0)) {
+        return 0;
+    }
+
+    /* 已复制到发送环, 立即释放 */
+    can_trace_consume(number);
+
+    return number;
+}
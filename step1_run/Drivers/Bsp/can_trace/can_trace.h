@@ -0,0 +1,30 @@
+/**
+ * @file    can_trace.h
+ * @author  Deadline039
+ * @brief   CAN 抓包记录通过串口 DMA 发送
+ * @version 1.0
+ * @date    2024-12-10
+ * @note    CSP 把收发的帧记录到 16 字节一条的环形缓冲区, 本模块把记录复制到
+ *          串口的 DMA 发送环, 与该串口的其他输出按消息排队. 主机用
+ *          `Tools/can_trace_host` 转换为 candump/ASC 格式或回放.
+ */
+
+#ifndef __CAN_TRACE_H
+#define __CAN_TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <CSP_Config.h>
+
+/* 每条消息最多发送的记录数 */
+#define CAN_TRACE_DRAIN_MAX 64
+
+uint32_t can_trace_drain(UART_HandleTypeDef *huart);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __CAN_TRACE_H */
@@ -0,0 +1,56 @@
+/**
+ * @file    core_crc.c
+ * @author  Deadline039
+ * @brief   Hardware CRC unit.
+ * @version 1.0
+ * @date    2024-12-11
+ */
+
+#include "core_crc.h"
+
+#include <string.h>
+
+/**
+ * @brief Enable the clock of the CRC unit.
+ *
+ */
+void crc_init(void) {
+    __HAL_RCC_CRC_CLK_ENABLE();
+}
+
+/**
+ * @brief Calculate the CRC32 of the data. Polynomial 0x04C11DB7, initial
+ *        value 0xFFFFFFFF, no reflection and no final XOR. The bytes are
+ *        loaded into 32-bit words in little endian, the last word is padded
+ *        with 0. The unit is shared by tasks and interrupts, so the
+ *        calculation runs with interrupts disabled, about 1 cycle per byte.
+ *
+ * @param data The data.
+ * @param len The data length.
+ * @return The CRC.
+ */
+uint32_t crc_calculate(const void *data, size_t len) {
+    const uint8_t *ptr = (const uint8_t *)data;
+    uint32_t word;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    CRC->CR = CRC_CR_RESET;
+
+    for (; len >= 4; len -= 4, ptr += 4) {
+        memcpy(&word, ptr, sizeof(uint32_t));
+        CRC->DR = word;
+    }
+
+    if (len > 0) {
+        word = 0;
+        memcpy(&word, ptr, len);
+        CRC->DR = word;
+    }
+
+    uint32_t crc = CRC->DR;
+    __set_PRIMASK(primask);
+
+    return crc;
+}
@@ -0,0 +1,27 @@
+/**
+ * @file    core_crc.h
+ * @author  Deadline039
+ * @brief   Hardware CRC unit.
+ * @version 1.0
+ * @date    2024-12-11
+ * @note    The result is the same as `crc32_bytes(CRC32_INIT, ...)` in
+ *          `User/Utils/crc32`, which is used by the host tools.
+ */
+
+#ifndef __CORE_CRC_H
+#define __CORE_CRC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <CSP_Config.h>
+
+void crc_init(void);
+uint32_t crc_calculate(const void *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __CORE_CRC_H */
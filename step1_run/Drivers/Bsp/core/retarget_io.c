@@ -2,12 +2,21 @@
  * @file    retarget_io.c
  * @author  Deadline039
  * @brief   Retarget C library system I/O interface.
- * @version 1.1
- * @date    2024-07-29
+ * @version 1.2
+ * @date    2024-12-11
  * @ref
  * https://developer.arm.com/documentation/100073/0611/the-c-and-c---library-functions-reference
  * https://developer.arm.com/documentation/100073/0622/The-Arm-C-and-C---Libraries/ISO-C-library-implementation-definition
  *
+ * @note    stdout and stderr are buffered by line in tasks and queued into
+ *          the DMA send ring of the UART, printf does not wait for the UART.
+ *          In interrupts the characters bypass the line buffer and are queued
+ *          directly, each `_write` call as one message. With ARMCC the C
+ *          library calls `fputc` per character, so printf in interrupts
+ *          queues every character as a message, avoid it. Without DMA Tx
+ *          every character is polled as before. Call `retarget_flush` to
+ *          send a line without '\n'.
+ *
  * @warning 1. ARM GCC is not fully supported. There are problems with printf
  *             floating point numbers
  *          2. It is not recommended to use scanf() in the code. If you use the
@@ -17,21 +26,73 @@
  *             recommended to use uart_scanf()
  *          4. IAR has not been tested
  *          5. Only support C99 and later.
+ *          6. The output is dropped when the send ring is full, see
+ *             `uart_dmatx_get_stats`.
  */
 
-#include "stm32f4xx_hal.h"
+#include "retarget_io.h"
 
 #include <stdio.h>
 
-#define STDOUT_UART USART1
-#define STDIN_UART  USART1
-#define STDERR_UART USART1
+#if RETARGET_USE_RTOS
+#include "FreeRTOS.h"
+#include "task.h"
+#endif /* RETARGET_USE_RTOS */
 
 /**
  * @defgroup retarget stdin, stdout, stderr
  * @{
  */
 
+/**
+ * @brief Output stream buffered by line.
+ */
+typedef struct {
+    UART_HandleTypeDef *huart;   /*!< The UART to send.         */
+    uint32_t len;                /*!< Characters in the buffer. */
+    char buf[RETARGET_BUF_SIZE]; /*!< Line buffer.              */
+} retarget_stream_t;
+
+#ifdef STDOUT_UART
+static retarget_stream_t retarget_stdout = {.huart = &STDOUT_UART};
+#endif /* STDOUT_UART */
+
+#ifdef STDERR_UART
+static retarget_stream_t retarget_stderr = {.huart = &STDERR_UART};
+#endif /* STDERR_UART */
+
+/**
+ * @brief Lock the line buffers against the other tasks. The interrupts never
+ *        touch the line buffers, so they are not disabled.
+ *
+ * @return Whether the scheduler is suspended, pass to `retarget_unlock`.
+ */
+static inline uint8_t retarget_lock(void) {
+#if RETARGET_USE_RTOS
+    if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING) {
+        vTaskSuspendAll();
+        return 1;
+    }
+#endif /* RETARGET_USE_RTOS */
+
+    return 0;
+}
+
+/**
+ * @brief Unlock the line buffers.
+ *
+ * @param locked The value returned by `retarget_lock`.
+ */
+static inline void retarget_unlock(uint8_t locked) {
+#if RETARGET_USE_RTOS
+    if (locked) {
+        xTaskResumeAll();
+    }
+#else  /* RETARGET_USE_RTOS */
+    UNUSED(locked);
+#endif /* RETARGET_USE_RTOS */
+}
+
 /**
  * @brief Put char into uart.
  *
@@ -57,6 +118,87 @@ static char __io_getchar_uart(USART_TypeDef *uart) {
     return (int)uart->DR;
 }
 
+/**
+ * @brief Write characters to the stream. In tasks they are put into the line
+ *        buffer, which is queued into the send ring at '\n' or when full.
+ *        In interrupts they are queued directly, so a half line of a task is
+ *        not mixed with them. Polled if the UART has no DMA Tx, dropped if
+ *        the UART is not initialized yet.
+ *
+ * @param stream The stream.
+ * @param str The characters.
+ * @param len The number of characters.
+ */
+static void retarget_write(retarget_stream_t *stream, const char *str,
+                           uint32_t len) {
+    UART_HandleTypeDef *huart = stream->huart;
+
+    if ((huart->Instance == NULL) ||
+        (HAL_UART_GetState(huart) == HAL_UART_STATE_RESET)) {
+        /* printf before the UART init, the clock is off and polling the TC
+           flag never ends. */
+        return;
+    }
+
+    if (huart->hdmatx == NULL) {
+        for (uint32_t i = 0; i < len; ++i) {
+            __io_putchar_uart(huart->Instance, str[i]);
+        }
+        return;
+    }
+
+    if (__get_IPSR() != 0) {
+        uart_dmatx_write(huart, str, len);
+        return;
+    }
+
+    /* Serialize the tasks, the interrupts stay enabled while copying. */
+    uint8_t locked = retarget_lock();
+    for (uint32_t i = 0; i < len; ++i) {
+        stream->buf[stream->len++] = str[i];
+
+        if ((str[i] == '\n') || (stream->len == RETARGET_BUF_SIZE)) {
+            uart_dmatx_write(huart, stream->buf, stream->len);
+            stream->len = 0;
+        }
+    }
+    retarget_unlock(locked);
+}
+
+/**
+ * @brief Queue the characters in the line buffer of the stream.
+ *
+ * @param stream The stream.
+ */
+static void retarget_flush_stream(retarget_stream_t *stream) {
+    /* The line buffers belong to the tasks. */
+    if (__get_IPSR() != 0) {
+        return;
+    }
+
+    uint8_t locked = retarget_lock();
+    if (stream->len > 0) {
+        uart_dmatx_write(stream->huart, stream->buf, stream->len);
+        stream->len = 0;
+    }
+    retarget_unlock(locked);
+}
+
+/**
+ * @brief Send the characters in the line buffer of stdout and stderr, for
+ *        the output without '\n' (e.g. a prompt). Call in task, it does
+ *        nothing in interrupts.
+ */
+void retarget_flush(void) {
+#ifdef STDOUT_UART
+    retarget_flush_stream(&retarget_stdout);
+#endif /* STDOUT_UART */
+
+#ifdef STDERR_UART
+    retarget_flush_stream(&retarget_stderr);
+#endif /* STDERR_UART */
+}
+
 #if defined(__ARMCC_VERSION) /* Compiler */
 
 #if ((__ARMCC_VERSION >= 5000000) &&                                           \
@@ -76,7 +218,8 @@ FILE __stderr;
 FILE __stdin;
 
 /**
- * @brief Write a character to file.
+ * @brief Write a character to file. In interrupts every character is queued
+ *        as a message.
  *
  * @param ch The character will be written.
  * @param file File pointer.
@@ -86,7 +229,8 @@ int fputc(int ch, FILE *file) {
     if (file == stdout) {
 
 #ifdef STDOUT_UART
-        __io_putchar_uart(STDOUT_UART, ch);
+        char c = (char)ch;
+        retarget_write(&retarget_stdout, &c, 1);
 #else /* STDOUT_UART */
         /* Your implement here. */
 
@@ -95,7 +239,8 @@ int fputc(int ch, FILE *file) {
     } else if (file == stderr) {
 
 #ifdef STDERR_UART
-        __io_putchar_uart(STDERR_UART, ch);
+        char c = (char)ch;
+        retarget_write(&retarget_stderr, &c, 1);
 #else /* STDERR_UART */
         /* Your implement here. */
 
@@ -117,7 +262,7 @@ int fputc(int ch, FILE *file) {
 int fgetc(FILE *file) {
     if (file == stdin) {
 #ifdef STDIN_UART
-        return __io_getchar_uart(STDIN_UART);
+        return __io_getchar_uart(STDIN_UART.Instance);
 #else /* STDIN_UART */
         /* Your implement here.  */
 
@@ -139,47 +284,48 @@ int fgetc(FILE *file) {
 int _write(int file, char *str, int len) {
     if (file == 1) {
 #ifdef STDOUT_UART
-        for (int i = 0; i < len; ++i) {
-            __io_putchar_uart(STDOUT_UART);
+        retarget_write(&retarget_stdout, str, (uint32_t)len);
 #else /* STDOUT_UART */
         /* Your implement here. */
 
 #endif /* STDOUT_UART */
-        }
     } else if (file == 2) {
 #ifdef STDERR_UART
-        for (int i = 0; i < len; ++i) {
-            __io_putchar_uart(STDERR_UART);
+        retarget_write(&retarget_stderr, str, (uint32_t)len);
 #else /* STDERR_UART */
-    /* Your implement here. */
+        /* Your implement here. */
 
 #endif /* STDERR_UART */
-        }
     }
     return len;
 }
 
 /**
- * @brief Read string from file.
+ * @brief Read string from file, until '\n' or the buffer is full.
  *
  * @param file The file will be read.
  * @param str The string buffer will be written.
  * @param len The string length.
+ * @return The length of string read.
  */
 int _read(int file, char *str, int len) {
+    int i = 0;
 
     if (file == 0) {
-        for (int i = 0; i < len; ++i) {
+        while (i < len) {
 #ifdef STDIN_UART
-            __io_getchar_uart(STDIN_UART);
+            str[i] = __io_getchar_uart(STDIN_UART.Instance);
 #else /* STDIN_UART */
             /* Your implement here. */
 
 #endif /* STDIN_UART */
+            if (str[i++] == '\n') {
+                break;
+            }
         }
     }
 
-    return index;
+    return i;
 }
 
 #endif /* Compiler */
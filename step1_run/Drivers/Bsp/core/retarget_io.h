@@ -0,0 +1,37 @@
+/**
+ * @file    retarget_io.h
+ * @author  Deadline039
+ * @brief   Retarget C library system I/O interface.
+ * @version 1.2
+ * @date    2024-12-11
+ */
+
+#ifndef __RETARGET_IO_H
+#define __RETARGET_IO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <CSP_Config.h>
+
+/* The UART handle of stdio. stdout and stderr are sent by the DMA send ring
+   of the UART (`uart_dmatx_write`), polled if DMA Tx is not enabled. */
+#define STDOUT_UART       usart1_handle
+#define STDIN_UART        usart1_handle
+#define STDERR_UART       usart1_handle
+
+/* Line buffer of stdout and stderr, flushed at '\n' or when full. */
+#define RETARGET_BUF_SIZE 128
+
+/* Tasks printing at the same time are serialized by suspending the
+   scheduler, only support FreeRTOS. 0 if printed from one task only. */
+#define RETARGET_USE_RTOS 1
+
+void retarget_flush(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __RETARGET_IO_H */
@@ -0,0 +1,370 @@
+/**
+ * @file    host_cmd.c
+ * @author  Deadline039
+ * @brief   上位机二进制命令接收
+ * @version 1.0
+ * @date    2024-12-12
+ */
+
+#include "host_cmd.h"
+
+#include "core/core_crc.h"
+#include "mpsc_fifo/mpsc_fifo.h"
+
+#if HOST_CMD_TELEMETRY
+#include "telemetry/telemetry.h"
+#endif /* HOST_CMD_TELEMETRY */
+
+#include <string.h>
+
+/* 一帧编码后的最大长度, 不含分隔符 */
+#define HOST_CMD_ENCODED_MAX COBS_ENCODE_MAX(HOST_CMD_FRAME_MAX)
+
+static UART_HandleTypeDef *host_cmd_uart;
+static dm_handle_t *host_cmd_motors[HOST_CMD_CHANNEL_MAX];
+static host_cmd_stats_t host_cmd_stats;
+
+/* 中断写入, 控制任务读出 */
+static mpsc_fifo_t host_cmd_queue;
+static mpsc_fifo_atomic_t host_cmd_queue_seq[HOST_CMD_QUEUE_SIZE];
+static host_cmd_setpoint_t host_cmd_queue_buf[HOST_CMD_QUEUE_SIZE];
+
+/* 以下只在解析中访问 */
+static uint32_t host_cmd_frame[HOST_CMD_FRAME_MAX / sizeof(uint32_t)];
+static uint8_t host_cmd_wrap[HOST_CMD_ENCODED_MAX];
+static uint16_t host_cmd_seq;
+static uint8_t host_cmd_synced;
+
+/* IDLE 与 DMA 中断优先级不同时解析可能嵌套, 嵌套的一次只做标记 */
+static volatile uint8_t host_cmd_busy;
+static volatile uint8_t host_cmd_pending;
+
+/**
+ * @brief 从 `from` 开始查找分隔符
+ *
+ * @param span 接收的数据
+ * @param from 起始位置
+ * @param count 数据长度
+ * @return 分隔符的位置, 没有找到时为 `count`
+ */
+static uint32_t host_cmd_find(const uart_rx_span_t *span, uint32_t from,
+                              uint32_t count) {
+    const uint8_t *found;
+
+    if (from < span->len[0]) {
+        found = memchr(span->data[0] + from, 0x00, span->len[0] - from);
+        if (found != NULL) {
+            return (uint32_t)(found - span->data[0]);
+        }
+        from = span->len[0];
+    }
+
+    if (from < count) {
+        from -= span->len[0];
+        found = memchr(span->data[1] + from, 0x00, span->len[1] - from);
+        if (found != NULL) {
+            return span->len[0] + (uint32_t)(found - span->data[1]);
+        }
+    }
+
+    return count;
+}
+
+/**
+ * @brief 解码并校验一帧, 设定值写入队列
+ *
+ * @param span 接收的数据
+ * @param begin 帧在数据中的位置
+ * @param len 帧长度, 不含分隔符
+ */
+static void host_cmd_frame_parse(const uart_rx_span_t *span, uint32_t begin,
+                                 uint32_t len) {
+    const uint8_t *src;
+
+    if (len > HOST_CMD_ENCODED_MAX) {
+        ++host_cmd_stats.invalid;
+        return;
+    }
+
+    /* 只有跨过缓冲区末尾的帧需要复制 */
+    if (begin + len <= span->len[0]) {
+        src = span->data[0] + begin;
+    } else if (begin >= span->len[0]) {
+        src = span->data[1] + (begin - span->len[0]);
+    } else {
+        uint32_t first = span->len[0] - begin;
+        memcpy(host_cmd_wrap, span->data[0] + begin, first);
+        memcpy(&host_cmd_wrap[first], span->data[1], len - first);
+        src = host_cmd_wrap;
+    }
+
+    size_t frame_len = cobs_decode(src, len, (uint8_t *)host_cmd_frame,
+                                   sizeof(host_cmd_frame));
+    const host_cmd_header_t *header = (const host_cmd_header_t *)host_cmd_frame;
+
+    if ((frame_len < sizeof(host_cmd_header_t) + sizeof(uint32_t)) ||
+        (header->type !=
+         ((HOST_CMD_VERSION << 4) | HOST_CMD_TYPE_SETPOINT)) ||
+        (header->count > HOST_CMD_CHANNEL_MAX) ||
+        (frame_len != sizeof(host_cmd_header_t) +
+                          header->count * sizeof(host_cmd_setpoint_t) +
+                          sizeof(uint32_t))) {
+        ++host_cmd_stats.invalid;
+        return;
+    }
+
+    uint32_t crc;
+    frame_len -= sizeof(uint32_t);
+    memcpy(&crc, (const uint8_t *)host_cmd_frame + frame_len,
+           sizeof(uint32_t));
+    if (crc_calculate(host_cmd_frame, frame_len) != crc) {
+        ++host_cmd_stats.crc_error;
+        return;
+    }
+
+    if (host_cmd_synced) {
+        host_cmd_stats.seq_lost += (uint16_t)(header->seq - host_cmd_seq - 1);
+    }
+    host_cmd_seq = header->seq;
+    host_cmd_synced = 1;
+    ++host_cmd_stats.frames;
+
+    const host_cmd_setpoint_t *setpoint =
+        (const host_cmd_setpoint_t *)&header[1];
+
+    for (uint32_t i = 0; i < header->count; ++i, ++setpoint) {
+        if (setpoint->channel >= HOST_CMD_CHANNEL_MAX) {
+            ++host_cmd_stats.rejected;
+            continue;
+        }
+
+        if (mpsc_fifo_push(&host_cmd_queue, setpoint) != 0) {
+            ++host_cmd_stats.dropped;
+            continue;
+        }
+        ++host_cmd_stats.commands;
+    }
+}
+
+/**
+ * @brief 解析已接收的完整帧, 释放已解析的数据
+ *
+ */
+static void host_cmd_parse(void) {
+    uart_rx_span_t span;
+    uint32_t count = uart_dmarx_peek(host_cmd_uart, &span);
+    uint32_t begin = 0;
+    uint32_t end;
+
+    host_cmd_stats.lost += span.lost;
+
+    while ((end = host_cmd_find(&span, begin, count)) < count) {
+        if (end > begin) {
+            host_cmd_frame_parse(&span, begin, end - begin);
+        }
+        begin = end + 1;
+    }
+
+    /* 没有分隔符且超过一帧, 不是命令帧, 丢弃 */
+    if (count - begin > HOST_CMD_ENCODED_MAX) {
+        ++host_cmd_stats.invalid;
+        begin = count;
+    }
+
+    if (uart_dmarx_consume(host_cmd_uart, begin) == 2) {
+        /* 解析时数据被覆盖, 写入队列的设定值都已通过 CRC 校验, 只统计 */
+        host_cmd_stats.lost += count;
+    }
+}
+
+/**
+ * @brief 串口接收回调, 在 IDLE 与 DMA 中断中调用
+ *
+ * @param huart 串口句柄
+ */
+static void host_cmd_rx_callback(UART_HandleTypeDef *huart) {
+    if (huart != host_cmd_uart) {
+        return;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (host_cmd_busy) {
+        host_cmd_pending = 1;
+        __set_PRIMASK(primask);
+        return;
+    }
+    host_cmd_busy = 1;
+    __set_PRIMASK(primask);
+
+    for (;;) {
+        host_cmd_parse();
+
+        primask = __get_PRIMASK();
+        __disable_irq();
+        if (!host_cmd_pending) {
+            host_cmd_busy = 0;
+            __set_PRIMASK(primask);
+            break;
+        }
+        host_cmd_pending = 0;
+        __set_PRIMASK(primask);
+    }
+}
+
+/**
+ * @brief 初始化命令接收, 需先初始化串口并开启 DMA 接收. 该串口切换为
+ *        零拷贝接收
+ *
+ * @param huart 串口句柄
+ * @return 初始化结果
+ * @retval - 0: 成功
+ * @retval - 1: 串口未开启 DMA 接收
+ * @retval - 2: DMA 接收缓冲区小于 `HOST_CMD_RX_BUF_MIN`
+ */
+uint8_t host_cmd_init(UART_HandleTypeDef *huart) {
+    if ((huart == NULL) || (huart->hdmarx == NULL)) {
+        return 1;
+    }
+
+    if (uart_dmarx_get_buf_size(huart) < HOST_CMD_RX_BUF_MIN) {
+        return 2;
+    }
+
+    crc_init();
+    mpsc_fifo_init(&host_cmd_queue, host_cmd_queue_seq, host_cmd_queue_buf,
+                   HOST_CMD_QUEUE_SIZE, sizeof(host_cmd_setpoint_t));
+    memset(&host_cmd_stats, 0, sizeof(host_cmd_stats));
+    host_cmd_synced = 0;
+    host_cmd_busy = 0;
+    host_cmd_pending = 0;
+    host_cmd_uart = huart;
+
+    uart_dmarx_zero_copy(huart, 1);
+    uart_dmarx_set_callback(huart, host_cmd_rx_callback);
+
+    return 0;
+}
+
+/**
+ * @brief 停止命令接收, 串口恢复为通过 FIFO 接收
+ *
+ */
+void host_cmd_deinit(void) {
+    if (host_cmd_uart == NULL) {
+        return;
+    }
+
+    uart_dmarx_set_callback(host_cmd_uart, NULL);
+    uart_dmarx_zero_copy(host_cmd_uart, 0);
+    host_cmd_uart = NULL;
+}
+
+/**
+ * @brief 设置通道对应的电机
+ *
+ * @param channel 通道号, 小于 `HOST_CMD_CHANNEL_MAX`
+ * @param motor 电机, NULL 删除该通道
+ * @return 设置结果
+ * @retval - 0: 成功
+ * @retval - 1: 通道号超出范围
+ */
+uint8_t host_cmd_add_channel(uint8_t channel, dm_handle_t *motor) {
+    if (channel >= HOST_CMD_CHANNEL_MAX) {
+        return 1;
+    }
+
+    host_cmd_motors[channel] = motor;
+
+    return 0;
+}
+
+/**
+ * @brief 执行收到的设定值, 在控制任务每个周期开始时调用. 同一通道在本周期
+ *        内收到多个设定值时只执行最新的一个
+ *
+ * @return 发到电机的设定值数
+ */
+uint32_t host_cmd_process(void) {
+    host_cmd_setpoint_t latest[HOST_CMD_CHANNEL_MAX];
+    host_cmd_setpoint_t setpoint;
+    uint32_t received = 0;
+    uint32_t applied = 0;
+    uint32_t rejected = 0;
+
+    if (host_cmd_uart == NULL) {
+        return 0;
+    }
+
+    while (mpsc_fifo_pop(&host_cmd_queue, &setpoint) == 0) {
+        latest[setpoint.channel] = setpoint;
+        received |= 1U << setpoint.channel;
+    }
+
+    for (uint8_t i = 0; i < HOST_CMD_CHANNEL_MAX; ++i) {
+        if ((received & (1U << i)) == 0) {
+            continue;
+        }
+
+        const host_cmd_setpoint_t *cmd = &latest[i];
+        dm_handle_t *motor = host_cmd_motors[i];
+
+        if ((motor == NULL) || (cmd->mode != (uint8_t)motor->mode)) {
+            ++rejected;
+            continue;
+        }
+
+        switch (motor->mode) {
+            case DM_MODE_MIT: {
+                dm_mit_ctrl(motor, cmd->position, cmd->speed, cmd->kp,
+                            cmd->kd, cmd->torque);
+            } break;
+
+            case DM_MODE_POS_SPEED: {
+                dm_pos_speed_ctrl(motor, cmd->position, cmd->speed);
+            } break;
+
+            case DM_MODE_SPEED: {
+                dm_speed_ctrl(motor, cmd->speed);
+            } break;
+
+            default: {
+            } break;
+        }
+
+#if HOST_CMD_TELEMETRY
+        telemetry_setpoint_t telemetry = {.position = cmd->position,
+                                          .speed = cmd->speed,
+                                          .kp = cmd->kp,
+                                          .kd = cmd->kd,
+                                          .torque = cmd->torque};
+        telemetry_set_setpoint(i, &telemetry);
+#endif /* HOST_CMD_TELEMETRY */
+
+        ++applied;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    host_cmd_stats.applied += applied;
+    host_cmd_stats.rejected += rejected;
+    __set_PRIMASK(primask);
+
+    return applied;
+}
+
+/**
+ * @brief 获取统计
+ *
+ * @param[out] stats 统计
+ */
+void host_cmd_get_stats(host_cmd_stats_t *stats) {
+    if (stats == NULL) {
+        return;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *stats = host_cmd_stats;
+    __set_PRIMASK(primask);
+}
@@ -0,0 +1,67 @@
+/**
+ * @file    host_cmd.h
+ * @author  Deadline039
+ * @brief   上位机二进制命令接收
+ * @version 1.0
+ * @date    2024-12-12
+ * @note    串口以零拷贝方式接收(`uart_dmarx_peek`), 在 IDLE 与 DMA 中断中
+ *          按 0x00 分帧, 直接在 DMA 缓冲区中 COBS 解码并用硬件 CRC 校验,
+ *          把每个设定值写入无锁队列. 控制任务每个周期开始时调用
+ *          `host_cmd_process`, 每个通道只执行最新的设定值, 收到的命令在
+ *          下一个控制周期内发到电机. 帧格式见 `host_cmd_record.h`, 上位机
+ *          可用 `Tools/host_cmd_host` 发送.
+ *
+ *          需要开启串口的 DMA 接收与串口中断. DMA 缓冲区至少为两帧
+ *          (`HOST_CMD_RX_BUF_MIN`), 该串口不能再用 `uart_dmarx_read` 或
+ *          `uart_scanf` 读取. 发送方向不受影响, 可以同时发送遥测.
+ */
+
+#ifndef __HOST_CMD_H
+#define __HOST_CMD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <CSP_Config.h>
+
+#include "Damiao-Motor/damiao.h"
+#include "cobs/cobs.h"
+#include "host_cmd_record.h"
+
+/* 队列长度(设定值个数), 必须为 2 的幂次方, 默认可缓存 4 个满帧 */
+#define HOST_CMD_QUEUE_SIZE 32
+
+/* 执行设定值时同时记录到遥测(`telemetry_set_setpoint`) */
+#define HOST_CMD_TELEMETRY  1
+
+/* 串口 DMA 接收缓冲区的最小长度: 缓冲区过半时才在中断中解析, 未解析的
+   数据最多为半个缓冲区加一帧 */
+#define HOST_CMD_RX_BUF_MIN (2 * (COBS_ENCODE_MAX(HOST_CMD_FRAME_MAX) + 2))
+
+/**
+ * @brief 接收统计
+ */
+typedef struct {
+    uint32_t frames;    /*!< 有效帧数 */
+    uint32_t commands;  /*!< 写入队列的设定值数 */
+    uint32_t applied;   /*!< 发到电机的设定值数 */
+    uint32_t seq_lost;  /*!< 按帧序号统计的丢帧数 */
+    uint32_t crc_error; /*!< CRC 错误的帧数 */
+    uint32_t invalid;   /*!< 长度、类型或通道不对的帧数 */
+    uint32_t rejected;  /*!< 通道未设置电机或模式不一致的设定值数 */
+    uint32_t dropped;   /*!< 队列满丢弃的设定值数 */
+    uint32_t lost;      /*!< 被 DMA 覆盖而丢弃的字节数 */
+} host_cmd_stats_t;
+
+uint8_t host_cmd_init(UART_HandleTypeDef *huart);
+void host_cmd_deinit(void);
+uint8_t host_cmd_add_channel(uint8_t channel, dm_handle_t *motor);
+uint32_t host_cmd_process(void);
+void host_cmd_get_stats(host_cmd_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __HOST_CMD_H */
@@ -0,0 +1,68 @@
+/**
+ * @file    host_cmd_record.h
+ * @author  Deadline039
+ * @brief   上位机命令帧格式, MCU 与上位机共用
+ * @version 1.0
+ * @date    2024-12-12
+ * @note    一帧为帧头 + 若干设定值 + CRC32, 全部小端, 字段按自然对齐排列.
+ *          CRC 与遥测帧相同, 按 32 位字计算帧头与设定值(`User/Utils/crc32`).
+ *          整帧经 COBS 编码后前后各加一个 0x00 分隔符发送.
+ *
+ *          本文件只依赖 stdint.h, 修改格式时需增加 `HOST_CMD_VERSION`.
+ */
+
+#ifndef __HOST_CMD_RECORD_H
+#define __HOST_CMD_RECORD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stdint.h>
+
+/* 帧格式版本, 写在帧类型的高 4 位 */
+#define HOST_CMD_VERSION       1U
+/* 帧类型: 电机设定值 */
+#define HOST_CMD_TYPE_SETPOINT 1U
+
+/* 一帧最多的设定值数, 也是通道数, 与 `DM_MOTOR_MAX_NUMBER` 相同 */
+#define HOST_CMD_CHANNEL_MAX   8
+
+/**
+ * @brief 帧头
+ */
+typedef struct {
+    uint8_t type;  /*!< 低 4 位帧类型, 高 4 位格式版本 */
+    uint8_t count; /*!< 设定值个数 */
+    uint16_t seq;  /*!< 帧序号, 每帧加 1, 用于统计丢帧 */
+} host_cmd_header_t;
+
+/**
+ * @brief 一个电机的设定值, 按 `mode` 使用其中的字段
+ */
+typedef struct {
+    uint8_t channel;   /*!< 通道号 */
+    uint8_t mode;      /*!< `dm_mode_t`, 需与电机当前模式一致 */
+    uint16_t reserved; /*!< 保留, 填 0 */
+
+    float position; /*!< 位置, MIT 与位置速度模式 */
+    float speed;    /*!< 速度, 所有模式 */
+    float kp;       /*!< Kp, MIT 模式 */
+    float kd;       /*!< Kd, MIT 模式 */
+    float torque;   /*!< 前馈扭矩, MIT 模式 */
+} host_cmd_setpoint_t;
+
+/* 帧的最大长度, 含 CRC, 不含 COBS 开销 */
+#define HOST_CMD_FRAME_MAX                                                     \
+    (sizeof(host_cmd_header_t) +                                               \
+     HOST_CMD_CHANNEL_MAX * sizeof(host_cmd_setpoint_t) + sizeof(uint32_t))
+
+_Static_assert(sizeof(host_cmd_header_t) == 4, "host command header layout");
+_Static_assert(sizeof(host_cmd_setpoint_t) == 24,
+               "host command setpoint layout");
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __HOST_CMD_RECORD_H */
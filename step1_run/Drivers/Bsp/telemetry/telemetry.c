@@ -0,0 +1,271 @@
+/**
+ * @file    telemetry.c
+ * @author  Deadline039
+ * @brief   电机状态二进制遥测, 通过串口 DMA 发送
+ * @version 1.0
+ * @date    2024-12-11
+ */
+
+#include "telemetry.h"
+
+#include "cobs/cobs.h"
+#include "core/core_crc.h"
+
+#include <string.h>
+
+/**
+ * @brief 通道
+ */
+typedef struct {
+    dm_handle_t *motor;            /*!< 电机, NULL 表示未使用 */
+    telemetry_setpoint_t setpoint; /*!< 最近一次的设定值 */
+} telemetry_channel_t;
+
+static UART_HandleTypeDef *telemetry_uart;
+static telemetry_channel_t telemetry_channels[TELEMETRY_CHANNEL_MAX];
+static volatile uint32_t telemetry_mask = 0xFFFFFFFFU;
+static volatile uint32_t telemetry_decimation = 1;
+static uint32_t telemetry_tick;
+static uint16_t telemetry_seq;
+static telemetry_stats_t telemetry_stats;
+
+/* 采样时间, 由 DWT 周期计数累加, 余下不足 1 us 的周期留到下一次 */
+static uint32_t telemetry_time_us;
+static uint32_t telemetry_last_cycles;
+static uint32_t telemetry_rest_cycles;
+
+/* 按字对齐, CRC 单元按字读取 */
+static uint32_t telemetry_frame[TELEMETRY_FRAME_MAX / sizeof(uint32_t)];
+static uint8_t telemetry_encoded[COBS_ENCODE_MAX(TELEMETRY_FRAME_MAX) + 2];
+
+/**
+ * @brief 温度转换为 0.1 ℃ 的整数
+ *
+ * @param temperature 温度
+ * @return 转换结果
+ */
+static int16_t telemetry_temperature(float temperature) {
+    return (int16_t)(temperature * 10.0f +
+                     ((temperature < 0.0f) ? -0.5f : 0.5f));
+}
+
+/**
+ * @brief 初始化遥测, 需先初始化串口并开启 DMA 发送. 发送缓冲区不足
+ *        `TELEMETRY_TX_FRAMES` 帧时扩大
+ *
+ * @param huart 串口句柄
+ * @return 初始化结果
+ * @retval - 0: 成功
+ * @retval - 1: 串口未开启 DMA 发送
+ * @retval - 2: 扩大发送缓冲区失败, 缓冲区不为空或内存不足
+ */
+uint8_t telemetry_init(UART_HandleTypeDef *huart) {
+    if ((huart == NULL) || (huart->hdmatx == NULL)) {
+        return 1;
+    }
+
+    /* 每条消息在发送缓冲区中另有 2 字节头, 按 4 字节留出 */
+    uint32_t size = TELEMETRY_TX_FRAMES * (sizeof(telemetry_encoded) + 4);
+    if ((uart_damtx_get_buf_szie(huart) < size) &&
+        (uart_dmatx_resize_buf(huart, size) != 0)) {
+        return 2;
+    }
+
+    crc_init();
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    telemetry_tick = 0;
+    telemetry_seq = 0;
+    telemetry_time_us = 0;
+    telemetry_last_cycles = DWT->CYCCNT;
+    telemetry_rest_cycles = 0;
+    memset(&telemetry_stats, 0, sizeof(telemetry_stats));
+    telemetry_uart = huart;
+
+    return 0;
+}
+
+/**
+ * @brief 设置通道对应的电机
+ *
+ * @param channel 通道号, 小于 `TELEMETRY_CHANNEL_MAX`
+ * @param motor 电机, NULL 删除该通道
+ * @return 设置结果
+ * @retval - 0: 成功
+ * @retval - 1: 通道号超出范围
+ */
+uint8_t telemetry_add_channel(uint8_t channel, dm_handle_t *motor) {
+    if (channel >= TELEMETRY_CHANNEL_MAX) {
+        return 1;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    telemetry_channels[channel].motor = motor;
+    memset(&telemetry_channels[channel].setpoint, 0,
+           sizeof(telemetry_setpoint_t));
+    __set_PRIMASK(primask);
+
+    return 0;
+}
+
+/**
+ * @brief 记录通道的控制设定值, 与反馈一起发送
+ *
+ * @param channel 通道号
+ * @param setpoint 设定值
+ */
+void telemetry_set_setpoint(uint8_t channel,
+                            const telemetry_setpoint_t *setpoint) {
+    if ((channel >= TELEMETRY_CHANNEL_MAX) || (setpoint == NULL)) {
+        return;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    telemetry_channels[channel].setpoint = *setpoint;
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief 选择发送的通道, 可在运行时修改
+ *
+ * @param mask 第 n 位为 1 发送通道 n, 默认全部发送
+ */
+void telemetry_select(uint32_t mask) {
+    telemetry_mask = mask;
+}
+
+/**
+ * @brief 设置抽取比, 每调用 `decimation` 次 `telemetry_process` 发送一帧
+ *
+ * @param decimation 抽取比, 0 按 1 处理
+ */
+void telemetry_set_decimation(uint32_t decimation) {
+    telemetry_decimation = (decimation == 0) ? 1 : decimation;
+}
+
+/**
+ * @brief 采样并发送一帧, 在固定周期的任务或定时器中断中调用(如 1 kHz).
+ *        快照在关中断下复制, 同一电机的各字段来自同一次反馈. 发送缓冲区满时
+ *        丢弃该帧, 帧序号照常增加
+ *
+ * @return 写入发送缓冲区的字节数, 未到抽取周期、没有选中的通道或丢弃时为 0
+ */
+uint32_t telemetry_process(void) {
+    if (telemetry_uart == NULL) {
+        return 0;
+    }
+
+    /* 每次调用都累加时间, 暂停发送时间也不会跳变 */
+    uint32_t start = DWT->CYCCNT;
+    uint32_t cycles_per_us = SystemCoreClock / 1000000;
+    uint32_t elapsed =
+        start - telemetry_last_cycles + telemetry_rest_cycles;
+    telemetry_last_cycles = start;
+    telemetry_rest_cycles = elapsed % cycles_per_us;
+    telemetry_time_us += elapsed / cycles_per_us;
+
+    if (++telemetry_tick < telemetry_decimation) {
+        return 0;
+    }
+    telemetry_tick = 0;
+
+    telemetry_header_t *header = (telemetry_header_t *)telemetry_frame;
+    telemetry_motor_t *record = (telemetry_motor_t *)&header[1];
+    uint32_t mask = telemetry_mask;
+    uint8_t count = 0;
+
+    for (uint8_t i = 0; i < TELEMETRY_CHANNEL_MAX; ++i) {
+        telemetry_channel_t *channel = &telemetry_channels[i];
+
+        if (((mask & (1U << i)) == 0) || (channel->motor == NULL)) {
+            continue;
+        }
+
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+
+        const dm_handle_t *motor = channel->motor;
+        if (motor == NULL) {
+            __set_PRIMASK(primask);
+            continue;
+        }
+
+        record->channel = i;
+        record->mode = (uint8_t)motor->mode;
+        record->error = (uint8_t)motor->error;
+        record->enabled = motor->enabled;
+        record->mos_temperature = telemetry_temperature(motor->mos_temperature);
+        record->motor_temperature =
+            telemetry_temperature(motor->motor_temperature);
+        record->position = motor->position;
+        record->speed = motor->speed;
+        record->torque = motor->torque;
+        record->set_position = channel->setpoint.position;
+        record->set_speed = channel->setpoint.speed;
+        record->set_kp = channel->setpoint.kp;
+        record->set_kd = channel->setpoint.kd;
+        record->set_torque = channel->setpoint.torque;
+
+        __set_PRIMASK(primask);
+
+        ++record;
+        ++count;
+    }
+
+    ++telemetry_stats.samples;
+
+    if (count == 0) {
+        return 0;
+    }
+
+    header->type = (TELEMETRY_VERSION << 4) | TELEMETRY_TYPE_MOTOR;
+    header->count = count;
+    header->seq = telemetry_seq++;
+    header->time_us = telemetry_time_us;
+
+    size_t len = (size_t)((uint8_t *)record - (uint8_t *)telemetry_frame);
+    uint32_t crc = crc_calculate(telemetry_frame, len);
+    memcpy(record, &crc, sizeof(uint32_t));
+    len += sizeof(uint32_t);
+
+    /* 帧前后各一个分隔符, 两帧之间的文本单独成为一段, 不会破坏下一帧 */
+    telemetry_encoded[0] = 0x00;
+    size_t encoded_len = 1 + cobs_encode((const uint8_t *)telemetry_frame,
+                                         len, &telemetry_encoded[1]);
+    telemetry_encoded[encoded_len++] = 0x00;
+
+    uint32_t cycles = DWT->CYCCNT - start;
+    if (cycles > telemetry_stats.max_cycles) {
+        telemetry_stats.max_cycles = cycles;
+    }
+
+    if (uart_dmatx_write(telemetry_uart, telemetry_encoded, encoded_len) ==
+        0) {
+        ++telemetry_stats.dropped;
+        return 0;
+    }
+
+    ++telemetry_stats.frames;
+    telemetry_stats.bytes += encoded_len;
+
+    return encoded_len;
+}
+
+/**
+ * @brief 获取统计
+ *
+ * @param[out] stats 统计
+ */
+void telemetry_get_stats(telemetry_stats_t *stats) {
+    if (stats == NULL) {
+        return;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *stats = telemetry_stats;
+    __set_PRIMASK(primask);
+}
@@ -0,0 +1,67 @@
+/**
+ * @file    telemetry.h
+ * @author  Deadline039
+ * @brief   电机状态二进制遥测, 通过串口 DMA 发送
+ * @version 1.0
+ * @date    2024-12-11
+ * @note    每次调用 `telemetry_process` 对选中的电机做一次快照, 打包为
+ *          `telemetry_record.h` 中的帧, 用硬件 CRC 单元计算 CRC, COBS 编码后
+ *          写入串口的 DMA 发送环形缓冲区. 主机用 `Tools/telemetry_host`
+ *          解码为 CSV 或按列存储的文件.
+ *
+ *          8 个电机一帧 336 字节, 1 kHz 时(8N1)需要 3.36 Mbaud, 用 4.5 Mbaud;
+ *          4 个电机 175 字节, 2 Mbaud 可以满足. 带宽不足时降低抽取比或减少
+ *          通道, 发送缓冲区满时丢弃整帧, 由帧序号体现.
+ */
+
+#ifndef __TELEMETRY_H
+#define __TELEMETRY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <CSP_Config.h>
+
+#include "Damiao-Motor/damiao.h"
+#include "telemetry_record.h"
+
+/* 发送缓冲区至少能容纳的帧数, 初始化时不足则扩大 */
+#define TELEMETRY_TX_FRAMES 4
+
+/**
+ * @brief 控制设定值, 由控制任务在发送控制帧时一并设置
+ */
+typedef struct {
+    float position; /*!< 位置设定 */
+    float speed;    /*!< 速度设定 */
+    float kp;       /*!< Kp 设定 */
+    float kd;       /*!< Kd 设定 */
+    float torque;   /*!< 前馈扭矩设定 */
+} telemetry_setpoint_t;
+
+/**
+ * @brief 遥测统计
+ */
+typedef struct {
+    uint32_t samples;     /*!< 调用 `telemetry_process` 并采样的次数 */
+    uint32_t frames;      /*!< 写入发送缓冲区的帧数 */
+    uint32_t dropped;     /*!< 发送缓冲区满丢弃的帧数 */
+    uint32_t bytes;       /*!< 写入的字节数, 含 COBS 与分隔符 */
+    uint32_t max_cycles;  /*!< 一次打包与编码的最大 CPU 周期 */
+} telemetry_stats_t;
+
+uint8_t telemetry_init(UART_HandleTypeDef *huart);
+uint8_t telemetry_add_channel(uint8_t channel, dm_handle_t *motor);
+void telemetry_set_setpoint(uint8_t channel,
+                            const telemetry_setpoint_t *setpoint);
+void telemetry_select(uint32_t mask);
+void telemetry_set_decimation(uint32_t decimation);
+uint32_t telemetry_process(void);
+void telemetry_get_stats(telemetry_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __TELEMETRY_H */
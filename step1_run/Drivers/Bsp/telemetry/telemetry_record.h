@@ -0,0 +1,76 @@
+/**
+ * @file    telemetry_record.h
+ * @author  Deadline039
+ * @brief   遥测帧格式, MCU 与上位机共用
+ * @version 1.0
+ * @date    2024-12-11
+ * @note    一帧为帧头 + 若干电机记录 + CRC32, 全部小端. 字段按自然对齐排列,
+ *          不需要 packed. CRC 按 32 位字计算帧头与记录(长度总是 4 的倍数),
+ *          与 STM32 CRC 单元相同(`User/Utils/crc32`). 整帧经 COBS 编码后前后
+ *          各加一个 0x00 分隔符发送, 同一串口上的文本输出不会破坏帧边界.
+ *
+ *          本文件只依赖 stdint.h, 修改格式时需增加 `TELEMETRY_VERSION`.
+ */
+
+#ifndef __TELEMETRY_RECORD_H
+#define __TELEMETRY_RECORD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stdint.h>
+
+/* 帧格式版本, 写在帧类型的高 4 位 */
+#define TELEMETRY_VERSION     1U
+/* 帧类型: 电机状态 */
+#define TELEMETRY_TYPE_MOTOR  1U
+
+/* 一帧最多的电机数, 与 `DM_MOTOR_MAX_NUMBER` 相同 */
+#define TELEMETRY_CHANNEL_MAX 8
+
+/**
+ * @brief 帧头
+ */
+typedef struct {
+    uint8_t type;     /*!< 低 4 位帧类型, 高 4 位格式版本 */
+    uint8_t count;    /*!< 电机记录数 */
+    uint16_t seq;     /*!< 帧序号, 每帧加 1, 用于统计丢帧 */
+    uint32_t time_us; /*!< 采样时间, 单位 us, 约 71 分钟回绕 */
+} telemetry_header_t;
+
+/**
+ * @brief 一个电机的记录, 反馈值与最近一次的控制设定值
+ */
+typedef struct {
+    uint8_t channel;           /*!< 通道号 */
+    uint8_t mode;              /*!< `dm_mode_t` */
+    uint8_t error;             /*!< `dm_error_t` */
+    uint8_t enabled;           /*!< 是否已使能 */
+    int16_t mos_temperature;   /*!< MOS 温度, 单位 0.1 ℃ */
+    int16_t motor_temperature; /*!< 线圈温度, 单位 0.1 ℃ */
+
+    float position; /*!< 位置反馈 */
+    float speed;    /*!< 速度反馈 */
+    float torque;   /*!< 扭矩反馈 */
+
+    float set_position; /*!< 位置设定 */
+    float set_speed;    /*!< 速度设定 */
+    float set_kp;       /*!< Kp 设定 */
+    float set_kd;       /*!< Kd 设定 */
+    float set_torque;   /*!< 前馈扭矩设定 */
+} telemetry_motor_t;
+
+/* 帧的最大长度, 含 CRC, 不含 COBS 开销 */
+#define TELEMETRY_FRAME_MAX                                                    \
+    (sizeof(telemetry_header_t) +                                              \
+     TELEMETRY_CHANNEL_MAX * sizeof(telemetry_motor_t) + sizeof(uint32_t))
+
+_Static_assert(sizeof(telemetry_header_t) == 8, "telemetry header layout");
+_Static_assert(sizeof(telemetry_motor_t) == 40, "telemetry record layout");
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __TELEMETRY_RECORD_H */
@@ -12,984 +12,3710 @@
 
 #include "CAN_STM32F4xx.h"
 
-#include <math.h>
+#include "can_bit_timing/can_bit_timing.h"
+#include "mpsc_fifo/mpsc_fifo.h"
 
+#include <string.h>
+
+/* Timestamp of CAN, the DWT cycle counter. */
+#define CAN_TIMESTAMP_INIT()                                                   \
+    do {                                                                       \
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;                        \
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;                                   \
+    } while (0)
+#define CAN_GET_TIMESTAMP() (DWT->CYCCNT)
 
 /*****************************************************************************
- * @defgroup CAN1 Functions.
+ * @defgroup Filter functions.
  * @{
  */
 
-#if CAN1_ENABLE
+/**
+ * @brief Filter bank used by `can_filter_add`.
+ */
+typedef struct {
+    uint32_t can_ide; /*!< `CAN_ID_STD` or `CAN_ID_EXT`.         */
+    uint32_t id;      /*!< CAN ID.                               */
+    uint32_t id_mask; /*!< CAN ID mask.                          */
+    uint8_t used;     /*!< Whether this bank is used.            */
+} can_filter_bank_t;
 
-CAN_HandleTypeDef can1_handle = {.Instance = CAN1,
-                                 .Init = {.Mode = CAN_MODE_NORMAL,
-                                          .TimeTriggeredMode = DISABLE,
-                                          .AutoBusOff = DISABLE,
-                                          .AutoWakeUp = DISABLE,
-                                          .AutoRetransmission = ENABLE,
-                                          .ReceiveFifoLocked = DISABLE,
-                                          .TransmitFifoPriority = DISABLE}};
+static can_filter_bank_t can_filter_bank[3][CAN_FILTER_BANK_NUMBER - 1];
 
 /**
- * @brief CAN1 initialization
+ * @brief Get the first filter bank of the CAN.
  *
- * @param baud_rate Baud rate. Unit: Kbps.
- * @param prop_delay The propagation delay of bus, include cable and can
- *                   transceiver. Unit: ns.
- * @return CAN init status.
- * @retval - 0: `CAN_INIT_OK`:           Success.
- * @retval - 1: `CAN_INIT_RATE_ERR`:     Can not satisfied this baudrate in this
- *                                       condition.
- * @retval - 2: `CAN_INIT_FILTER_FAIL`:  CAN Filter init failed.
- * @retval - 3: `CAN_INIT_FAIL`:         CAN hardware init failed.
- * @retval - 4: `CAN_INIT_START_FAIL`:   CAN start failed.
- * @retval - 5: `CAN_INIT_NOTIFY_FAIL`:  Enable CAN receive notify failed.
- * @retval - 6: `CAN_INITED`:            This can is inited.
+ * @param can_selected Specific which CAN.
+ * @return The first filter bank.
  */
-uint8_t can1_init(uint32_t baud_rate, uint32_t prop_delay) {
-    if (__HAL_RCC_CAN1_IS_CLK_ENABLED()) {
-        return CAN_INITED;
+static inline uint32_t can_filter_first_bank(can_selected_t can_selected) {
+    return (can_selected == can2_selected) ? CAN_FILTER_SLAVE_START : 0;
+}
+
+/**
+ * @brief Config a filter bank in 32 bit mask mode.
+ *
+ * @param hcan The handle of CAN.
+ * @param bank The filter bank.
+ * @param filter_id Value of the filter register, same layout as `CAN_RIxR`.
+ * @param filter_mask Mask of the filter register.
+ * @param fifo `CAN_FILTER_FIFO0` or `CAN_FILTER_FIFO1`.
+ * @param activation `CAN_FILTER_ENABLE` or `CAN_FILTER_DISABLE`.
+ * @return Config status:
+ * @retval - 0: Success.
+ * @retval - 1: Config failed.
+ */
+static uint8_t can_filter_config(CAN_HandleTypeDef *hcan, uint32_t bank,
+                                 uint32_t filter_id, uint32_t filter_mask,
+                                 uint32_t fifo, uint32_t activation) {
+    CAN_FilterTypeDef can_filter_config;
+
+    can_filter_config.FilterBank = bank;
+    can_filter_config.FilterMode = CAN_FILTERMODE_IDMASK;
+    can_filter_config.FilterScale = CAN_FILTERSCALE_32BIT;
+    can_filter_config.FilterIdHigh = filter_id >> 16;
+    can_filter_config.FilterIdLow = filter_id & 0xFFFF;
+    can_filter_config.FilterMaskIdHigh = filter_mask >> 16;
+    can_filter_config.FilterMaskIdLow = filter_mask & 0xFFFF;
+    can_filter_config.FilterFIFOAssignment = fifo;
+    can_filter_config.FilterActivation = activation;
+    can_filter_config.SlaveStartFilterBank = CAN_FILTER_SLAVE_START;
+
+    if (HAL_CAN_ConfigFilter(hcan, &can_filter_config) != HAL_OK) {
+        return 1;
     }
 
-    uint32_t prescale, tbs1, tbs2, tsjw;
-    if (can_rate_calc(baud_rate * 1000, prop_delay, HAL_RCC_GetPCLK1Freq(),
-                      &prescale, &tsjw, &tbs1, &tbs2) == 1) {
-        return CAN_INIT_RATE_ERR;
+    return 0;
+}
+
+/**
+ * @brief Route the frames of the ID to the specific FIFO with a dedicated
+ *        filter bank. The filter has higher match priority than the accept
+ *        all filter, so the frames of this ID never queue behind the other
+ *        traffic in the FIFO.
+ *
+ * @param can_selected Specific which CAN.
+ * @param can_ide Specific standard ID or Extend ID.
+ * @param id The ID to route.
+ * @param id_mask The ID mask, the bits set must match.
+ * @param fifo `CAN_FILTER_FIFO0` or `CAN_FILTER_FIFO1`.
+ * @return Operational status:
+ * @retval - 0: Success.
+ * @retval - 1: No filter bank is free.
+ * @retval - 2: Filter config failed, the CAN is not initialized.
+ * @retval - 3: Parameter invalid.
+ * @note The reception stops in a short time when configuring the filter.
+ *       Call in the thread context.
+ */
+uint8_t can_filter_add(can_selected_t can_selected, uint32_t can_ide,
+                       uint32_t id, uint32_t id_mask, uint32_t fifo) {
+    CAN_HandleTypeDef *can_handle = can_get_handle(can_selected);
+    if (can_handle == NULL) {
+        return 3;
     }
 
-    can1_handle.Init.Prescaler = prescale;
-    can1_handle.Init.TimeSeg1 = (tbs1 - 1) << CAN_BTR_TS1_Pos;
-    can1_handle.Init.TimeSeg2 = (tbs2 - 1) << CAN_BTR_TS2_Pos;
-    can1_handle.Init.SyncJumpWidth = (tsjw - 1) << CAN_BTR_SJW_Pos;
+    if ((can_ide != CAN_ID_STD) && (can_ide != CAN_ID_EXT)) {
+        return 3;
+    }
 
-    if (HAL_CAN_Init(&can1_handle) != HAL_OK) {
-        return CAN_INIT_FAIL;
+    if ((fifo != CAN_FILTER_FIFO0) && (fifo != CAN_FILTER_FIFO1)) {
+        return 3;
     }
 
-    CAN_FilterTypeDef can_filter_config;
+    can_filter_bank_t *banks = can_filter_bank[can_selected];
+    uint32_t index = CAN_FILTER_BANK_NUMBER - 1;
 
-    can_filter_config.FilterBank = 0;
-    can_filter_config.FilterMode = CAN_FILTERMODE_IDMASK;
-    can_filter_config.FilterScale = CAN_FILTERSCALE_32BIT;
-    can_filter_config.FilterIdHigh = 0x0000;
-    can_filter_config.FilterIdLow = 0x0000;
-    can_filter_config.FilterMaskIdHigh = 0x0000;
-    can_filter_config.FilterMaskIdLow = 0x0000;
-    can_filter_config.FilterActivation = CAN_FILTER_ENABLE;
-    can_filter_config.SlaveStartFilterBank = 0;
+    for (uint32_t i = 0; i < CAN_FILTER_BANK_NUMBER - 1; ++i) {
+        if (banks[i].used == 0) {
+            if (index == CAN_FILTER_BANK_NUMBER - 1) {
+                index = i;
+            }
+            continue;
+        }
 
-#if CAN1_RX0_IT_ENABLE
-    can_filter_config.FilterFIFOAssignment = CAN_FILTER_FIFO0;
-    if (HAL_CAN_ConfigFilter(&can1_handle, &can_filter_config) != HAL_OK) {
-        return CAN_INIT_FILTER_FAIL;
-    }
-    if (HAL_CAN_ActivateNotification(&can1_handle,
-                                     CAN_IT_RX_FIFO0_MSG_PENDING) != HAL_OK) {
-        return CAN_INIT_NOTIFY_FAIL;
+        if ((banks[i].can_ide == can_ide) && (banks[i].id == id) &&
+            (banks[i].id_mask == id_mask)) {
+            /* Already added, change the FIFO only. */
+            index = i;
+            break;
+        }
     }
-#endif /* CAN1_RX0_IT_ENABLE */
 
-#if CAN1_RX1_IT_ENABLE
-    can_filter_config.FilterFIFOAssignment = CAN_FILTER_FIFO1;
-    if (HAL_CAN_ConfigFilter(&can1_handle, &can_filter_config) != HAL_OK) {
-        return CAN_INIT_FILTER_FAIL;
+    if (index == CAN_FILTER_BANK_NUMBER - 1) {
+        return 1;
     }
-    if (HAL_CAN_ActivateNotification(&can1_handle,
-                                     CAN_IT_RX_FIFO1_MSG_PENDING) != HAL_OK) {
-        return CAN_INIT_NOTIFY_FAIL;
+
+    uint32_t filter_id, filter_mask;
+
+    if (can_ide == CAN_ID_STD) {
+        filter_id = (id & 0x7FFU) << CAN_RI0R_STID_Pos;
+        filter_mask = (id_mask & 0x7FFU) << CAN_RI0R_STID_Pos;
+    } else {
+        filter_id = ((id & 0x1FFFFFFFU) << CAN_RI0R_EXID_Pos) | CAN_ID_EXT;
+        filter_mask = (id_mask & 0x1FFFFFFFU) << CAN_RI0R_EXID_Pos;
     }
-#endif /* CAN1_RX1_IT_ENABLE */
 
-    if (HAL_CAN_Start(&can1_handle) != HAL_OK) {
-        return CAN_INIT_START_FAIL;
+    /* The IDE bit must match, ignore the RTR bit. */
+    filter_mask |= CAN_ID_EXT;
+
+    if (can_filter_config(can_handle,
+                          can_filter_first_bank(can_selected) + index,
+                          filter_id, filter_mask, fifo,
+                          CAN_FILTER_ENABLE) != 0) {
+        return 2;
     }
 
-    return CAN_INIT_OK;
-}
+    banks[index].can_ide = can_ide;
+    banks[index].id = id;
+    banks[index].id_mask = id_mask;
+    banks[index].used = 1;
 
-#if CAN1_TX_IT_ENABLE
+    return 0;
+}
 
 /**
- * @brief CAN1 TX ISR.
+ * @brief Remove the filter added by `can_filter_add`, the frames of the ID
+ *        are received by the accept all filter again.
  *
+ * @param can_selected Specific which CAN.
+ * @param can_ide Specific standard ID or Extend ID.
+ * @param id The ID added.
+ * @param id_mask The ID mask added.
+ * @return Operational status:
+ * @retval - 0: Success.
+ * @retval - 1: The filter does not exist.
+ * @retval - 2: Filter config failed.
+ * @retval - 3: Parameter invalid.
  */
-void CAN1_TX_IRQHandler(void) {
-    HAL_CAN_IRQHandler(&can1_handle);
-}
+uint8_t can_filter_remove(can_selected_t can_selected, uint32_t can_ide,
+                          uint32_t id, uint32_t id_mask) {
+    CAN_HandleTypeDef *can_handle = can_get_handle(can_selected);
+    if (can_handle == NULL) {
+        return 3;
+    }
 
-#endif /* CAN1_TX_IT_ENABLE */
+    can_filter_bank_t *banks = can_filter_bank[can_selected];
 
-#if CAN1_RX0_IT_ENABLE
+    for (uint32_t i = 0; i < CAN_FILTER_BANK_NUMBER - 1; ++i) {
+        if ((banks[i].used == 0) || (banks[i].can_ide != can_ide) ||
+            (banks[i].id != id) || (banks[i].id_mask != id_mask)) {
+            continue;
+        }
 
-/**
- * @brief CAN1 RX FIFO0 ISR.
- *
- */
-void CAN1_RX0_IRQHandler(void) {
-    HAL_CAN_IRQHandler(&can1_handle);
-}
+        if (can_filter_config(can_handle,
+                              can_filter_first_bank(can_selected) + i,
+                              0x00000000, 0x00000000, CAN_FILTER_FIFO0,
+                              CAN_FILTER_DISABLE) != 0) {
+            return 2;
+        }
 
-#endif /* CAN1_RX0_IT_ENABLE */
+        banks[i].used = 0;
 
-#if CAN1_RX1_IT_ENABLE
+        return 0;
+    }
+
+    return 1;
+}
 
 /**
- * @brief CAN1 RX FIFO1 ISR.
- *
+ * @}
  */
-void CAN1_RX1_IRQHandler(void) {
-    HAL_CAN_IRQHandler(&can1_handle);
-}
 
-#endif /* CAN1_RX1_IT_ENABLE */
 
-#if CAN1_SCE_IT_ENABLE
+/*****************************************************************************
+ * @defgroup Bus meter functions.
+ * @{
+ */
+
+/* Bits after the CRC sequence, never stuffed: CRC delimiter, ACK slot, ACK
+   delimiter, end of frame and intermission. */
+#define CAN_FRAME_TAIL_BITS 13
 
 /**
- * @brief CAN1 SCE ISR.
+ * @brief Bit stream of a frame, count the stuff bits and the CRC.
+ */
+typedef struct {
+    uint32_t crc;   /*!< CRC-15 of the bits put.                */
+    uint32_t last;  /*!< Last bit on the bus, 2 before SOF.     */
+    uint32_t run;   /*!< Same bits in a row, include stuff bit. */
+    uint32_t stuff; /*!< Stuff bits inserted.                   */
+} can_bit_stream_t;
+
+/**
+ * @brief Put the bits into the stream, MSB first.
  *
+ * @param stream The bit stream.
+ * @param value The bits.
+ * @param bits Number of bits.
+ * @param crc Whether the bits are covered by the CRC.
  */
-void CAN1_SCE_IRQHandler(void) {
-    HAL_CAN_IRQHandler(&can1_handle);
-}
+static inline void can_bit_stream_put(can_bit_stream_t *stream,
+                                      uint32_t value, uint32_t bits,
+                                      uint8_t crc) {
+    while (bits > 0) {
+        --bits;
+        uint32_t bit = (value >> bits) & 1U;
+
+        if (crc) {
+            uint32_t next = bit ^ ((stream->crc >> 14) & 1U);
+            stream->crc = (stream->crc << 1) & 0x7FFFU;
+            if (next) {
+                stream->crc ^= 0x4599U;
+            }
+        }
 
-#endif /* CAN1_SCE_IT_ENABLE */
+        if (bit != stream->last) {
+            stream->last = bit;
+            stream->run = 1;
+        } else if (++stream->run == 5) {
+            /* The stuff bit is the opposite, and starts the next run. */
+            ++stream->stuff;
+            stream->last = !bit;
+            stream->run = 1;
+        }
+    }
+}
 
 /**
- * @brief CAN1 deinitialization.
+ * @brief Get the bits of the frame on the bus, from SOF to the end of
+ *        intermission, the stuff bits are counted by the real content.
  *
- * @return Deinit status.
- * @retval - 0: `CAN_DEINIT_OK`:   Success.
- * @retval - 1: `CAN_DEINIT_FAIL`: CAN hardware deinit failed.
- * @retval - 2: `CAN_NO_INIT`:     This can is no init.
+ * @param can_ide Specific standard ID or Extend ID.
+ * @param id Message ID.
+ * @param rtr Specific data frame or remote frame.
+ * @param len Message length, 8 at most.
+ * @param msg Message content, not used by remote frame.
+ * @param[out] stuff The stuff bits in the frame, can be `NULL`.
+ * @return The bits of the frame.
  */
-uint8_t can1_deinit(void) {
-    if (__HAL_RCC_CAN1_CLK_DISABLE()) {
-        return CAN_NO_INIT;
+uint32_t can_frame_bits(uint32_t can_ide, uint32_t id, uint32_t rtr,
+                        uint8_t len, const uint8_t *msg, uint32_t *stuff) {
+    can_bit_stream_t stream = {.crc = 0, .last = 2, .run = 0, .stuff = 0};
+    uint32_t rtr_bit = (rtr == CAN_RTR_REMOTE) ? 1U : 0U;
+    uint32_t bits;
+
+    if (len > 8) {
+        len = 8;
     }
 
-    if (HAL_CAN_Stop(&can1_handle) != HAL_OK) {
-        return CAN_DEINIT_FAIL;
+    /* SOF, the dominant bit is 0. */
+    can_bit_stream_put(&stream, 0, 1, 1);
+
+    if (can_ide == CAN_ID_STD) {
+        /* ID, RTR, IDE and r0. */
+        can_bit_stream_put(&stream, id & 0x7FFU, 11, 1);
+        can_bit_stream_put(&stream, rtr_bit << 2, 3, 1);
+        bits = 1 + 11 + 3;
+    } else {
+        /* Base ID, SRR, IDE, extended ID, RTR, r1 and r0. */
+        can_bit_stream_put(&stream, (id >> 18) & 0x7FFU, 11, 1);
+        can_bit_stream_put(&stream, 3U, 2, 1);
+        can_bit_stream_put(&stream, id & 0x3FFFFU, 18, 1);
+        can_bit_stream_put(&stream, rtr_bit << 2, 3, 1);
+        bits = 1 + 11 + 2 + 18 + 3;
     }
 
-    if (HAL_CAN_DeInit(&can1_handle) != HAL_OK) {
-        return CAN_DEINIT_FAIL;
+    can_bit_stream_put(&stream, len, 4, 1);
+    bits += 4;
+
+    if ((rtr_bit == 0) && (msg != NULL)) {
+        for (uint8_t i = 0; i < len; ++i) {
+            can_bit_stream_put(&stream, msg[i], 8, 1);
+        }
+        bits += len * 8U;
     }
 
-    return CAN_DEINIT_OK;
+    can_bit_stream_put(&stream, stream.crc, 15, 0);
+    bits += 15;
+
+    if (stuff != NULL) {
+        *stuff = stream.stuff;
+    }
+
+    return bits + stream.stuff + CAN_FRAME_TAIL_BITS;
 }
 
-#endif /* CAN1_ENABLE */
+#if CAN_METER_ENABLE
+
+/* Bits of an error frame: error flag, error delimiter and intermission. The
+   broken frame and the superposed error flags are not known. */
+#define CAN_METER_ERROR_FRAME_BITS 17
+
+/* Slots of the rolling window, the current slot is not finished. */
+#define CAN_METER_SLOT_TOTAL       (CAN_METER_SLOT_NUMBER + 1)
 
 /**
- * @}
+ * @brief Bus meter state of a CAN.
  */
+typedef struct {
+    uint32_t slot_epoch[CAN_METER_SLOT_TOTAL]; /*!< Slot start, unit: slot. */
+    uint32_t slot_bits[CAN_METER_SLOT_TOTAL];  /*!< Bits in the slot.       */
+    can_meter_t meter;                         /*!< Counters.               */
+} can_meter_state_t;
 
+static can_meter_state_t can_meter_state[3];
 
+/**
+ * @brief Reset the bus meter, call when the CAN is initialized.
+ *
+ * @param can_selected Specific which CAN.
+ * @param bit_rate Bit rate, unit: bps.
+ */
+static void can_meter_init(can_selected_t can_selected, uint32_t bit_rate) {
+    can_meter_state_t *state = &can_meter_state[can_selected];
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    memset(state, 0, sizeof(can_meter_state_t));
+    state->meter.bit_rate = bit_rate;
+    __set_PRIMASK(primask);
+}
 
-/*****************************************************************************
- * @defgroup CAN2 Functions.
- * @{
+/**
+ * @brief Add the bits into the rolling window, call in critical section.
+ *
+ * @param state The meter state.
+ * @param bits Bits on the bus.
  */
+static void can_meter_add_bits(can_meter_state_t *state, uint32_t bits) {
+    uint32_t epoch = HAL_GetTick() / CAN_METER_SLOT_MS;
+    uint32_t index = epoch % CAN_METER_SLOT_TOTAL;
 
-#if CAN2_ENABLE
+    if (state->slot_epoch[index] != epoch) {
+        state->slot_epoch[index] = epoch;
+        state->slot_bits[index] = 0;
+    }
 
-CAN_HandleTypeDef can2_handle = {.Instance = CAN2,
-                                 .Init = {.Mode = CAN_MODE_NORMAL,
-                                          .TimeTriggeredMode = DISABLE,
-                                          .AutoBusOff = DISABLE,
-                                          .AutoWakeUp = DISABLE,
-                                          .AutoRetransmission = ENABLE,
-                                          .ReceiveFifoLocked = DISABLE,
-                                          .TransmitFifoPriority = DISABLE}};
+    state->slot_bits[index] += bits;
+}
 
 /**
- * @brief CAN2 initialization
+ * @brief Count a frame on the bus.
  *
- * @param baud_rate Baud rate. Unit: Kbps.
- * @param prop_delay The propagation delay of bus, include cable and can
- *                   transceiver. Unit: ns.
- * @return CAN init status.
- * @retval - 0: `CAN_INIT_OK`:           Success.
- * @retval - 1: `CAN_INIT_RATE_ERR`:     Can not satisfied this baudrate in this
- *                                       condition.
- * @retval - 2: `CAN_INIT_FILTER_FAIL`:  CAN Filter init failed.
- * @retval - 3: `CAN_INIT_FAIL`:         CAN hardware init failed.
- * @retval - 4: `CAN_INIT_START_FAIL`:   CAN start failed.
- * @retval - 5: `CAN_INIT_NOTIFY_FAIL`:  Enable CAN receive notify failed.
- * @retval - 6: `CAN_INITED`:            This can is inited.
+ * @param can_selected Specific which CAN.
+ * @param tx Whether the frame is sent by this CAN.
+ * @param bits Bits of the frame, `can_frame_bits`.
+ * @param stuff Stuff bits of the frame.
  */
-uint8_t can2_init(uint32_t baud_rate, uint32_t prop_delay) {
-    if (__HAL_RCC_CAN2_IS_CLK_ENABLED()) {
-        return CAN_INITED;
-    }
+static void can_meter_add_frame(can_selected_t can_selected, uint8_t tx,
+                                uint32_t bits, uint32_t stuff) {
+    can_meter_state_t *state = &can_meter_state[can_selected];
 
-    uint32_t prescale, tbs1, tbs2, tsjw;
-    if (can_rate_calc(baud_rate * 1000, prop_delay, HAL_RCC_GetPCLK1Freq(),
-                      &prescale, &tsjw, &tbs1, &tbs2) == 1) {
-        return CAN_INIT_RATE_ERR;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (tx) {
+        ++state->meter.tx_frames;
+        state->meter.tx_bits += bits;
+    } else {
+        ++state->meter.rx_frames;
+        state->meter.rx_bits += bits;
     }
+    state->meter.stuff_bits += stuff;
+    can_meter_add_bits(state, bits);
 
-    can2_handle.Init.Prescaler = prescale;
-    can2_handle.Init.TimeSeg1 = (tbs1 - 1) << CAN_BTR_TS1_Pos;
-    can2_handle.Init.TimeSeg2 = (tbs2 - 1) << CAN_BTR_TS2_Pos;
-    can2_handle.Init.SyncJumpWidth = (tsjw - 1) << CAN_BTR_SJW_Pos;
+    __set_PRIMASK(primask);
+}
 
-    if (HAL_CAN_Init(&can2_handle) != HAL_OK) {
-        return CAN_INIT_FAIL;
+/**
+ * @brief Count the TX latency, call in critical section.
+ *
+ * @param can_selected Specific which CAN.
+ * @param latency From push to transmitted, unit: CPU cycles.
+ * @param wire_time From mailbox request to transmitted, unit: CPU cycles.
+ */
+static void can_meter_add_latency(can_selected_t can_selected,
+                                  uint32_t latency, uint32_t wire_time) {
+    can_meter_t *meter = &can_meter_state[can_selected].meter;
+    uint32_t cycles_per_us = SystemCoreClock / 1000000U;
+    uint32_t bucket = 0;
+
+    latency /= cycles_per_us;
+    wire_time /= cycles_per_us;
+
+    if (latency >= 2) {
+        bucket = 31U - __CLZ(latency);
+        if (bucket >= CAN_METER_LATENCY_BUCKETS) {
+            bucket = CAN_METER_LATENCY_BUCKETS - 1;
+        }
     }
 
-    CAN_FilterTypeDef can_filter_config;
+    ++meter->latency_hist[bucket];
+    if (wire_time > meter->max_wire_time) {
+        meter->max_wire_time = wire_time;
+    }
+}
 
-    can_filter_config.FilterBank = 0;
-    can_filter_config.FilterMode = CAN_FILTERMODE_IDMASK;
-    can_filter_config.FilterScale = CAN_FILTERSCALE_32BIT;
-    can_filter_config.FilterIdHigh = 0x0000;
-    can_filter_config.FilterIdLow = 0x0000;
-    can_filter_config.FilterMaskIdHigh = 0x0000;
-    can_filter_config.FilterMaskIdLow = 0x0000;
-    can_filter_config.FilterActivation = CAN_FILTER_ENABLE;
-    can_filter_config.SlaveStartFilterBank = 0;
+/**
+ * @brief Get the percentile of the latency histogram.
+ *
+ * @param meter The meter.
+ * @param percent Percentile.
+ * @return The upper bound of the bucket, unit: us. 0 if no sample.
+ */
+static uint32_t can_meter_percentile(const can_meter_t *meter,
+                                     uint32_t percent) {
+    uint32_t total = 0;
+    uint32_t sum = 0;
 
-#if CAN2_RX0_IT_ENABLE
-    can_filter_config.FilterFIFOAssignment = CAN_FILTER_FIFO0;
-    if (HAL_CAN_ConfigFilter(&can2_handle, &can_filter_config) != HAL_OK) {
-        return CAN_INIT_FILTER_FAIL;
-    }
-    if (HAL_CAN_ActivateNotification(&can2_handle,
-                                     CAN_IT_RX_FIFO0_MSG_PENDING) != HAL_OK) {
-        return CAN_INIT_NOTIFY_FAIL;
+    for (uint32_t i = 0; i < CAN_METER_LATENCY_BUCKETS; ++i) {
+        total += meter->latency_hist[i];
     }
-#endif /* CAN2_RX0_IT_ENABLE */
 
-#if CAN2_RX1_IT_ENABLE
-    can_filter_config.FilterFIFOAssignment = CAN_FILTER_FIFO1;
-    if (HAL_CAN_ConfigFilter(&can2_handle, &can_filter_config) != HAL_OK) {
-        return CAN_INIT_FILTER_FAIL;
-    }
-    if (HAL_CAN_ActivateNotification(&can2_handle,
-                                     CAN_IT_RX_FIFO1_MSG_PENDING) != HAL_OK) {
-        return CAN_INIT_NOTIFY_FAIL;
+    if (total == 0) {
+        return 0;
     }
-#endif /* CAN2_RX1_IT_ENABLE */
 
-    if (HAL_CAN_Start(&can2_handle) != HAL_OK) {
-        return CAN_INIT_START_FAIL;
+    uint32_t target = (uint32_t)(((uint64_t)total * percent + 99) / 100);
+
+    for (uint32_t i = 0; i < CAN_METER_LATENCY_BUCKETS; ++i) {
+        sum += meter->latency_hist[i];
+        if (sum >= target) {
+            return 2U << i;
+        }
     }
 
-    return CAN_INIT_OK;
+    return 2U << (CAN_METER_LATENCY_BUCKETS - 1);
 }
 
-#if CAN2_TX_IT_ENABLE
-
 /**
- * @brief CAN2 TX ISR.
+ * @brief Count an error frame, call in critical section.
  *
+ * @param can_selected Specific which CAN.
  */
-void CAN2_TX_IRQHandler(void) {
-    HAL_CAN_IRQHandler(&can2_handle);
-}
+static void can_meter_add_error(can_selected_t can_selected) {
+    can_meter_state_t *state = &can_meter_state[can_selected];
 
-#endif /* CAN2_TX_IT_ENABLE */
+    ++state->meter.error_frames;
+    can_meter_add_bits(state, CAN_METER_ERROR_FRAME_BITS);
+}
 
-#if CAN2_RX0_IT_ENABLE
+#endif /* CAN_METER_ENABLE */
 
 /**
- * @brief CAN2 RX FIFO0 ISR.
- *
+ * @}
  */
-void CAN2_RX0_IRQHandler(void) {
-    HAL_CAN_IRQHandler(&can2_handle);
-}
-
-#endif /* CAN2_RX0_IT_ENABLE */
 
-#if CAN2_RX1_IT_ENABLE
 
-/**
- * @brief CAN2 RX FIFO1 ISR.
- *
+/*****************************************************************************
+ * @defgroup Trace capture functions.
+ * @{
  */
-void CAN2_RX1_IRQHandler(void) {
-    HAL_CAN_IRQHandler(&can2_handle);
-}
 
-#endif /* CAN2_RX1_IT_ENABLE */
+#if CAN_TRACE_ENABLE
 
-#if CAN2_SCE_IT_ENABLE
+#if (CAN_TRACE_RECORD_NUMBER & (CAN_TRACE_RECORD_NUMBER - 1)) != 0
+#error "CAN_TRACE_RECORD_NUMBER must be a power of 2. "
+#endif /* CAN_TRACE_RECORD_NUMBER */
 
 /**
- * @brief CAN2 SCE ISR.
+ * @brief Ring of the trace records. Written by the CAN interrupts, read by
+ *        `can_trace_peek` and `can_trace_consume` in one task.
+ */
+typedef struct {
+    can_trace_record_t ring[CAN_TRACE_RECORD_NUMBER]; /*!< Records.       */
+    volatile uint32_t head;  /*!< Records written, free running.          */
+    volatile uint32_t tail;  /*!< Records consumed, free running.         */
+    uint32_t can_mask;       /*!< Bit n enables the CAN n + 1.            */
+    uint32_t last_cycles;    /*!< `CAN_GET_TIMESTAMP()` of the last one.  */
+    uint32_t rest_cycles;    /*!< Cycles less than 1 us, not counted.     */
+    uint64_t time_us;        /*!< Time of the last record, unit: us.      */
+    uint32_t since_sync;     /*!< Records since the last time record.     */
+    uint8_t lost;            /*!< Records dropped since the last one.     */
+    can_trace_stats_t stats; /*!< Statistics.                             */
+} can_trace_ring_t;
+
+static can_trace_ring_t can_trace;
+
+/**
+ * @brief Put a record into the ring, with interrupt disabled.
  *
+ * @param record The record.
  */
-void CAN2_SCE_IRQHandler(void) {
-    HAL_CAN_IRQHandler(&can2_handle);
+static inline void can_trace_put(const can_trace_record_t *record) {
+    can_trace.ring[can_trace.head & (CAN_TRACE_RECORD_NUMBER - 1)] = *record;
+    ++can_trace.head;
+    ++can_trace.stats.records;
 }
 
-#endif /* CAN2_SCE_IT_ENABLE */
-
 /**
- * @brief CAN2 deinitialization.
+ * @brief Record a frame. A time record is put before it when the delta is
+ *        too long for 16 bits, or every `CAN_TRACE_SYNC_INTERVAL` records.
  *
- * @return Deinit status.
- * @retval - 0: `CAN_DEINIT_OK`:   Success.
- * @retval - 1: `CAN_DEINIT_FAIL`: CAN hardware deinit failed.
- * @retval - 2: `CAN_NO_INIT`:     This can is no init.
+ * @param can_selected Specific which CAN.
+ * @param tx 1 for the frame transmitted.
+ * @param can_ide Specific standard ID or Extend ID.
+ * @param id Message ID.
+ * @param rtr Specific data frame or remote frame.
+ * @param len Message length.
+ * @param msg Message content, can be `NULL` for remote frame.
  */
-uint8_t can2_deinit(void) {
-    if (__HAL_RCC_CAN2_CLK_DISABLE()) {
-        return CAN_NO_INIT;
+static void can_trace_frame(can_selected_t can_selected, uint8_t tx,
+                            uint32_t can_ide, uint32_t id, uint32_t rtr,
+                            uint8_t len, const uint8_t *msg) {
+    if ((can_trace.can_mask & (1U << can_selected)) == 0) {
+        return;
     }
 
-    if (HAL_CAN_Stop(&can2_handle) != HAL_OK) {
-        return CAN_DEINIT_FAIL;
+    can_trace_record_t record = {.flags = (uint8_t)can_selected};
+    if (tx) {
+        record.flags |= CAN_TRACE_TX;
+    }
+    if (can_ide == CAN_ID_EXT) {
+        record.flags |= CAN_TRACE_EXT;
+    }
+    if (rtr == CAN_RTR_REMOTE) {
+        record.flags |= CAN_TRACE_RTR;
+    } else if (msg != NULL) {
+        memcpy(record.data, msg, (len > 8) ? 8 : len);
+    }
+    record.dlc = len;
+    record.id = id;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t now = CAN_GET_TIMESTAMP();
+    uint32_t cycles_per_us = SystemCoreClock / 1000000;
+    uint32_t elapsed = now - can_trace.last_cycles + can_trace.rest_cycles;
+    uint32_t delta = elapsed / cycles_per_us;
+
+    can_trace.last_cycles = now;
+    can_trace.rest_cycles = elapsed % cycles_per_us;
+    can_trace.time_us += delta;
+
+    uint8_t sync = (delta > 0xFFFFU) ||
+                   (can_trace.since_sync >= CAN_TRACE_SYNC_INTERVAL);
+    uint32_t free =
+        CAN_TRACE_RECORD_NUMBER - (can_trace.head - can_trace.tail);
+
+    if (free < (sync ? 2U : 1U)) {
+        /* The time is kept, the next record has the right delta. */
+        can_trace.lost = 1;
+        ++can_trace.stats.dropped;
+        __set_PRIMASK(primask);
+        return;
     }
 
-    if (HAL_CAN_DeInit(&can2_handle) != HAL_OK) {
-        return CAN_DEINIT_FAIL;
+    if (sync) {
+        can_trace_record_t time = {.flags = CAN_TRACE_TIME,
+                                   .dlc = 8,
+                                   .id = CAN_TRACE_MAGIC};
+        memcpy(time.data, &can_trace.time_us, sizeof(uint64_t));
+        can_trace_put(&time);
+        can_trace.since_sync = 0;
+        delta = 0;
     }
 
-    return CAN_DEINIT_OK;
+    record.delta = (uint16_t)delta;
+    if (can_trace.lost) {
+        record.flags |= CAN_TRACE_LOST;
+        can_trace.lost = 0;
+    }
+    can_trace_put(&record);
+    ++can_trace.since_sync;
+
+    uint32_t queued = can_trace.head - can_trace.tail;
+    if (queued > can_trace.stats.high_water) {
+        can_trace.stats.high_water = queued;
+    }
+
+    __set_PRIMASK(primask);
 }
 
-#endif /* CAN2_ENABLE */
+#if CAN_TX_QUEUE_LENGTH > 0
 
 /**
- * @}
+ * @brief Record the frame transmitted by a mailbox. The mailbox registers
+ *        keep the frame after transmission.
+ *
+ * @param can_selected Specific which CAN.
+ * @param mailbox The mailbox transmitted.
  */
+static void can_trace_mailbox(can_selected_t can_selected,
+                              const CAN_TxMailBox_TypeDef *mailbox) {
+    uint32_t tir = mailbox->TIR;
+    uint32_t data[2] = {mailbox->TDLR, mailbox->TDHR};
+    uint32_t can_ide = tir & CAN_TI0R_IDE;
+    uint32_t id = (can_ide == CAN_ID_EXT) ? (tir >> CAN_TI0R_EXID_Pos)
+                                          : (tir >> CAN_TI0R_STID_Pos);
+
+    can_trace_frame(can_selected, 1, can_ide, id, tir & CAN_TI0R_RTR,
+                    (uint8_t)(mailbox->TDTR & CAN_TDT0R_DLC),
+                    (const uint8_t *)data);
+}
+
+#endif /* CAN_TX_QUEUE_LENGTH > 0 */
 
+#endif /* CAN_TRACE_ENABLE */
+
+/**
+ * @}
+ */
 
 
 /*****************************************************************************
- * @defgroup CAN3 Functions.
+ * @defgroup Error management functions.
  * @{
  */
 
-#if CAN3_ENABLE
+#if CAN_BUS_OFF_AUTO_RECOVERY
+#define CAN_AUTO_BUS_OFF ENABLE
+#else /* CAN_BUS_OFF_AUTO_RECOVERY */
+#define CAN_AUTO_BUS_OFF DISABLE
+#endif /* CAN_BUS_OFF_AUTO_RECOVERY */
+
+/* Interrupts enabled with the SCE interrupt. */
+#define CAN_ERROR_IT                                                           \
+    (CAN_IT_ERROR_WARNING | CAN_IT_ERROR_PASSIVE | CAN_IT_BUSOFF |             \
+     CAN_IT_LAST_ERROR_CODE | CAN_IT_ERROR)
+
+/* The error state changes are found by interrupt: a worse state by the SCE
+   interrupt, the recovery by the TX interrupt. */
+#if CAN1_ENABLE && CAN1_SCE_IT_ENABLE && CAN1_TX_IT_ENABLE &&                 \
+    (CAN_TX_QUEUE_LENGTH > 0)
+#define CAN1_ERROR_NOTIFY 1
+#else /* CAN1_ENABLE && CAN1_SCE_IT_ENABLE && CAN1_TX_IT_ENABLE */
+#define CAN1_ERROR_NOTIFY 0
+#endif /* CAN1_ENABLE && CAN1_SCE_IT_ENABLE && CAN1_TX_IT_ENABLE */
+
+#if CAN2_ENABLE && CAN2_SCE_IT_ENABLE && CAN2_TX_IT_ENABLE &&                 \
+    (CAN_TX_QUEUE_LENGTH > 0)
+#define CAN2_ERROR_NOTIFY 1
+#else /* CAN2_ENABLE && CAN2_SCE_IT_ENABLE && CAN2_TX_IT_ENABLE */
+#define CAN2_ERROR_NOTIFY 0
+#endif /* CAN2_ENABLE && CAN2_SCE_IT_ENABLE && CAN2_TX_IT_ENABLE */
+
+#if CAN3_ENABLE && CAN3_SCE_IT_ENABLE && CAN3_TX_IT_ENABLE &&                 \
+    (CAN_TX_QUEUE_LENGTH > 0)
+#define CAN3_ERROR_NOTIFY 1
+#else /* CAN3_ENABLE && CAN3_SCE_IT_ENABLE && CAN3_TX_IT_ENABLE */
+#define CAN3_ERROR_NOTIFY 0
+#endif /* CAN3_ENABLE && CAN3_SCE_IT_ENABLE && CAN3_TX_IT_ENABLE */
+
+static const uint8_t can_error_notify[3] = {
+    CAN1_ERROR_NOTIFY, CAN2_ERROR_NOTIFY, CAN3_ERROR_NOTIFY};
 
-CAN_HandleTypeDef can3_handle = {.Instance = CAN3,
-                                 .Init = {.Mode = CAN_MODE_NORMAL,
-                                          .TimeTriggeredMode = DISABLE,
-                                          .AutoBusOff = DISABLE,
-                                          .AutoWakeUp = DISABLE,
-                                          .AutoRetransmission = ENABLE,
-                                          .ReceiveFifoLocked = DISABLE,
-                                          .TransmitFifoPriority = DISABLE}};
+/**
+ * @brief Error management of a CAN.
+ */
+typedef struct {
+    can_error_stats_t stats; /*!< Error counters.                      */
+    uint32_t bus_off_time;   /*!< Bus-off start, `CAN_GET_TIMESTAMP()`. */
+    uint32_t bus_off_tick;   /*!< Bus-off start, `HAL_GetTick()`.       */
+    /* Callbacks of the error state. */
+    can_error_callback_t callback[CAN_ERROR_CALLBACK_NUMBER];
+} can_error_info_t;
+
+static can_error_info_t can_error_info[3];
 
 /**
- * @brief CAN3 initialization
+ * @brief Reset the error management, the callbacks are kept. Call when the
+ *        CAN is initialized.
  *
- * @param baud_rate Baud rate. Unit: Kbps.
- * @param prop_delay The propagation delay of bus, include cable and can
- *                   transceiver. Unit: ns.
- * @return CAN init status.
- * @retval - 0: `CAN_INIT_OK`:           Success.
- * @retval - 1: `CAN_INIT_RATE_ERR`:     Can not satisfied this baudrate in this
- *                                       condition.
- * @retval - 2: `CAN_INIT_FILTER_FAIL`:  CAN Filter init failed.
- * @retval - 3: `CAN_INIT_FAIL`:         CAN hardware init failed.
- * @retval - 4: `CAN_INIT_START_FAIL`:   CAN start failed.
- * @retval - 5: `CAN_INIT_NOTIFY_FAIL`:  Enable CAN receive notify failed.
- * @retval - 6: `CAN_INITED`:            This can is inited.
+ * @param can_selected Specific which CAN.
  */
-uint8_t can3_init(uint32_t baud_rate, uint32_t prop_delay) {
-    if (__HAL_RCC_CAN3_IS_CLK_ENABLED()) {
-        return CAN_INITED;
-    }
+static void can_error_init(can_selected_t can_selected) {
+    can_error_info_t *info = &can_error_info[can_selected];
 
-    uint32_t prescale, tbs1, tbs2, tsjw;
-    if (can_rate_calc(baud_rate * 1000, prop_delay, HAL_RCC_GetPCLK1Freq(),
-                      &prescale, &tsjw, &tbs1, &tbs2) == 1) {
-        return CAN_INIT_RATE_ERR;
-    }
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    memset(&info->stats, 0, sizeof(can_error_stats_t));
+    __set_PRIMASK(primask);
+}
 
-    can3_handle.Init.Prescaler = prescale;
-    can3_handle.Init.TimeSeg1 = (tbs1 - 1) << CAN_BTR_TS1_Pos;
-    can3_handle.Init.TimeSeg2 = (tbs2 - 1) << CAN_BTR_TS2_Pos;
-    can3_handle.Init.SyncJumpWidth = (tsjw - 1) << CAN_BTR_SJW_Pos;
+/**
+ * @brief Read the error counters and the state from ESR, notify the
+ *        callbacks when the state changes. The hardware only interrupts when
+ *        entering a worse state, so it is also called by the TX interrupt
+ *        and `can_get_error_stats` to find the recovery. The change is taken
+ *        with interrupt disabled, so each change is notified once, by the
+ *        caller which finds it first.
+ *
+ * @param can_selected Specific which CAN.
+ */
+static void can_error_update(can_selected_t can_selected) {
+    CAN_HandleTypeDef *can_handle = can_get_handle(can_selected);
+    can_error_info_t *info = &can_error_info[can_selected];
+    can_error_stats_t *stats = &info->stats;
+    can_error_state_t state;
 
-    if (HAL_CAN_Init(&can3_handle) != HAL_OK) {
-        return CAN_INIT_FAIL;
+    if (can_handle == NULL) {
+        return;
     }
 
-    CAN_FilterTypeDef can_filter_config;
+    uint32_t esr = can_handle->Instance->ESR;
+    uint8_t tec = (uint8_t)((esr & CAN_ESR_TEC) >> CAN_ESR_TEC_Pos);
+    uint8_t rec = (uint8_t)((esr & CAN_ESR_REC) >> CAN_ESR_REC_Pos);
 
-    can_filter_config.FilterBank = 0;
-    can_filter_config.FilterMode = CAN_FILTERMODE_IDMASK;
-    can_filter_config.FilterScale = CAN_FILTERSCALE_32BIT;
-    can_filter_config.FilterIdHigh = 0x0000;
-    can_filter_config.FilterIdLow = 0x0000;
-    can_filter_config.FilterMaskIdHigh = 0x0000;
-    can_filter_config.FilterMaskIdLow = 0x0000;
-    can_filter_config.FilterActivation = CAN_FILTER_ENABLE;
-    can_filter_config.SlaveStartFilterBank = 0;
+    if (esr & CAN_ESR_BOFF) {
+        state = can_error_bus_off;
+    } else if (esr & CAN_ESR_EPVF) {
+        state = can_error_passive;
+    } else if (esr & CAN_ESR_EWGF) {
+        state = can_error_warning;
+    } else {
+        state = can_error_active;
+    }
 
-#if CAN3_RX0_IT_ENABLE
-    can_filter_config.FilterFIFOAssignment = CAN_FILTER_FIFO0;
-    if (HAL_CAN_ConfigFilter(&can3_handle, &can_filter_config) != HAL_OK) {
-        return CAN_INIT_FILTER_FAIL;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    stats->tec = tec;
+    stats->rec = rec;
+    if (tec > stats->max_tec) {
+        stats->max_tec = tec;
     }
-    if (HAL_CAN_ActivateNotification(&can3_handle,
-                                     CAN_IT_RX_FIFO0_MSG_PENDING) != HAL_OK) {
-        return CAN_INIT_NOTIFY_FAIL;
+    if (rec > stats->max_rec) {
+        stats->max_rec = rec;
     }
-#endif /* CAN3_RX0_IT_ENABLE */
 
-#if CAN3_RX1_IT_ENABLE
-    can_filter_config.FilterFIFOAssignment = CAN_FILTER_FIFO1;
-    if (HAL_CAN_ConfigFilter(&can3_handle, &can_filter_config) != HAL_OK) {
-        return CAN_INIT_FILTER_FAIL;
-    }
-    if (HAL_CAN_ActivateNotification(&can3_handle,
-                                     CAN_IT_RX_FIFO1_MSG_PENDING) != HAL_OK) {
-        return CAN_INIT_NOTIFY_FAIL;
+    can_error_state_t last = stats->state;
+    if (state == last) {
+        __set_PRIMASK(primask);
+        return;
     }
-#endif /* CAN3_RX1_IT_ENABLE */
+    stats->state = state;
+
+    if (state > last) {
+        switch (state) {
+            case can_error_warning: {
+                ++stats->warning_count;
+            } break;
+
+            case can_error_passive: {
+                ++stats->passive_count;
+            } break;
+
+            case can_error_bus_off: {
+                ++stats->bus_off_count;
+                info->bus_off_time = CAN_GET_TIMESTAMP();
+                info->bus_off_tick = HAL_GetTick();
+            } break;
+
+            default: {
+            } break;
+        }
+    } else if (last == can_error_bus_off) {
+        uint32_t ms = HAL_GetTick() - info->bus_off_tick;
+        uint32_t us;
+
+        /* The cycle counter wraps in seconds. */
+        if (ms < 1000) {
+            us = (CAN_GET_TIMESTAMP() - info->bus_off_time) /
+                 (SystemCoreClock / 1000000U);
+        } else {
+            us = ms * 1000U;
+        }
 
-    if (HAL_CAN_Start(&can3_handle) != HAL_OK) {
-        return CAN_INIT_START_FAIL;
+        ++stats->recovered_count;
+        stats->last_recovery_us = us;
+        if (us > stats->max_recovery_us) {
+            stats->max_recovery_us = us;
+        }
     }
 
-    return CAN_INIT_OK;
-}
+    __set_PRIMASK(primask);
 
-#if CAN3_TX_IT_ENABLE
+    for (uint32_t i = 0; i < CAN_ERROR_CALLBACK_NUMBER; ++i) {
+        can_error_callback_t callback = info->callback[i];
+        if (callback != NULL) {
+            callback(can_selected, state);
+        }
+    }
+}
 
 /**
- * @brief CAN3 TX ISR.
+ * @brief Error callback, classify the last error code and update the error
+ *        state.
  *
+ * @param hcan The handle of CAN.
  */
-void CAN3_TX_IRQHandler(void) {
-    HAL_CAN_IRQHandler(&can3_handle);
-}
+void HAL_CAN_ErrorCallback(CAN_HandleTypeDef *hcan) {
+    static const uint32_t lec_error[6] = {
+        HAL_CAN_ERROR_STF, HAL_CAN_ERROR_FOR, HAL_CAN_ERROR_ACK,
+        HAL_CAN_ERROR_BR,  HAL_CAN_ERROR_BD,  HAL_CAN_ERROR_CRC};
 
-#endif /* CAN3_TX_IT_ENABLE */
+    uint32_t error = HAL_CAN_GetError(hcan);
 
-#if CAN3_RX0_IT_ENABLE
+    /* HAL accumulates the error code. */
+    HAL_CAN_ResetError(hcan);
+
+    for (uint32_t i = 0; i < 3; ++i) {
+        if (can_get_handle((can_selected_t)i) != hcan) {
+            continue;
+        }
+
+        can_error_stats_t *stats = &can_error_info[i].stats;
+
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        for (uint32_t j = 0; j < 6; ++j) {
+            if (error & lec_error[j]) {
+                ++stats->lec_count[j];
+
+#if CAN_METER_ENABLE
+                can_meter_add_error((can_selected_t)i);
+#endif /* CAN_METER_ENABLE */
+            }
+        }
+        __set_PRIMASK(primask);
+
+        can_error_update((can_selected_t)i);
+        break;
+    }
+}
 
 /**
- * @brief CAN3 RX FIFO0 ISR.
- *
+ * @}
  */
-void CAN3_RX0_IRQHandler(void) {
-    HAL_CAN_IRQHandler(&can3_handle);
-}
 
-#endif /* CAN3_RX0_IT_ENABLE */
 
-#if CAN3_RX1_IT_ENABLE
+/*****************************************************************************
+ * @defgroup TX queue functions.
+ * @{
+ */
+
+#if CAN_TX_QUEUE_LENGTH > 0
+
+#if CAN_TX_PRIORITY_NUMBER > 4
+#error "CAN_TX_PRIORITY_NUMBER must not be greater than 4. "
+#endif /* CAN_TX_PRIORITY_NUMBER */
+
+#if (CAN_TX_INTAKE_LENGTH == 0) ||                                             \
+    ((CAN_TX_INTAKE_LENGTH & (CAN_TX_INTAKE_LENGTH - 1)) != 0)
+#error "CAN_TX_INTAKE_LENGTH must be power of 2. "
+#endif /* CAN_TX_INTAKE_LENGTH */
+
+/* Priority class is stored in the top 2 bits of the key. */
+#define CAN_TX_KEY_CLASS(key)  ((key) >> 30)
 
 /**
- * @brief CAN3 RX FIFO1 ISR.
- *
+ * @brief Mailbox state of the TX queue.
  */
-void CAN3_RX1_IRQHandler(void) {
-    HAL_CAN_IRQHandler(&can3_handle);
-}
+typedef enum {
+    can_tx_mailbox_free = 0U, /*!< Not used by the TX queue.             */
+    can_tx_mailbox_pending,   /*!< Transmit requested.                   */
+    can_tx_mailbox_aborting   /*!< Abort requested, requeue the frame.   */
+} can_tx_mailbox_state_t;
 
-#endif /* CAN3_RX1_IT_ENABLE */
+/**
+ * @brief Frame waiting in the TX queue.
+ */
+typedef struct {
+    uint32_t key;       /*!< Lower key is sent earlier.               */
+    uint32_t seq;       /*!< Push order of the same key.              */
+    uint32_t timestamp; /*!< Push time, `CAN_GET_TIMESTAMP()`.        */
+    uint32_t request;   /*!< Mailbox request time.                    */
+    uint32_t can_ide;   /*!< `CAN_ID_STD` or `CAN_ID_EXT`.            */
+    uint32_t id;        /*!< Message ID.                              */
+    uint32_t rtr;       /*!< `CAN_RTR_DATA` or `CAN_RTR_REMOTE`.      */
+    uint8_t len;        /*!< Message length.                          */
+    uint8_t slot;       /*!< Overwritten by the newer slot frame.     */
+    uint8_t bits;       /*!< Bits on the bus, `can_frame_bits`.       */
+    uint8_t stuff;      /*!< Stuff bits in `bits`.                    */
+    uint8_t data[8];    /*!< Message content.                         */
+} can_tx_frame_t;
 
-#if CAN3_SCE_IT_ENABLE
+/**
+ * @brief TX queue of a CAN. Tasks and interrupts push the frames into the
+ *        lock-free intake, the TX interrupt moves them into a binary heap
+ *        ordered by the key and loads the heap into the mailboxes.
+ */
+typedef struct {
+    mpsc_fifo_t intake;                               /*!< Frame intake.   */
+    mpsc_fifo_atomic_t intake_seq[CAN_TX_INTAKE_LENGTH];
+    can_tx_frame_t intake_buf[CAN_TX_INTAKE_LENGTH];
+    can_tx_frame_t heap[CAN_TX_QUEUE_LENGTH];         /*!< Frame heap.     */
+    uint32_t count;                                   /*!< Frames in heap. */
+    uint32_t seq;                                     /*!< Next order.     */
+    can_tx_frame_t mailbox[3];                        /*!< Mailbox frames. */
+    uint8_t mailbox_state[3];                         /*!< Mailbox state.  */
+    can_tx_stats_t stats;                             /*!< Statistics.     */
+} can_tx_queue_t;
+
+static can_tx_queue_t can_tx_queue[3];
+
+#if CAN_SYNC_ENABLE
+static void can_sync_tx_done(can_selected_t can_selected, uint32_t mailbox,
+                             uint8_t success);
+#endif /* CAN_SYNC_ENABLE */
 
 /**
- * @brief CAN3 SCE ISR.
+ * @brief Initialize the TX queue, call before the CAN starts.
  *
+ * @param can_selected Specific which CAN.
  */
-void CAN3_SCE_IRQHandler(void) {
-    HAL_CAN_IRQHandler(&can3_handle);
-}
+static void can_tx_queue_init(can_selected_t can_selected) {
+    can_tx_queue_t *queue = &can_tx_queue[can_selected];
 
-#endif /* CAN3_SCE_IT_ENABLE */
+    memset(queue, 0, sizeof(can_tx_queue_t));
+    mpsc_fifo_init(&queue->intake, queue->intake_seq, queue->intake_buf,
+                   CAN_TX_INTAKE_LENGTH, sizeof(can_tx_frame_t));
+}
 
 /**
- * @brief CAN3 deinitialization.
+ * @brief Get the TX interrupt number of the CAN.
  *
- * @return Deinit status.
- * @retval - 0: `CAN_DEINIT_OK`:   Success.
- * @retval - 1: `CAN_DEINIT_FAIL`: CAN hardware deinit failed.
- * @retval - 2: `CAN_NO_INIT`:     This can is no init.
+ * @param can_selected Specific which CAN.
+ * @param[out] irqn The TX interrupt number.
+ * @return Whether the TX interrupt is enabled:
+ * @retval - 0: Enabled, the TX queue can be used.
+ * @retval - 1: Not enabled.
  */
-uint8_t can3_deinit(void) {
-    if (__HAL_RCC_CAN3_CLK_DISABLE()) {
-        return CAN_NO_INIT;
-    }
+static inline uint8_t can_tx_get_irqn(can_selected_t can_selected,
+                                      IRQn_Type *irqn) {
+    switch (can_selected) {
 
-    if (HAL_CAN_Stop(&can3_handle) != HAL_OK) {
-        return CAN_DEINIT_FAIL;
+#if CAN1_ENABLE && CAN1_TX_IT_ENABLE
+        case can1_selected: {
+            *irqn = CAN1_TX_IRQn;
+            return 0;
+        }
+#endif /* CAN1_ENABLE && CAN1_TX_IT_ENABLE */
+
+#if CAN2_ENABLE && CAN2_TX_IT_ENABLE
+        case can2_selected: {
+            *irqn = CAN2_TX_IRQn;
+            return 0;
+        }
+#endif /* CAN2_ENABLE && CAN2_TX_IT_ENABLE */
+
+#if CAN3_ENABLE && CAN3_TX_IT_ENABLE
+        case can3_selected: {
+            *irqn = CAN3_TX_IRQn;
+            return 0;
+        }
+#endif /* CAN3_ENABLE && CAN3_TX_IT_ENABLE */
+
+        default: {
+            return 1;
+        }
     }
+}
 
-    if (HAL_CAN_DeInit(&can3_handle) != HAL_OK) {
-        return CAN_DEINIT_FAIL;
+/**
+ * @brief Get the index of CAN by the handle.
+ *
+ * @param hcan The handle of CAN.
+ * @return The CAN index, 3 if the TX queue is not used by this CAN.
+ */
+static inline uint8_t can_tx_identify(CAN_HandleTypeDef *hcan) {
+    for (uint8_t i = 0; i < 3; ++i) {
+        IRQn_Type irqn;
+
+        if ((can_tx_get_irqn((can_selected_t)i, &irqn) == 0) &&
+            (can_get_handle((can_selected_t)i) == hcan)) {
+            return i;
+        }
     }
 
-    return CAN_DEINIT_OK;
+    return 3;
 }
 
-#endif /* CAN3_ENABLE */
-
 /**
- * @}
+ * @brief Make the key of the frame. The priority class is compared first,
+ *        then the arbitration field, same as the bus arbitration.
+ *
+ * @param priority The priority class, lower value is more urgent.
+ * @param can_ide Specific standard ID or Extend ID.
+ * @param id Message ID.
+ * @return The key.
  */
+static inline uint32_t can_tx_make_key(uint8_t priority, uint32_t can_ide,
+                                       uint32_t id) {
+    uint32_t arbitration;
 
+    if (can_ide == CAN_ID_STD) {
+        arbitration = (id & 0x7FFU) << 19;
+    } else {
+        /* Standard frame wins the extended frame with the same base ID. */
+        arbitration = (((id >> 18) & 0x7FFU) << 19) | (1U << 18) |
+                      (id & 0x3FFFFU);
+    }
 
+    return ((uint32_t)priority << 30) | arbitration;
+}
 
-/*****************************************************************************
- * @defgroup Public functions of CAN.
- * @{
+/**
+ * @brief Whether frame `a` should be sent before frame `b`.
+ *
+ * @param a Frame a.
+ * @param b Frame b.
+ * @return 1: `a` is earlier, 0: otherwise.
  */
+static inline uint8_t can_tx_before(const can_tx_frame_t *a,
+                                    const can_tx_frame_t *b) {
+    if (a->key != b->key) {
+        return a->key < b->key;
+    }
+
+    /* The same ID keeps the push order. */
+    return (int32_t)(a->seq - b->seq) < 0;
+}
 
 /**
- * @brief CAN Low level initialization
+ * @brief Find the slot frame waiting in the heap with the same key, call in
+ *        critical section.
  *
- * @param hcan The handle of CAN
- * @note If you want to use dual CAN, you must initialize both CAN GPIO at the
- *       same time, otherwise there will be a `Wait initialisation acknowledge`
- *       error.
+ * @param queue The TX queue.
+ * @param frame The slot frame.
+ * @return The index in the heap, `queue->count` if not found.
  */
-void HAL_CAN_MspInit(CAN_HandleTypeDef *hcan) {
-    GPIO_InitTypeDef gpio_init_struct = {.Mode = GPIO_MODE_AF_PP,
-                                         .Pull = GPIO_PULLUP,
-                                         .Speed = GPIO_SPEED_FREQ_VERY_HIGH};
-#if CAN3_ENABLE
-    if (hcan->Instance == CAN3) {
+static uint32_t can_tx_heap_find_slot(can_tx_queue_t *queue,
+                                      const can_tx_frame_t *frame) {
+    uint32_t i;
 
-        CSP_GPIO_CLK_ENABLE(CAN3_TX_PORT);
-        gpio_init_struct.Pin = CAN3_TX_PIN;
-        gpio_init_struct.Alternate = CAN3_TX_AF;
-        HAL_GPIO_Init(CSP_GPIO_PORT(CAN3_TX_PORT), &gpio_init_struct);
+    for (i = 0; i < queue->count; ++i) {
+        if (queue->heap[i].slot && (queue->heap[i].key == frame->key)) {
+            break;
+        }
+    }
 
-        CSP_GPIO_CLK_ENABLE(CAN3_RX_PORT);
-        gpio_init_struct.Pin = CAN3_RX_PIN;
-        gpio_init_struct.Alternate = CAN3_RX_AF;
-        HAL_GPIO_Init(CSP_GPIO_PORT(CAN3_RX_PORT), &gpio_init_struct);
-        __HAL_RCC_CAN3_CLK_ENABLE();
+    return i;
+}
 
-#if CAN3_TX_IT_ENABLE
-        HAL_NVIC_SetPriority(CAN3_TX_IRQn, CAN3_TX_IT_PRIORITY, CAN3_TX_IT_SUB);
-        HAL_NVIC_EnableIRQ(CAN3_TX_IRQn);
-#endif /* CAN3_TX_IT_ENABLE */
+/**
+ * @brief Push a frame into the heap, call in critical section.
+ *
+ * @param queue The TX queue.
+ * @param frame The frame to push.
+ * @return Push status:
+ * @retval - 0: Success.
+ * @retval - 1: The queue is full.
+ */
+static uint8_t can_tx_heap_push(can_tx_queue_t *queue,
+                                const can_tx_frame_t *frame) {
+    if (queue->count >= CAN_TX_QUEUE_LENGTH) {
+        return 1;
+    }
 
-#if CAN3_RX0_IT_ENABLE
-        HAL_NVIC_SetPriority(CAN3_RX0_IRQn, CAN3_RX0_IT_PRIORITY,
-                             CAN3_RX0_IT_SUB);
-        HAL_NVIC_EnableIRQ(CAN3_RX0_IRQn);
-#endif /* CAN3_RX0_IT_ENABLE */
+    uint32_t pos = queue->count++;
 
-#if CAN3_RX1_IT_ENABLE
-        HAL_NVIC_SetPriority(CAN3_RX1_IRQn, CAN3_RX1_IT_PRIORITY,
-                             CAN3_RX1_IT_SUB);
-        HAL_NVIC_EnableIRQ(CAN3_RX1_IRQn);
-#endif /* CAN3_RX1_IT_ENABLE */
+    while (pos > 0) {
+        uint32_t parent = (pos - 1) / 2;
 
-#if CAN3_SCE_IT_ENABLE
-        HAL_NVIC_SetPriority(CAN3_SCE_IRQn, CAN3_SCE_IT_PRIORITY,
-                             CAN3_SCE_IT_SUB);
-        HAL_NVIC_EnableIRQ(CAN3_SCE_IRQn);
-#endif /* CAN3_SCE_IT_ENABLE */
+        if (!can_tx_before(frame, &queue->heap[parent])) {
+            break;
+        }
+
+        queue->heap[pos] = queue->heap[parent];
+        pos = parent;
+    }
+
+    queue->heap[pos] = *frame;
+
+    if (queue->count > queue->stats.high_water) {
+        queue->stats.high_water = queue->count;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Pop the earliest frame from the heap, call in critical section.
+ *
+ * @param queue The TX queue, not empty.
+ * @param[out] frame The frame popped.
+ */
+static void can_tx_heap_pop(can_tx_queue_t *queue, can_tx_frame_t *frame) {
+    *frame = queue->heap[0];
+
+    const can_tx_frame_t *last = &queue->heap[--queue->count];
+    uint32_t pos = 0;
+
+    while (1) {
+        uint32_t child = pos * 2 + 1;
+
+        if (child >= queue->count) {
+            break;
+        }
+
+        if ((child + 1 < queue->count) &&
+            can_tx_before(&queue->heap[child + 1], &queue->heap[child])) {
+            ++child;
+        }
+
+        if (!can_tx_before(&queue->heap[child], last)) {
+            break;
+        }
+
+        queue->heap[pos] = queue->heap[child];
+        pos = child;
+    }
+
+    queue->heap[pos] = *last;
+}
+
+/**
+ * @brief Push a frame into the TX queue. Lock-free and reentrant, tasks and
+ *        interrupts may push at the same time. Never blocks, the frame is
+ *        dropped when the intake is full.
+ *
+ * @param can_selected Specific which CAN.
+ * @param frame The frame to push, the key is filled.
+ * @return Push status:
+ * @retval - 0: Success.
+ * @retval - 1: The intake is full, the frame is dropped.
+ */
+static uint8_t can_tx_enqueue(can_selected_t can_selected,
+                              can_tx_frame_t *frame) {
+    can_tx_queue_t *queue = &can_tx_queue[can_selected];
 
+    frame->timestamp = CAN_GET_TIMESTAMP();
+
+    return (uint8_t)mpsc_fifo_push(&queue->intake, frame);
+}
+
+/**
+ * @brief Move a frame from the intake into the heap, call in critical
+ *        section. The slot frame overwrites the content of the waiting slot
+ *        frame with the same key, the position in the heap and the timestamp
+ *        are kept.
+ *
+ * @param queue The TX queue.
+ * @param frame The frame from the intake.
+ */
+static void can_tx_heap_insert(can_tx_queue_t *queue, can_tx_frame_t *frame) {
+    uint32_t index = frame->slot ? can_tx_heap_find_slot(queue, frame)
+                                 : queue->count;
+
+    if (index < queue->count) {
+        can_tx_frame_t *stale = &queue->heap[index];
+
+        stale->rtr = frame->rtr;
+        stale->len = frame->len;
+        stale->bits = frame->bits;
+        stale->stuff = frame->stuff;
+        memcpy(stale->data, frame->data, sizeof(stale->data));
+        ++queue->stats.coalesced;
         return;
     }
-#endif /* CAN3_ENABLE */
 
-#if CAN1_ENABLE
-    __HAL_RCC_CAN1_CLK_ENABLE();
+    frame->seq = queue->seq++;
+    if (can_tx_heap_push(queue, frame) != 0) {
+        ++queue->stats.dropped;
+    }
+}
 
-    CSP_GPIO_CLK_ENABLE(CAN1_TX_PORT);
-    gpio_init_struct.Pin = CAN1_TX_PIN;
-    gpio_init_struct.Alternate = CAN1_TX_AF;
-    HAL_GPIO_Init(CSP_GPIO_PORT(CAN1_TX_PORT), &gpio_init_struct);
+/**
+ * @brief The frame in the mailbox is finished, call in critical section.
+ *
+ * @param queue The TX queue.
+ * @param mailbox Mailbox index.
+ * @param success Whether the frame is transmitted.
+ */
+static void can_tx_finish(can_tx_queue_t *queue, uint32_t mailbox,
+                          uint8_t success) {
+    can_tx_frame_t *frame = &queue->mailbox[mailbox];
+
+    if (success) {
+        uint32_t now = CAN_GET_TIMESTAMP();
+        uint32_t latency = now - frame->timestamp;
+        uint32_t priority = CAN_TX_KEY_CLASS(frame->key);
+
+        ++queue->stats.sent;
+        if (latency > queue->stats.max_latency[priority]) {
+            queue->stats.max_latency[priority] = latency;
+        }
 
-    CSP_GPIO_CLK_ENABLE(CAN1_RX_PORT);
-    gpio_init_struct.Pin = CAN1_RX_PIN;
-    gpio_init_struct.Alternate = CAN1_RX_AF;
-    HAL_GPIO_Init(CSP_GPIO_PORT(CAN1_RX_PORT), &gpio_init_struct);
+#if CAN_METER_ENABLE
+        can_selected_t can_selected = (can_selected_t)(queue - can_tx_queue);
+        can_meter_add_frame(can_selected, 1, frame->bits, frame->stuff);
+        can_meter_add_latency(can_selected, latency, now - frame->request);
+#endif /* CAN_METER_ENABLE */
+    } else if (queue->mailbox_state[mailbox] == can_tx_mailbox_aborting) {
+        /* Keep the push order and timestamp, the latency includes abort. */
+        ++queue->stats.aborted;
+        if (frame->slot &&
+            (can_tx_heap_find_slot(queue, frame) < queue->count)) {
+            /* A newer frame of this slot is waiting, drop the stale one. */
+            ++queue->stats.coalesced;
+        } else if (can_tx_heap_push(queue, frame) != 0) {
+            ++queue->stats.dropped;
+        }
+    } else {
+        ++queue->stats.send_error;
+    }
 
-#if CAN1_TX_IT_ENABLE
-    HAL_NVIC_SetPriority(CAN1_TX_IRQn, CAN1_TX_IT_PRIORITY, CAN1_TX_IT_SUB);
-    HAL_NVIC_EnableIRQ(CAN1_TX_IRQn);
-#endif /* CAN1_TX_IT_ENABLE */
+    queue->mailbox_state[mailbox] = can_tx_mailbox_free;
+}
 
-#if CAN1_RX0_IT_ENABLE
-    HAL_NVIC_SetPriority(CAN1_RX0_IRQn, CAN1_RX0_IT_PRIORITY, CAN1_RX0_IT_SUB);
-    HAL_NVIC_EnableIRQ(CAN1_RX0_IRQn);
-#endif /* CAN1_RX0_IT_ENABLE */
+/**
+ * @brief Load the earliest frame of the heap into a free mailbox, call in
+ *        critical section. The sync release may take the mailboxes between
+ *        the critical sections, so the free level is checked here.
+ *
+ * @param can_handle The handle of CAN.
+ * @param queue The TX queue.
+ * @return Load status:
+ * @retval - 0: A frame is loaded.
+ * @retval - 1: The heap is empty, no mailbox is free or loading failed.
+ */
+static uint8_t can_tx_load(CAN_HandleTypeDef *can_handle,
+                           can_tx_queue_t *queue) {
+    CAN_TxHeaderTypeDef tx_header = {.TransmitGlobalTime = DISABLE};
+    can_tx_frame_t frame;
+    uint32_t tx_mail_box;
+
+    if ((queue->count == 0) ||
+        (HAL_CAN_GetTxMailboxesFreeLevel(can_handle) == 0)) {
+        return 1;
+    }
 
-#if CAN1_RX1_IT_ENABLE
-    HAL_NVIC_SetPriority(CAN1_RX1_IRQn, CAN1_RX1_IT_PRIORITY, CAN1_RX1_IT_SUB);
-    HAL_NVIC_EnableIRQ(CAN1_RX1_IRQn);
-#endif /* CAN1_RX1_IT_ENABLE */
+    can_tx_heap_pop(queue, &frame);
 
-#if CAN1_SCE_IT_ENABLE
-    HAL_NVIC_SetPriority(CAN1_SCE_IRQn, CAN1_SCE_IT_PRIORITY, CAN1_SCE_IT_SUB);
-    HAL_NVIC_EnableIRQ(CAN1_SCE_IRQn);
-#endif /* CAN1_SCE_IT_ENABLE */
+    tx_header.IDE = frame.can_ide;
+    tx_header.RTR = frame.rtr;
+    tx_header.DLC = frame.len;
+    if (frame.can_ide == CAN_ID_STD) {
+        tx_header.StdId = frame.id;
+    } else {
+        tx_header.ExtId = frame.id;
+    }
 
-#endif /* CAN1_ENABLE */
+    if (HAL_CAN_AddTxMessage(can_handle, &tx_header, frame.data,
+                             &tx_mail_box) != HAL_OK) {
+        /* Put it back with the same order, the slot just popped is free.
+           Retry at the next TX interrupt. */
+        ++queue->stats.send_error;
+        if (can_tx_heap_push(queue, &frame) != 0) {
+            ++queue->stats.dropped;
+        }
+        return 1;
+    }
 
-#if CAN2_ENABLE
-    __HAL_RCC_CAN2_CLK_ENABLE();
+    /* `CAN_TX_MAILBOX0` is bit 0. */
+    uint32_t mailbox = __CLZ(__RBIT(tx_mail_box));
+    frame.request = CAN_GET_TIMESTAMP();
+    queue->mailbox[mailbox] = frame;
+    queue->mailbox_state[mailbox] = can_tx_mailbox_pending;
 
-    CSP_GPIO_CLK_ENABLE(CAN2_TX_PORT);
-    gpio_init_struct.Pin = CAN2_TX_PIN;
-    gpio_init_struct.Alternate = CAN2_TX_AF;
+    return 0;
+}
 
-    HAL_GPIO_Init(CSP_GPIO_PORT(CAN2_TX_PORT), &gpio_init_struct);
+/**
+ * @brief Load the queued frames into the free mailboxes, and abort the
+ *        mailboxes blocking a more urgent frame. Called in the TX interrupt
+ *        only. Each critical section covers a single heap or mailbox update,
+ *        the sync timer is never masked for the whole pass.
+ *
+ * @param can_selected Specific which CAN.
+ */
+static void can_tx_process(can_selected_t can_selected) {
+    CAN_HandleTypeDef *can_handle = can_get_handle(can_selected);
+    can_tx_queue_t *queue = &can_tx_queue[can_selected];
+    can_tx_frame_t frame;
+    uint32_t primask;
+    uint8_t loaded;
+
+    /* Find the recovery from the error states. */
+    can_error_update(can_selected);
+
+    /* This interrupt is the only consumer of the intake, pop without
+       masking and insert the frames into the heap one by one. A frame not
+       published yet stops the intake, its producer pends this interrupt
+       again after publish. The frames pushed during the drain are left to
+       that pend, so the drain is bounded. */
+    for (uint32_t i = 0; i < CAN_TX_INTAKE_LENGTH; ++i) {
+        if (mpsc_fifo_pop(&queue->intake, &frame) != 0) {
+            break;
+        }
 
-    CSP_GPIO_CLK_ENABLE(CAN2_RX_PORT);
-    gpio_init_struct.Pin = CAN2_RX_PIN;
-    gpio_init_struct.Alternate = CAN2_RX_AF;
-    HAL_GPIO_Init(CSP_GPIO_PORT(CAN2_RX_PORT), &gpio_init_struct);
+        primask = __get_PRIMASK();
+        __disable_irq();
+        can_tx_heap_insert(queue, &frame);
+        __set_PRIMASK(primask);
+    }
 
-#if CAN2_TX_IT_ENABLE
-    HAL_NVIC_SetPriority(CAN2_TX_IRQn, CAN2_TX_IT_PRIORITY, CAN2_TX_IT_SUB);
-    HAL_NVIC_EnableIRQ(CAN2_TX_IRQn);
-#endif /* CAN2_TX_IT_ENABLE */
+    uint32_t dropped = mpsc_fifo_take_dropped(&queue->intake);
+    if (dropped != 0) {
+        primask = __get_PRIMASK();
+        __disable_irq();
+        queue->stats.dropped += dropped;
+        __set_PRIMASK(primask);
+    }
 
-#if CAN2_RX0_IT_ENABLE
-    HAL_NVIC_SetPriority(CAN2_RX0_IRQn, CAN2_RX0_IT_PRIORITY, CAN2_RX0_IT_SUB);
-    HAL_NVIC_EnableIRQ(CAN2_RX0_IRQn);
-#endif /* CAN2_RX0_IT_ENABLE */
+    /* HAL reports a frame failed after lost arbitration or error as an
+       error, not abort. The mailbox is empty without callback. */
+    for (uint32_t i = 0; i < 3; ++i) {
+        primask = __get_PRIMASK();
+        __disable_irq();
+
+        uint32_t tsr = can_handle->Instance->TSR;
+        if ((queue->mailbox_state[i] != can_tx_mailbox_free) &&
+            ((tsr & (CAN_TSR_TME0 << i)) != 0) &&
+            ((tsr & (CAN_TSR_RQCP0 << (i * 8))) == 0)) {
+            can_tx_finish(queue, i, 0);
+        }
 
-#if CAN2_RX1_IT_ENABLE
-    HAL_NVIC_SetPriority(CAN2_RX1_IRQn, CAN2_RX1_IT_PRIORITY, CAN2_RX1_IT_SUB);
-    HAL_NVIC_EnableIRQ(CAN2_RX1_IRQn);
-#endif /* CAN2_RX1_IT_ENABLE */
+        __set_PRIMASK(primask);
+    }
 
-#if CAN2_SCE_IT_ENABLE
-    HAL_NVIC_SetPriority(CAN2_SCE_IRQn, CAN2_SCE_IT_PRIORITY, CAN2_SCE_IT_SUB);
-    HAL_NVIC_EnableIRQ(CAN2_SCE_IRQn);
-#endif /* CAN2_SCE_IT_ENABLE */
+    do {
+        primask = __get_PRIMASK();
+        __disable_irq();
+        loaded = (can_tx_load(can_handle, queue) == 0);
+        __set_PRIMASK(primask);
+    } while (loaded);
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    if ((queue->count > 0) &&
+        (HAL_CAN_GetTxMailboxesFreeLevel(can_handle) == 0)) {
+        /* All mailboxes are used, abort the less urgent class. The frames
+           loaded are sent in order (TXFP), so the urgent frame is sent
+           right after the frame on the bus. */
+        uint32_t priority = CAN_TX_KEY_CLASS(queue->heap[0].key);
+
+        for (uint32_t i = 0; i < 3; ++i) {
+            if ((queue->mailbox_state[i] == can_tx_mailbox_pending) &&
+                (CAN_TX_KEY_CLASS(queue->mailbox[i].key) > priority)) {
+                /* Write the ABRQ bit only, read-modify-write clears the
+                   RQCP flags not handled yet. */
+                can_handle->Instance->TSR = CAN_TSR_ABRQ0 << (i * 8);
+                queue->mailbox_state[i] = can_tx_mailbox_aborting;
+            }
+        }
+    }
 
-#endif /* CAN2_ENABLE */
+    __set_PRIMASK(primask);
 }
 
 /**
- * @brief CAN Low level deinitialization
+ * @brief Mailbox finished, called by the HAL callbacks.
  *
- * @param hcan The handle of CAN
+ * @param hcan The handle of CAN.
+ * @param mailbox Mailbox index.
+ * @param success Whether the frame is transmitted.
  */
-void HAL_CAN_MspDeInit(CAN_HandleTypeDef *hcan) {
+static void can_tx_mailbox_callback(CAN_HandleTypeDef *hcan,
+                                    uint32_t mailbox, uint8_t success) {
+    uint8_t can_selected = can_tx_identify(hcan);
+    if (can_selected >= 3) {
+        return;
+    }
 
-#if CAN1_ENABLE
-    if (hcan->Instance == CAN1) {
-        __HAL_RCC_CAN1_CLK_DISABLE();
+    can_tx_queue_t *queue = &can_tx_queue[can_selected];
 
-        HAL_GPIO_DeInit(CSP_GPIO_PORT(CAN1_RX_PORT), CAN1_RX_PIN);
-        HAL_GPIO_DeInit(CSP_GPIO_PORT(CAN1_TX_PORT), CAN1_TX_PIN);
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+#if CAN_SYNC_ENABLE
+    can_sync_tx_done((can_selected_t)can_selected, mailbox, success);
+#endif /* CAN_SYNC_ENABLE */
+    if (queue->mailbox_state[mailbox] != can_tx_mailbox_free) {
+        can_tx_finish(queue, mailbox, success);
+    }
+    __set_PRIMASK(primask);
 
-#if CAN1_TX_IT_ENABLE
-        HAL_NVIC_DisableIRQ(CAN1_TX_IRQn);
-#endif /* CAN1_TX_IT_ENABLE */
+#if CAN_TRACE_ENABLE
+    if (success) {
+        can_trace_mailbox((can_selected_t)can_selected,
+                          &hcan->Instance->sTxMailBox[mailbox]);
+    }
+#endif /* CAN_TRACE_ENABLE */
 
-#if CAN1_RX0_IT_ENABLE
-        HAL_NVIC_DisableIRQ(CAN1_RX0_IRQn);
-#endif /* CAN1_RX0_IT_ENABLE */
+    /* The callback may come from the other CAN interrupts. */
+    IRQn_Type irqn;
+    can_tx_get_irqn((can_selected_t)can_selected, &irqn);
+    HAL_NVIC_SetPendingIRQ(irqn);
+}
 
-#if CAN1_RX1_IT_ENABLE
-        HAL_NVIC_DisableIRQ(CAN1_RX1_IRQn);
-#endif /* CAN1_RX1_IT_ENABLE */
+/**
+ * @brief Tx Mailbox 0 complete callback.
+ *
+ * @param hcan The handle of CAN.
+ */
+void HAL_CAN_TxMailbox0CompleteCallback(CAN_HandleTypeDef *hcan) {
+    can_tx_mailbox_callback(hcan, 0, 1);
+}
+
+/**
+ * @brief Tx Mailbox 1 complete callback.
+ *
+ * @param hcan The handle of CAN.
+ */
+void HAL_CAN_TxMailbox1CompleteCallback(CAN_HandleTypeDef *hcan) {
+    can_tx_mailbox_callback(hcan, 1, 1);
+}
+
+/**
+ * @brief Tx Mailbox 2 complete callback.
+ *
+ * @param hcan The handle of CAN.
+ */
+void HAL_CAN_TxMailbox2CompleteCallback(CAN_HandleTypeDef *hcan) {
+    can_tx_mailbox_callback(hcan, 2, 1);
+}
+
+/**
+ * @brief Tx Mailbox 0 abort callback.
+ *
+ * @param hcan The handle of CAN.
+ */
+void HAL_CAN_TxMailbox0AbortCallback(CAN_HandleTypeDef *hcan) {
+    can_tx_mailbox_callback(hcan, 0, 0);
+}
+
+/**
+ * @brief Tx Mailbox 1 abort callback.
+ *
+ * @param hcan The handle of CAN.
+ */
+void HAL_CAN_TxMailbox1AbortCallback(CAN_HandleTypeDef *hcan) {
+    can_tx_mailbox_callback(hcan, 1, 0);
+}
+
+/**
+ * @brief Tx Mailbox 2 abort callback.
+ *
+ * @param hcan The handle of CAN.
+ */
+void HAL_CAN_TxMailbox2AbortCallback(CAN_HandleTypeDef *hcan) {
+    can_tx_mailbox_callback(hcan, 2, 0);
+}
+
+#endif /* CAN_TX_QUEUE_LENGTH > 0 */
+
+/**
+ * @}
+ */
+
+
+/*****************************************************************************
+ * @defgroup Sync window functions.
+ * @{
+ */
+
+#if CAN_SYNC_ENABLE
+
+#if CAN_TX_QUEUE_LENGTH == 0
+#error "The sync window needs the TX queue, CAN_TX_QUEUE_LENGTH is 0. "
+#endif /* CAN_TX_QUEUE_LENGTH == 0 */
+
+/* Interframe space, counted by `can_frame_bits` but after the completion. */
+#define CAN_SYNC_IFS_BITS 3
+
+/**
+ * @brief Frame staged in the sync window, in the mailbox register format.
+ */
+typedef struct {
+    uint32_t tir;  /*!< Identifier, TXRQ is cleared.        */
+    uint32_t tdtr; /*!< Data length.                        */
+    uint32_t tdlr; /*!< Data byte 0-3.                      */
+    uint32_t tdhr; /*!< Data byte 4-7.                      */
+    uint8_t bits;  /*!< Bits on the bus, `can_frame_bits`.  */
+    uint8_t stuff; /*!< Stuff bits in `bits`.               */
+} can_sync_frame_t;
+
+/**
+ * @brief Sync window of a CAN.
+ */
+typedef struct {
+    can_sync_frame_t frame[CAN_SYNC_FRAME_NUMBER]; /*!< Staged frames. */
+    uint32_t count;   /*!< Frames staged.                               */
+    uint32_t mailbox; /*!< Mailboxes of the window, bit 0 is mailbox 0. */
+    uint8_t bits[3];  /*!< Bits of the frame in each mailbox.           */
+    uint8_t stuff[3]; /*!< Stuff bits of the frame in each mailbox.     */
+    uint8_t started;  /*!< The first frame of the window is sent.       */
+    uint32_t sof;     /*!< Start of the first frame, estimated.         */
+} can_sync_bus_t;
+
+static can_sync_bus_t can_sync_bus[3];
+static can_sync_stats_t can_sync_stats;
+
+/**
+ * @brief Convert the timestamp cycles to nanoseconds.
+ *
+ * @param cycles `CAN_GET_TIMESTAMP()` cycles.
+ * @return Nanoseconds.
+ */
+static inline uint32_t can_sync_cycles_to_ns(uint32_t cycles) {
+    return (uint32_t)((uint64_t)cycles * 1000000000ULL / SystemCoreClock);
+}
+
+/**
+ * @brief Get the CPU cycles of a bit from the bit timing register.
+ *
+ * @param instance The CAN peripheral.
+ * @return Cycles of a bit.
+ */
+static uint32_t can_sync_cycles_per_bit(CAN_TypeDef *instance) {
+    uint32_t btr = instance->BTR;
+    uint32_t prescale = ((btr & CAN_BTR_BRP) >> CAN_BTR_BRP_Pos) + 1;
+    uint32_t tq_per_bit = ((btr & CAN_BTR_TS1) >> CAN_BTR_TS1_Pos) +
+                          ((btr & CAN_BTR_TS2) >> CAN_BTR_TS2_Pos) + 3;
+
+    return (uint32_t)((uint64_t)SystemCoreClock * prescale * tq_per_bit /
+                      HAL_RCC_GetPCLK1Freq());
+}
+
+/**
+ * @brief Take the skew of the last window, the spread of the start of frame
+ *        of the buses. Call in critical section.
+ */
+static void can_sync_finish(void) {
+    int32_t first = 0;
+    int32_t last = 0;
+    uint32_t reference = 0;
+    uint32_t buses = 0;
+
+    for (uint32_t i = 0; i < 3; ++i) {
+        can_sync_bus_t *bus = &can_sync_bus[i];
+        if (bus->started == 0) {
+            continue;
+        }
+
+        if (buses == 0) {
+            reference = bus->sof;
+        }
+
+        int32_t offset = (int32_t)(bus->sof - reference);
+        if (offset < first) {
+            first = offset;
+        }
+        if (offset > last) {
+            last = offset;
+        }
+
+        bus->started = 0;
+        ++buses;
+    }
+
+    if (buses < 2) {
+        return;
+    }
+
+    uint32_t skew = can_sync_cycles_to_ns((uint32_t)(last - first));
+
+    ++can_sync_stats.skew_samples;
+    can_sync_stats.last_skew_ns = skew;
+    if (skew > can_sync_stats.max_skew_ns) {
+        can_sync_stats.max_skew_ns = skew;
+    }
+}
+
+/**
+ * @brief A mailbox is finished, called by the TX queue in critical section.
+ *        The start of the first frame of the window is estimated from the
+ *        completion time and the frame length, the error is the latency of
+ *        the TX interrupt.
+ *
+ * @param can_selected Specific which CAN.
+ * @param mailbox Mailbox index.
+ * @param success Whether the frame is transmitted.
+ */
+static void can_sync_tx_done(can_selected_t can_selected, uint32_t mailbox,
+                             uint8_t success) {
+    can_sync_bus_t *bus = &can_sync_bus[can_selected];
+    uint32_t now = CAN_GET_TIMESTAMP();
+
+    if ((bus->mailbox & (1U << mailbox)) == 0) {
+        return;
+    }
+
+    bus->mailbox &= ~(1U << mailbox);
+    if (success == 0) {
+        return;
+    }
+
+#if CAN_METER_ENABLE
+    can_meter_add_frame(can_selected, 1, bus->bits[mailbox],
+                        bus->stuff[mailbox]);
+#endif /* CAN_METER_ENABLE */
+
+    if (bus->started) {
+        return;
+    }
+
+    CAN_TypeDef *instance = can_get_handle(can_selected)->Instance;
+    uint32_t wire = (bus->bits[mailbox] - CAN_SYNC_IFS_BITS) *
+                    can_sync_cycles_per_bit(instance);
+    bus->sof = now - wire;
+    bus->started = 1;
+}
+
+/**
+ * @brief Push a staged frame into the TX queue in the first class, when no
+ *        mailbox is free at release.
+ *
+ * @param can_selected Specific which CAN.
+ * @param sync The staged frame.
+ * @return 0: Success, 1: The TX queue is full.
+ */
+static uint8_t can_sync_enqueue(can_selected_t can_selected,
+                                const can_sync_frame_t *sync) {
+    can_tx_frame_t frame;
+
+    frame.can_ide = sync->tir & CAN_TI0R_IDE;
+    frame.id = (frame.can_ide == CAN_ID_STD)
+                   ? (sync->tir >> CAN_TI0R_STID_Pos)
+                   : (sync->tir >> CAN_TI0R_EXID_Pos);
+    frame.rtr = sync->tir & CAN_TI0R_RTR;
+    frame.len = (uint8_t)(sync->tdtr & CAN_TDT0R_DLC);
+    frame.key = can_tx_make_key(0, frame.can_ide, frame.id);
+    frame.slot = 0;
+    frame.bits = sync->bits;
+    frame.stuff = sync->stuff;
+    memcpy(&frame.data[0], &sync->tdlr, 4);
+    memcpy(&frame.data[4], &sync->tdhr, 4);
+
+    return can_tx_enqueue(can_selected, &frame);
+}
+
+/**
+ * @brief Release the sync window, called by the timer interrupt. All the
+ *        mailboxes are written first, then the transmit requests of all
+ *        buses are set back to back.
+ */
+static void can_sync_release(void) {
+    CAN_TypeDef *instance[3] = {NULL};
+    uint32_t released = 0;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    can_sync_finish();
+
+    for (uint32_t i = 0; i < 3; ++i) {
+        can_sync_bus_t *bus = &can_sync_bus[i];
+        can_tx_queue_t *queue = &can_tx_queue[i];
+
+        /* Frames of the last window not finished are not tracked. */
+        bus->mailbox = 0;
+        if (bus->count == 0) {
+            continue;
+        }
+
+        instance[i] = can_get_handle((can_selected_t)i)->Instance;
+
+        /* The requested mailboxes are sent first (TXFP). Abort the queued
+           frames not on the bus yet, they are requeued after the window. */
+        for (uint32_t j = 0; j < 3; ++j) {
+            if (queue->mailbox_state[j] == can_tx_mailbox_pending) {
+                instance[i]->TSR = CAN_TSR_ABRQ0 << (j * 8);
+                queue->mailbox_state[j] = can_tx_mailbox_aborting;
+            }
+        }
+
+        for (uint32_t j = 0; j < bus->count; ++j) {
+            can_sync_frame_t *frame = &bus->frame[j];
+            uint32_t free = ((instance[i]->TSR >> CAN_TSR_TME0_Pos) & 0x07U) &
+                            ~bus->mailbox;
+
+            if (free == 0) {
+                if (can_sync_enqueue((can_selected_t)i, frame) == 0) {
+                    ++can_sync_stats.queued;
+                } else {
+                    ++can_sync_stats.dropped;
+                }
+                continue;
+            }
+
+            uint32_t mailbox = __CLZ(__RBIT(free));
+            CAN_TxMailBox_TypeDef *tx_mailbox =
+                &instance[i]->sTxMailBox[mailbox];
+
+            tx_mailbox->TIR = frame->tir;
+            tx_mailbox->TDTR = frame->tdtr;
+            tx_mailbox->TDLR = frame->tdlr;
+            tx_mailbox->TDHR = frame->tdhr;
+            bus->bits[mailbox] = frame->bits;
+            bus->stuff[mailbox] = frame->stuff;
+            bus->mailbox |= 1U << mailbox;
+        }
+
+        bus->count = 0;
+    }
+
+    uint32_t start = CAN_GET_TIMESTAMP();
+    for (uint32_t i = 0; i < 3; ++i) {
+        for (uint32_t j = 0; j < 3; ++j) {
+            if (can_sync_bus[i].mailbox & (1U << j)) {
+                instance[i]->sTxMailBox[j].TIR |= CAN_TI0R_TXRQ;
+                ++released;
+            }
+        }
+    }
+    uint32_t end = CAN_GET_TIMESTAMP();
+
+    if (released > 0) {
+        ++can_sync_stats.windows;
+        can_sync_stats.released += released;
+        can_sync_stats.release_ns = can_sync_cycles_to_ns(end - start);
+    }
+
+    __set_PRIMASK(primask);
+
+    /* Load the overflow and the aborted frames. */
+    for (uint32_t i = 0; i < 3; ++i) {
+        IRQn_Type irqn;
+        if ((instance[i] != NULL) &&
+            (can_tx_get_irqn((can_selected_t)i, &irqn) == 0)) {
+            HAL_NVIC_SetPendingIRQ(irqn);
+        }
+    }
+}
+
+/**
+ * @brief Timer interrupt of the sync window.
+ */
+void CAN_SYNC_TIM_IRQHandler(void) {
+    if ((CAN_SYNC_TIM->SR & TIM_SR_UIF) == 0) {
+        return;
+    }
+
+    CAN_SYNC_TIM->SR = ~TIM_SR_UIF;
+    can_sync_release();
+}
+
+#endif /* CAN_SYNC_ENABLE */
+
+/**
+ * @}
+ */
+
+/*****************************************************************************
+ * @defgroup Bit timing functions.
+ * @{
+ */
+
+/**
+ * @brief Bit timing precomputed by `Tools/can_bit_timing_host`.
+ */
+typedef struct {
+    uint32_t clock;    /*!< CAN clock, 0 if not precomputed. */
+    uint32_t rate;     /*!< Bit rate.                        */
+    uint32_t prescale; /*!< Prescaler.                       */
+    uint32_t tseg1;    /*!< Time segment 1.                  */
+    uint32_t tseg2;    /*!< Time segment 2.                  */
+    uint32_t sjw;      /*!< Synchronization jump width.      */
+} can_timing_preset_t;
+
+static const can_timing_preset_t can_timing_preset[3] = {
+#ifdef CAN1_BIT_TIMING_CLOCK
+    [can1_selected] = {CAN1_BIT_TIMING_CLOCK, CAN1_BIT_TIMING_RATE,
+                       CAN1_BIT_TIMING_PRESCALE, CAN1_BIT_TIMING_TSEG1,
+                       CAN1_BIT_TIMING_TSEG2, CAN1_BIT_TIMING_SJW},
+#endif /* CAN1_BIT_TIMING_CLOCK */
+
+#ifdef CAN2_BIT_TIMING_CLOCK
+    [can2_selected] = {CAN2_BIT_TIMING_CLOCK, CAN2_BIT_TIMING_RATE,
+                       CAN2_BIT_TIMING_PRESCALE, CAN2_BIT_TIMING_TSEG1,
+                       CAN2_BIT_TIMING_TSEG2, CAN2_BIT_TIMING_SJW},
+#endif /* CAN2_BIT_TIMING_CLOCK */
+
+#ifdef CAN3_BIT_TIMING_CLOCK
+    [can3_selected] = {CAN3_BIT_TIMING_CLOCK, CAN3_BIT_TIMING_RATE,
+                       CAN3_BIT_TIMING_PRESCALE, CAN3_BIT_TIMING_TSEG1,
+                       CAN3_BIT_TIMING_TSEG2, CAN3_BIT_TIMING_SJW},
+#endif /* CAN3_BIT_TIMING_CLOCK */
+};
+
+/**
+ * @brief Get the bit timing of the CAN. Use the precomputed timing when the
+ *        bit rate and the clock match, otherwise solve it.
+ *
+ * @param can_selected Specific which CAN.
+ * @param baud_rate CAN band rate. Unit: bps.
+ * @param prop_delay The propagation delay of bus. Unit: ns.
+ * @param[out] prescale The prescale of CAN clock.
+ * @param[out] tsjw Syncronisation Jump Width.
+ * @param[out] tseg1 Time of segment 1.
+ * @param[out] tseg2 Time of segment 2.
+ * @return 0: Success, 1: Can not satisfied this baudrate.
+ */
+static uint8_t can_timing_get(can_selected_t can_selected, uint32_t baud_rate,
+                              uint32_t prop_delay, uint32_t *prescale,
+                              uint32_t *tsjw, uint32_t *tseg1,
+                              uint32_t *tseg2) {
+    const can_timing_preset_t *preset = &can_timing_preset[can_selected];
+    uint32_t base_freq = HAL_RCC_GetPCLK1Freq();
+
+    if ((preset->clock == base_freq) && (preset->rate == baud_rate)) {
+        *prescale = preset->prescale;
+        *tsjw = preset->sjw;
+        *tseg1 = preset->tseg1;
+        *tseg2 = preset->tseg2;
+        return 0;
+    }
+
+    return can_rate_calc(baud_rate, prop_delay, base_freq, prescale, tsjw,
+                         tseg1, tseg2);
+}
+
+/**
+ * @}
+ */
+
+
+/*****************************************************************************
+ * @defgroup CAN1 Functions.
+ * @{
+ */
+
+#if CAN1_ENABLE
+
+CAN_HandleTypeDef can1_handle = {.Instance = CAN1,
+                                 .Init = {.Mode = CAN_MODE_NORMAL,
+                                          .TimeTriggeredMode = DISABLE,
+                                          .AutoBusOff = CAN_AUTO_BUS_OFF,
+                                          .AutoWakeUp = DISABLE,
+                                          .AutoRetransmission = ENABLE,
+                                          .ReceiveFifoLocked = DISABLE,
+                                          .TransmitFifoPriority = DISABLE}};
+
+/**
+ * @brief CAN1 initialization
+ *
+ * @param baud_rate Baud rate. Unit: Kbps.
+ * @param prop_delay The propagation delay of bus, include cable and can
+ *                   transceiver. Unit: ns.
+ * @return CAN init status.
+ * @retval - 0: `CAN_INIT_OK`:           Success.
+ * @retval - 1: `CAN_INIT_RATE_ERR`:     Can not satisfied this baudrate in this
+ *                                       condition.
+ * @retval - 2: `CAN_INIT_FILTER_FAIL`:  CAN Filter init failed.
+ * @retval - 3: `CAN_INIT_FAIL`:         CAN hardware init failed.
+ * @retval - 4: `CAN_INIT_START_FAIL`:   CAN start failed.
+ * @retval - 5: `CAN_INIT_NOTIFY_FAIL`:  Enable CAN receive notify failed.
+ * @retval - 6: `CAN_INITED`:            This can is inited.
+ */
+uint8_t can1_init(uint32_t baud_rate, uint32_t prop_delay) {
+    if (__HAL_RCC_CAN1_IS_CLK_ENABLED()) {
+        return CAN_INITED;
+    }
+
+    uint32_t prescale, tbs1, tbs2, tsjw;
+    if (can_timing_get(can1_selected, baud_rate * 1000, prop_delay,
+                       &prescale, &tsjw, &tbs1, &tbs2) != 0) {
+        return CAN_INIT_RATE_ERR;
+    }
+
+    can1_handle.Init.Prescaler = prescale;
+    can1_handle.Init.TimeSeg1 = (tbs1 - 1) << CAN_BTR_TS1_Pos;
+    can1_handle.Init.TimeSeg2 = (tbs2 - 1) << CAN_BTR_TS2_Pos;
+    can1_handle.Init.SyncJumpWidth = (tsjw - 1) << CAN_BTR_SJW_Pos;
+
+    CAN_TIMESTAMP_INIT();
+    can_error_init(can1_selected);
+
+#if CAN_METER_ENABLE
+    can_meter_init(can1_selected, baud_rate * 1000);
+#endif /* CAN_METER_ENABLE */
+
+#if CAN1_TX_IT_ENABLE && (CAN_TX_QUEUE_LENGTH > 0)
+    /* The TX queue decides the order, mailboxes are sent by request order. */
+    can1_handle.Init.TransmitFifoPriority = ENABLE;
+    can_tx_queue_init(can1_selected);
+#endif /* CAN1_TX_IT_ENABLE && (CAN_TX_QUEUE_LENGTH > 0) */
+
+    if (HAL_CAN_Init(&can1_handle) != HAL_OK) {
+        return CAN_INIT_FAIL;
+    }
+
+    /* Accept all filter, at the last bank so the filters added by
+       `can_filter_add` have higher match priority. */
+    if (can_filter_config(&can1_handle,
+                          can_filter_first_bank(can1_selected) +
+                              CAN_FILTER_BANK_NUMBER - 1,
+                          0x00000000, 0x00000000, CAN1_ACCEPT_ALL_FIFO,
+                          CAN_FILTER_ENABLE) != 0) {
+        return CAN_INIT_FILTER_FAIL;
+    }
+
+#if CAN1_RX0_IT_ENABLE
+    if (HAL_CAN_ActivateNotification(&can1_handle,
+                                     CAN_IT_RX_FIFO0_MSG_PENDING) != HAL_OK) {
+        return CAN_INIT_NOTIFY_FAIL;
+    }
+#endif /* CAN1_RX0_IT_ENABLE */
+
+#if CAN1_RX1_IT_ENABLE
+    if (HAL_CAN_ActivateNotification(&can1_handle,
+                                     CAN_IT_RX_FIFO1_MSG_PENDING) != HAL_OK) {
+        return CAN_INIT_NOTIFY_FAIL;
+    }
+#endif /* CAN1_RX1_IT_ENABLE */
+
+#if CAN1_SCE_IT_ENABLE
+    /* Track the error state and count the errors. */
+    if (HAL_CAN_ActivateNotification(&can1_handle, CAN_ERROR_IT) != HAL_OK) {
+        return CAN_INIT_NOTIFY_FAIL;
+    }
+#endif /* CAN1_SCE_IT_ENABLE */
+
+#if CAN1_TX_IT_ENABLE && (CAN_TX_QUEUE_LENGTH > 0)
+    /* Load the next queued frame when a mailbox becomes empty. */
+    if (HAL_CAN_ActivateNotification(&can1_handle,
+                                     CAN_IT_TX_MAILBOX_EMPTY) != HAL_OK) {
+        return CAN_INIT_NOTIFY_FAIL;
+    }
+#endif /* CAN1_TX_IT_ENABLE && (CAN_TX_QUEUE_LENGTH > 0) */
+
+    if (HAL_CAN_Start(&can1_handle) != HAL_OK) {
+        return CAN_INIT_START_FAIL;
+    }
+
+    return CAN_INIT_OK;
+}
+
+#if CAN1_TX_IT_ENABLE
+
+/**
+ * @brief CAN1 TX ISR.
+ *
+ */
+void CAN1_TX_IRQHandler(void) {
+    HAL_CAN_IRQHandler(&can1_handle);
+
+#if CAN_TX_QUEUE_LENGTH > 0
+    can_tx_process(can1_selected);
+#endif /* CAN_TX_QUEUE_LENGTH > 0 */
+}
+
+#endif /* CAN1_TX_IT_ENABLE */
+
+#if CAN1_RX0_IT_ENABLE
+
+/**
+ * @brief CAN1 RX FIFO0 ISR.
+ *
+ */
+void CAN1_RX0_IRQHandler(void) {
+    HAL_CAN_IRQHandler(&can1_handle);
+}
+
+#endif /* CAN1_RX0_IT_ENABLE */
+
+#if CAN1_RX1_IT_ENABLE
+
+/**
+ * @brief CAN1 RX FIFO1 ISR.
+ *
+ */
+void CAN1_RX1_IRQHandler(void) {
+    HAL_CAN_IRQHandler(&can1_handle);
+}
+
+#endif /* CAN1_RX1_IT_ENABLE */
+
+#if CAN1_SCE_IT_ENABLE
+
+/**
+ * @brief CAN1 SCE ISR.
+ *
+ */
+void CAN1_SCE_IRQHandler(void) {
+    HAL_CAN_IRQHandler(&can1_handle);
+}
+
+#endif /* CAN1_SCE_IT_ENABLE */
+
+/**
+ * @brief CAN1 deinitialization.
+ *
+ * @return Deinit status.
+ * @retval - 0: `CAN_DEINIT_OK`:   Success.
+ * @retval - 1: `CAN_DEINIT_FAIL`: CAN hardware deinit failed.
+ * @retval - 2: `CAN_NO_INIT`:     This can is no init.
+ */
+uint8_t can1_deinit(void) {
+    if (__HAL_RCC_CAN1_CLK_DISABLE()) {
+        return CAN_NO_INIT;
+    }
+
+    if (HAL_CAN_Stop(&can1_handle) != HAL_OK) {
+        return CAN_DEINIT_FAIL;
+    }
+
+    if (HAL_CAN_DeInit(&can1_handle) != HAL_OK) {
+        return CAN_DEINIT_FAIL;
+    }
+
+    return CAN_DEINIT_OK;
+}
+
+#endif /* CAN1_ENABLE */
+
+/**
+ * @}
+ */
+
+
+
+/*****************************************************************************
+ * @defgroup CAN2 Functions.
+ * @{
+ */
+
+#if CAN2_ENABLE
+
+CAN_HandleTypeDef can2_handle = {.Instance = CAN2,
+                                 .Init = {.Mode = CAN_MODE_NORMAL,
+                                          .TimeTriggeredMode = DISABLE,
+                                          .AutoBusOff = CAN_AUTO_BUS_OFF,
+                                          .AutoWakeUp = DISABLE,
+                                          .AutoRetransmission = ENABLE,
+                                          .ReceiveFifoLocked = DISABLE,
+                                          .TransmitFifoPriority = DISABLE}};
+
+/**
+ * @brief CAN2 initialization
+ *
+ * @param baud_rate Baud rate. Unit: Kbps.
+ * @param prop_delay The propagation delay of bus, include cable and can
+ *                   transceiver. Unit: ns.
+ * @return CAN init status.
+ * @retval - 0: `CAN_INIT_OK`:           Success.
+ * @retval - 1: `CAN_INIT_RATE_ERR`:     Can not satisfied this baudrate in this
+ *                                       condition.
+ * @retval - 2: `CAN_INIT_FILTER_FAIL`:  CAN Filter init failed.
+ * @retval - 3: `CAN_INIT_FAIL`:         CAN hardware init failed.
+ * @retval - 4: `CAN_INIT_START_FAIL`:   CAN start failed.
+ * @retval - 5: `CAN_INIT_NOTIFY_FAIL`:  Enable CAN receive notify failed.
+ * @retval - 6: `CAN_INITED`:            This can is inited.
+ */
+uint8_t can2_init(uint32_t baud_rate, uint32_t prop_delay) {
+    if (__HAL_RCC_CAN2_IS_CLK_ENABLED()) {
+        return CAN_INITED;
+    }
+
+    uint32_t prescale, tbs1, tbs2, tsjw;
+    if (can_timing_get(can2_selected, baud_rate * 1000, prop_delay,
+                       &prescale, &tsjw, &tbs1, &tbs2) != 0) {
+        return CAN_INIT_RATE_ERR;
+    }
+
+    can2_handle.Init.Prescaler = prescale;
+    can2_handle.Init.TimeSeg1 = (tbs1 - 1) << CAN_BTR_TS1_Pos;
+    can2_handle.Init.TimeSeg2 = (tbs2 - 1) << CAN_BTR_TS2_Pos;
+    can2_handle.Init.SyncJumpWidth = (tsjw - 1) << CAN_BTR_SJW_Pos;
+
+    CAN_TIMESTAMP_INIT();
+    can_error_init(can2_selected);
+
+#if CAN_METER_ENABLE
+    can_meter_init(can2_selected, baud_rate * 1000);
+#endif /* CAN_METER_ENABLE */
+
+#if CAN2_TX_IT_ENABLE && (CAN_TX_QUEUE_LENGTH > 0)
+    /* The TX queue decides the order, mailboxes are sent by request order. */
+    can2_handle.Init.TransmitFifoPriority = ENABLE;
+    can_tx_queue_init(can2_selected);
+#endif /* CAN2_TX_IT_ENABLE && (CAN_TX_QUEUE_LENGTH > 0) */
+
+    if (HAL_CAN_Init(&can2_handle) != HAL_OK) {
+        return CAN_INIT_FAIL;
+    }
+
+    /* Accept all filter, at the last bank so the filters added by
+       `can_filter_add` have higher match priority. */
+    if (can_filter_config(&can2_handle,
+                          can_filter_first_bank(can2_selected) +
+                              CAN_FILTER_BANK_NUMBER - 1,
+                          0x00000000, 0x00000000, CAN2_ACCEPT_ALL_FIFO,
+                          CAN_FILTER_ENABLE) != 0) {
+        return CAN_INIT_FILTER_FAIL;
+    }
+
+#if CAN2_RX0_IT_ENABLE
+    if (HAL_CAN_ActivateNotification(&can2_handle,
+                                     CAN_IT_RX_FIFO0_MSG_PENDING) != HAL_OK) {
+        return CAN_INIT_NOTIFY_FAIL;
+    }
+#endif /* CAN2_RX0_IT_ENABLE */
+
+#if CAN2_RX1_IT_ENABLE
+    if (HAL_CAN_ActivateNotification(&can2_handle,
+                                     CAN_IT_RX_FIFO1_MSG_PENDING) != HAL_OK) {
+        return CAN_INIT_NOTIFY_FAIL;
+    }
+#endif /* CAN2_RX1_IT_ENABLE */
+
+#if CAN2_SCE_IT_ENABLE
+    /* Track the error state and count the errors. */
+    if (HAL_CAN_ActivateNotification(&can2_handle, CAN_ERROR_IT) != HAL_OK) {
+        return CAN_INIT_NOTIFY_FAIL;
+    }
+#endif /* CAN2_SCE_IT_ENABLE */
+
+#if CAN2_TX_IT_ENABLE && (CAN_TX_QUEUE_LENGTH > 0)
+    /* Load the next queued frame when a mailbox becomes empty. */
+    if (HAL_CAN_ActivateNotification(&can2_handle,
+                                     CAN_IT_TX_MAILBOX_EMPTY) != HAL_OK) {
+        return CAN_INIT_NOTIFY_FAIL;
+    }
+#endif /* CAN2_TX_IT_ENABLE && (CAN_TX_QUEUE_LENGTH > 0) */
+
+    if (HAL_CAN_Start(&can2_handle) != HAL_OK) {
+        return CAN_INIT_START_FAIL;
+    }
+
+    return CAN_INIT_OK;
+}
+
+#if CAN2_TX_IT_ENABLE
+
+/**
+ * @brief CAN2 TX ISR.
+ *
+ */
+void CAN2_TX_IRQHandler(void) {
+    HAL_CAN_IRQHandler(&can2_handle);
+
+#if CAN_TX_QUEUE_LENGTH > 0
+    can_tx_process(can2_selected);
+#endif /* CAN_TX_QUEUE_LENGTH > 0 */
+}
+
+#endif /* CAN2_TX_IT_ENABLE */
+
+#if CAN2_RX0_IT_ENABLE
+
+/**
+ * @brief CAN2 RX FIFO0 ISR.
+ *
+ */
+void CAN2_RX0_IRQHandler(void) {
+    HAL_CAN_IRQHandler(&can2_handle);
+}
+
+#endif /* CAN2_RX0_IT_ENABLE */
+
+#if CAN2_RX1_IT_ENABLE
+
+/**
+ * @brief CAN2 RX FIFO1 ISR.
+ *
+ */
+void CAN2_RX1_IRQHandler(void) {
+    HAL_CAN_IRQHandler(&can2_handle);
+}
+
+#endif /* CAN2_RX1_IT_ENABLE */
+
+#if CAN2_SCE_IT_ENABLE
+
+/**
+ * @brief CAN2 SCE ISR.
+ *
+ */
+void CAN2_SCE_IRQHandler(void) {
+    HAL_CAN_IRQHandler(&can2_handle);
+}
+
+#endif /* CAN2_SCE_IT_ENABLE */
+
+/**
+ * @brief CAN2 deinitialization.
+ *
+ * @return Deinit status.
+ * @retval - 0: `CAN_DEINIT_OK`:   Success.
+ * @retval - 1: `CAN_DEINIT_FAIL`: CAN hardware deinit failed.
+ * @retval - 2: `CAN_NO_INIT`:     This can is no init.
+ */
+uint8_t can2_deinit(void) {
+    if (__HAL_RCC_CAN2_CLK_DISABLE()) {
+        return CAN_NO_INIT;
+    }
+
+    if (HAL_CAN_Stop(&can2_handle) != HAL_OK) {
+        return CAN_DEINIT_FAIL;
+    }
+
+    if (HAL_CAN_DeInit(&can2_handle) != HAL_OK) {
+        return CAN_DEINIT_FAIL;
+    }
+
+    return CAN_DEINIT_OK;
+}
+
+#endif /* CAN2_ENABLE */
+
+/**
+ * @}
+ */
+
+
+
+/*****************************************************************************
+ * @defgroup CAN3 Functions.
+ * @{
+ */
+
+#if CAN3_ENABLE
+
+CAN_HandleTypeDef can3_handle = {.Instance = CAN3,
+                                 .Init = {.Mode = CAN_MODE_NORMAL,
+                                          .TimeTriggeredMode = DISABLE,
+                                          .AutoBusOff = CAN_AUTO_BUS_OFF,
+                                          .AutoWakeUp = DISABLE,
+                                          .AutoRetransmission = ENABLE,
+                                          .ReceiveFifoLocked = DISABLE,
+                                          .TransmitFifoPriority = DISABLE}};
+
+/**
+ * @brief CAN3 initialization
+ *
+ * @param baud_rate Baud rate. Unit: Kbps.
+ * @param prop_delay The propagation delay of bus, include cable and can
+ *                   transceiver. Unit: ns.
+ * @return CAN init status.
+ * @retval - 0: `CAN_INIT_OK`:           Success.
+ * @retval - 1: `CAN_INIT_RATE_ERR`:     Can not satisfied this baudrate in this
+ *                                       condition.
+ * @retval - 2: `CAN_INIT_FILTER_FAIL`:  CAN Filter init failed.
+ * @retval - 3: `CAN_INIT_FAIL`:         CAN hardware init failed.
+ * @retval - 4: `CAN_INIT_START_FAIL`:   CAN start failed.
+ * @retval - 5: `CAN_INIT_NOTIFY_FAIL`:  Enable CAN receive notify failed.
+ * @retval - 6: `CAN_INITED`:            This can is inited.
+ */
+uint8_t can3_init(uint32_t baud_rate, uint32_t prop_delay) {
+    if (__HAL_RCC_CAN3_IS_CLK_ENABLED()) {
+        return CAN_INITED;
+    }
+
+    uint32_t prescale, tbs1, tbs2, tsjw;
+    if (can_timing_get(can3_selected, baud_rate * 1000, prop_delay,
+                       &prescale, &tsjw, &tbs1, &tbs2) != 0) {
+        return CAN_INIT_RATE_ERR;
+    }
+
+    can3_handle.Init.Prescaler = prescale;
+    can3_handle.Init.TimeSeg1 = (tbs1 - 1) << CAN_BTR_TS1_Pos;
+    can3_handle.Init.TimeSeg2 = (tbs2 - 1) << CAN_BTR_TS2_Pos;
+    can3_handle.Init.SyncJumpWidth = (tsjw - 1) << CAN_BTR_SJW_Pos;
+
+    CAN_TIMESTAMP_INIT();
+    can_error_init(can3_selected);
+
+#if CAN_METER_ENABLE
+    can_meter_init(can3_selected, baud_rate * 1000);
+#endif /* CAN_METER_ENABLE */
+
+#if CAN3_TX_IT_ENABLE && (CAN_TX_QUEUE_LENGTH > 0)
+    /* The TX queue decides the order, mailboxes are sent by request order. */
+    can3_handle.Init.TransmitFifoPriority = ENABLE;
+    can_tx_queue_init(can3_selected);
+#endif /* CAN3_TX_IT_ENABLE && (CAN_TX_QUEUE_LENGTH > 0) */
+
+    if (HAL_CAN_Init(&can3_handle) != HAL_OK) {
+        return CAN_INIT_FAIL;
+    }
+
+    /* Accept all filter, at the last bank so the filters added by
+       `can_filter_add` have higher match priority. */
+    if (can_filter_config(&can3_handle,
+                          can_filter_first_bank(can3_selected) +
+                              CAN_FILTER_BANK_NUMBER - 1,
+                          0x00000000, 0x00000000, CAN3_ACCEPT_ALL_FIFO,
+                          CAN_FILTER_ENABLE) != 0) {
+        return CAN_INIT_FILTER_FAIL;
+    }
+
+#if CAN3_RX0_IT_ENABLE
+    if (HAL_CAN_ActivateNotification(&can3_handle,
+                                     CAN_IT_RX_FIFO0_MSG_PENDING) != HAL_OK) {
+        return CAN_INIT_NOTIFY_FAIL;
+    }
+#endif /* CAN3_RX0_IT_ENABLE */
+
+#if CAN3_RX1_IT_ENABLE
+    if (HAL_CAN_ActivateNotification(&can3_handle,
+                                     CAN_IT_RX_FIFO1_MSG_PENDING) != HAL_OK) {
+        return CAN_INIT_NOTIFY_FAIL;
+    }
+#endif /* CAN3_RX1_IT_ENABLE */
+
+#if CAN3_SCE_IT_ENABLE
+    /* Track the error state and count the errors. */
+    if (HAL_CAN_ActivateNotification(&can3_handle, CAN_ERROR_IT) != HAL_OK) {
+        return CAN_INIT_NOTIFY_FAIL;
+    }
+#endif /* CAN3_SCE_IT_ENABLE */
+
+#if CAN3_TX_IT_ENABLE && (CAN_TX_QUEUE_LENGTH > 0)
+    /* Load the next queued frame when a mailbox becomes empty. */
+    if (HAL_CAN_ActivateNotification(&can3_handle,
+                                     CAN_IT_TX_MAILBOX_EMPTY) != HAL_OK) {
+        return CAN_INIT_NOTIFY_FAIL;
+    }
+#endif /* CAN3_TX_IT_ENABLE && (CAN_TX_QUEUE_LENGTH > 0) */
+
+    if (HAL_CAN_Start(&can3_handle) != HAL_OK) {
+        return CAN_INIT_START_FAIL;
+    }
+
+    return CAN_INIT_OK;
+}
+
+#if CAN3_TX_IT_ENABLE
+
+/**
+ * @brief CAN3 TX ISR.
+ *
+ */
+void CAN3_TX_IRQHandler(void) {
+    HAL_CAN_IRQHandler(&can3_handle);
+
+#if CAN_TX_QUEUE_LENGTH > 0
+    can_tx_process(can3_selected);
+#endif /* CAN_TX_QUEUE_LENGTH > 0 */
+}
+
+#endif /* CAN3_TX_IT_ENABLE */
+
+#if CAN3_RX0_IT_ENABLE
+
+/**
+ * @brief CAN3 RX FIFO0 ISR.
+ *
+ */
+void CAN3_RX0_IRQHandler(void) {
+    HAL_CAN_IRQHandler(&can3_handle);
+}
+
+#endif /* CAN3_RX0_IT_ENABLE */
+
+#if CAN3_RX1_IT_ENABLE
+
+/**
+ * @brief CAN3 RX FIFO1 ISR.
+ *
+ */
+void CAN3_RX1_IRQHandler(void) {
+    HAL_CAN_IRQHandler(&can3_handle);
+}
+
+#endif /* CAN3_RX1_IT_ENABLE */
+
+#if CAN3_SCE_IT_ENABLE
+
+/**
+ * @brief CAN3 SCE ISR.
+ *
+ */
+void CAN3_SCE_IRQHandler(void) {
+    HAL_CAN_IRQHandler(&can3_handle);
+}
+
+#endif /* CAN3_SCE_IT_ENABLE */
+
+/**
+ * @brief CAN3 deinitialization.
+ *
+ * @return Deinit status.
+ * @retval - 0: `CAN_DEINIT_OK`:   Success.
+ * @retval - 1: `CAN_DEINIT_FAIL`: CAN hardware deinit failed.
+ * @retval - 2: `CAN_NO_INIT`:     This can is no init.
+ */
+uint8_t can3_deinit(void) {
+    if (__HAL_RCC_CAN3_CLK_DISABLE()) {
+        return CAN_NO_INIT;
+    }
+
+    if (HAL_CAN_Stop(&can3_handle) != HAL_OK) {
+        return CAN_DEINIT_FAIL;
+    }
+
+    if (HAL_CAN_DeInit(&can3_handle) != HAL_OK) {
+        return CAN_DEINIT_FAIL;
+    }
+
+    return CAN_DEINIT_OK;
+}
+
+#endif /* CAN3_ENABLE */
+
+/**
+ * @}
+ */
+
+
+
+/*****************************************************************************
+ * @defgroup Public functions of CAN.
+ * @{
+ */
+
+/**
+ * @brief CAN Low level initialization
+ *
+ * @param hcan The handle of CAN
+ * @note If you want to use dual CAN, you must initialize both CAN GPIO at the
+ *       same time, otherwise there will be a `Wait initialisation acknowledge`
+ *       error.
+ */
+void HAL_CAN_MspInit(CAN_HandleTypeDef *hcan) {
+    GPIO_InitTypeDef gpio_init_struct = {.Mode = GPIO_MODE_AF_PP,
+                                         .Pull = GPIO_PULLUP,
+                                         .Speed = GPIO_SPEED_FREQ_VERY_HIGH};
+#if CAN3_ENABLE
+    if (hcan->Instance == CAN3) {
+
+        CSP_GPIO_CLK_ENABLE(CAN3_TX_PORT);
+        gpio_init_struct.Pin = CAN3_TX_PIN;
+        gpio_init_struct.Alternate = CAN3_TX_AF;
+        HAL_GPIO_Init(CSP_GPIO_PORT(CAN3_TX_PORT), &gpio_init_struct);
+
+        CSP_GPIO_CLK_ENABLE(CAN3_RX_PORT);
+        gpio_init_struct.Pin = CAN3_RX_PIN;
+        gpio_init_struct.Alternate = CAN3_RX_AF;
+        HAL_GPIO_Init(CSP_GPIO_PORT(CAN3_RX_PORT), &gpio_init_struct);
+        __HAL_RCC_CAN3_CLK_ENABLE();
+
+#if CAN3_TX_IT_ENABLE
+        HAL_NVIC_SetPriority(CAN3_TX_IRQn, CAN3_TX_IT_PRIORITY, CAN3_TX_IT_SUB);
+        HAL_NVIC_EnableIRQ(CAN3_TX_IRQn);
+#endif /* CAN3_TX_IT_ENABLE */
+
+#if CAN3_RX0_IT_ENABLE
+        HAL_NVIC_SetPriority(CAN3_RX0_IRQn, CAN3_RX0_IT_PRIORITY,
+                             CAN3_RX0_IT_SUB);
+        HAL_NVIC_EnableIRQ(CAN3_RX0_IRQn);
+#endif /* CAN3_RX0_IT_ENABLE */
+
+#if CAN3_RX1_IT_ENABLE
+        HAL_NVIC_SetPriority(CAN3_RX1_IRQn, CAN3_RX1_IT_PRIORITY,
+                             CAN3_RX1_IT_SUB);
+        HAL_NVIC_EnableIRQ(CAN3_RX1_IRQn);
+#endif /* CAN3_RX1_IT_ENABLE */
+
+#if CAN3_SCE_IT_ENABLE
+        HAL_NVIC_SetPriority(CAN3_SCE_IRQn, CAN3_SCE_IT_PRIORITY,
+                             CAN3_SCE_IT_SUB);
+        HAL_NVIC_EnableIRQ(CAN3_SCE_IRQn);
+#endif /* CAN3_SCE_IT_ENABLE */
+
+        return;
+    }
+#endif /* CAN3_ENABLE */
+
+#if CAN1_ENABLE
+    __HAL_RCC_CAN1_CLK_ENABLE();
+
+    CSP_GPIO_CLK_ENABLE(CAN1_TX_PORT);
+    gpio_init_struct.Pin = CAN1_TX_PIN;
+    gpio_init_struct.Alternate = CAN1_TX_AF;
+    HAL_GPIO_Init(CSP_GPIO_PORT(CAN1_TX_PORT), &gpio_init_struct);
+
+    CSP_GPIO_CLK_ENABLE(CAN1_RX_PORT);
+    gpio_init_struct.Pin = CAN1_RX_PIN;
+    gpio_init_struct.Alternate = CAN1_RX_AF;
+    HAL_GPIO_Init(CSP_GPIO_PORT(CAN1_RX_PORT), &gpio_init_struct);
+
+#if CAN1_TX_IT_ENABLE
+    HAL_NVIC_SetPriority(CAN1_TX_IRQn, CAN1_TX_IT_PRIORITY, CAN1_TX_IT_SUB);
+    HAL_NVIC_EnableIRQ(CAN1_TX_IRQn);
+#endif /* CAN1_TX_IT_ENABLE */
+
+#if CAN1_RX0_IT_ENABLE
+    HAL_NVIC_SetPriority(CAN1_RX0_IRQn, CAN1_RX0_IT_PRIORITY, CAN1_RX0_IT_SUB);
+    HAL_NVIC_EnableIRQ(CAN1_RX0_IRQn);
+#endif /* CAN1_RX0_IT_ENABLE */
+
+#if CAN1_RX1_IT_ENABLE
+    HAL_NVIC_SetPriority(CAN1_RX1_IRQn, CAN1_RX1_IT_PRIORITY, CAN1_RX1_IT_SUB);
+    HAL_NVIC_EnableIRQ(CAN1_RX1_IRQn);
+#endif /* CAN1_RX1_IT_ENABLE */
+
+#if CAN1_SCE_IT_ENABLE
+    HAL_NVIC_SetPriority(CAN1_SCE_IRQn, CAN1_SCE_IT_PRIORITY, CAN1_SCE_IT_SUB);
+    HAL_NVIC_EnableIRQ(CAN1_SCE_IRQn);
+#endif /* CAN1_SCE_IT_ENABLE */
+
+#endif /* CAN1_ENABLE */
+
+#if CAN2_ENABLE
+    __HAL_RCC_CAN2_CLK_ENABLE();
+
+    CSP_GPIO_CLK_ENABLE(CAN2_TX_PORT);
+    gpio_init_struct.Pin = CAN2_TX_PIN;
+    gpio_init_struct.Alternate = CAN2_TX_AF;
+
+    HAL_GPIO_Init(CSP_GPIO_PORT(CAN2_TX_PORT), &gpio_init_struct);
+
+    CSP_GPIO_CLK_ENABLE(CAN2_RX_PORT);
+    gpio_init_struct.Pin = CAN2_RX_PIN;
+    gpio_init_struct.Alternate = CAN2_RX_AF;
+    HAL_GPIO_Init(CSP_GPIO_PORT(CAN2_RX_PORT), &gpio_init_struct);
+
+#if CAN2_TX_IT_ENABLE
+    HAL_NVIC_SetPriority(CAN2_TX_IRQn, CAN2_TX_IT_PRIORITY, CAN2_TX_IT_SUB);
+    HAL_NVIC_EnableIRQ(CAN2_TX_IRQn);
+#endif /* CAN2_TX_IT_ENABLE */
+
+#if CAN2_RX0_IT_ENABLE
+    HAL_NVIC_SetPriority(CAN2_RX0_IRQn, CAN2_RX0_IT_PRIORITY, CAN2_RX0_IT_SUB);
+    HAL_NVIC_EnableIRQ(CAN2_RX0_IRQn);
+#endif /* CAN2_RX0_IT_ENABLE */
+
+#if CAN2_RX1_IT_ENABLE
+    HAL_NVIC_SetPriority(CAN2_RX1_IRQn, CAN2_RX1_IT_PRIORITY, CAN2_RX1_IT_SUB);
+    HAL_NVIC_EnableIRQ(CAN2_RX1_IRQn);
+#endif /* CAN2_RX1_IT_ENABLE */
+
+#if CAN2_SCE_IT_ENABLE
+    HAL_NVIC_SetPriority(CAN2_SCE_IRQn, CAN2_SCE_IT_PRIORITY, CAN2_SCE_IT_SUB);
+    HAL_NVIC_EnableIRQ(CAN2_SCE_IRQn);
+#endif /* CAN2_SCE_IT_ENABLE */
+
+#endif /* CAN2_ENABLE */
+}
+
+/**
+ * @brief CAN Low level deinitialization
+ *
+ * @param hcan The handle of CAN
+ */
+void HAL_CAN_MspDeInit(CAN_HandleTypeDef *hcan) {
+
+#if CAN1_ENABLE
+    if (hcan->Instance == CAN1) {
+        __HAL_RCC_CAN1_CLK_DISABLE();
+
+        HAL_GPIO_DeInit(CSP_GPIO_PORT(CAN1_RX_PORT), CAN1_RX_PIN);
+        HAL_GPIO_DeInit(CSP_GPIO_PORT(CAN1_TX_PORT), CAN1_TX_PIN);
+
+#if CAN1_TX_IT_ENABLE
+        HAL_NVIC_DisableIRQ(CAN1_TX_IRQn);
+#endif /* CAN1_TX_IT_ENABLE */
+
+#if CAN1_RX0_IT_ENABLE
+        HAL_NVIC_DisableIRQ(CAN1_RX0_IRQn);
+#endif /* CAN1_RX0_IT_ENABLE */
+
+#if CAN1_RX1_IT_ENABLE
+        HAL_NVIC_DisableIRQ(CAN1_RX1_IRQn);
+#endif /* CAN1_RX1_IT_ENABLE */
+
+#if CAN1_SCE_IT_ENABLE
+        HAL_NVIC_DisableIRQ(CAN1_SCE_IRQn);
+#endif /* CAN1_SCE_IT_ENABLE */
+    }
+#endif /* CAN1_ENABLE */
+
+#if CAN2_ENABLE
+    if (hcan->Instance == CAN2) {
+        __HAL_RCC_CAN2_CLK_DISABLE();
+
+        HAL_GPIO_DeInit(CSP_GPIO_PORT(CAN2_RX_PORT), CAN2_RX_PIN);
+        HAL_GPIO_DeInit(CSP_GPIO_PORT(CAN2_TX_PORT), CAN2_TX_PIN);
+
+#if CAN2_TX_IT_ENABLE
+        HAL_NVIC_DisableIRQ(CAN2_TX_IRQn);
+#endif /* CAN2_TX_IT_ENABLE */
+
+#if CAN2_RX0_IT_ENABLE
+        HAL_NVIC_DisableIRQ(CAN2_RX0_IRQn);
+#endif /* CAN2_RX0_IT_ENABLE */
+
+#if CAN2_RX1_IT_ENABLE
+        HAL_NVIC_DisableIRQ(CAN2_RX1_IRQn);
+#endif /* CAN2_RX1_IT_ENABLE */
+
+#if CAN2_SCE_IT_ENABLE
+        HAL_NVIC_DisableIRQ(CAN2_SCE_IRQn);
+#endif /* CAN2_SCE_IT_ENABLE */
+    }
+#endif /* CAN2_ENABLE */
+
+#if CAN3_ENABLE
+    if (hcan->Instance == CAN3) {
+        __HAL_RCC_CAN3_CLK_DISABLE();
+
+        HAL_GPIO_DeInit(CSP_GPIO_PORT(CAN3_RX_PORT), CAN3_RX_PIN);
+        HAL_GPIO_DeInit(CSP_GPIO_PORT(CAN3_TX_PORT), CAN3_TX_PIN);
+
+#if CAN3_TX_IT_ENABLE
+        HAL_NVIC_DisableIRQ(CAN3_TX_IRQn);
+#endif /* CAN3_TX_IT_ENABLE */
+
+#if CAN3_RX0_IT_ENABLE
+        HAL_NVIC_DisableIRQ(CAN3_RX0_IRQn);
+#endif /* CAN3_RX0_IT_ENABLE */
+
+#if CAN3_RX1_IT_ENABLE
+        HAL_NVIC_DisableIRQ(CAN3_RX1_IRQn);
+#endif /* CAN3_RX1_IT_ENABLE */
+
+#if CAN3_SCE_IT_ENABLE
+        HAL_NVIC_DisableIRQ(CAN3_SCE_IRQn);
+#endif /* CAN3_SCE_IT_ENABLE */
+    }
+#endif /* CAN3_ENABLE */
+
+}
+
+/**
+ * @brief Calcuate parameters of specific CAN Classic baudrate. All the
+ *        prescalers and segments are searched by `can_bit_timing_solve`,
+ *        the sample point targets `CAN_SAMPLE_POINT`.
+ *
+ * @param[in] baud_rate CAN band rate. Unit: bps.
+ * @param[in] prop_delay The propagation delay of bus, include cable and can
+ *                       transceiver. Unit: ns.
+ * @param[in] base_freq Base frequency of peripherals. Unit: Hz.
+ * @param[out] prescale The prescale of `base_freq`.
+ * @param[out] tsjw Syncronisation Jump Width
+ * @param[out] tseg1 Time of segment 1.
+ * @param[out] tseg2 Time of segment 2.
+ * @return Calcuate status.
+ * @retval - 0: No error;
+ * @retval - 1: Can not satisfied this baudrate in this condition.
+ */
+uint8_t can_rate_calc(uint32_t baud_rate, uint32_t prop_delay,
+                      uint32_t base_freq, uint32_t *prescale, uint32_t *tsjw,
+                      uint32_t *tseg1, uint32_t *tseg2) {
+    static const can_bit_timing_limit_t limit = CAN_BIT_TIMING_BXCAN;
+    can_bit_timing_config_t config = {.clock = base_freq,
+                                      .bit_rate = baud_rate,
+                                      .sample_point = CAN_SAMPLE_POINT,
+                                      .sample_range = CAN_SAMPLE_POINT_RANGE,
+                                      .prop_delay = prop_delay,
+                                      .rate_error = 0,
+                                      .limit = &limit};
+    can_bit_timing_t timing;
+
+    if (can_bit_timing_solve(&config, &timing, 1) == 0) {
+        return 1;
+    }
+
+    *prescale = timing.prescale;
+    *tsjw = timing.sjw;
+    *tseg1 = timing.tseg1;
+    *tseg2 = timing.tseg2;
+
+    return 0;
+}
+
+/**
+ * @brief Get the CAN handle with specified CAN.
+ *
+ * @param can_selected Specific which can will to get.
+ * @return The handle of CAN. return NULL which the CAN doesn't exist.
+ */
+CAN_HandleTypeDef *can_get_handle(can_selected_t can_selected) {
+    switch (can_selected) {
+
+#if CAN1_ENABLE
+        case can1_selected:
+            return &can1_handle;
+#endif /* CAN1_ENABLE */
+
+#if CAN2_ENABLE
+        case can2_selected:
+            return &can2_handle;
+#endif /* CAN2_ENABLE */
+
+#if CAN3_ENABLE
+        case can3_selected:
+            return &can3_handle;
+#endif /* CAN3_ENABLE */
+
+        default:
+            return NULL;
+    }
+}
+
+/**
+ * @brief Send a frame. With the TX interrupt enabled, the frame is pushed
+ *        into the TX queue and the TX interrupt loads it into the mailbox,
+ *        otherwise wait for a free mailbox.
+ *
+ * @param can_selected Specific which CAN to send message.
+ * @param can_ide Specific standard ID or Extend ID.
+ * @param id Specific message id.
+ * @param rtr Specific data frame or remote frame.
+ * @param len Specific message length.
+ * @param msg Specific message content.
+ * @param priority Priority class in the TX queue.
+ * @param slot Whether the frame overwrites the waiting frame of the same ID.
+ * @return Send status, same as `can_send_message`.
+ */
+static uint8_t can_transmit(can_selected_t can_selected, uint32_t can_ide,
+                            uint32_t id, uint32_t rtr, uint8_t len,
+                            const uint8_t *msg, uint8_t priority,
+                            uint8_t slot) {
+    CAN_HandleTypeDef *can_handle = can_get_handle(can_selected);
+    if (can_handle == NULL) {
+        return 3;
+    }
+
+    if ((len > 8) || (priority >= CAN_TX_PRIORITY_NUMBER)) {
+        return 3;
+    }
+
+    if ((msg == NULL) && (len > 0) && (rtr == CAN_RTR_DATA)) {
+        return 3;
+    }
+
+    if (HAL_CAN_GetState(can_handle) == HAL_CAN_STATE_RESET) {
+        return 4;
+    }
+
+#if CAN_METER_ENABLE
+    uint32_t stuff;
+    uint32_t bits = can_frame_bits(can_ide, id, rtr, len, msg, &stuff);
+#endif /* CAN_METER_ENABLE */
+
+#if CAN_TX_QUEUE_LENGTH > 0
+    IRQn_Type irqn;
+
+    if (can_tx_get_irqn(can_selected, &irqn) == 0) {
+        can_tx_frame_t frame;
+
+        frame.key = can_tx_make_key(priority, can_ide, id);
+        frame.can_ide = can_ide;
+        frame.id = id;
+        frame.rtr = rtr;
+        frame.len = len;
+        frame.slot = slot;
+        if ((rtr == CAN_RTR_DATA) && (len > 0)) {
+            memcpy(frame.data, msg, len);
+        }
+
+#if CAN_METER_ENABLE
+        frame.bits = (uint8_t)bits;
+        frame.stuff = (uint8_t)stuff;
+#endif /* CAN_METER_ENABLE */
+
+        if (can_tx_enqueue(can_selected, &frame) != 0) {
+            return 2;
+        }
+
+        /* Let the TX interrupt load it, a mailbox may be free now. */
+        HAL_NVIC_SetPendingIRQ(irqn);
+
+        return 0;
+    }
+#else  /* CAN_TX_QUEUE_LENGTH > 0 */
+    UNUSED(slot);
+#endif /* CAN_TX_QUEUE_LENGTH > 0 */
+
+    uint16_t wait_time = 0;
+    uint32_t tx_mail_box = CAN_TX_MAILBOX0;
+
+    CAN_TxHeaderTypeDef tx_header = {.TransmitGlobalTime = DISABLE};
+    tx_header.IDE = can_ide;
+    tx_header.RTR = rtr;
+    tx_header.DLC = len;
+    if (can_ide == CAN_ID_STD) {
+        tx_header.StdId = id;
+    } else {
+        tx_header.ExtId = id;
+    }
+
+    while (HAL_CAN_GetTxMailboxesFreeLevel(can_handle) == 0) {
+        /* Wait to all mailbox is empty. */
+        ++wait_time;
+        if (wait_time > CAN_SEND_TIMEOUT) {
+            return 2;
+        }
+    }
+
+    if (HAL_CAN_AddTxMessage(can_handle, &tx_header, msg, &tx_mail_box) !=
+        HAL_OK) {
+        return 1;
+    }
+
+#if CAN_METER_ENABLE
+    /* Not known when transmitted, count at request. */
+    can_meter_add_frame(can_selected, 1, bits, stuff);
+#endif /* CAN_METER_ENABLE */
+
+#if CAN_TRACE_ENABLE
+    can_trace_frame(can_selected, 1, can_ide, id, rtr, len, msg);
+#endif /* CAN_TRACE_ENABLE */
+
+    return 0;
+}
+
+/**
+ * @brief CAN send message. Never blocks when the TX queue is used.
+ *
+ * @param can_selected Specific which CAN to send message.
+ * @param can_ide Specific standard ID or Extend ID.
+ * @param id Specific message id.
+ * @param len Specific message length.
+ * @param msg Specific message content.
+ * @return Send status.
+ * @retval - 0: Success.
+ * @retval - 1: Send error.
+ * @retval - 2: Timeout, or the TX queue is full and the frame is dropped.
+ * @retval - 3: Parameter invalid.
+ * @retval - 4: This CAN is not initialized.
+ */
+uint8_t can_send_message(can_selected_t can_selected, uint32_t can_ide,
+                         uint32_t id, uint8_t len, const uint8_t *msg) {
+    return can_transmit(can_selected, can_ide, id, CAN_RTR_DATA, len, msg,
+                        CAN_TX_DEFAULT_PRIORITY, 0);
+}
+
+/**
+ * @brief CAN send message with the priority class.
+ *
+ * @param can_selected Specific which CAN to send message.
+ * @param can_ide Specific standard ID or Extend ID.
+ * @param id Specific message id.
+ * @param len Specific message length.
+ * @param msg Specific message content.
+ * @param priority Priority class, lower value is sent earlier. Less than
+ *        `CAN_TX_PRIORITY_NUMBER`.
+ * @return Send status, same as `can_send_message`.
+ */
+uint8_t can_send_message_prio(can_selected_t can_selected, uint32_t can_ide,
+                              uint32_t id, uint8_t len, const uint8_t *msg,
+                              uint8_t priority) {
+    return can_transmit(can_selected, can_ide, id, CAN_RTR_DATA, len, msg,
+                        priority, 0);
+}
+
+/**
+ * @brief CAN send message in the latest-value-wins slot. The slot is the ID
+ *        and the priority class, when a frame of the same slot is waiting
+ *        in the TX queue, its content is replaced by this frame instead of
+ *        pushing a new one, so the bus always carries the latest value and
+ *        the queue holds one frame of each slot. The frame already in the
+ *        mailbox is not replaced. Same as `can_send_message_prio` when the
+ *        TX queue is not used.
+ *
+ * @param can_selected Specific which CAN to send message.
+ * @param can_ide Specific standard ID or Extend ID.
+ * @param id Specific message id.
+ * @param len Specific message length.
+ * @param msg Specific message content.
+ * @param priority Priority class, lower value is sent earlier. Less than
+ *        `CAN_TX_PRIORITY_NUMBER`.
+ * @return Send status, same as `can_send_message`.
+ */
+uint8_t can_send_message_slot(can_selected_t can_selected, uint32_t can_ide,
+                              uint32_t id, uint8_t len, const uint8_t *msg,
+                              uint8_t priority) {
+    return can_transmit(can_selected, can_ide, id, CAN_RTR_DATA, len, msg,
+                        priority, 1);
+}
+
+/**
+ * @brief CAN send remote message. Never blocks when the TX queue is used.
+ *
+ * @param can_selected Specific which CAN to send message.
+ * @param can_ide Specific standard ID or Extend ID.
+ * @param id Specific message id.
+ * @param len Specific message length.
+ * @param msg Specific message content.
+ * @return Send status.
+ * @retval - 0: Success.
+ * @retval - 1: Send error.
+ * @retval - 2: Timeout, or the TX queue is full and the frame is dropped.
+ * @retval - 3: Parameter invalid.
+ * @retval - 4: This CAN is not initialized.
+ */
+uint8_t can_send_remote(can_selected_t can_selected, uint32_t can_ide,
+                        uint32_t id, uint8_t len, const uint8_t *msg) {
+    return can_transmit(can_selected, can_ide, id, CAN_RTR_REMOTE, len, msg,
+                        CAN_TX_DEFAULT_PRIORITY, 0);
+}
+
+/**
+ * @brief Send a frame of classic CAN or CAN FD.
+ *
+ * @param can_selected Specific which CAN to send message.
+ * @param frame The frame. The data length of the FD frame is rounded up by
+ *        `can_len_to_dlc`, the padding bytes are 0.
+ * @param priority Priority class in the TX queue, less than
+ *        `CAN_TX_PRIORITY_NUMBER`.
+ * @return Send status, same as `can_send_message`, and:
+ * @retval - 5: FD frame, but this CAN is not FD capable.
+ */
+uint8_t can_send_frame(can_selected_t can_selected, const can_frame_t *frame,
+                       uint8_t priority) {
+    if (frame == NULL) {
+        return 3;
+    }
+
+    if (frame->flags & (CAN_FRAME_FD | CAN_FRAME_BRS)) {
+        /* FD has no remote frame. bxCAN sends classic frames only. */
+        if ((frame->len > CAN_FRAME_MAX_LEN) ||
+            (frame->frame_type != CAN_RTR_DATA) ||
+            ((frame->flags & CAN_FRAME_FD) == 0)) {
+            return 3;
+        }
+
+        return 5;
+    }
+
+    return can_transmit(can_selected, frame->id_type, frame->id,
+                        frame->frame_type, frame->len, frame->data, priority,
+                        0);
+}
+
+/**
+ * @brief Whether the CAN sends and receives FD frames.
+ *
+ * @param can_selected Specific which CAN.
+ * @return 0: Classic CAN only, 1: FD capable.
+ */
+uint8_t can_fd_supported(can_selected_t can_selected) {
+    UNUSED(can_selected);
+
+    /* bxCAN is CAN 2.0B. */
+    return 0;
+}
+
+/**
+ * @brief Get the data length of the DLC.
+ *
+ * @param dlc Data length code, 0-15.
+ * @return Data length, 0-8 for classic CAN, 12-64 for FD when `dlc` > 8.
+ */
+uint8_t can_dlc_to_len(uint8_t dlc) {
+    static const uint8_t fd_len[] = {12, 16, 20, 24, 32, 48, 64};
+
+    if (dlc <= 8) {
+        return dlc;
+    }
+
+    return fd_len[(dlc > 15) ? 6 : (dlc - 9)];
+}
+
+/**
+ * @brief Get the DLC of the data length, rounded up to the next FD length.
+ *
+ * @param len Data length.
+ * @return Data length code, 15 for more than 48 bytes.
+ */
+uint8_t can_len_to_dlc(uint8_t len) {
+    uint8_t dlc = (len <= 8) ? len : 9;
+
+    while ((dlc < 15) && (can_dlc_to_len(dlc) < len)) {
+        ++dlc;
+    }
+
+    return dlc;
+}
+
+/**
+ * @brief Get the statistics of the TX queue.
+ *
+ * @param can_selected Specific which CAN.
+ * @param[out] stats The statistics snapshot.
+ * @return Operational status:
+ * @retval - 0: Success.
+ * @retval - 1: The TX queue is not used by this CAN.
+ */
+uint8_t can_get_tx_stats(can_selected_t can_selected, can_tx_stats_t *stats) {
+#if CAN_TX_QUEUE_LENGTH > 0
+    IRQn_Type irqn;
+
+    if ((stats == NULL) || (can_tx_get_irqn(can_selected, &irqn) != 0)) {
+        return 1;
+    }
+
+    can_tx_queue_t *queue = &can_tx_queue[can_selected];
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    queue->stats.dropped += mpsc_fifo_take_dropped(&queue->intake);
+    *stats = queue->stats;
+    stats->queued = queue->count + mpsc_fifo_count(&queue->intake);
+    __set_PRIMASK(primask);
+
+    return 0;
+#else  /* CAN_TX_QUEUE_LENGTH > 0 */
+    UNUSED(can_selected);
+    UNUSED(stats);
+
+    return 1;
+#endif /* CAN_TX_QUEUE_LENGTH > 0 */
+}
+
+/**
+ * @brief Clear the statistics of the TX queue, the frames queued are kept.
+ *
+ * @param can_selected Specific which CAN.
+ * @return Operational status:
+ * @retval - 0: Success.
+ * @retval - 1: The TX queue is not used by this CAN.
+ */
+uint8_t can_clear_tx_stats(can_selected_t can_selected) {
+#if CAN_TX_QUEUE_LENGTH > 0
+    IRQn_Type irqn;
+
+    if (can_tx_get_irqn(can_selected, &irqn) != 0) {
+        return 1;
+    }
+
+    can_tx_queue_t *queue = &can_tx_queue[can_selected];
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    mpsc_fifo_take_dropped(&queue->intake);
+    memset(&queue->stats, 0, sizeof(can_tx_stats_t));
+    __set_PRIMASK(primask);
+
+    return 0;
+#else  /* CAN_TX_QUEUE_LENGTH > 0 */
+    UNUSED(can_selected);
+
+    return 1;
+#endif /* CAN_TX_QUEUE_LENGTH > 0 */
+}
+
+/**
+ * @brief Count a received frame into the bus meter, called by the receive
+ *        interrupt.
+ *
+ * @param can_selected Specific which CAN.
+ * @param can_ide Specific standard ID or Extend ID.
+ * @param id Message ID.
+ * @param rtr Specific data frame or remote frame.
+ * @param len Message length.
+ * @param msg Message content.
+ */
+void can_meter_count_rx(can_selected_t can_selected, uint32_t can_ide,
+                        uint32_t id, uint32_t rtr, uint8_t len,
+                        const uint8_t *msg) {
+#if CAN_METER_ENABLE
+    if (can_get_handle(can_selected) == NULL) {
+        return;
+    }
+
+    uint32_t stuff;
+    uint32_t bits = can_frame_bits(can_ide, id, rtr, len, msg, &stuff);
+    can_meter_add_frame(can_selected, 0, bits, stuff);
+#else  /* CAN_METER_ENABLE */
+    UNUSED(can_selected);
+    UNUSED(can_ide);
+    UNUSED(id);
+    UNUSED(rtr);
+    UNUSED(len);
+    UNUSED(msg);
+#endif /* CAN_METER_ENABLE */
+}
+
+/**
+ * @brief Get the bus meter, the bus load and the latency percentiles are
+ *        calculated now.
+ *
+ * @param can_selected Specific which CAN.
+ * @param[out] meter The meter snapshot.
+ * @return Operational status:
+ * @retval - 0: Success.
+ * @retval - 1: The meter is disabled, or parameter invalid.
+ */
+uint8_t can_get_meter(can_selected_t can_selected, can_meter_t *meter) {
+#if CAN_METER_ENABLE
+    if ((meter == NULL) || (can_get_handle(can_selected) == NULL)) {
+        return 1;
+    }
+
+    can_meter_state_t *state = &can_meter_state[can_selected];
+    uint32_t epoch = HAL_GetTick() / CAN_METER_SLOT_MS;
+    uint32_t window_bits = 0;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *meter = state->meter;
+    for (uint32_t i = 0; i < CAN_METER_SLOT_TOTAL; ++i) {
+        uint32_t age = epoch - state->slot_epoch[i];
+        if ((age >= 1) && (age <= CAN_METER_SLOT_NUMBER)) {
+            window_bits += state->slot_bits[i];
+        }
+    }
+    __set_PRIMASK(primask);
+
+    meter->window_bits = window_bits;
+    if (meter->bit_rate != 0) {
+        meter->bus_load = (float)window_bits * 100.0f * 1000.0f /
+                          ((float)meter->bit_rate * CAN_METER_SLOT_NUMBER *
+                           CAN_METER_SLOT_MS);
+    }
+    meter->latency_p50 = can_meter_percentile(meter, 50);
+    meter->latency_p90 = can_meter_percentile(meter, 90);
+    meter->latency_p99 = can_meter_percentile(meter, 99);
+
+    return 0;
+#else  /* CAN_METER_ENABLE */
+    UNUSED(can_selected);
+    UNUSED(meter);
+
+    return 1;
+#endif /* CAN_METER_ENABLE */
+}
+
+/**
+ * @brief Clear the counters of the bus meter, the rolling window is kept.
+ *
+ * @param can_selected Specific which CAN.
+ * @return Operational status:
+ * @retval - 0: Success.
+ * @retval - 1: The meter is disabled, or parameter invalid.
+ */
+uint8_t can_clear_meter(can_selected_t can_selected) {
+#if CAN_METER_ENABLE
+    if (can_get_handle(can_selected) == NULL) {
+        return 1;
+    }
+
+    can_meter_t *meter = &can_meter_state[can_selected].meter;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t bit_rate = meter->bit_rate;
+    memset(meter, 0, sizeof(can_meter_t));
+    meter->bit_rate = bit_rate;
+    __set_PRIMASK(primask);
+
+    return 0;
+#else  /* CAN_METER_ENABLE */
+    UNUSED(can_selected);
+
+    return 1;
+#endif /* CAN_METER_ENABLE */
+}
 
-#if CAN1_SCE_IT_ENABLE
-        HAL_NVIC_DisableIRQ(CAN1_SCE_IRQn);
-#endif /* CAN1_SCE_IT_ENABLE */
+/**
+ * @brief Record a received frame into the trace, called by the receive
+ *        interrupt.
+ *
+ * @param can_selected Specific which CAN.
+ * @param can_ide Specific standard ID or Extend ID.
+ * @param id Message ID.
+ * @param rtr Specific data frame or remote frame.
+ * @param len Message length.
+ * @param msg Message content.
+ */
+void can_trace_count_rx(can_selected_t can_selected, uint32_t can_ide,
+                        uint32_t id, uint32_t rtr, uint8_t len,
+                        const uint8_t *msg) {
+#if CAN_TRACE_ENABLE
+    if (can_selected > can3_selected) {
+        return;
     }
-#endif /* CAN1_ENABLE */
 
-#if CAN2_ENABLE
-    if (hcan->Instance == CAN2) {
-        __HAL_RCC_CAN2_CLK_DISABLE();
+    can_trace_frame(can_selected, 0, can_ide, id, rtr, len, msg);
+#else  /* CAN_TRACE_ENABLE */
+    UNUSED(can_selected);
+    UNUSED(can_ide);
+    UNUSED(id);
+    UNUSED(rtr);
+    UNUSED(len);
+    UNUSED(msg);
+#endif /* CAN_TRACE_ENABLE */
+}
 
-        HAL_GPIO_DeInit(CSP_GPIO_PORT(CAN2_RX_PORT), CAN2_RX_PIN);
-        HAL_GPIO_DeInit(CSP_GPIO_PORT(CAN2_TX_PORT), CAN2_TX_PIN);
+/**
+ * @brief Start the trace capture. The first record is a time record. The
+ *        records not consumed are kept.
+ *
+ * @param can_mask Bit n captures the CAN n + 1, e.g. 0x03 for CAN1 and CAN2.
+ * @return Operational status:
+ * @retval - 0: Success.
+ * @retval - 1: The trace is disabled, or parameter invalid.
+ */
+uint8_t can_trace_start(uint32_t can_mask) {
+#if CAN_TRACE_ENABLE
+    if ((can_mask == 0) || (can_mask > 0x07U)) {
+        return 1;
+    }
 
-#if CAN2_TX_IT_ENABLE
-        HAL_NVIC_DisableIRQ(CAN2_TX_IRQn);
-#endif /* CAN2_TX_IT_ENABLE */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    can_trace.last_cycles = CAN_GET_TIMESTAMP();
+    can_trace.rest_cycles = 0;
+    can_trace.since_sync = CAN_TRACE_SYNC_INTERVAL;
+    can_trace.can_mask = can_mask;
+    __set_PRIMASK(primask);
 
-#if CAN2_RX0_IT_ENABLE
-        HAL_NVIC_DisableIRQ(CAN2_RX0_IRQn);
-#endif /* CAN2_RX0_IT_ENABLE */
+    return 0;
+#else  /* CAN_TRACE_ENABLE */
+    UNUSED(can_mask);
 
-#if CAN2_RX1_IT_ENABLE
-        HAL_NVIC_DisableIRQ(CAN2_RX1_IRQn);
-#endif /* CAN2_RX1_IT_ENABLE */
+    return 1;
+#endif /* CAN_TRACE_ENABLE */
+}
 
-#if CAN2_SCE_IT_ENABLE
-        HAL_NVIC_DisableIRQ(CAN2_SCE_IRQn);
-#endif /* CAN2_SCE_IT_ENABLE */
+/**
+ * @brief Stop the trace capture, the records in the ring can still be read.
+ */
+void can_trace_stop(void) {
+#if CAN_TRACE_ENABLE
+    can_trace.can_mask = 0;
+#endif /* CAN_TRACE_ENABLE */
+}
+
+/**
+ * @brief Get the records not consumed, without copy. The span is contiguous
+ *        in the ring, call again after `can_trace_consume` for the rest at
+ *        the wrap-around. Can be sent by DMA directly.
+ *
+ * @param[out] records The first record.
+ * @return Number of the records in the span.
+ */
+uint32_t can_trace_peek(const can_trace_record_t **records) {
+#if CAN_TRACE_ENABLE
+    if (records == NULL) {
+        return 0;
     }
-#endif /* CAN2_ENABLE */
 
-#if CAN3_ENABLE
-    if (hcan->Instance == CAN3) {
-        __HAL_RCC_CAN3_CLK_DISABLE();
+    uint32_t tail = can_trace.tail;
+    uint32_t queued = can_trace.head - tail;
+    uint32_t index = tail & (CAN_TRACE_RECORD_NUMBER - 1);
+    uint32_t span = CAN_TRACE_RECORD_NUMBER - index;
 
-        HAL_GPIO_DeInit(CSP_GPIO_PORT(CAN3_RX_PORT), CAN3_RX_PIN);
-        HAL_GPIO_DeInit(CSP_GPIO_PORT(CAN3_TX_PORT), CAN3_TX_PIN);
+    *records = &can_trace.ring[index];
 
-#if CAN3_TX_IT_ENABLE
-        HAL_NVIC_DisableIRQ(CAN3_TX_IRQn);
-#endif /* CAN3_TX_IT_ENABLE */
+    return (queued < span) ? queued : span;
+#else  /* CAN_TRACE_ENABLE */
+    UNUSED(records);
 
-#if CAN3_RX0_IT_ENABLE
-        HAL_NVIC_DisableIRQ(CAN3_RX0_IRQn);
-#endif /* CAN3_RX0_IT_ENABLE */
+    return 0;
+#endif /* CAN_TRACE_ENABLE */
+}
 
-#if CAN3_RX1_IT_ENABLE
-        HAL_NVIC_DisableIRQ(CAN3_RX1_IRQn);
-#endif /* CAN3_RX1_IT_ENABLE */
+/**
+ * @brief Release the records returned by `can_trace_peek`.
+ *
+ * @param number Number of the records, not more than the span.
+ */
+void can_trace_consume(uint32_t number) {
+#if CAN_TRACE_ENABLE
+    uint32_t queued = can_trace.head - can_trace.tail;
+
+    can_trace.tail += (number < queued) ? number : queued;
+#else  /* CAN_TRACE_ENABLE */
+    UNUSED(number);
+#endif /* CAN_TRACE_ENABLE */
+}
 
-#if CAN3_SCE_IT_ENABLE
-        HAL_NVIC_DisableIRQ(CAN3_SCE_IRQn);
-#endif /* CAN3_SCE_IT_ENABLE */
+/**
+ * @brief Get the statistics of the trace capture.
+ *
+ * @param[out] stats The statistics.
+ * @return Operational status:
+ * @retval - 0: Success.
+ * @retval - 1: The trace is disabled, or parameter invalid.
+ */
+uint8_t can_trace_get_stats(can_trace_stats_t *stats) {
+#if CAN_TRACE_ENABLE
+    if (stats == NULL) {
+        return 1;
     }
-#endif /* CAN3_ENABLE */
 
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *stats = can_trace.stats;
+    stats->queued = can_trace.head - can_trace.tail;
+    __set_PRIMASK(primask);
+
+    return 0;
+#else  /* CAN_TRACE_ENABLE */
+    UNUSED(stats);
+
+    return 1;
+#endif /* CAN_TRACE_ENABLE */
 }
 
 /**
- * @brief Calcuate parameters of specific CAN Classic baudrate.
+ * @brief Register a callback of the error state, called with the new state
+ *        when the state changes. A worse state is found by the SCE
+ *        interrupt, the recovery by the TX interrupt after a frame is sent,
+ *        either of them may also be found first by `can_get_error_stats`.
+ *        So the callback runs in the SCE or TX interrupt, or in the task
+ *        calling `can_get_error_stats`, and must be safe in both.
  *
- * @param[in] baud_rate CAN band rate. Unit: bps.
- * @param[in] prop_delay The propagation delay of bus, include cable and can
- *                       transceiver. Unit: ns.
- * @param[in] base_freq Base frequency of peripherals. Unit: Hz.
- * @param[out] prescale The prescale of `base_freq`.
- * @param[out] tsjw Syncronisation Jump Width
- * @param[out] tseg1 Time of segment 1.
- * @param[out] tseg2 Time of segment 2.
- * @return Calcuate status.
- * @retval - 0: No error;
- * @retval - 1: Can not satisfied this baudrate in this condition.
+ * @param can_selected Specific which CAN.
+ * @param callback The callback.
+ * @return Operational status:
+ * @retval - 0: Success, or registered already.
+ * @retval - 1: Parameter invalid.
+ * @retval - 2: No free callback, increase `CAN_ERROR_CALLBACK_NUMBER`.
+ * @retval - 3: The SCE or TX interrupt of this CAN is disabled, the changes
+ *              would only be found by polling `can_get_error_stats`.
  */
-uint8_t can_rate_calc(uint32_t baud_rate, uint32_t prop_delay,
-                      uint32_t base_freq, uint32_t *prescale, uint32_t *tsjw,
-                      uint32_t *tseg1, uint32_t *tseg2) {
-
-    /*## step 1: determine minimum permissible time for the prop_seg
-                 segment. #################################################*/
-    uint32_t t_prop_seg = 2 * prop_delay;
-
-    /*## step 2: choose can system clock frequency. #######################*/
-    uint32_t f_div;
-    *prescale = 0;
+uint8_t can_error_register(can_selected_t can_selected,
+                           can_error_callback_t callback) {
+    if ((callback == NULL) || (can_get_handle(can_selected) == NULL)) {
+        return 1;
+    }
 
-    while (1) {
-        ++(*prescale);
-        f_div = base_freq / (*prescale);
+    if (can_error_notify[can_selected] == 0) {
+        return 3;
+    }
 
-        if (f_div / baud_rate > 25) {
-            continue;
-        }
+    can_error_info_t *info = &can_error_info[can_selected];
+    uint8_t res = 2;
 
-        if (f_div / baud_rate < 8) {
-            /* cannot divide this baudrate. */
-            return 1;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for (uint32_t i = 0; i < CAN_ERROR_CALLBACK_NUMBER; ++i) {
+        if (info->callback[i] == callback) {
+            res = 0;
+            break;
         }
+    }
 
-        if (f_div % baud_rate != 0) {
-            continue;
-        } else {
-            break;
+    for (uint32_t i = 0; (res != 0) && (i < CAN_ERROR_CALLBACK_NUMBER); ++i) {
+        if (info->callback[i] == NULL) {
+            info->callback[i] = callback;
+            res = 0;
         }
     }
+    __set_PRIMASK(primask);
 
-    /*## step 3: calculate prop_seg duration. ##########################*/
-    uint32_t tq_per_bit = f_div / baud_rate;
-    uint32_t prop_seg =
-        (uint32_t)ceilf((float)(t_prop_seg * f_div) / 1000000000.0f);
+    return res;
+}
 
-    /*## step 4: determine phase_seg1, phase_seg2 */
-    uint32_t tq_remain = tq_per_bit - prop_seg - 1;
-    if (tq_remain < 3) {
-        /* frequency division is from small to large, which means that if
-         * the condition is met, the frequency division coefficient must be
-         * the highest. if even the highest frequency cannot meet this
-         * condition, then there is no other way. */
+/**
+ * @brief Unregister the callback of the error state.
+ *
+ * @param can_selected Specific which CAN.
+ * @param callback The callback.
+ * @return Operational status:
+ * @retval - 0: Success.
+ * @retval - 1: Parameter invalid, or not registered.
+ */
+uint8_t can_error_unregister(can_selected_t can_selected,
+                             can_error_callback_t callback) {
+    if ((callback == NULL) || (can_get_handle(can_selected) == NULL)) {
         return 1;
     }
 
-    if (tq_remain == 3) {
-        /* if the remaining number is equal to 3, than phase_seg1 = 1 and
-         * phase_seg2 = 2 */
-        *tseg1 = 1;
-        *tseg2 = 2;
-    } else {
-        /* if the remain number is an odd number greater than 3, than add
-         * one to the prop_seg (also subtract one to the remain number)*/
-        tq_remain = (tq_remain % 2 == 0) ? (tq_remain) : (tq_remain - 1);
+    can_error_info_t *info = &can_error_info[can_selected];
+    uint8_t res = 1;
 
-        /* divide the remaining number by to and assign the result to
-         * phase_seg1 and phase_seg2. */
-        *tseg1 = tq_remain / 2;
-        *tseg2 = tq_remain - *tseg1;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for (uint32_t i = 0; i < CAN_ERROR_CALLBACK_NUMBER; ++i) {
+        if (info->callback[i] == callback) {
+            info->callback[i] = NULL;
+            res = 0;
+        }
     }
+    __set_PRIMASK(primask);
 
-    *tseg1 += prop_seg;
+    return res;
+}
 
-    if (*tseg2 > 8) {
-        /* STM32F4 CAN BS2 range: 1-8 */
-        *tseg2 = 8;
-        *tseg1 = tq_remain - *tseg2;
-    }
-    if (*tseg1 > 16) {
-        /* STM32F4 CAN BS1 range: 1-16 */
+/**
+ * @brief Get the error statistics, the state is read from the hardware now.
+ *
+ * @param can_selected Specific which CAN.
+ * @param[out] stats The statistics snapshot.
+ * @return Operational status:
+ * @retval - 0: Success.
+ * @retval - 1: Parameter invalid.
+ */
+uint8_t can_get_error_stats(can_selected_t can_selected,
+                            can_error_stats_t *stats) {
+    CAN_HandleTypeDef *can_handle = can_get_handle(can_selected);
+    if ((stats == NULL) || (can_handle == NULL)) {
         return 1;
     }
 
-    /*## step 5: determine trjw (also called tsjw) #########################*/
-    /* rjw is the smaller of 4 and phase_seg1. */
-    *tsjw = (*tseg1 > 4) ? (4) : (*tseg1);
+    if (HAL_CAN_GetState(can_handle) != HAL_CAN_STATE_RESET) {
+        can_error_update(can_selected);
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *stats = can_error_info[can_selected].stats;
+    __set_PRIMASK(primask);
 
-    /*## skip step 6: calculate required oscillator. #######################*/
     return 0;
 }
 
 /**
- * @brief Get the CAN handle with specified CAN.
+ * @brief Clear the error statistics, the state and the counters now are
+ *        kept.
  *
- * @param can_selected Specific which can will to get.
- * @return The handle of CAN. return NULL which the CAN doesn't exist.
+ * @param can_selected Specific which CAN.
+ * @return Operational status:
+ * @retval - 0: Success.
+ * @retval - 1: Parameter invalid.
  */
-CAN_HandleTypeDef *can_get_handle(can_selected_t can_selected) {
-    switch (can_selected) {
+uint8_t can_clear_error_stats(can_selected_t can_selected) {
+    if (can_get_handle(can_selected) == NULL) {
+        return 1;
+    }
 
-#if CAN1_ENABLE
-        case can1_selected:
-            return &can1_handle;
-#endif /* CAN1_ENABLE */
+    can_error_stats_t *stats = &can_error_info[can_selected].stats;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    can_error_state_t state = stats->state;
+    uint8_t tec = stats->tec;
+    uint8_t rec = stats->rec;
+    memset(stats, 0, sizeof(can_error_stats_t));
+    stats->state = state;
+    stats->tec = tec;
+    stats->rec = rec;
+    stats->max_tec = tec;
+    stats->max_rec = rec;
+    __set_PRIMASK(primask);
 
-#if CAN2_ENABLE
-        case can2_selected:
-            return &can2_handle;
-#endif /* CAN2_ENABLE */
+    return 0;
+}
 
-#if CAN3_ENABLE
-        case can3_selected:
-            return &can3_handle;
-#endif /* CAN3_ENABLE */
+/**
+ * @brief Leave bus-off by software, request to enter and leave the
+ *        initialization mode. The hardware then waits 128 x 11 recessive bits
+ *        before joining the bus. Call in task, it waits for the hardware.
+ *        Needless when `CAN_BUS_OFF_AUTO_RECOVERY` is enabled.
+ *
+ * @param can_selected Specific which CAN.
+ * @return Operational status:
+ * @retval - 0: Success, or not in bus-off.
+ * @retval - 1: Parameter invalid, or this CAN is not initialized.
+ * @retval - 2: Failed to restart the CAN.
+ */
+uint8_t can_error_recover(can_selected_t can_selected) {
+    CAN_HandleTypeDef *can_handle = can_get_handle(can_selected);
+    if ((can_handle == NULL) ||
+        (HAL_CAN_GetState(can_handle) == HAL_CAN_STATE_RESET)) {
+        return 1;
+    }
 
-        default:
-            return NULL;
+    if ((can_handle->Instance->ESR & CAN_ESR_BOFF) == 0) {
+        return 0;
+    }
+
+    if ((HAL_CAN_Stop(can_handle) != HAL_OK) ||
+        (HAL_CAN_Start(can_handle) != HAL_OK)) {
+        return 2;
     }
+
+    return 0;
 }
 
 /**
- * @brief CAN send message.
+ * @brief Switch the test mode, for self-test without other nodes. Loopback
+ *        receives the frames sent by itself and ignores the ACK, the frames
+ *        are still driven to the bus. Silent loopback does not drive the bus,
+ *        safe to run on a live bus. The filters, interrupts and the TX queue
+ *        are kept. Call in task, it waits for the hardware.
  *
- * @param can_selected Specific which CAN to send message.
- * @param can_ide Specific standard ID or Extend ID.
- * @param id Specific message id.
- * @param len Specific message length.
- * @param msg Specific message content.
- * @return Send status.
+ * @param can_selected Specific which CAN.
+ * @param mode `CAN_MODE_NORMAL`, `CAN_MODE_LOOPBACK`, `CAN_MODE_SILENT` or
+ *             `CAN_MODE_SILENT_LOOPBACK`.
+ * @return Operational status:
  * @retval - 0: Success.
- * @retval - 1: Send error.
- * @retval - 2: Timeout.
- * @retval - 3: Parameter invalid.
- * @retval - 4: This CAN is not initialized.
+ * @retval - 1: Parameter invalid, or this CAN is not initialized.
+ * @retval - 2: Failed to restart the CAN.
  */
-uint8_t can_send_message(can_selected_t can_selected, uint32_t can_ide,
-                         uint32_t id, uint8_t len, const uint8_t *msg) {
+uint8_t can_set_mode(can_selected_t can_selected, uint32_t mode) {
     CAN_HandleTypeDef *can_handle = can_get_handle(can_selected);
-    if (can_handle == NULL) {
-        return 3;
+    if ((can_handle == NULL) ||
+        (HAL_CAN_GetState(can_handle) == HAL_CAN_STATE_RESET) ||
+        ((mode & ~(CAN_BTR_LBKM | CAN_BTR_SILM)) != 0)) {
+        return 1;
     }
 
-    if (len > 8) {
-        return 3;
+    /* LBKM and SILM are writable in the initialization mode only. */
+    if (HAL_CAN_Stop(can_handle) != HAL_OK) {
+        return 2;
     }
 
-    if (HAL_CAN_GetState(can_handle) == HAL_CAN_STATE_RESET) {
-        return 4;
+    MODIFY_REG(can_handle->Instance->BTR, CAN_BTR_LBKM | CAN_BTR_SILM, mode);
+    can_handle->Init.Mode = mode;
+
+    if (HAL_CAN_Start(can_handle) != HAL_OK) {
+        return 2;
     }
 
-    uint16_t wait_time = 0;
-    uint32_t tx_mail_box = CAN_TX_MAILBOX0;
+    return 0;
+}
 
-    static CAN_TxHeaderTypeDef tx_header;
-    tx_header.IDE = can_ide;
-    tx_header.RTR = CAN_RTR_DATA;
-    tx_header.DLC = len;
-    if (can_ide == CAN_ID_STD) {
-        tx_header.StdId = id;
-    } else {
-        tx_header.ExtId = id;
+/**
+ * @brief Start the timer of the sync window. The frames staged are released
+ *        to all buses together at each period.
+ *
+ * @param period_us Period of the window, 1-65536. Unit: us.
+ * @return Operational status:
+ * @retval - 0: Success.
+ * @retval - 1: The sync window is disabled, or parameter invalid.
+ */
+uint8_t can_sync_start(uint32_t period_us) {
+#if CAN_SYNC_ENABLE
+    if ((period_us == 0) || (period_us > 0x10000U)) {
+        return 1;
     }
 
-    while (HAL_CAN_GetTxMailboxesFreeLevel(can_handle) == 0) {
-        /* Wait to all mailbox is empty. */
-        ++wait_time;
-        if (wait_time > CAN_SEND_TIMEOUT) {
-            return 2;
-        }
+    /* The timer clock is doubled when APB1 is divided. */
+    uint32_t tim_clock = HAL_RCC_GetPCLK1Freq();
+    if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_CFGR_PPRE1_DIV1) {
+        tim_clock *= 2;
     }
 
-    if (HAL_CAN_AddTxMessage(can_handle, &tx_header, msg, &tx_mail_box) !=
-        HAL_OK) {
-        return 1;
-    }
+    CAN_SYNC_TIM_CLK_ENABLE();
+
+    CAN_SYNC_TIM->CR1 = 0;
+    CAN_SYNC_TIM->DIER = 0;
+    CAN_SYNC_TIM->PSC = tim_clock / 1000000U - 1;
+    CAN_SYNC_TIM->ARR = period_us - 1;
+    /* Load the prescaler now, the update flag is set by it. */
+    CAN_SYNC_TIM->EGR = TIM_EGR_UG;
+    CAN_SYNC_TIM->SR = 0;
+    CAN_SYNC_TIM->DIER = TIM_DIER_UIE;
+
+    HAL_NVIC_SetPriority(CAN_SYNC_TIM_IRQn, CAN_SYNC_IT_PRIORITY,
+                         CAN_SYNC_IT_SUB);
+    HAL_NVIC_EnableIRQ(CAN_SYNC_TIM_IRQn);
+
+    CAN_SYNC_TIM->CR1 = TIM_CR1_ARPE | TIM_CR1_CEN;
+
     return 0;
+#else  /* CAN_SYNC_ENABLE */
+    UNUSED(period_us);
+
+    return 1;
+#endif /* CAN_SYNC_ENABLE */
+}
+
+/**
+ * @brief Stop the timer of the sync window, the frames staged are dropped.
+ */
+void can_sync_stop(void) {
+#if CAN_SYNC_ENABLE
+    CAN_SYNC_TIM->CR1 = 0;
+    CAN_SYNC_TIM->DIER = 0;
+    HAL_NVIC_DisableIRQ(CAN_SYNC_TIM_IRQn);
+    CAN_SYNC_TIM->SR = 0;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for (uint32_t i = 0; i < 3; ++i) {
+        can_sync_bus[i].count = 0;
+    }
+    __set_PRIMASK(primask);
+#endif /* CAN_SYNC_ENABLE */
 }
 
 /**
- * @brief CAN send remote message.
+ * @brief Stage a data frame into the sync window, it is released with the
+ *        frames of the other buses by the next period of the timer. A frame
+ *        of the same ID staged in this window is overwritten.
  *
- * @param can_selected Specific which CAN to send message.
+ * @param can_selected Specific which CAN, the TX queue must be used by it.
  * @param can_ide Specific standard ID or Extend ID.
  * @param id Specific message id.
  * @param len Specific message length.
  * @param msg Specific message content.
- * @return Send status.
+ * @return Operational status:
  * @retval - 0: Success.
- * @retval - 1: Send error.
- * @retval - 2: Timeout.
- * @retval - 3: Parameter invalid.
- * @retval - 4: This CAN is not initialized.
+ * @retval - 1: Parameter invalid, the CAN is not initialized or not using
+ *              the TX queue, or the sync window is disabled.
+ * @retval - 2: The window is full, increase `CAN_SYNC_FRAME_NUMBER`.
  */
-uint8_t can_send_remote(can_selected_t can_selected, uint32_t can_ide,
-                        uint32_t id, uint8_t len, const uint8_t *msg) {
+uint8_t can_sync_stage(can_selected_t can_selected, uint32_t can_ide,
+                       uint32_t id, uint8_t len, const uint8_t *msg) {
+#if CAN_SYNC_ENABLE
     CAN_HandleTypeDef *can_handle = can_get_handle(can_selected);
-    if (can_handle == NULL) {
-        return 3;
-    }
+    IRQn_Type irqn;
 
-    if (len > 8) {
-        return 3;
+    if ((can_handle == NULL) || (len > 8) || ((msg == NULL) && (len > 0)) ||
+        (can_tx_get_irqn(can_selected, &irqn) != 0) ||
+        (HAL_CAN_GetState(can_handle) == HAL_CAN_STATE_RESET)) {
+        return 1;
     }
 
-    if (HAL_CAN_GetState(can_handle) == HAL_CAN_STATE_RESET) {
-        return 4;
-    }
+    can_sync_frame_t frame;
+    uint8_t data[8] = {0};
+    uint32_t stuff;
 
-    uint16_t wait_time = 0;
-    uint32_t tx_mail_box = CAN_TX_MAILBOX0;
+    if (len > 0) {
+        memcpy(data, msg, len);
+    }
 
-    static CAN_TxHeaderTypeDef tx_header;
-    tx_header.IDE = can_ide;
-    tx_header.RTR = CAN_RTR_REMOTE;
-    tx_header.DLC = len;
     if (can_ide == CAN_ID_STD) {
-        tx_header.StdId = id;
+        frame.tir = id << CAN_TI0R_STID_Pos;
     } else {
-        tx_header.ExtId = id;
+        frame.tir = (id << CAN_TI0R_EXID_Pos) | CAN_TI0R_IDE;
     }
-
-    while (HAL_CAN_GetTxMailboxesFreeLevel(can_handle) == 0) {
-        /* Wait to all mailbox is empty. */
-        ++wait_time;
-        if (wait_time > CAN_SEND_TIMEOUT) {
-            return 2;
+    frame.tdtr = len;
+    memcpy(&frame.tdlr, &data[0], 4);
+    memcpy(&frame.tdhr, &data[4], 4);
+    frame.bits = (uint8_t)can_frame_bits(can_ide, id, CAN_RTR_DATA, len,
+                                         data, &stuff);
+    frame.stuff = (uint8_t)stuff;
+
+    can_sync_bus_t *bus = &can_sync_bus[can_selected];
+    uint8_t res = 2;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for (uint32_t i = 0; i < bus->count; ++i) {
+        if (bus->frame[i].tir == frame.tir) {
+            bus->frame[i] = frame;
+            res = 0;
+            break;
         }
     }
 
-    if (HAL_CAN_AddTxMessage(can_handle, &tx_header, msg, &tx_mail_box) !=
-        HAL_OK) {
+    if ((res != 0) && (bus->count < CAN_SYNC_FRAME_NUMBER)) {
+        bus->frame[bus->count++] = frame;
+        res = 0;
+    }
+
+    if (res != 0) {
+        ++can_sync_stats.dropped;
+    }
+    __set_PRIMASK(primask);
+
+    return res;
+#else  /* CAN_SYNC_ENABLE */
+    UNUSED(can_selected);
+    UNUSED(can_ide);
+    UNUSED(id);
+    UNUSED(len);
+    UNUSED(msg);
+
+    return 1;
+#endif /* CAN_SYNC_ENABLE */
+}
+
+/**
+ * @brief Get the statistics of the sync window. The skew is the spread of
+ *        the start of the first frame of each bus in a window, measured
+ *        when the next window is released.
+ *
+ * @param[out] stats The statistics snapshot.
+ * @return Operational status:
+ * @retval - 0: Success.
+ * @retval - 1: The sync window is disabled, or parameter invalid.
+ */
+uint8_t can_get_sync_stats(can_sync_stats_t *stats) {
+#if CAN_SYNC_ENABLE
+    if (stats == NULL) {
         return 1;
     }
 
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *stats = can_sync_stats;
+    __set_PRIMASK(primask);
+
     return 0;
+#else  /* CAN_SYNC_ENABLE */
+    UNUSED(stats);
+
+    return 1;
+#endif /* CAN_SYNC_ENABLE */
+}
+
+/**
+ * @brief Clear the statistics of the sync window.
+ */
+void can_clear_sync_stats(void) {
+#if CAN_SYNC_ENABLE
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    memset(&can_sync_stats, 0, sizeof(can_sync_stats_t));
+    __set_PRIMASK(primask);
+#endif /* CAN_SYNC_ENABLE */
 }
 
 /**
@@ -38,6 +38,97 @@ extern "C" {
 /* Wait for can tx mailbox empty times. */
 #define CAN_SEND_TIMEOUT        100
 
+/* Length of the TX queue of each CAN. The queue is used when the TX interrupt
+   of the CAN is enabled, 0 to always wait for a free mailbox. */
+#define CAN_TX_QUEUE_LENGTH     32
+/* Length of the lock-free intake of each CAN TX queue, must be power of 2.
+   Frames are moved from the intake into the queue in the TX interrupt. */
+#define CAN_TX_INTAKE_LENGTH    16
+/* Priority classes of the TX queue, 4 at most. Lower class is sent first,
+   the same class is sent by ID like the bus arbitration. The mailboxes of
+   less urgent class are aborted when an urgent frame is waiting. */
+#define CAN_TX_PRIORITY_NUMBER  4
+/* Priority class of `can_send_message`. */
+#define CAN_TX_DEFAULT_PRIORITY 1
+
+/* Bus meter, count the bits on the bus and the TX latency. 0 to disable. */
+#define CAN_METER_ENABLE        1
+/* The bus load is the bits of the last `CAN_METER_SLOT_NUMBER` slots, each
+   slot is `CAN_METER_SLOT_MS` long. */
+#define CAN_METER_SLOT_MS       10
+#define CAN_METER_SLOT_NUMBER   10
+/* Buckets of the TX latency histogram. Bucket 0 counts the latency less than
+   2 us, bucket n counts [2^n, 2^(n+1)) us, the last one counts the rest. */
+#define CAN_METER_LATENCY_BUCKETS 16
+
+/* Leave bus-off automatically (ABOM) after 128 x 11 recessive bits. 0 to
+   recover by `can_error_recover`. */
+#define CAN_BUS_OFF_AUTO_RECOVERY 1
+/* Error state callbacks of each CAN. */
+#define CAN_ERROR_CALLBACK_NUMBER 4
+
+/* Sync window: the frames staged by `can_sync_stage` on all buses are loaded
+   into the mailboxes together by a timer interrupt. Needs the TX queue. 0 to
+   disable. */
+#define CAN_SYNC_ENABLE         1
+/* Frames staged of each CAN in a window. */
+#define CAN_SYNC_FRAME_NUMBER   8
+/* Basic timer of the sync window. */
+#define CAN_SYNC_TIM            TIM7
+#define CAN_SYNC_TIM_IRQn       TIM7_IRQn
+#define CAN_SYNC_TIM_IRQHandler TIM7_IRQHandler
+#define CAN_SYNC_TIM_CLK_ENABLE __HAL_RCC_TIM7_CLK_ENABLE
+#define CAN_SYNC_IT_PRIORITY    0
+#define CAN_SYNC_IT_SUB         0
+
+/* Trace capture: the frames received and transmitted are recorded into a RAM
+   ring of 16-byte records, read by `can_trace_peek`. 0 to disable. */
+#define CAN_TRACE_ENABLE        1
+/* Records of the ring, power of 2. */
+#define CAN_TRACE_RECORD_NUMBER 512
+/* A time record is put after this many records, so the reader can find the
+   record boundary and the absolute time in the middle of the stream. */
+#define CAN_TRACE_SYNC_INTERVAL 64
+
+/* Filter banks of each CAN. CAN1 and CAN2 share 28 banks, the banks of CAN2
+   start from `CAN_FILTER_SLAVE_START`. CAN3 has its own banks. The last bank
+   of each CAN is the accept all filter, the others are used by
+   `can_filter_add`. */
+#define CAN_FILTER_BANK_NUMBER  14
+#define CAN_FILTER_SLAVE_START  14
+
+/* Sample point target of the bit timing and the range accepted around it,
+   in permille. The timing with the most oscillator tolerance in the range is
+   used, see `can_bit_timing_solve`. */
+#define CAN_SAMPLE_POINT        875
+#define CAN_SAMPLE_POINT_RANGE  25
+
+/* Precomputed bit timing, generated by `Tools/can_bit_timing_host`. The init
+   function of the CAN uses it without search when the bit rate and the clock
+   match, otherwise the timing is solved at init. For example:
+#define CAN1_BIT_TIMING_CLOCK    45000000
+#define CAN1_BIT_TIMING_RATE     1000000
+#define CAN1_BIT_TIMING_PRESCALE 3
+#define CAN1_BIT_TIMING_TSEG1    12
+#define CAN1_BIT_TIMING_TSEG2    2
+#define CAN1_BIT_TIMING_SJW      1
+*/
+
+/* Flags of `can_frame_t`. */
+#define CAN_FRAME_FD            0x01U /* FD format, 64 bytes at most.  */
+#define CAN_FRAME_BRS           0x02U /* Bit rate switch, FD only.     */
+/* Data length of the FD frame. */
+#define CAN_FRAME_MAX_LEN       64
+
+/* Flags of `can_trace_record_t`, bit 0-1 is the CAN, 0 for CAN1. */
+#define CAN_TRACE_TX            0x04U /* Transmitted by this node.     */
+#define CAN_TRACE_EXT           0x08U /* Extended ID.                  */
+#define CAN_TRACE_RTR           0x10U /* Remote frame.                 */
+#define CAN_TRACE_TIME          0x20U /* Time record, not a frame.     */
+#define CAN_TRACE_LOST          0x40U /* Records dropped before it.    */
+/* ID of the time record, "CANT" in the stream. */
+#define CAN_TRACE_MAGIC         0x544E4143U
+
 /**
  * @}
  */
@@ -57,6 +148,137 @@ typedef enum {
     can3_selected       /*!< Select CAN3 */
 } can_selected_t;
 
+/**
+ * @brief Frame of classic CAN and CAN FD.
+ */
+typedef struct {
+    uint32_t id;                     /*!< Message ID.                       */
+    uint32_t id_type;                /*!< `CAN_ID_STD` or `CAN_ID_EXT`.     */
+    uint32_t frame_type;             /*!< `CAN_RTR_DATA`, `CAN_RTR_REMOTE`. */
+    uint8_t flags;                   /*!< `CAN_FRAME_FD`, `CAN_FRAME_BRS`.  */
+    uint8_t len;                     /*!< Data length.                      */
+    uint8_t data[CAN_FRAME_MAX_LEN]; /*!< Message content.                  */
+} can_frame_t;
+
+/**
+ * @brief Statistics of the TX queue.
+ */
+typedef struct {
+    uint32_t queued;     /*!< Frames waiting in the queue now.        */
+    uint32_t high_water; /*!< Maximum frames waiting in the queue.    */
+    uint32_t sent;       /*!< Frames loaded into the mailboxes.       */
+    uint32_t dropped;    /*!< Frames dropped because queue is full.   */
+    uint32_t send_error; /*!< Failed loads (requeued) or transmits.   */
+    uint32_t aborted;    /*!< Mailboxes aborted for urgent frames.    */
+    uint32_t coalesced;  /*!< Slot frames replaced by a newer one.    */
+    /* Worst latency from push to transmitted of each priority class, unit:
+       CPU cycles. */
+    uint32_t max_latency[CAN_TX_PRIORITY_NUMBER];
+} can_tx_stats_t;
+
+/**
+ * @brief Bus meter of a CAN. The frames sent through the TX queue are
+ *        counted when transmitted, the others when requested. The received
+ *        frames are counted by `can_meter_count_rx`.
+ */
+typedef struct {
+    uint32_t bit_rate;      /*!< Bit rate, unit: bps.                     */
+    float bus_load;         /*!< Load of the rolling window, percent.     */
+    uint32_t window_bits;   /*!< Bits in the rolling window.              */
+    uint32_t tx_frames;     /*!< Frames sent.                             */
+    uint32_t rx_frames;     /*!< Frames received.                         */
+    uint32_t tx_bits;       /*!< Bits sent, include stuff bits and IFS.   */
+    uint32_t rx_bits;       /*!< Bits received, same as `tx_bits`.        */
+    uint32_t stuff_bits;    /*!< Stuff bits in `tx_bits` and `rx_bits`.   */
+    uint32_t error_frames;  /*!< Error frames, by the last error code.    */
+    uint32_t max_wire_time; /*!< Worst mailbox request to transmitted,
+                                 unit: us.                                */
+    /* Latency from push to transmitted of the TX queue, unit: us. The
+       percentiles are the upper bound of the histogram bucket. */
+    uint32_t latency_p50;
+    uint32_t latency_p90;
+    uint32_t latency_p99;
+    uint32_t latency_hist[CAN_METER_LATENCY_BUCKETS];
+} can_meter_t;
+
+/**
+ * @brief Statistics of the sync window.
+ */
+typedef struct {
+    uint32_t windows;      /*!< Windows released with frames.          */
+    uint32_t released;     /*!< Frames loaded into the mailboxes.      */
+    uint32_t queued;       /*!< Frames pushed into the TX queue, no
+                                free mailbox at release.               */
+    uint32_t dropped;      /*!< Frames dropped, stage or queue full.   */
+    uint32_t release_ns;   /*!< Last time to request all buses.        */
+    uint32_t skew_samples; /*!< Windows measured on 2 buses or more.   */
+    uint32_t last_skew_ns; /*!< Last skew of the start of frame.       */
+    uint32_t max_skew_ns;  /*!< Worst skew of the start of frame.      */
+} can_sync_stats_t;
+
+/**
+ * @brief Trace record, 16 bytes, little endian. The time record has the
+ *        absolute time (us, 64 bits) in `data`, the time of a frame record
+ *        is the time of the last time record plus the deltas after it.
+ */
+typedef struct {
+    uint16_t delta;  /*!< Time since the previous record, unit: us. */
+    uint8_t flags;   /*!< CAN and `CAN_TRACE_xxx`.                  */
+    uint8_t dlc;     /*!< Data length.                              */
+    uint32_t id;     /*!< Message ID, `CAN_TRACE_MAGIC` if time.    */
+    uint8_t data[8]; /*!< Message content.                          */
+} can_trace_record_t;
+
+/**
+ * @brief Statistics of the trace capture.
+ */
+typedef struct {
+    uint32_t records;    /*!< Records written, include time records. */
+    uint32_t dropped;    /*!< Frames dropped, the ring is full.      */
+    uint32_t queued;     /*!< Records not consumed now.              */
+    uint32_t high_water; /*!< Maximum records not consumed.          */
+} can_trace_stats_t;
+
+/**
+ * @brief Error state of CAN, by the error counters.
+ */
+typedef enum {
+    can_error_active = 0U, /*!< TEC and REC are less than 96.        */
+    can_error_warning,     /*!< TEC or REC reaches 96.               */
+    can_error_passive,     /*!< TEC or REC is greater than 127.      */
+    can_error_bus_off      /*!< TEC is greater than 255, off bus.    */
+} can_error_state_t;
+
+/**
+ * @brief Error statistics of CAN.
+ */
+typedef struct {
+    can_error_state_t state;  /*!< Error state now.                    */
+    uint8_t tec;              /*!< Transmit error counter now.         */
+    uint8_t rec;              /*!< Receive error counter now.          */
+    uint8_t max_tec;          /*!< Maximum TEC seen.                   */
+    uint8_t max_rec;          /*!< Maximum REC seen.                   */
+    /* Errors by the last error code: stuff, form, acknowledgment, bit
+       recessive, bit dominant and CRC. */
+    uint32_t lec_count[6];
+    uint32_t warning_count;    /*!< Times entered error warning.       */
+    uint32_t passive_count;    /*!< Times entered error passive.       */
+    uint32_t bus_off_count;    /*!< Times entered bus-off.             */
+    uint32_t recovered_count;  /*!< Times left bus-off.                */
+    uint32_t last_recovery_us; /*!< Last time from bus-off to active.  */
+    uint32_t max_recovery_us;  /*!< Worst time from bus-off to active. */
+} can_error_stats_t;
+
+/**
+ * @brief Error state callback, called when the state changes, in interrupt
+ *        or in the task calling `can_get_error_stats`.
+ *
+ * @param can_selected Which CAN.
+ * @param state The new state.
+ */
+typedef void (*can_error_callback_t)(can_selected_t can_selected,
+                                     can_error_state_t state);
+
 /**
  * @}
  */
@@ -106,6 +328,14 @@ typedef enum {
 #  endif  /* (defined(STM32F412Vx) || defined(STM32F446xx) || defined(STM32F412Cx) || defined(STM32F413xx) || defined(STM32F423xx) || defined(STM32F412Rx) || defined(STM32F412Zx)) */
 #endif  /* CAN1_RX_ID */
 
+/* The accept all filter uses FIFO1 if enabled, so FIFO0 is left to the IDs
+   added by `can_filter_add`. */
+#if CAN1_RX1_IT_ENABLE
+#  define CAN1_ACCEPT_ALL_FIFO CAN_FILTER_FIFO1
+#else
+#  define CAN1_ACCEPT_ALL_FIFO CAN_FILTER_FIFO0
+#endif  /* CAN1_RX1_IT_ENABLE */
+
 extern CAN_HandleTypeDef can1_handle;
 
 uint8_t can1_init(uint32_t baud_rate, uint32_t prop_delay);
@@ -146,6 +376,14 @@ uint8_t can1_deinit(void);
 #  endif  /* (defined(STM32F407xx) || defined(STM32F439xx) || defined(STM32F429xx) || defined(STM32F479xx) || defined(STM32F415xx) || defined(STM32F469xx) || defined(STM32F437xx) || defined(STM32F427xx) || defined(STM32F417xx) || defined(STM32F446xx) || defined(STM32F405xx)) */
 #endif  /* CAN2_RX_ID */
 
+/* The accept all filter uses FIFO1 if enabled, so FIFO0 is left to the IDs
+   added by `can_filter_add`. */
+#if CAN2_RX1_IT_ENABLE
+#  define CAN2_ACCEPT_ALL_FIFO CAN_FILTER_FIFO1
+#else
+#  define CAN2_ACCEPT_ALL_FIFO CAN_FILTER_FIFO0
+#endif  /* CAN2_RX1_IT_ENABLE */
+
 extern CAN_HandleTypeDef can2_handle;
 
 uint8_t can2_init(uint32_t baud_rate, uint32_t prop_delay);
@@ -176,6 +414,14 @@ uint8_t can2_deinit(void);
 #  define CAN3_RX_AF GPIO_AF11_CAN3
 #endif  /* CAN3_RX_ID */
 
+/* The accept all filter uses FIFO1 if enabled, so FIFO0 is left to the IDs
+   added by `can_filter_add`. */
+#if CAN3_RX1_IT_ENABLE
+#  define CAN3_ACCEPT_ALL_FIFO CAN_FILTER_FIFO1
+#else
+#  define CAN3_ACCEPT_ALL_FIFO CAN_FILTER_FIFO0
+#endif  /* CAN3_RX1_IT_ENABLE */
+
 extern CAN_HandleTypeDef can3_handle;
 
 uint8_t can3_init(uint32_t baud_rate, uint32_t prop_delay);
@@ -198,8 +444,66 @@ uint8_t can_rate_calc(uint32_t baud_rate, uint32_t prop_delay,
                       uint32_t base_freq, uint32_t *prescale, uint32_t *tsjw,
                       uint32_t *tseg1, uint32_t *tseg2);
 
+CAN_HandleTypeDef *can_get_handle(can_selected_t can_selected);
+
+uint8_t can_filter_add(can_selected_t can_selected, uint32_t can_ide,
+                       uint32_t id, uint32_t id_mask, uint32_t fifo);
+uint8_t can_filter_remove(can_selected_t can_selected, uint32_t can_ide,
+                          uint32_t id, uint32_t id_mask);
+
 uint8_t can_send_message(can_selected_t can_selected, uint32_t can_ide,
                          uint32_t id, uint8_t len, const uint8_t *msg);
+uint8_t can_send_message_prio(can_selected_t can_selected, uint32_t can_ide,
+                              uint32_t id, uint8_t len, const uint8_t *msg,
+                              uint8_t priority);
+uint8_t can_send_message_slot(can_selected_t can_selected, uint32_t can_ide,
+                              uint32_t id, uint8_t len, const uint8_t *msg,
+                              uint8_t priority);
+uint8_t can_send_remote(can_selected_t can_selected, uint32_t can_ide,
+                        uint32_t id, uint8_t len, const uint8_t *msg);
+
+uint8_t can_send_frame(can_selected_t can_selected, const can_frame_t *frame,
+                       uint8_t priority);
+uint8_t can_fd_supported(can_selected_t can_selected);
+uint8_t can_dlc_to_len(uint8_t dlc);
+uint8_t can_len_to_dlc(uint8_t len);
+
+uint8_t can_get_tx_stats(can_selected_t can_selected, can_tx_stats_t *stats);
+uint8_t can_clear_tx_stats(can_selected_t can_selected);
+
+uint32_t can_frame_bits(uint32_t can_ide, uint32_t id, uint32_t rtr,
+                        uint8_t len, const uint8_t *msg, uint32_t *stuff);
+void can_meter_count_rx(can_selected_t can_selected, uint32_t can_ide,
+                        uint32_t id, uint32_t rtr, uint8_t len,
+                        const uint8_t *msg);
+uint8_t can_get_meter(can_selected_t can_selected, can_meter_t *meter);
+uint8_t can_clear_meter(can_selected_t can_selected);
+
+void can_trace_count_rx(can_selected_t can_selected, uint32_t can_ide,
+                        uint32_t id, uint32_t rtr, uint8_t len,
+                        const uint8_t *msg);
+uint8_t can_trace_start(uint32_t can_mask);
+void can_trace_stop(void);
+uint32_t can_trace_peek(const can_trace_record_t **records);
+void can_trace_consume(uint32_t number);
+uint8_t can_trace_get_stats(can_trace_stats_t *stats);
+
+uint8_t can_error_register(can_selected_t can_selected,
+                           can_error_callback_t callback);
+uint8_t can_error_unregister(can_selected_t can_selected,
+                             can_error_callback_t callback);
+uint8_t can_get_error_stats(can_selected_t can_selected,
+                            can_error_stats_t *stats);
+uint8_t can_clear_error_stats(can_selected_t can_selected);
+uint8_t can_error_recover(can_selected_t can_selected);
+uint8_t can_set_mode(can_selected_t can_selected, uint32_t mode);
+
+uint8_t can_sync_start(uint32_t period_us);
+void can_sync_stop(void);
+uint8_t can_sync_stage(can_selected_t can_selected, uint32_t can_ide,
+                       uint32_t id, uint8_t len, const uint8_t *msg);
+uint8_t can_get_sync_stats(can_sync_stats_t *stats);
+void can_clear_sync_stats(void);
 
 /**
  * @}
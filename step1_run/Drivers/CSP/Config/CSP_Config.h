@@ -3931,7 +3931,7 @@
 
 //   <o> CAN1 RX0 Interrupt Priority <0-15>
 //   <i> The Interrupt Priority of CAN1 RX0
-#define CAN1_RX0_IT_PRIORITY        2
+#define CAN1_RX0_IT_PRIORITY        1
 //   <o> CAN1 RX0 Interrupt SubPriority <0-15>
 //   <i> The Interrupt SubPriority of CAN1 RX0
 #define CAN1_RX0_IT_SUB             3
@@ -3997,7 +3997,7 @@
 #endif  /* CAN2_TX_ID */
 
 //   <e> Enable CAN2 TX Interrupt
-#define CAN2_TX_IT_ENABLE 0
+#define CAN2_TX_IT_ENABLE 1
 
 #if CAN2_TX_IT_ENABLE
 
@@ -4012,7 +4012,7 @@
 #endif /* CAN2_TX_IT_ENABLE */
 
 //   <e> Enable CAN2 SCE Interrupt
-#define CAN2_SCE_IT_ENABLE 0
+#define CAN2_SCE_IT_ENABLE 1
 
 #if CAN2_SCE_IT_ENABLE
 
@@ -4033,7 +4033,7 @@
 
 //   <o> CAN2 RX0 Interrupt Priority <0-15>
 //   <i> The Interrupt Priority of CAN2 RX0
-#define CAN2_RX0_IT_PRIORITY        2
+#define CAN2_RX0_IT_PRIORITY        1
 //   <o> CAN2 RX0 Interrupt SubPriority <0-15>
 //   <i> The Interrupt SubPriority of CAN2 RX0
 #define CAN2_RX0_IT_SUB             3
@@ -4093,7 +4093,7 @@
 #endif  /* CAN3_TX_ID */
 
 //   <e> Enable CAN3 TX Interrupt
-#define CAN3_TX_IT_ENABLE 0
+#define CAN3_TX_IT_ENABLE 1
 
 #if CAN3_TX_IT_ENABLE
 
@@ -4108,7 +4108,7 @@
 #endif /* CAN3_TX_IT_ENABLE */
 
 //   <e> Enable CAN3 SCE Interrupt
-#define CAN3_SCE_IT_ENABLE 0
+#define CAN3_SCE_IT_ENABLE 1
 
 #if CAN3_SCE_IT_ENABLE
 
@@ -4129,7 +4129,7 @@
 
 //   <o> CAN3 RX0 Interrupt Priority <0-15>
 //   <i> The Interrupt Priority of CAN3 RX0
-#define CAN3_RX0_IT_PRIORITY        2
+#define CAN3_RX0_IT_PRIORITY        1
 //   <o> CAN3 RX0 Interrupt SubPriority <0-15>
 //   <i> The Interrupt SubPriority of CAN3 RX0
 #define CAN3_RX0_IT_SUB             3
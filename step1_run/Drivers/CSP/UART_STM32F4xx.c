@@ -20,17 +20,29 @@
  * @{
  */
 
-/* The buf of `uart_printf` and `uart_scanf`. */
+/* The buf of `uart_scanf`, and `uart_printf` of the UART without DMA Tx. */
 static char uart_buffer[256];
 
+/* Record header of the send ring is the data length, the busy bit is set
+   until the data is written. */
+#define UART_TX_REC_BUSY 0x8000U
+/* Header at the end of the ring, the next record is at the start. */
+#define UART_TX_REC_WRAP 0x7FFFU
+/* Size of the record header. */
+#define UART_TX_REC_HEAD sizeof(uint16_t)
+
 /**
- * @brief Send buf of UART.
+ * @brief Send ring of UART. Each message is a record of a 16-bit header and
+ *        the data, the DMA transmits one record at a time and the transfer
+ *        complete interrupt starts the next one.
  */
 typedef struct {
-    uint8_t *send_buf; /*!< Send data buf.                                  */
-    uint32_t head_ptr; /*!< Pointer of send buf to control the length of DMA
-                            transfer.                                       */
-    size_t buf_size;   /*!< The size of buffer. Prevent overflow.           */
+    uint8_t *send_buf;     /*!< Send ring.                                  */
+    uint32_t head_ptr;     /*!< Offset of the next record to write.         */
+    uint32_t tail_ptr;     /*!< Offset of the record in DMA or the next.    */
+    uint32_t sending;      /*!< Size of the record in DMA, 0 if idle.       */
+    size_t buf_size;       /*!< The size of buffer. Prevent overflow.       */
+    uart_tx_stats_t stats; /*!< Statistics.                                 */
 } uart_tx_buf_t;
 
 /**
@@ -44,6 +56,11 @@ typedef struct {
                                control the DMA receive.      */
     uint32_t buf_size;    /*!< Size of `recv_buf`.           */
     uint32_t fifo_size;   /*!< Size of `rx_fifo_buf`.        */
+    uint32_t tail_ptr;    /*!< Bytes consumed in zero-copy
+                               mode, same base as `head_ptr`. */
+    uint8_t zero_copy;    /*!< Read from `recv_buf` by peek
+                               and consume, skip the fifo.   */
+    uart_rx_callback_t callback; /*!< Notify the receiver.   */
 } uart_rx_fifo_t;
 
 /**
@@ -58,6 +75,11 @@ typedef struct {
 static void uart_dmarx_halfdone_callback(UART_HandleTypeDef *huart);
 static void uart_dmarx_done_callback(UART_HandleTypeDef *huart);
 void uart_dmarx_idle_callback(UART_HandleTypeDef *huart);
+static void uart_dmatx_done_callback(UART_HandleTypeDef *huart);
+static inline uart_tx_buf_t *uart_tx_identify(UART_HandleTypeDef *huart);
+static uint8_t *uart_dmatx_reserve(uart_tx_buf_t *tx_buf, uint32_t len);
+static void uart_dmatx_commit(UART_HandleTypeDef *huart,
+                              uart_tx_buf_t *tx_buf, uint8_t *data);
 
 /**
  * @}
@@ -175,6 +197,7 @@ uint8_t usart1_init(uint32_t baud_rate) {
 
 #if USART1_RX_DMA
     usart1_rx_fifo.head_ptr = 0;
+    usart1_rx_fifo.tail_ptr = 0;
 
     usart1_rx_fifo.recv_buf = CSP_MALLOC(usart1_rx_fifo.buf_size);
     if (usart1_rx_fifo.recv_buf == NULL) {
@@ -205,6 +228,10 @@ uint8_t usart1_init(uint32_t baud_rate) {
 #endif /* USART1_RX_DMA */
 
 #if USART1_TX_DMA
+    usart1_tx_buf.head_ptr = 0;
+    usart1_tx_buf.tail_ptr = 0;
+    usart1_tx_buf.sending = 0;
+
     usart1_tx_buf.send_buf = CSP_MALLOC(usart1_tx_buf.buf_size);
     if (usart1_tx_buf.send_buf == NULL) {
         return UART_INIT_MEM_FAIL;
@@ -240,6 +267,11 @@ uint8_t usart1_init(uint32_t baud_rate) {
                               uart_dmarx_done_callback);
 #endif /* USE_HAL_UART_REGISTER_CALLBACKS */
 #endif /* USART1_RX_DMA */
+
+#if USART1_TX_DMA && USE_HAL_UART_REGISTER_CALLBACKS
+    HAL_UART_RegisterCallback(&usart1_handle, HAL_UART_TX_COMPLETE_CB_ID,
+                              uart_dmatx_done_callback);
+#endif /* USART1_TX_DMA && USE_HAL_UART_REGISTER_CALLBACKS */
     return UART_INIT_OK;
 }
 
@@ -351,6 +383,9 @@ uint8_t usart1_deinit(void) {
 
     HAL_NVIC_DisableIRQ(USART1_TX_DMA_IRQn);
 
+#if USE_HAL_UART_REGISTER_CALLBACKS
+    HAL_UART_UnRegisterCallback(&usart1_handle, HAL_UART_TX_COMPLETE_CB_ID);
+#endif /* USE_HAL_UART_REGISTER_CALLBACKS */
     usart1_handle.hdmatx = NULL;
 #endif /* USART1_TX_DMA */
 
@@ -480,6 +515,7 @@ uint8_t usart2_init(uint32_t baud_rate) {
 
 #if USART2_RX_DMA
     usart2_rx_fifo.head_ptr = 0;
+    usart2_rx_fifo.tail_ptr = 0;
 
     usart2_rx_fifo.recv_buf = CSP_MALLOC(usart2_rx_fifo.buf_size);
     if (usart2_rx_fifo.recv_buf == NULL) {
@@ -510,6 +546,10 @@ uint8_t usart2_init(uint32_t baud_rate) {
 #endif /* USART2_RX_DMA */
 
 #if USART2_TX_DMA
+    usart2_tx_buf.head_ptr = 0;
+    usart2_tx_buf.tail_ptr = 0;
+    usart2_tx_buf.sending = 0;
+
     usart2_tx_buf.send_buf = CSP_MALLOC(usart2_tx_buf.buf_size);
     if (usart2_tx_buf.send_buf == NULL) {
         return UART_INIT_MEM_FAIL;
@@ -545,6 +585,11 @@ uint8_t usart2_init(uint32_t baud_rate) {
                               uart_dmarx_done_callback);
 #endif /* USE_HAL_UART_REGISTER_CALLBACKS */
 #endif /* USART2_RX_DMA */
+
+#if USART2_TX_DMA && USE_HAL_UART_REGISTER_CALLBACKS
+    HAL_UART_RegisterCallback(&usart2_handle, HAL_UART_TX_COMPLETE_CB_ID,
+                              uart_dmatx_done_callback);
+#endif /* USART2_TX_DMA && USE_HAL_UART_REGISTER_CALLBACKS */
     return UART_INIT_OK;
 }
 
@@ -656,6 +701,9 @@ uint8_t usart2_deinit(void) {
 
     HAL_NVIC_DisableIRQ(USART2_TX_DMA_IRQn);
 
+#if USE_HAL_UART_REGISTER_CALLBACKS
+    HAL_UART_UnRegisterCallback(&usart2_handle, HAL_UART_TX_COMPLETE_CB_ID);
+#endif /* USE_HAL_UART_REGISTER_CALLBACKS */
     usart2_handle.hdmatx = NULL;
 #endif /* USART2_TX_DMA */
 
@@ -785,6 +833,7 @@ uint8_t usart3_init(uint32_t baud_rate) {
 
 #if USART3_RX_DMA
     usart3_rx_fifo.head_ptr = 0;
+    usart3_rx_fifo.tail_ptr = 0;
 
     usart3_rx_fifo.recv_buf = CSP_MALLOC(usart3_rx_fifo.buf_size);
     if (usart3_rx_fifo.recv_buf == NULL) {
@@ -815,6 +864,10 @@ uint8_t usart3_init(uint32_t baud_rate) {
 #endif /* USART3_RX_DMA */
 
 #if USART3_TX_DMA
+    usart3_tx_buf.head_ptr = 0;
+    usart3_tx_buf.tail_ptr = 0;
+    usart3_tx_buf.sending = 0;
+
     usart3_tx_buf.send_buf = CSP_MALLOC(usart3_tx_buf.buf_size);
     if (usart3_tx_buf.send_buf == NULL) {
         return UART_INIT_MEM_FAIL;
@@ -850,6 +903,11 @@ uint8_t usart3_init(uint32_t baud_rate) {
                               uart_dmarx_done_callback);
 #endif /* USE_HAL_UART_REGISTER_CALLBACKS */
 #endif /* USART3_RX_DMA */
+
+#if USART3_TX_DMA && USE_HAL_UART_REGISTER_CALLBACKS
+    HAL_UART_RegisterCallback(&usart3_handle, HAL_UART_TX_COMPLETE_CB_ID,
+                              uart_dmatx_done_callback);
+#endif /* USART3_TX_DMA && USE_HAL_UART_REGISTER_CALLBACKS */
     return UART_INIT_OK;
 }
 
@@ -961,6 +1019,9 @@ uint8_t usart3_deinit(void) {
 
     HAL_NVIC_DisableIRQ(USART3_TX_DMA_IRQn);
 
+#if USE_HAL_UART_REGISTER_CALLBACKS
+    HAL_UART_UnRegisterCallback(&usart3_handle, HAL_UART_TX_COMPLETE_CB_ID);
+#endif /* USE_HAL_UART_REGISTER_CALLBACKS */
     usart3_handle.hdmatx = NULL;
 #endif /* USART3_TX_DMA */
 
@@ -1090,6 +1151,7 @@ uint8_t uart4_init(uint32_t baud_rate) {
 
 #if UART4_RX_DMA
     uart4_rx_fifo.head_ptr = 0;
+    uart4_rx_fifo.tail_ptr = 0;
 
     uart4_rx_fifo.recv_buf = CSP_MALLOC(uart4_rx_fifo.buf_size);
     if (uart4_rx_fifo.recv_buf == NULL) {
@@ -1120,6 +1182,10 @@ uint8_t uart4_init(uint32_t baud_rate) {
 #endif /* UART4_RX_DMA */
 
 #if UART4_TX_DMA
+    uart4_tx_buf.head_ptr = 0;
+    uart4_tx_buf.tail_ptr = 0;
+    uart4_tx_buf.sending = 0;
+
     uart4_tx_buf.send_buf = CSP_MALLOC(uart4_tx_buf.buf_size);
     if (uart4_tx_buf.send_buf == NULL) {
         return UART_INIT_MEM_FAIL;
@@ -1155,6 +1221,11 @@ uint8_t uart4_init(uint32_t baud_rate) {
                               uart_dmarx_done_callback);
 #endif /* USE_HAL_UART_REGISTER_CALLBACKS */
 #endif /* UART4_RX_DMA */
+
+#if UART4_TX_DMA && USE_HAL_UART_REGISTER_CALLBACKS
+    HAL_UART_RegisterCallback(&uart4_handle, HAL_UART_TX_COMPLETE_CB_ID,
+                              uart_dmatx_done_callback);
+#endif /* UART4_TX_DMA && USE_HAL_UART_REGISTER_CALLBACKS */
     return UART_INIT_OK;
 }
 
@@ -1266,6 +1337,9 @@ uint8_t uart4_deinit(void) {
 
     HAL_NVIC_DisableIRQ(UART4_TX_DMA_IRQn);
 
+#if USE_HAL_UART_REGISTER_CALLBACKS
+    HAL_UART_UnRegisterCallback(&uart4_handle, HAL_UART_TX_COMPLETE_CB_ID);
+#endif /* USE_HAL_UART_REGISTER_CALLBACKS */
     uart4_handle.hdmatx = NULL;
 #endif /* UART4_TX_DMA */
 
@@ -1395,6 +1469,7 @@ uint8_t uart5_init(uint32_t baud_rate) {
 
 #if UART5_RX_DMA
     uart5_rx_fifo.head_ptr = 0;
+    uart5_rx_fifo.tail_ptr = 0;
 
     uart5_rx_fifo.recv_buf = CSP_MALLOC(uart5_rx_fifo.buf_size);
     if (uart5_rx_fifo.recv_buf == NULL) {
@@ -1425,6 +1500,10 @@ uint8_t uart5_init(uint32_t baud_rate) {
 #endif /* UART5_RX_DMA */
 
 #if UART5_TX_DMA
+    uart5_tx_buf.head_ptr = 0;
+    uart5_tx_buf.tail_ptr = 0;
+    uart5_tx_buf.sending = 0;
+
     uart5_tx_buf.send_buf = CSP_MALLOC(uart5_tx_buf.buf_size);
     if (uart5_tx_buf.send_buf == NULL) {
         return UART_INIT_MEM_FAIL;
@@ -1460,6 +1539,11 @@ uint8_t uart5_init(uint32_t baud_rate) {
                               uart_dmarx_done_callback);
 #endif /* USE_HAL_UART_REGISTER_CALLBACKS */
 #endif /* UART5_RX_DMA */
+
+#if UART5_TX_DMA && USE_HAL_UART_REGISTER_CALLBACKS
+    HAL_UART_RegisterCallback(&uart5_handle, HAL_UART_TX_COMPLETE_CB_ID,
+                              uart_dmatx_done_callback);
+#endif /* UART5_TX_DMA && USE_HAL_UART_REGISTER_CALLBACKS */
     return UART_INIT_OK;
 }
 
@@ -1571,6 +1655,9 @@ uint8_t uart5_deinit(void) {
 
     HAL_NVIC_DisableIRQ(UART5_TX_DMA_IRQn);
 
+#if USE_HAL_UART_REGISTER_CALLBACKS
+    HAL_UART_UnRegisterCallback(&uart5_handle, HAL_UART_TX_COMPLETE_CB_ID);
+#endif /* USE_HAL_UART_REGISTER_CALLBACKS */
     uart5_handle.hdmatx = NULL;
 #endif /* UART5_TX_DMA */
 
@@ -1700,6 +1787,7 @@ uint8_t usart6_init(uint32_t baud_rate) {
 
 #if USART6_RX_DMA
     usart6_rx_fifo.head_ptr = 0;
+    usart6_rx_fifo.tail_ptr = 0;
 
     usart6_rx_fifo.recv_buf = CSP_MALLOC(usart6_rx_fifo.buf_size);
     if (usart6_rx_fifo.recv_buf == NULL) {
@@ -1730,6 +1818,10 @@ uint8_t usart6_init(uint32_t baud_rate) {
 #endif /* USART6_RX_DMA */
 
 #if USART6_TX_DMA
+    usart6_tx_buf.head_ptr = 0;
+    usart6_tx_buf.tail_ptr = 0;
+    usart6_tx_buf.sending = 0;
+
     usart6_tx_buf.send_buf = CSP_MALLOC(usart6_tx_buf.buf_size);
     if (usart6_tx_buf.send_buf == NULL) {
         return UART_INIT_MEM_FAIL;
@@ -1765,6 +1857,11 @@ uint8_t usart6_init(uint32_t baud_rate) {
                               uart_dmarx_done_callback);
 #endif /* USE_HAL_UART_REGISTER_CALLBACKS */
 #endif /* USART6_RX_DMA */
+
+#if USART6_TX_DMA && USE_HAL_UART_REGISTER_CALLBACKS
+    HAL_UART_RegisterCallback(&usart6_handle, HAL_UART_TX_COMPLETE_CB_ID,
+                              uart_dmatx_done_callback);
+#endif /* USART6_TX_DMA && USE_HAL_UART_REGISTER_CALLBACKS */
     return UART_INIT_OK;
 }
 
@@ -1876,6 +1973,9 @@ uint8_t usart6_deinit(void) {
 
     HAL_NVIC_DisableIRQ(USART6_TX_DMA_IRQn);
 
+#if USE_HAL_UART_REGISTER_CALLBACKS
+    HAL_UART_UnRegisterCallback(&usart6_handle, HAL_UART_TX_COMPLETE_CB_ID);
+#endif /* USE_HAL_UART_REGISTER_CALLBACKS */
     usart6_handle.hdmatx = NULL;
 #endif /* USART6_TX_DMA */
 
@@ -1987,6 +2087,7 @@ uint8_t uart7_init(uint32_t baud_rate) {
 
 #if UART7_RX_DMA
     uart7_rx_fifo.head_ptr = 0;
+    uart7_rx_fifo.tail_ptr = 0;
 
     uart7_rx_fifo.recv_buf = CSP_MALLOC(uart7_rx_fifo.buf_size);
     if (uart7_rx_fifo.recv_buf == NULL) {
@@ -2017,6 +2118,10 @@ uint8_t uart7_init(uint32_t baud_rate) {
 #endif /* UART7_RX_DMA */
 
 #if UART7_TX_DMA
+    uart7_tx_buf.head_ptr = 0;
+    uart7_tx_buf.tail_ptr = 0;
+    uart7_tx_buf.sending = 0;
+
     uart7_tx_buf.send_buf = CSP_MALLOC(uart7_tx_buf.buf_size);
     if (uart7_tx_buf.send_buf == NULL) {
         return UART_INIT_MEM_FAIL;
@@ -2052,6 +2157,11 @@ uint8_t uart7_init(uint32_t baud_rate) {
                               uart_dmarx_done_callback);
 #endif /* USE_HAL_UART_REGISTER_CALLBACKS */
 #endif /* UART7_RX_DMA */
+
+#if UART7_TX_DMA && USE_HAL_UART_REGISTER_CALLBACKS
+    HAL_UART_RegisterCallback(&uart7_handle, HAL_UART_TX_COMPLETE_CB_ID,
+                              uart_dmatx_done_callback);
+#endif /* UART7_TX_DMA && USE_HAL_UART_REGISTER_CALLBACKS */
     return UART_INIT_OK;
 }
 
@@ -2155,6 +2265,9 @@ uint8_t uart7_deinit(void) {
 
     HAL_NVIC_DisableIRQ(UART7_TX_DMA_IRQn);
 
+#if USE_HAL_UART_REGISTER_CALLBACKS
+    HAL_UART_UnRegisterCallback(&uart7_handle, HAL_UART_TX_COMPLETE_CB_ID);
+#endif /* USE_HAL_UART_REGISTER_CALLBACKS */
     uart7_handle.hdmatx = NULL;
 #endif /* UART7_TX_DMA */
 
@@ -2266,6 +2379,7 @@ uint8_t uart8_init(uint32_t baud_rate) {
 
 #if UART8_RX_DMA
     uart8_rx_fifo.head_ptr = 0;
+    uart8_rx_fifo.tail_ptr = 0;
 
     uart8_rx_fifo.recv_buf = CSP_MALLOC(uart8_rx_fifo.buf_size);
     if (uart8_rx_fifo.recv_buf == NULL) {
@@ -2296,6 +2410,10 @@ uint8_t uart8_init(uint32_t baud_rate) {
 #endif /* UART8_RX_DMA */
 
 #if UART8_TX_DMA
+    uart8_tx_buf.head_ptr = 0;
+    uart8_tx_buf.tail_ptr = 0;
+    uart8_tx_buf.sending = 0;
+
     uart8_tx_buf.send_buf = CSP_MALLOC(uart8_tx_buf.buf_size);
     if (uart8_tx_buf.send_buf == NULL) {
         return UART_INIT_MEM_FAIL;
@@ -2331,6 +2449,11 @@ uint8_t uart8_init(uint32_t baud_rate) {
                               uart_dmarx_done_callback);
 #endif /* USE_HAL_UART_REGISTER_CALLBACKS */
 #endif /* UART8_RX_DMA */
+
+#if UART8_TX_DMA && USE_HAL_UART_REGISTER_CALLBACKS
+    HAL_UART_RegisterCallback(&uart8_handle, HAL_UART_TX_COMPLETE_CB_ID,
+                              uart_dmatx_done_callback);
+#endif /* UART8_TX_DMA && USE_HAL_UART_REGISTER_CALLBACKS */
     return UART_INIT_OK;
 }
 
@@ -2434,6 +2557,9 @@ uint8_t uart8_deinit(void) {
 
     HAL_NVIC_DisableIRQ(UART8_TX_DMA_IRQn);
 
+#if USE_HAL_UART_REGISTER_CALLBACKS
+    HAL_UART_UnRegisterCallback(&uart8_handle, HAL_UART_TX_COMPLETE_CB_ID);
+#endif /* USE_HAL_UART_REGISTER_CALLBACKS */
     uart8_handle.hdmatx = NULL;
 #endif /* UART8_TX_DMA */
 
@@ -2545,6 +2671,7 @@ uint8_t uart9_init(uint32_t baud_rate) {
 
 #if UART9_RX_DMA
     uart9_rx_fifo.head_ptr = 0;
+    uart9_rx_fifo.tail_ptr = 0;
 
     uart9_rx_fifo.recv_buf = CSP_MALLOC(uart9_rx_fifo.buf_size);
     if (uart9_rx_fifo.recv_buf == NULL) {
@@ -2575,6 +2702,10 @@ uint8_t uart9_init(uint32_t baud_rate) {
 #endif /* UART9_RX_DMA */
 
 #if UART9_TX_DMA
+    uart9_tx_buf.head_ptr = 0;
+    uart9_tx_buf.tail_ptr = 0;
+    uart9_tx_buf.sending = 0;
+
     uart9_tx_buf.send_buf = CSP_MALLOC(uart9_tx_buf.buf_size);
     if (uart9_tx_buf.send_buf == NULL) {
         return UART_INIT_MEM_FAIL;
@@ -2610,6 +2741,11 @@ uint8_t uart9_init(uint32_t baud_rate) {
                               uart_dmarx_done_callback);
 #endif /* USE_HAL_UART_REGISTER_CALLBACKS */
 #endif /* UART9_RX_DMA */
+
+#if UART9_TX_DMA && USE_HAL_UART_REGISTER_CALLBACKS
+    HAL_UART_RegisterCallback(&uart9_handle, HAL_UART_TX_COMPLETE_CB_ID,
+                              uart_dmatx_done_callback);
+#endif /* UART9_TX_DMA && USE_HAL_UART_REGISTER_CALLBACKS */
     return UART_INIT_OK;
 }
 
@@ -2713,6 +2849,9 @@ uint8_t uart9_deinit(void) {
 
     HAL_NVIC_DisableIRQ(UART9_TX_DMA_IRQn);
 
+#if USE_HAL_UART_REGISTER_CALLBACKS
+    HAL_UART_UnRegisterCallback(&uart9_handle, HAL_UART_TX_COMPLETE_CB_ID);
+#endif /* USE_HAL_UART_REGISTER_CALLBACKS */
     uart9_handle.hdmatx = NULL;
 #endif /* UART9_TX_DMA */
 
@@ -2824,6 +2963,7 @@ uint8_t uart10_init(uint32_t baud_rate) {
 
 #if UART10_RX_DMA
     uart10_rx_fifo.head_ptr = 0;
+    uart10_rx_fifo.tail_ptr = 0;
 
     uart10_rx_fifo.recv_buf = CSP_MALLOC(uart10_rx_fifo.buf_size);
     if (uart10_rx_fifo.recv_buf == NULL) {
@@ -2854,6 +2994,10 @@ uint8_t uart10_init(uint32_t baud_rate) {
 #endif /* UART10_RX_DMA */
 
 #if UART10_TX_DMA
+    uart10_tx_buf.head_ptr = 0;
+    uart10_tx_buf.tail_ptr = 0;
+    uart10_tx_buf.sending = 0;
+
     uart10_tx_buf.send_buf = CSP_MALLOC(uart10_tx_buf.buf_size);
     if (uart10_tx_buf.send_buf == NULL) {
         return UART_INIT_MEM_FAIL;
@@ -2889,6 +3033,11 @@ uint8_t uart10_init(uint32_t baud_rate) {
                               uart_dmarx_done_callback);
 #endif /* USE_HAL_UART_REGISTER_CALLBACKS */
 #endif /* UART10_RX_DMA */
+
+#if UART10_TX_DMA && USE_HAL_UART_REGISTER_CALLBACKS
+    HAL_UART_RegisterCallback(&uart10_handle, HAL_UART_TX_COMPLETE_CB_ID,
+                              uart_dmatx_done_callback);
+#endif /* UART10_TX_DMA && USE_HAL_UART_REGISTER_CALLBACKS */
     return UART_INIT_OK;
 }
 
@@ -2992,6 +3141,9 @@ uint8_t uart10_deinit(void) {
 
     HAL_NVIC_DisableIRQ(UART10_TX_DMA_IRQn);
 
+#if USE_HAL_UART_REGISTER_CALLBACKS
+    HAL_UART_UnRegisterCallback(&uart10_handle, HAL_UART_TX_COMPLETE_CB_ID);
+#endif /* USE_HAL_UART_REGISTER_CALLBACKS */
     uart10_handle.hdmatx = NULL;
 #endif /* UART10_TX_DMA */
 
@@ -3014,12 +3166,16 @@ uint8_t uart10_deinit(void) {
  */
 
 /**
- * @brief Formatted print to the UART.
+ * @brief Formatted print to the UART. With DMA Tx, the message is formatted
+ *        into the send ring and the function returns without waiting, the
+ *        message is dropped when the ring is full. Can be called from tasks
+ *        and interrupts at the same time. Without DMA Tx, it is blocking.
  *
  * @param huart The handle of UART.
  * @param __format The string with format.
  * @return The number of characters that would have been written in the
- *         array, not counting the terminating null character.
+ *         array, not counting the terminating null character. 0 if the
+ *         message is dropped.
  */
 int uart_printf(UART_HandleTypeDef *huart, const char *__format, ...) {
     int res;
@@ -3031,6 +3187,30 @@ int uart_printf(UART_HandleTypeDef *huart, const char *__format, ...) {
         return 0;
     }
 
+    uart_tx_buf_t *tx_buf = uart_tx_identify(huart);
+
+    if ((tx_buf != NULL) && (huart->hdmatx != NULL)) {
+        va_start(ap, __format);
+        res = vsnprintf(NULL, 0, __format, ap);
+        va_end(ap);
+
+        if (res <= 0) {
+            return res;
+        }
+
+        uint8_t *data = uart_dmatx_reserve(tx_buf, (uint32_t)res);
+        if (data == NULL) {
+            return 0;
+        }
+
+        va_start(ap, __format);
+        vsnprintf((char *)data, (size_t)res + 1, __format, ap);
+        va_end(ap);
+
+        uart_dmatx_commit(huart, tx_buf, data);
+        return res;
+    }
+
     /* Wait for last transfer end. */
     while (__HAL_UART_GET_FLAG(huart, UART_FLAG_TC) == RESET)
         ;
@@ -3041,11 +3221,7 @@ int uart_printf(UART_HandleTypeDef *huart, const char *__format, ...) {
 
     len = strlen(uart_buffer);
 
-    if (huart->hdmatx != NULL) {
-        HAL_UART_Transmit_DMA(huart, (uint8_t *)uart_buffer, len);
-    } else {
-        HAL_UART_Transmit(huart, (uint8_t *)uart_buffer, len, 1000);
-    }
+    HAL_UART_Transmit(huart, (uint8_t *)uart_buffer, len, 1000);
 
     return res;
 }
@@ -3200,7 +3376,14 @@ void uart_dmarx_idle_callback(UART_HandleTypeDef *huart) {
     copy = tail_ptr - offset;
     uart_rx_fifo->head_ptr += copy;
 
-    ring_fifo_write(uart_rx_fifo->rx_fifo, huart->pRxBuffPtr + offset, copy);
+    if (!uart_rx_fifo->zero_copy) {
+        ring_fifo_write(uart_rx_fifo->rx_fifo, huart->pRxBuffPtr + offset,
+                        copy);
+    }
+
+    if (uart_rx_fifo->callback != NULL) {
+        uart_rx_fifo->callback(huart);
+    }
 }
 
 /**
@@ -3233,7 +3416,14 @@ void uart_dmarx_halfdone_callback(UART_HandleTypeDef *huart) {
     copy = tail_ptr - offset;
     uart_rx_fifo->head_ptr += copy;
 
-    ring_fifo_write(uart_rx_fifo->rx_fifo, huart->pRxBuffPtr + offset, copy);
+    if (!uart_rx_fifo->zero_copy) {
+        ring_fifo_write(uart_rx_fifo->rx_fifo, huart->pRxBuffPtr + offset,
+                        copy);
+    }
+
+    if (uart_rx_fifo->callback != NULL) {
+        uart_rx_fifo->callback(huart);
+    }
 }
 
 /**
@@ -3266,7 +3456,10 @@ void uart_dmarx_done_callback(UART_HandleTypeDef *huart) {
     copy = tail_ptr - offset;
     uart_rx_fifo->head_ptr += copy;
 
-    ring_fifo_write(uart_rx_fifo->rx_fifo, huart->pRxBuffPtr + offset, copy);
+    if (!uart_rx_fifo->zero_copy) {
+        ring_fifo_write(uart_rx_fifo->rx_fifo, huart->pRxBuffPtr + offset,
+                        copy);
+    }
 
     if (huart->hdmarx->Init.Mode != DMA_CIRCULAR) {
         /* Reopen the DMA receive. */
@@ -3275,6 +3468,10 @@ void uart_dmarx_done_callback(UART_HandleTypeDef *huart) {
             __HAL_UNLOCK(huart);
         }
     }
+
+    if (uart_rx_fifo->callback != NULL) {
+        uart_rx_fifo->callback(huart);
+    }
 }
 
 /**
@@ -3364,6 +3561,162 @@ uint32_t uart_dmarx_get_fifo_size(UART_HandleTypeDef *huart) {
 
     return uart_rx_fifo->fifo_size;
 }
+
+/**
+ * @brief Bytes received since the UART was initialized, same base as
+ *        `head_ptr`. The callbacks run at least every half buffer, the DMA
+ *        is less than one buffer ahead of `head_ptr`. Call with interrupts
+ *        disabled.
+ *
+ * @param huart The handle of UART.
+ * @param uart_rx_fifo The receive fifo of UART.
+ * @return The bytes received.
+ */
+static uint32_t uart_dmarx_received(UART_HandleTypeDef *huart,
+                                    uart_rx_fifo_t *uart_rx_fifo) {
+    uint32_t size = huart->RxXferSize;
+    uint32_t offset = uart_rx_fifo->head_ptr % size;
+    uint32_t tail_ptr = size - __HAL_DMA_GET_COUNTER(huart->hdmarx);
+
+    return uart_rx_fifo->head_ptr + (tail_ptr + size - offset) % size;
+}
+
+/**
+ * @brief Switch the UART to zero-copy receive. The callbacks only count the
+ *        received bytes, the data stays in the DMA buffer and is read by
+ *        `uart_dmarx_peek` and `uart_dmarx_consume`. `uart_dmarx_read`
+ *        returns nothing in this mode. The data received before is dropped.
+ *
+ * @param huart The handle of UART.
+ * @param enable 1: zero-copy, 0: copy into the receive fifo.
+ * @return Switch message:
+ * @retval - 0: Success.
+ * @retval - 1: This uart not enable DMA Rx.
+ */
+uint8_t uart_dmarx_zero_copy(UART_HandleTypeDef *huart, uint8_t enable) {
+    uart_rx_fifo_t *uart_rx_fifo = uart_rx_identify(huart);
+    if (uart_rx_fifo == NULL) {
+        return 1;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uart_rx_fifo->zero_copy = enable ? 1 : 0;
+    uart_rx_fifo->tail_ptr = (huart->hdmarx == NULL)
+                                 ? uart_rx_fifo->head_ptr
+                                 : uart_dmarx_received(huart, uart_rx_fifo);
+    __set_PRIMASK(primask);
+
+    return 0;
+}
+
+/**
+ * @brief Get the received data not consumed, in the DMA buffer. The DMA
+ *        keeps writing, the data must be parsed and consumed before the
+ *        buffer wraps around onto it. If it has already, all the data is
+ *        dropped and counted in `span->lost`. Call from one context only.
+ *
+ * @param huart The handle of UART.
+ * @param[out] span The data, the second segment is at the start of the
+ *                  buffer when the data wraps around.
+ * @return The length of the data.
+ */
+uint32_t uart_dmarx_peek(UART_HandleTypeDef *huart, uart_rx_span_t *span) {
+    if (span == NULL) {
+        return 0;
+    }
+    memset(span, 0, sizeof(uart_rx_span_t));
+
+    uart_rx_fifo_t *uart_rx_fifo = uart_rx_identify(huart);
+    if ((uart_rx_fifo == NULL) || (huart->hdmarx == NULL) ||
+        (!uart_rx_fifo->zero_copy)) {
+        return 0;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t received = uart_dmarx_received(huart, uart_rx_fifo);
+    __set_PRIMASK(primask);
+
+    uint32_t size = huart->RxXferSize;
+    uint32_t count = received - uart_rx_fifo->tail_ptr;
+
+    if (count > size) {
+        span->lost = count;
+        uart_rx_fifo->tail_ptr = received;
+        return 0;
+    }
+
+    uint32_t offset = uart_rx_fifo->tail_ptr % size;
+    uint32_t first = size - offset;
+
+    span->data[0] = huart->pRxBuffPtr + offset;
+    span->len[0] = (count < first) ? count : first;
+    if (count > first) {
+        span->data[1] = huart->pRxBuffPtr;
+        span->len[1] = count - first;
+    }
+
+    return count;
+}
+
+/**
+ * @brief Release the data returned by `uart_dmarx_peek`.
+ *
+ * @param huart The handle of UART.
+ * @param len The length consumed, limited to the data received.
+ * @return Consume message:
+ * @retval - 0: Success.
+ * @retval - 1: This uart not enable DMA Rx or not in zero-copy mode.
+ * @retval - 2: The DMA has overwritten the data before it is consumed, the
+ *              result of parsing is invalid. All the data is dropped.
+ */
+uint8_t uart_dmarx_consume(UART_HandleTypeDef *huart, uint32_t len) {
+    uart_rx_fifo_t *uart_rx_fifo = uart_rx_identify(huart);
+    if ((uart_rx_fifo == NULL) || (huart->hdmarx == NULL) ||
+        (!uart_rx_fifo->zero_copy)) {
+        return 1;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t received = uart_dmarx_received(huart, uart_rx_fifo);
+    __set_PRIMASK(primask);
+
+    uint32_t count = received - uart_rx_fifo->tail_ptr;
+
+    if (count > (uint32_t)huart->RxXferSize) {
+        uart_rx_fifo->tail_ptr = received;
+        return 2;
+    }
+
+    uart_rx_fifo->tail_ptr += (len < count) ? len : count;
+
+    return 0;
+}
+
+/**
+ * @brief Set the callback called in the interrupt when data is received,
+ *        usually to parse with `uart_dmarx_peek` in zero-copy mode. The
+ *        IDLE and the DMA interrupts may nest if their priorities differ.
+ *
+ * @param huart The handle of UART.
+ * @param callback The callback, `NULL` to remove.
+ * @return Set message:
+ * @retval - 0: Success.
+ * @retval - 1: This uart not enable DMA Rx.
+ */
+uint8_t uart_dmarx_set_callback(UART_HandleTypeDef *huart,
+                                uart_rx_callback_t callback) {
+    uart_rx_fifo_t *uart_rx_fifo = uart_rx_identify(huart);
+    if (uart_rx_fifo == NULL) {
+        return 1;
+    }
+
+    uart_rx_fifo->callback = callback;
+
+    return 0;
+}
 /**
  * @}
  */
@@ -3450,12 +3803,203 @@ static inline uart_tx_buf_t *uart_tx_identify(UART_HandleTypeDef *huart) {
 }
 
 /**
- * @brief Write the transmit data to the buffer.
+ * @brief Size of the record in the ring, aligned to the header. There is at
+ *        least one byte after the data for the terminating null character
+ *        of `vsnprintf`.
+ *
+ * @param len Data length.
+ * @return Size of the record.
+ */
+static inline uint32_t uart_dmatx_record_size(uint32_t len) {
+    return (UART_TX_REC_HEAD + len + 2U) & ~1U;
+}
+
+/**
+ * @brief Reserve a record in the send ring, the data is contiguous. The
+ *        header is marked busy, DMA stops at the record until it is
+ *        committed. Records committed out of order are sent in order.
+ *
+ * @param tx_buf The send ring.
+ * @param len Data length to transmit.
+ * @return The data area of the record, `len + 1` bytes can be written. `NULL`
+ *         if the ring is full (the message is counted as dropped).
+ */
+static uint8_t *uart_dmatx_reserve(uart_tx_buf_t *tx_buf, uint32_t len) {
+    uint32_t size = uart_dmatx_record_size(len);
+    uint32_t buf_size = (uint32_t)tx_buf->buf_size & ~1U;
+    uint32_t offset;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if ((len >= UART_TX_REC_WRAP) || (tx_buf->send_buf == NULL)) {
+        ++tx_buf->stats.dropped;
+        __set_PRIMASK(primask);
+        return NULL;
+    }
+
+    uint32_t head = tx_buf->head_ptr;
+    uint32_t tail = tx_buf->tail_ptr;
+
+    if (head == tail) {
+        /* Empty and no DMA in progress, start from the beginning. */
+        head = tail = 0;
+        tx_buf->head_ptr = 0;
+        tx_buf->tail_ptr = 0;
+    }
+
+    /**
+     * head >= tail:                    head < tail:
+     * +-----------*******---------+    +*******-----------*******-+
+     * |           ^      ^        |    |       ^          ^       |
+     * |          tail   head      |    |      head       tail     |
+     * +---------------------------+    +--------------------------+
+     * The head never catches up the tail, equal means empty.
+     */
+    if ((head >= tail) && (buf_size - head >= size) &&
+        ((tail != 0) || (buf_size - head > size))) {
+        offset = head;
+    } else if ((head >= tail) && (tail > size)) {
+        if (buf_size - head >= UART_TX_REC_HEAD) {
+            *(uint16_t *)&tx_buf->send_buf[head] = UART_TX_REC_WRAP;
+        }
+        offset = 0;
+    } else if ((head < tail) && (tail - head > size)) {
+        offset = head;
+    } else {
+        ++tx_buf->stats.dropped;
+        __set_PRIMASK(primask);
+        return NULL;
+    }
+
+    *(uint16_t *)&tx_buf->send_buf[offset] = (uint16_t)(len | UART_TX_REC_BUSY);
+    head = offset + size;
+    tx_buf->head_ptr = (head == buf_size) ? 0 : head;
+
+    tx_buf->stats.queued = (tx_buf->head_ptr >= tail)
+                               ? tx_buf->head_ptr - tail
+                               : buf_size - tail + tx_buf->head_ptr;
+    if (tx_buf->stats.queued > tx_buf->stats.high_water) {
+        tx_buf->stats.high_water = tx_buf->stats.queued;
+    }
+
+    __set_PRIMASK(primask);
+
+    return &tx_buf->send_buf[offset + UART_TX_REC_HEAD];
+}
+
+/**
+ * @brief Start the DMA of the next committed record if the UART is idle.
+ *        Called by the writers and the transfer complete interrupt. If the
+ *        HAL refuses to start (e.g. `HAL_BUSY`), the record is kept at the
+ *        tail and retried by the next kick.
+ *
+ * @param huart The handle of UART.
+ * @param tx_buf The send ring.
+ */
+static void uart_dmatx_kick(UART_HandleTypeDef *huart, uart_tx_buf_t *tx_buf) {
+    uint32_t buf_size = (uint32_t)tx_buf->buf_size & ~1U;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    while ((tx_buf->sending == 0) && (tx_buf->tail_ptr != tx_buf->head_ptr) &&
+           (huart->gState == HAL_UART_STATE_READY)) {
+        uint32_t tail = tx_buf->tail_ptr;
+        uint16_t header;
+
+        if ((buf_size - tail < UART_TX_REC_HEAD) ||
+            ((header = *(uint16_t *)&tx_buf->send_buf[tail]) ==
+             UART_TX_REC_WRAP)) {
+            tx_buf->tail_ptr = 0;
+            continue;
+        }
+
+        if (header & UART_TX_REC_BUSY) {
+            /* Not committed yet, the writer will start it. */
+            break;
+        }
+
+        if (header == 0) {
+            /* Nothing to send, skip the record. */
+            tx_buf->tail_ptr = tail + uart_dmatx_record_size(header);
+            continue;
+        }
+
+        tx_buf->sending = uart_dmatx_record_size(header);
+        if (HAL_UART_Transmit_DMA(huart,
+                                  &tx_buf->send_buf[tail + UART_TX_REC_HEAD],
+                                  header) != HAL_OK) {
+            /* Keep the record, retry by the next write or `uart_dmatx_send`. */
+            tx_buf->sending = 0;
+            ++tx_buf->stats.retried;
+            break;
+        }
+
+        ++tx_buf->stats.messages;
+    }
+
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief Commit the record reserved by `uart_dmatx_reserve`, and start the
+ *        DMA if the UART is idle.
+ *
+ * @param huart The handle of UART.
+ * @param tx_buf The send ring.
+ * @param data The data area of the record.
+ */
+static void uart_dmatx_commit(UART_HandleTypeDef *huart,
+                              uart_tx_buf_t *tx_buf, uint8_t *data) {
+    uint16_t *header = (uint16_t *)(data - UART_TX_REC_HEAD);
+
+    *header &= (uint16_t)~UART_TX_REC_BUSY;
+    uart_dmatx_kick(huart, tx_buf);
+}
+
+/**
+ * @brief DMA transmit complete callback, release the record sent and start
+ *        the next one. Needs the UART interrupt, the HAL sets the UART ready
+ *        in the TC interrupt after the DMA transfer.
+ *
+ * @param huart The handle of UART.
+ */
+static void uart_dmatx_done_callback(UART_HandleTypeDef *huart) {
+    uart_tx_buf_t *tx_buf = uart_tx_identify(huart);
+    if (tx_buf == NULL) {
+        return;
+    }
+
+    /* `sending` is 0 if the transfer was not started by the ring, the
+       messages written during it are started here. */
+    if (tx_buf->sending != 0) {
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        uint32_t buf_size = (uint32_t)tx_buf->buf_size & ~1U;
+        uint32_t tail = tx_buf->tail_ptr + tx_buf->sending;
+        uint32_t head = tx_buf->head_ptr;
+
+        tx_buf->tail_ptr = (tail >= buf_size) ? 0 : tail;
+        tx_buf->sending = 0;
+        tx_buf->stats.queued = (head >= tx_buf->tail_ptr)
+                                   ? head - tx_buf->tail_ptr
+                                   : buf_size - tx_buf->tail_ptr + head;
+        __set_PRIMASK(primask);
+    }
+
+    uart_dmatx_kick(huart, tx_buf);
+}
+
+/**
+ * @brief Write the transmit data to the send ring. The data is a message,
+ *        transmitted by DMA without calling `uart_dmatx_send`.
  *
  * @param huart The handle of UART.
  * @param data The data will be write.
  * @param len The data length will be written.
- * @return The length that be written.
+ * @return The length that be written, 0 if the ring is full (the data is
+ *         dropped).
  */
 uint32_t uart_dmatx_write(UART_HandleTypeDef *huart, const void *data,
                           size_t len) {
@@ -3464,33 +4008,29 @@ uint32_t uart_dmatx_write(UART_HandleTypeDef *huart, const void *data,
     }
 
     uart_tx_buf_t *send_tx_buf = uart_tx_identify(huart);
-    if (send_tx_buf == NULL) {
+    if ((send_tx_buf == NULL) || (huart->hdmatx == NULL)) {
         return 0;
     }
 
-    /* Get the remain length of buffer. */
-    uint32_t buf_remain = send_tx_buf->buf_size - send_tx_buf->head_ptr;
-
-    /* Prevent overflow. */
-    if (buf_remain < len) {
-        memcpy(send_tx_buf->send_buf + send_tx_buf->head_ptr, data, buf_remain);
-        send_tx_buf->head_ptr += buf_remain;
-        return buf_remain;
-    } else {
-        memcpy(send_tx_buf->send_buf + send_tx_buf->head_ptr, data, len);
-        send_tx_buf->head_ptr += len;
-        return len;
+    uint8_t *record = uart_dmatx_reserve(send_tx_buf, len);
+    if (record == NULL) {
+        return 0;
     }
+
+    memcpy(record, data, len);
+    uart_dmatx_commit(huart, send_tx_buf, record);
+
+    return len;
 }
 
 /**
- * @brief Transmit the data in the buf.
+ * @brief Start the transmission of the send ring if it is stopped. The
+ *        messages are transmitted by the transfer complete interrupt, this
+ *        is only needed if the UART was busy by other transfers (e.g.
+ *        `HAL_UART_Transmit_DMA`) when the message was written.
  *
  * @param huart The handle of UART.
- * @return The length which is succeed transmitted.
- * @note If you want transmit data, using `uart_dmatx_write` before.
- *       If you have huge continous data to transmit, we recommand use
- *       `HAL_UART_Transmit_DMA()`.
+ * @return The length not transmitted in the ring, include record headers.
  */
 uint32_t uart_dmatx_send(UART_HandleTypeDef *huart) {
     uart_tx_buf_t *send_tx_buf = uart_tx_identify(huart);
@@ -3502,18 +4042,32 @@ uint32_t uart_dmatx_send(UART_HandleTypeDef *huart) {
         return 0;
     }
 
-    uint32_t len = send_tx_buf->head_ptr;
-    if (len == 0) {
-        return 0;
+    uart_dmatx_kick(huart, send_tx_buf);
+    return send_tx_buf->stats.queued;
+}
+
+/**
+ * @brief Get the statistics of the send ring.
+ *
+ * @param huart The handle of UART.
+ * @param[out] stats The statistics.
+ * @return Get status:
+ * @retval - 0: Success.
+ * @retval - 1: This uart not enable DMA Tx, or `stats` is `NULL`.
+ */
+uint8_t uart_dmatx_get_stats(UART_HandleTypeDef *huart,
+                             uart_tx_stats_t *stats) {
+    uart_tx_buf_t *send_tx_buf = uart_tx_identify(huart);
+    if ((send_tx_buf == NULL) || (stats == NULL)) {
+        return 1;
     }
 
-    /* Wait for last transfer end. */
-    while (__HAL_UART_GET_FLAG(huart, UART_FLAG_TC) == RESET)
-        ;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *stats = send_tx_buf->stats;
+    __set_PRIMASK(primask);
 
-    HAL_UART_Transmit_DMA(huart, send_tx_buf->send_buf, (uint16_t)len);
-    send_tx_buf->head_ptr = 0;
-    return len;
+    return 0;
 }
 
 /**
@@ -3525,7 +4079,7 @@ uint32_t uart_dmatx_send(UART_HandleTypeDef *huart) {
  * @retval - 0: Success
  * @retval - 1: This uart not enable DMA Tx.
  * @retval - 2: No free memory to allocate.
- * @retval - 3: This uart is busy now.
+ * @retval - 3: This uart is busy now, the ring is not empty or sending.
  * @retval - 4: Parameter error, size can't be 0.
  */
 uint8_t uart_dmatx_resize_buf(UART_HandleTypeDef *huart, uint32_t size) {
@@ -3538,26 +4092,42 @@ uint8_t uart_dmatx_resize_buf(UART_HandleTypeDef *huart, uint32_t size) {
         return 1;
     }
 
-    if ((huart->gState) & (HAL_UART_STATE_BUSY_TX | HAL_UART_STATE_BUSY) &
-        ~HAL_UART_STATE_READY) {
-        /* The UART is busy. */
-        return 3;
-    }
-
     /* The UART is uninitialized, just adjust the size. */
     if (huart->hdmatx == NULL) {
         send_tx_buf->buf_size = size;
         return 0;
     }
 
-    uint8_t *new_ptr = CSP_REALLOC(send_tx_buf->send_buf, size);
+    /* Allocate outside, the ring is only swapped in the critical section
+       below, where no writer or DMA can use it. */
+    uint8_t *new_ptr = CSP_MALLOC(size);
 
     if (new_ptr == NULL) {
         return 2;
     }
 
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (((huart->gState) & (HAL_UART_STATE_BUSY_TX | HAL_UART_STATE_BUSY) &
+         ~HAL_UART_STATE_READY) ||
+        (send_tx_buf->sending != 0) ||
+        (send_tx_buf->head_ptr != send_tx_buf->tail_ptr)) {
+        /* The UART is busy, or a message is reserved or queued. */
+        __set_PRIMASK(primask);
+        CSP_FREE(new_ptr);
+        return 3;
+    }
+
+    uint8_t *old_ptr = send_tx_buf->send_buf;
     send_tx_buf->send_buf = new_ptr;
     send_tx_buf->buf_size = size;
+    send_tx_buf->head_ptr = 0;
+    send_tx_buf->tail_ptr = 0;
+
+    __set_PRIMASK(primask);
+
+    CSP_FREE(old_ptr);
 
     return 0;
 }
@@ -3643,6 +4213,17 @@ void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) {
 
 #if USE_HAL_UART_REGISTER_CALLBACKS == 0
 
+/**
+ * @brief Tx Transfer completed callbacks.
+ *
+ * @param huart The handle of UART.
+ */
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
+    if (huart->hdmatx != NULL) {
+        uart_dmatx_done_callback(huart);
+    }
+}
+
 /**
  * @brief Rx Transfer completed callbacks.
  *
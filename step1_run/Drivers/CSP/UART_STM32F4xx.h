@@ -32,6 +32,33 @@ extern "C" {
 #define UART_DEINIT_DMA_FAIL 2
 #define UART_NO_INIT         3
 
+/**
+ * @brief Statistics of the UART DMA send ring.
+ */
+typedef struct {
+    uint32_t queued;     /*!< Bytes in the ring now, include headers. */
+    uint32_t high_water; /*!< Maximum of `queued`.                    */
+    uint32_t messages;   /*!< Messages handed to the DMA.             */
+    uint32_t dropped;    /*!< Messages dropped, the ring is full.     */
+    uint32_t retried;    /*!< DMA start refused by HAL, kept to retry. */
+} uart_tx_stats_t;
+
+/**
+ * @brief Received data in the DMA buffer, two segments if it wraps around.
+ */
+typedef struct {
+    const uint8_t *data[2]; /*!< Start of the segments.                   */
+    uint32_t len[2];        /*!< Length of the segments, 0 if not used.   */
+    uint32_t lost;          /*!< Bytes overwritten by the DMA and dropped
+                                 since the last peek.                     */
+} uart_rx_span_t;
+
+/**
+ * @brief Called in the interrupt after the received count is updated, by
+ *        the IDLE, DMA half and DMA complete callbacks.
+ */
+typedef void (*uart_rx_callback_t)(UART_HandleTypeDef *huart);
+
 /**
  * @}
  */
@@ -771,10 +798,17 @@ uint8_t uart_dmarx_resize_fifo(UART_HandleTypeDef *huart, uint32_t buf_size,
                                uint32_t fifo_size);
 uint32_t uart_dmarx_get_buf_size(UART_HandleTypeDef *huart);
 uint32_t uart_dmarx_get_fifo_size(UART_HandleTypeDef *huart);
+uint8_t uart_dmarx_zero_copy(UART_HandleTypeDef *huart, uint8_t enable);
+uint32_t uart_dmarx_peek(UART_HandleTypeDef *huart, uart_rx_span_t *span);
+uint8_t uart_dmarx_consume(UART_HandleTypeDef *huart, uint32_t len);
+uint8_t uart_dmarx_set_callback(UART_HandleTypeDef *huart,
+                                uart_rx_callback_t callback);
 
 uint32_t uart_dmatx_write(UART_HandleTypeDef *huart, const void *data,
                           size_t len);
 uint32_t uart_dmatx_send(UART_HandleTypeDef *huart);
+uint8_t uart_dmatx_get_stats(UART_HandleTypeDef *huart,
+                             uart_tx_stats_t *stats);
 uint8_t uart_dmatx_resize_buf(UART_HandleTypeDef *huart, uint32_t size);
 uint32_t uart_damtx_get_buf_szie(UART_HandleTypeDef *huart);
 
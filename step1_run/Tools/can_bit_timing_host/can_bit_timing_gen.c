@@ -0,0 +1,131 @@
+/**
+ * @file    can_bit_timing_gen.c
+ * @author  Deadline039
+ * @brief   Generate the precomputed bit timing of the CAN CSP on the host.
+ * @version 1.0
+ * @date    2024-12-05
+ * @note    Run `can_bit_timing_solve` with the bxCAN limits, print the ranked
+ *          candidates and the macros used by `canx_init` without search.
+ *
+ *          Usage: can_bit_timing_gen [-c clock] [-r rate] [-s sample]
+ *                 [-w range] [-p delay] [-e error] [-l list] [-n name]
+ */
+
+#include "can_bit_timing/can_bit_timing.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define GEN_MAX_LIST 64
+
+/**
+ * @brief Print the usage.
+ *
+ * @param name Program name.
+ */
+static void gen_usage(const char *name) {
+    fprintf(stderr,
+            "Usage: %s [-c clock] [-r rate] [-s sample] [-w range] "
+            "[-p delay] [-e error] [-l list] [-n name]\n"
+            "  -c  CAN clock (APB1), Hz. Default 45000000\n"
+            "  -r  Bit rate, bps. Default 1000000\n"
+            "  -s  Sample point target, permille. Default 875\n"
+            "  -w  Sample point range, permille. Default 25\n"
+            "  -p  Propagation delay one way, ns. Default 350\n"
+            "  -e  Bit rate error accepted, ppm. Default 0\n"
+            "  -l  Candidates listed, %d at most. Default 10\n"
+            "  -n  Macro prefix. Default CAN1\n",
+            name, GEN_MAX_LIST);
+}
+
+int main(int argc, char *argv[]) {
+    static const can_bit_timing_limit_t limit = CAN_BIT_TIMING_BXCAN;
+    static can_bit_timing_t result[GEN_MAX_LIST];
+    can_bit_timing_config_t config = {.clock = 45000000,
+                                      .bit_rate = 1000000,
+                                      .sample_point = 875,
+                                      .sample_range = 25,
+                                      .prop_delay = 350,
+                                      .rate_error = 0,
+                                      .limit = &limit};
+    uint32_t list = 10;
+    const char *name = "CAN1";
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:r:s:w:p:e:l:n:h")) != -1) {
+        switch (opt) {
+            case 'c': {
+                config.clock = (uint32_t)strtoul(optarg, NULL, 0);
+            } break;
+
+            case 'r': {
+                config.bit_rate = (uint32_t)strtoul(optarg, NULL, 0);
+            } break;
+
+            case 's': {
+                config.sample_point = (uint32_t)strtoul(optarg, NULL, 0);
+            } break;
+
+            case 'w': {
+                config.sample_range = (uint32_t)strtoul(optarg, NULL, 0);
+            } break;
+
+            case 'p': {
+                config.prop_delay = (uint32_t)strtoul(optarg, NULL, 0);
+            } break;
+
+            case 'e': {
+                config.rate_error = (uint32_t)strtoul(optarg, NULL, 0);
+            } break;
+
+            case 'l': {
+                list = (uint32_t)strtoul(optarg, NULL, 0);
+            } break;
+
+            case 'n': {
+                name = optarg;
+            } break;
+
+            default: {
+                gen_usage(argv[0]);
+                return 1;
+            }
+        }
+    }
+
+    if ((list == 0) || (list > GEN_MAX_LIST)) {
+        gen_usage(argv[0]);
+        return 1;
+    }
+
+    uint32_t count = can_bit_timing_solve(&config, result, list);
+    if (count == 0) {
+        fprintf(stderr, "No bit timing for %u bps at %u Hz.\n",
+                config.bit_rate, config.clock);
+        return 1;
+    }
+
+    printf("/* %u Hz, %u bps, sample point %u +- %u, propagation %u ns\n",
+           config.clock, config.bit_rate, config.sample_point,
+           config.sample_range, config.prop_delay);
+    printf("   rank   brp  tq  bs1  bs2  sjw  prop  sample  error/ppm  "
+           "tolerance/ppm\n");
+    for (uint32_t i = 0; i < count; ++i) {
+        const can_bit_timing_t *t = &result[i];
+        printf("   %4u  %4u  %2u  %3u  %3u  %3u  %4u  %6u  %9d  %13u\n", i + 1,
+               t->prescale, t->tq_per_bit, t->tseg1, t->tseg2, t->sjw,
+               t->prop_seg, t->sample_point, t->rate_error, t->tolerance);
+    }
+    printf("*/\n");
+
+    const can_bit_timing_t *best = &result[0];
+    printf("#define %s_BIT_TIMING_CLOCK    %u\n", name, config.clock);
+    printf("#define %s_BIT_TIMING_RATE     %u\n", name, config.bit_rate);
+    printf("#define %s_BIT_TIMING_PRESCALE %u\n", name, best->prescale);
+    printf("#define %s_BIT_TIMING_TSEG1    %u\n", name, best->tseg1);
+    printf("#define %s_BIT_TIMING_TSEG2    %u\n", name, best->tseg2);
+    printf("#define %s_BIT_TIMING_SJW      %u\n", name, best->sjw);
+
+    return 0;
+}
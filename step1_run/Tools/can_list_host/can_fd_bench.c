@@ -0,0 +1,243 @@
+/**
+ * @file    can_fd_bench.c
+ * @author  Deadline039
+ * @brief   Classic CAN and CAN FD bus time of the motor control cycle.
+ * @version 1.0
+ * @date    2024-12-07
+ * @note    Each motor needs `-p` bytes per cycle. Classic CAN sends one frame
+ *          per motor, CAN FD packs the motors into 64-byte frames, with and
+ *          without bit rate switch. The bus time is bit exact for the random
+ *          payload, then the aggregate frames are dispatched by can_list in
+ *          the simulator to compare the receive cost per motor.
+ *
+ *          Usage: can_fd_bench [-n nominal_bps] [-d data_bps] [-p bytes]
+ *                              [-c cycles]
+ */
+
+#include "can_sim.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+static const uint32_t motor_sweep[] = {1, 2, 4, 8, 16, 32};
+
+#define BENCH_MOTOR_MAX 32
+#define BENCH_BASE_ID   0x100
+
+/**
+ * @brief Benchmark options.
+ */
+typedef struct {
+    uint32_t nominal_rate; /*!< Nominal bit rate, bps.              */
+    uint32_t data_rate;    /*!< Data bit rate of the BRS frame.     */
+    uint32_t payload;      /*!< Bytes per motor, 8 at most.         */
+    uint32_t cycles;       /*!< Control cycles of each case.        */
+} bench_option_t;
+
+/**
+ * @brief Mode of the control cycle.
+ */
+typedef enum {
+    bench_classic = 0, /*!< One classic frame per motor.        */
+    bench_fd,          /*!< Aggregate FD frames, no BRS.        */
+    bench_fd_brs       /*!< Aggregate FD frames with BRS.       */
+} bench_mode_t;
+
+static volatile uint32_t bench_sink;
+static uint32_t bench_payload;
+
+/**
+ * @brief Callback of the classic frame, one motor.
+ */
+static void bench_classic_callback(void *node_obj,
+                                   can_rx_header_t *can_rx_header,
+                                   uint8_t *can_msg) {
+    UNUSED(node_obj);
+    bench_sink += can_rx_header->id + can_msg[0] + can_msg[7];
+}
+
+/**
+ * @brief Callback of the aggregate frame, walk the motors in the payload.
+ */
+static void bench_fd_callback(void *node_obj, can_rx_header_t *can_rx_header,
+                              uint8_t *can_msg) {
+    UNUSED(node_obj);
+
+    for (uint32_t i = 0; i + bench_payload <= can_rx_header->data_length;
+         i += bench_payload) {
+        bench_sink += can_msg[i] + can_msg[i + bench_payload - 1];
+    }
+}
+
+/**
+ * @brief Fill random bytes.
+ */
+static void bench_random(uint8_t *data, uint32_t len) {
+    for (uint32_t i = 0; i < len; ++i) {
+        data[i] = (uint8_t)rand();
+    }
+}
+
+/**
+ * @brief Frames of a control cycle.
+ *
+ * @param option Benchmark options.
+ * @param mode Cycle mode.
+ * @param motors Motor number.
+ * @return Frames.
+ */
+static uint32_t bench_frames(const bench_option_t *option, bench_mode_t mode,
+                             uint32_t motors) {
+    uint32_t per_frame = CAN_FRAME_MAX_LEN / option->payload;
+
+    if (mode == bench_classic) {
+        return motors;
+    }
+
+    return (motors + per_frame - 1) / per_frame;
+}
+
+/**
+ * @brief Run one case, print the bus time and the dispatch cost.
+ *
+ * @param option Benchmark options.
+ * @param mode Cycle mode.
+ * @param motors Motor number.
+ * @return 0 if success.
+ */
+static int bench_run(const bench_option_t *option, bench_mode_t mode,
+                     uint32_t motors) {
+    static const char *const mode_name[] = {"classic", "fd", "fd+brs"};
+    static can_sim_t sim;
+    uint32_t frames = bench_frames(option, mode, motors);
+    uint32_t per_frame = (mode == bench_classic)
+                             ? 1
+                             : CAN_FRAME_MAX_LEN / option->payload;
+    uint8_t flags = (mode == bench_classic) ? 0
+                    : (mode == bench_fd)    ? CAN_FRAME_FD
+                                            : (CAN_FRAME_FD | CAN_FRAME_BRS);
+    uint8_t data[CAN_FRAME_MAX_LEN];
+    uint64_t bus_ns = 0;
+    uint64_t cpu_ns = 0;
+    uint32_t stuff = 0;
+
+    can_sim_init(&sim, can1_selected);
+    for (uint32_t i = 0; i < frames; ++i) {
+        if (can_list_add_new_node(
+                can1_selected, NULL, BENCH_BASE_ID + i, 0x7FF, CAN_ID_STD,
+                (mode == bench_classic) ? bench_classic_callback
+                                        : bench_fd_callback) != 0) {
+            return 1;
+        }
+    }
+
+    for (uint32_t c = 0; c < option->cycles; ++c) {
+        for (uint32_t i = 0; i < frames; ++i) {
+            uint32_t count = motors - i * per_frame;
+            uint32_t len;
+            can_sim_bits_t bits;
+
+            if (count > per_frame) {
+                count = per_frame;
+            }
+            len = can_sim_fd_len((uint8_t)(count * option->payload));
+
+            memset(data, 0, sizeof(data));
+            bench_random(data, count * option->payload);
+            can_sim_frame_bits(CAN_ID_STD, BENCH_BASE_ID + i, flags,
+                               (uint8_t)len, data, &bits);
+            bus_ns += can_sim_frame_time_ns(&bits, option->nominal_rate,
+                                            option->data_rate);
+            stuff += bits.stuff;
+
+            can_sim_inject_fd(&sim, CAN_RX_FIFO0, BENCH_BASE_ID + i,
+                              CAN_ID_STD, flags, (uint8_t)len, data);
+            uint32_t start = can_sim_timestamp();
+            can_sim_irq(&sim, CAN_RX_FIFO0);
+            cpu_ns += can_sim_timestamp() - start;
+        }
+    }
+
+    double cycle_us = (double)bus_ns / option->cycles / 1000.0;
+
+    printf("%6u  %-7s %6u %10.2f %11.0f %9.1f %9.1f\n", motors,
+           mode_name[mode], frames, cycle_us, 1e6 / cycle_us,
+           (double)stuff / option->cycles / frames,
+           (double)cpu_ns / option->cycles / motors);
+
+    for (uint32_t i = 0; i < frames; ++i) {
+        can_list_del_node_by_id(can1_selected, CAN_ID_STD, BENCH_BASE_ID + i);
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    bench_option_t option = {.nominal_rate = 1000000,
+                             .data_rate = 5000000,
+                             .payload = 8,
+                             .cycles = 10000};
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:d:p:c:h")) != -1) {
+        switch (opt) {
+            case 'n': {
+                option.nominal_rate = (uint32_t)strtoul(optarg, NULL, 0);
+            } break;
+
+            case 'd': {
+                option.data_rate = (uint32_t)strtoul(optarg, NULL, 0);
+            } break;
+
+            case 'p': {
+                option.payload = (uint32_t)strtoul(optarg, NULL, 0);
+            } break;
+
+            case 'c': {
+                option.cycles = (uint32_t)strtoul(optarg, NULL, 0);
+            } break;
+
+            default: {
+                option.cycles = 0;
+            } break;
+        }
+    }
+
+    if ((option.nominal_rate == 0) || (option.data_rate == 0) ||
+        (option.payload == 0) || (option.payload > 8) ||
+        (option.cycles == 0)) {
+        fprintf(stderr,
+                "Usage: %s [-n nominal_bps] [-d data_bps] [-p bytes] "
+                "[-c cycles]\n",
+                argv[0]);
+        return 1;
+    }
+
+    if (can_list_add_can(can1_selected, 16, 1) != 0) {
+        return 1;
+    }
+
+    bench_payload = option.payload;
+    srand(1);
+    printf("nominal %u bps, data %u bps, %u bytes per motor, %u cycles\n",
+           option.nominal_rate, option.data_rate, option.payload,
+           option.cycles);
+    printf("motors  mode    frames   cycle/us  max_rate/Hz "
+           "stuff/frm  rx/motor/ns\n");
+
+    for (uint32_t i = 0; i < sizeof(motor_sweep) / sizeof(motor_sweep[0]);
+         ++i) {
+        if (motor_sweep[i] > BENCH_MOTOR_MAX) {
+            break;
+        }
+
+        for (uint32_t mode = bench_classic; mode <= bench_fd_brs; ++mode) {
+            if (bench_run(&option, (bench_mode_t)mode, motor_sweep[i]) != 0) {
+                fprintf(stderr, "motors %u failed.\n", motor_sweep[i]);
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,244 @@
+/**
+ * @file    can_list_bench.c
+ * @author  Deadline039
+ * @brief   Dispatch benchmark of can_list on the host.
+ * @version 1.0
+ * @date    2024-11-24
+ * @note    Sweep the node number and the standard ID hash table length, each
+ *          configuration runs in a child process, so the CAN table starts
+ *          empty and the heap is counted from zero.
+ *
+ *          Usage: can_list_bench [-n frames] [-r rate_hz] [-d uniform|hot]
+ *                                [-u unmatched_percent]
+ */
+
+#include "can_sim.h"
+
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static const uint32_t node_sweep[] = {1, 4, 16, 64, 256};
+static const uint32_t len_sweep[] = {1, 4, 16, 64};
+
+/**
+ * @brief Benchmark options.
+ */
+typedef struct {
+    uint32_t frames;        /*!< Frames of each configuration.  */
+    uint32_t rate_hz;       /*!< Frame rate on the bus.         */
+    can_sim_dist_t dist;    /*!< ID distribution.               */
+    uint32_t unmatched_pct; /*!< Percent of unmatched frames.   */
+} bench_option_t;
+
+static volatile uint32_t bench_sink;
+
+/**
+ * @brief Callback of the nodes, touch the data like a real decoder.
+ *
+ * @param node_obj Node data.
+ * @param can_rx_header CAN message rx header.
+ * @param can_msg CAN message data.
+ */
+static void bench_callback(void *node_obj, can_rx_header_t *can_rx_header,
+                           uint8_t *can_msg) {
+    UNUSED(node_obj);
+    bench_sink += can_rx_header->id + can_msg[0] + can_msg[7];
+}
+
+/**
+ * @brief Compare function of `qsort`.
+ */
+static int bench_compare(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Get the percentile of the sorted samples.
+ *
+ * @param samples Sorted samples.
+ * @param count Number of samples.
+ * @param permille Percentile in permille.
+ * @return The sample.
+ */
+static uint32_t bench_percentile(const uint32_t *samples, uint32_t count,
+                                 uint32_t permille) {
+    uint64_t index = (uint64_t)count * permille / 1000;
+    if (index >= count) {
+        index = count - 1;
+    }
+
+    return samples[index];
+}
+
+/**
+ * @brief Run one configuration and print the result, in the child process.
+ *
+ * @param option Benchmark options.
+ * @param nodes Node number.
+ * @param std_len Standard ID hash table length.
+ * @return 0 if success.
+ */
+static int bench_run(const bench_option_t *option, uint32_t nodes,
+                     uint32_t std_len) {
+    static can_sim_t sim;
+    uint32_t *ids = malloc(nodes * sizeof(uint32_t));
+    uint32_t *samples = malloc(option->frames * sizeof(uint32_t));
+    uint8_t data[8] = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88};
+    can_sim_traffic_t traffic;
+    uint64_t total = 0;
+
+    if (ids == NULL || samples == NULL) {
+        return 1;
+    }
+
+    can_sim_init(&sim, can1_selected);
+    if (can_list_add_can(can1_selected, std_len, 1) != 0) {
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < nodes; ++i) {
+        ids[i] = 0x100 + i;
+        if (can_list_add_new_node(can1_selected, NULL, ids[i], 0x7FF,
+                                  CAN_ID_STD, bench_callback) != 0) {
+            return 1;
+        }
+    }
+
+    can_sim_traffic_init(&traffic, ids, nodes, option->dist,
+                         option->unmatched_pct, option->rate_hz);
+
+    for (uint32_t i = 0; i < option->frames; ++i) {
+        can_sim_inject(&sim, CAN_RX_FIFO0, can_sim_traffic_next(&traffic),
+                       CAN_ID_STD, 8, data);
+
+        uint32_t start = can_sim_timestamp();
+        can_sim_irq(&sim, CAN_RX_FIFO0);
+        samples[i] = can_sim_timestamp() - start;
+        total += samples[i];
+    }
+
+    qsort(samples, option->frames, sizeof(uint32_t), bench_compare);
+
+    double mean = (double)total / option->frames;
+    /* Busy time of the receive interrupt at the given frame rate. */
+    double load = mean * option->rate_hz / 1e7;
+
+    can_list_bus_stats_t stats;
+    can_list_get_bus_stats(can1_selected, &stats);
+
+    printf("%5u %5u %9.1f %7u %7u %7u %7u %8zu %7.3f%% %9u\n", nodes, std_len,
+           mean, bench_percentile(samples, option->frames, 500),
+           bench_percentile(samples, option->frames, 990),
+           bench_percentile(samples, option->frames, 999),
+           samples[option->frames - 1], can_sim_heap_peak(), load,
+           stats.rx_unmatched);
+
+    free(samples);
+    free(ids);
+
+    return 0;
+}
+
+/**
+ * @brief Parse the command line.
+ *
+ * @param argc Argument count.
+ * @param argv Arguments.
+ * @param[out] option Benchmark options.
+ * @return 0 if success.
+ */
+static int bench_parse(int argc, char *argv[], bench_option_t *option) {
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:d:u:h")) != -1) {
+        switch (opt) {
+            case 'n': {
+                option->frames = (uint32_t)strtoul(optarg, NULL, 0);
+            } break;
+
+            case 'r': {
+                option->rate_hz = (uint32_t)strtoul(optarg, NULL, 0);
+            } break;
+
+            case 'd': {
+                if (strcmp(optarg, "uniform") == 0) {
+                    option->dist = can_sim_dist_uniform;
+                } else if (strcmp(optarg, "hot") == 0) {
+                    option->dist = can_sim_dist_hot;
+                } else {
+                    return 1;
+                }
+            } break;
+
+            case 'u': {
+                option->unmatched_pct = (uint32_t)strtoul(optarg, NULL, 0);
+            } break;
+
+            default: {
+                return 1;
+            }
+        }
+    }
+
+    if (option->frames == 0 || option->rate_hz == 0 ||
+        option->unmatched_pct > 100) {
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    bench_option_t option = {.frames = 100000,
+                             .rate_hz = 8000,
+                             .dist = can_sim_dist_uniform,
+                             .unmatched_pct = 0};
+
+    if (bench_parse(argc, argv, &option) != 0) {
+        fprintf(stderr,
+                "Usage: %s [-n frames] [-r rate_hz] [-d uniform|hot] "
+                "[-u unmatched_percent]\n",
+                argv[0]);
+        return 1;
+    }
+
+    printf("frames %u, rate %u Hz, %s, unmatched %u%%\n", option.frames,
+           option.rate_hz,
+           (option.dist == can_sim_dist_hot) ? "hot" : "uniform",
+           option.unmatched_pct);
+    printf("nodes   len   mean/ns  p50/ns  p99/ns p999/ns  max/ns heap/B "
+           "    load unmatched\n");
+
+    for (size_t i = 0; i < sizeof(node_sweep) / sizeof(node_sweep[0]); ++i) {
+        for (size_t j = 0; j < sizeof(len_sweep) / sizeof(len_sweep[0]);
+             ++j) {
+            fflush(stdout);
+
+            pid_t pid = fork();
+            if (pid < 0) {
+                perror("fork");
+                return 1;
+            }
+
+            if (pid == 0) {
+                int res = bench_run(&option, node_sweep[i], len_sweep[j]);
+                fflush(stdout);
+                _exit(res);
+            }
+
+            int status;
+            waitpid(pid, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                fprintf(stderr, "nodes %u, len %u failed.\n", node_sweep[i],
+                        len_sweep[j]);
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file    can_list_port_host.h
+ * @author  Deadline039
+ * @brief   Host replacement of the chip definitions used by can_list.
+ * @version 1.0
+ * @date    2024-11-24
+ * @note    Included by `can_list.h` instead of `CSP_Config.h` when
+ *          `CAN_LIST_PORT_HOST` is defined.
+ */
+
+#ifndef __CAN_LIST_PORT_HOST_H
+#define __CAN_LIST_PORT_HOST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef UNUSED
+#define UNUSED(x) ((void)(x))
+#endif /* UNUSED */
+
+/* Same value as the STM32 HAL. */
+#define CAN_ID_STD     0x00000000U
+#define CAN_ID_EXT     0x00000004U
+#define CAN_RTR_DATA   0x00000000U
+#define CAN_RTR_REMOTE 0x00000002U
+
+#define CAN_RX_FIFO0   0x00000000U
+#define CAN_RX_FIFO1   0x00000001U
+
+/* Same value as the CSP, the simulator is FD capable. */
+#define CAN_FRAME_FD      0x01U
+#define CAN_FRAME_BRS     0x02U
+#define CAN_FRAME_MAX_LEN 64
+
+/**
+ * @brief Select which CAN will be used.
+ */
+typedef enum {
+    can1_selected = 0U, /*!< Select CAN1 */
+    can2_selected,      /*!< Select CAN2 */
+    can3_selected       /*!< Select CAN3 */
+} can_selected_t;
+
+/* Memory of can_list is counted by the simulator. */
+#define CAN_LIST_MALLOC(p)       can_sim_malloc(p)
+#define CAN_LIST_CALLOC(x, p)    can_sim_calloc(x, p)
+#define CAN_LIST_FREE(p)         can_sim_free(p)
+
+/* Timestamp in nanoseconds of the host monotonic clock. */
+#define CAN_LIST_TIMESTAMP_INIT()
+#define CAN_LIST_GET_TIMESTAMP() can_sim_timestamp()
+
+void *can_sim_malloc(size_t size);
+void *can_sim_calloc(size_t num, size_t size);
+void can_sim_free(void *ptr);
+uint32_t can_sim_timestamp(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __CAN_LIST_PORT_HOST_H */
@@ -0,0 +1,633 @@
+/**
+ * @file    can_sim.c
+ * @author  Deadline039
+ * @brief   Simulated bxCAN on the host, the host port of can_list.
+ * @version 1.0
+ * @date    2024-11-24
+ */
+
+#include "can_list/can_list_port.h"
+
+#include <time.h>
+
+/* Registered simulators, used by `can_list_port_get_error`. */
+static can_sim_t *can_sim_instance[CAN_LIST_MAX_CAN_NUMBER];
+
+volatile uint8_t can_sim_in_irq;
+
+/*****************************************************************************
+ * @defgroup Memory and time.
+ * @{
+ */
+
+static size_t can_sim_heap_bytes;
+static size_t can_sim_heap_max;
+
+/* Size prefix of each block, keep the alignment of `malloc`. */
+typedef union {
+    size_t size;
+    max_align_t align;
+} can_sim_block_t;
+
+/**
+ * @brief Allocate memory and count the size.
+ *
+ * @param size Bytes to allocate.
+ * @return The memory, `NULL` if failed.
+ */
+void *can_sim_malloc(size_t size) {
+    can_sim_block_t *block = malloc(sizeof(can_sim_block_t) + size);
+    if (block == NULL) {
+        return NULL;
+    }
+
+    block->size = size;
+    can_sim_heap_bytes += size;
+    if (can_sim_heap_bytes > can_sim_heap_max) {
+        can_sim_heap_max = can_sim_heap_bytes;
+    }
+
+    return block + 1;
+}
+
+/**
+ * @brief Allocate zeroed memory and count the size.
+ *
+ * @param num Number of elements.
+ * @param size Size of each element.
+ * @return The memory, `NULL` if failed.
+ */
+void *can_sim_calloc(size_t num, size_t size) {
+    void *ptr = can_sim_malloc(num * size);
+    if (ptr != NULL) {
+        memset(ptr, 0, num * size);
+    }
+
+    return ptr;
+}
+
+/**
+ * @brief Free the memory allocated by `can_sim_malloc`.
+ *
+ * @param ptr The memory.
+ */
+void can_sim_free(void *ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+
+    can_sim_block_t *block = (can_sim_block_t *)ptr - 1;
+    can_sim_heap_bytes -= block->size;
+    free(block);
+}
+
+/**
+ * @brief Get the bytes allocated by can_list now.
+ *
+ * @return Bytes allocated.
+ */
+size_t can_sim_heap_used(void) {
+    return can_sim_heap_bytes;
+}
+
+/**
+ * @brief Get the peak bytes allocated by can_list.
+ *
+ * @return Peak bytes.
+ */
+size_t can_sim_heap_peak(void) {
+    return can_sim_heap_max;
+}
+
+/**
+ * @brief Get the timestamp, the host monotonic clock in nanoseconds.
+ *
+ * @return Timestamp, wraps like the DWT cycle counter.
+ */
+uint32_t can_sim_timestamp(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL +
+                      (uint64_t)ts.tv_nsec);
+}
+
+/**
+ * @}
+ */
+
+/*****************************************************************************
+ * @defgroup Port of can_list.
+ * @{
+ */
+
+/**
+ * @brief Specific which CAN had received message.
+ *
+ * @param hcan The simulated CAN.
+ * @return The index of CAN.
+ */
+uint8_t can_list_port_identify(can_list_handle_t *hcan) {
+    return (uint8_t)hcan->can_select;
+}
+
+/**
+ * @brief Read the oldest frame from the simulated FIFO.
+ *
+ * @param hcan The simulated CAN.
+ * @param rx_fifo Specific which FIFO will read.
+ * @param[out] header The header read.
+ * @param[out] data The data read.
+ * @return Read status:
+ * @retval - 0: Success.
+ * @retval - 1: The FIFO is empty.
+ */
+uint8_t can_list_port_read(can_list_handle_t *hcan, uint32_t rx_fifo,
+                           can_rx_header_t *header, uint8_t *data) {
+    can_sim_fifo_t *fifo = &hcan->fifo[rx_fifo & 1U];
+
+    if (fifo->level == 0) {
+        return 1;
+    }
+
+    can_sim_frame_t *frame = &fifo->frames[fifo->head];
+    *header = frame->header;
+    memcpy(data, frame->data, frame->header.data_length);
+
+    fifo->head = (fifo->head + 1) % CAN_SIM_FIFO_LEVEL;
+    --fifo->level;
+
+    return 0;
+}
+
+/**
+ * @brief Check and clear the overrun flag of the simulated FIFO.
+ *
+ * @param hcan The simulated CAN.
+ * @param rx_fifo Specific which FIFO will check.
+ * @return Whether the FIFO is overrun.
+ */
+uint8_t can_list_port_check_overrun(can_list_handle_t *hcan,
+                                    uint32_t rx_fifo) {
+    can_sim_fifo_t *fifo = &hcan->fifo[rx_fifo & 1U];
+    uint8_t overrun = fifo->overrun;
+
+    fifo->overrun = 0;
+
+    return overrun;
+}
+
+/**
+ * @brief Read the simulated error counters.
+ *
+ * @param can_select Specific which CAN to read.
+ * @param[out] stats The error counters.
+ */
+void can_list_port_get_error(can_selected_t can_select,
+                             can_list_bus_stats_t *stats) {
+    can_sim_t *sim = can_sim_instance[can_select];
+    if (sim == NULL) {
+        return;
+    }
+
+    stats->tx_error_count = sim->tx_error_count;
+    stats->rx_error_count = sim->rx_error_count;
+    stats->last_error_code = sim->last_error_code;
+}
+
+/**
+ * @brief Count the filters routing to FIFO0. The frames are injected with the
+ *        FIFO specified, so the filter is not simulated.
+ *
+ * @param can_select Specific which CAN.
+ * @param id_type `CAN_ID_STD` or `CAN_ID_EXT`.
+ * @param id The ID of the node.
+ * @param id_mask The ID mask of the node.
+ * @return 0: Success.
+ */
+uint8_t can_list_port_filter_add(can_selected_t can_select, uint32_t id_type,
+                                 uint32_t id, uint32_t id_mask) {
+    UNUSED(id_type);
+    UNUSED(id);
+    UNUSED(id_mask);
+
+    if (can_sim_instance[can_select] != NULL) {
+        ++can_sim_instance[can_select]->fifo0_filters;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Remove the filter added by `can_list_port_filter_add`.
+ *
+ * @param can_select Specific which CAN.
+ * @param id_type `CAN_ID_STD` or `CAN_ID_EXT`.
+ * @param id The ID of the node.
+ * @param id_mask The ID mask of the node.
+ */
+void can_list_port_filter_remove(can_selected_t can_select, uint32_t id_type,
+                                 uint32_t id, uint32_t id_mask) {
+    UNUSED(id_type);
+    UNUSED(id);
+    UNUSED(id_mask);
+
+    if (can_sim_instance[can_select] != NULL) {
+        --can_sim_instance[can_select]->fifo0_filters;
+    }
+}
+
+/**
+ * @}
+ */
+
+/*****************************************************************************
+ * @defgroup Simulated CAN.
+ * @{
+ */
+
+/**
+ * @brief Initialize the simulated CAN.
+ *
+ * @param sim The simulated CAN.
+ * @param can_select Which CAN it simulates.
+ */
+void can_sim_init(can_sim_t *sim, can_selected_t can_select) {
+    memset(sim, 0, sizeof(can_sim_t));
+    sim->can_select = can_select;
+    can_sim_instance[can_select] = sim;
+}
+
+/**
+ * @brief Put a classic frame into the FIFO, as the frame received from the
+ *        bus.
+ *
+ * @param sim The simulated CAN.
+ * @param rx_fifo Which FIFO the filter selected.
+ * @param id CAN ID.
+ * @param id_type `CAN_ID_STD` or `CAN_ID_EXT`.
+ * @param len Data length, 8 bytes at most.
+ * @param data The data.
+ * @return Inject status:
+ * @retval - 0: Success.
+ * @retval - 1: The FIFO is full, the newest frame is overwritten like
+ *              `ReceiveFifoLocked = DISABLE`.
+ */
+uint8_t can_sim_inject(can_sim_t *sim, uint32_t rx_fifo, uint32_t id,
+                       uint32_t id_type, uint8_t len, const uint8_t *data) {
+    return can_sim_inject_fd(sim, rx_fifo, id, id_type, 0,
+                             (len > 8) ? 8 : len, data);
+}
+
+/**
+ * @brief Put a classic or FD frame into the FIFO, as the frame received from
+ *        the bus.
+ *
+ * @param sim The simulated CAN.
+ * @param rx_fifo Which FIFO the filter selected.
+ * @param id CAN ID.
+ * @param id_type `CAN_ID_STD` or `CAN_ID_EXT`.
+ * @param flags `CAN_FRAME_FD`, `CAN_FRAME_BRS`.
+ * @param len Data length. 8 bytes at most for classic frame, rounded up to
+ *        the FD length for FD frame.
+ * @param data The data, the padding bytes are 0.
+ * @return Inject status, same as `can_sim_inject`.
+ */
+uint8_t can_sim_inject_fd(can_sim_t *sim, uint32_t rx_fifo, uint32_t id,
+                          uint32_t id_type, uint8_t flags, uint8_t len,
+                          const uint8_t *data) {
+    can_sim_fifo_t *fifo = &sim->fifo[rx_fifo & 1U];
+    uint8_t copy = len;
+    uint8_t res = 0;
+    uint32_t index;
+
+    if (flags & CAN_FRAME_FD) {
+        copy = (len > CAN_FRAME_MAX_LEN) ? CAN_FRAME_MAX_LEN : len;
+        len = can_sim_fd_len(copy);
+    } else {
+        flags = 0;
+        len = (len > 8) ? 8 : len;
+        copy = len;
+    }
+
+    if (fifo->level == CAN_SIM_FIFO_LEVEL) {
+        fifo->overrun = 1;
+        index = (fifo->head + CAN_SIM_FIFO_LEVEL - 1) % CAN_SIM_FIFO_LEVEL;
+        res = 1;
+    } else {
+        index = (fifo->head + fifo->level) % CAN_SIM_FIFO_LEVEL;
+        ++fifo->level;
+    }
+
+    can_sim_frame_t *frame = &fifo->frames[index];
+    frame->header.id = id;
+    frame->header.id_type = id_type;
+    frame->header.frame_type = CAN_RTR_DATA;
+    frame->header.data_length = len;
+    frame->header.flags = flags;
+    frame->header.timestamp = 0;
+    memset(frame->data, 0, sizeof(frame->data));
+    if (data != NULL) {
+        memcpy(frame->data, data, copy);
+    }
+
+    return res;
+}
+
+/**
+ * @brief The receive interrupt, process the frames until the FIFO is empty.
+ *
+ * @param sim The simulated CAN.
+ * @param rx_fifo Which FIFO is pending.
+ */
+void can_sim_irq(can_sim_t *sim, uint32_t rx_fifo) {
+    can_sim_in_irq++;
+    while (sim->fifo[rx_fifo & 1U].level != 0) {
+        can_list_rx_process(sim, rx_fifo);
+    }
+    can_sim_in_irq--;
+}
+
+/**
+ * @}
+ */
+
+/*****************************************************************************
+ * @defgroup Bus time.
+ * @{
+ */
+
+/* CRC delimiter, ACK slot, ACK delimiter, EOF and interframe space. */
+#define CAN_SIM_CLASSIC_TAIL_BITS 13
+/* ACK slot, ACK delimiter, EOF and interframe space, the CRC delimiter is
+   counted in the data phase. */
+#define CAN_SIM_FD_TAIL_BITS      12
+
+/**
+ * @brief Bit stream with bit stuffing, from SOF to the end of the stuffed
+ *        part.
+ */
+typedef struct {
+    uint32_t level;   /*!< Level of the last bit.                 */
+    uint32_t run;     /*!< Bits of the same level.                */
+    uint32_t crc;     /*!< CRC-15 of the classic frame.           */
+    uint32_t stuff;   /*!< Stuff bits inserted.                   */
+    uint32_t bits;    /*!< Bits include the stuff bits.           */
+} can_sim_stream_t;
+
+/**
+ * @brief Put bits into the stream, MSB first.
+ *
+ * @param stream The stream.
+ * @param value The bits.
+ * @param count Number of bits.
+ */
+static void can_sim_stream_put(can_sim_stream_t *stream, uint32_t value,
+                               uint32_t count) {
+    while (count-- > 0) {
+        uint32_t bit = (value >> count) & 1U;
+
+        if ((stream->crc ^ (bit << 14)) & 0x4000U) {
+            stream->crc = ((stream->crc << 1) ^ 0x4599U) & 0x7FFFU;
+        } else {
+            stream->crc = (stream->crc << 1) & 0x7FFFU;
+        }
+
+        if ((stream->bits > 0) && (bit == stream->level)) {
+            ++stream->run;
+        } else {
+            stream->level = bit;
+            stream->run = 1;
+        }
+        ++stream->bits;
+
+        if (stream->run == 5) {
+            /* Stuff bit of the opposite level, starts a new run. */
+            stream->level ^= 1U;
+            stream->run = 1;
+            ++stream->stuff;
+            ++stream->bits;
+        }
+    }
+}
+
+/**
+ * @brief Round the data length up to the FD length.
+ *
+ * @param len Data length.
+ * @return 0-8, 12, 16, 20, 24, 32, 48 or 64.
+ */
+uint8_t can_sim_fd_len(uint8_t len) {
+    static const uint8_t fd_len[] = {12, 16, 20, 24, 32, 48, 64};
+
+    if (len <= 8) {
+        return len;
+    }
+
+    for (uint32_t i = 0; i < sizeof(fd_len); ++i) {
+        if (len <= fd_len[i]) {
+            return fd_len[i];
+        }
+    }
+
+    return CAN_FRAME_MAX_LEN;
+}
+
+/**
+ * @brief Get the DLC of the data length.
+ *
+ * @param len Data length, rounded by `can_sim_fd_len`.
+ * @return The DLC.
+ */
+static uint32_t can_sim_len_to_dlc(uint8_t len) {
+    static const uint8_t fd_len[] = {12, 16, 20, 24, 32, 48, 64};
+
+    if (len <= 8) {
+        return len;
+    }
+
+    for (uint32_t i = 0; i < sizeof(fd_len); ++i) {
+        if (len == fd_len[i]) {
+            return 9 + i;
+        }
+    }
+
+    return 15;
+}
+
+/**
+ * @brief Count the bits of a data frame on the bus. Classic frames are bit
+ *        exact including the CRC. FD frames use the fixed stuff bits in the
+ *        CRC field, so the length does not depend on the CRC value.
+ *
+ * @param id_type `CAN_ID_STD` or `CAN_ID_EXT`.
+ * @param id CAN ID.
+ * @param flags `CAN_FRAME_FD`, `CAN_FRAME_BRS`.
+ * @param len Data length, rounded up to the FD length for FD frame.
+ * @param data The data, `NULL` for all 0.
+ * @param[out] bits The bits.
+ */
+void can_sim_frame_bits(uint32_t id_type, uint32_t id, uint8_t flags,
+                        uint8_t len, const uint8_t *data,
+                        can_sim_bits_t *bits) {
+    can_sim_stream_t stream = {0};
+    uint8_t fd = (flags & CAN_FRAME_FD) != 0;
+    uint32_t arbitration;
+
+    len = fd ? can_sim_fd_len(len) : ((len > 8) ? 8 : len);
+
+    can_sim_stream_put(&stream, 0, 1);
+    if (id_type == CAN_ID_STD) {
+        can_sim_stream_put(&stream, id & 0x7FFU, 11);
+        /* RTR (RRS of FD), IDE. */
+        can_sim_stream_put(&stream, 0, 2);
+    } else {
+        can_sim_stream_put(&stream, (id >> 18) & 0x7FFU, 11);
+        /* SRR, IDE. */
+        can_sim_stream_put(&stream, 3, 2);
+        can_sim_stream_put(&stream, id & 0x3FFFFU, 18);
+        /* RTR (RRS of FD), r1. */
+        can_sim_stream_put(&stream, 0, fd ? 1 : 2);
+    }
+
+    if (fd) {
+        /* FDF recessive, res, BRS. The bit rate switches after BRS. */
+        can_sim_stream_put(&stream, 2, 2);
+        can_sim_stream_put(&stream, (flags & CAN_FRAME_BRS) ? 1 : 0, 1);
+        arbitration = stream.bits;
+        /* ESI. */
+        can_sim_stream_put(&stream, 0, 1);
+    } else {
+        /* r0. */
+        can_sim_stream_put(&stream, 0, 1);
+        arbitration = 0;
+    }
+
+    can_sim_stream_put(&stream, can_sim_len_to_dlc(len), 4);
+    for (uint32_t i = 0; i < len; ++i) {
+        can_sim_stream_put(&stream, (data != NULL) ? data[i] : 0, 8);
+    }
+
+    if (fd == 0) {
+        can_sim_stream_put(&stream, stream.crc, 15);
+        bits->nominal = stream.bits + CAN_SIM_CLASSIC_TAIL_BITS;
+        bits->data = 0;
+        bits->stuff = stream.stuff;
+        return;
+    }
+
+    /* Stuff count and CRC-17 (CRC-21 above 16 bytes), with a fixed stuff
+       bit before the stuff count and after each 4 bits. */
+    uint32_t crc_field = 4 + ((len > 16) ? 21 : 17);
+    uint32_t fixed = 1 + crc_field / 4;
+    uint32_t data_phase = stream.bits - arbitration + crc_field + fixed + 1;
+
+    bits->stuff = stream.stuff + fixed;
+    if (flags & CAN_FRAME_BRS) {
+        bits->nominal = arbitration + CAN_SIM_FD_TAIL_BITS;
+        bits->data = data_phase;
+    } else {
+        bits->nominal = stream.bits + crc_field + fixed + 1 +
+                        CAN_SIM_FD_TAIL_BITS;
+        bits->data = 0;
+    }
+}
+
+/**
+ * @brief Get the time of a frame on the bus.
+ *
+ * @param bits Bits from `can_sim_frame_bits`.
+ * @param nominal_rate Nominal bit rate, bps.
+ * @param data_rate Data bit rate of the BRS frame, bps.
+ * @return Time, ns.
+ */
+uint64_t can_sim_frame_time_ns(const can_sim_bits_t *bits,
+                               uint32_t nominal_rate, uint32_t data_rate) {
+    uint64_t time = (uint64_t)bits->nominal * 1000000000ULL / nominal_rate;
+
+    if ((bits->data > 0) && (data_rate > 0)) {
+        time += (uint64_t)bits->data * 1000000000ULL / data_rate;
+    }
+
+    return time;
+}
+
+/**
+ * @}
+ */
+
+/*****************************************************************************
+ * @defgroup Traffic generator.
+ * @{
+ */
+
+/**
+ * @brief Next pseudo random number, xorshift32.
+ *
+ * @param seed The state.
+ * @return Random number.
+ */
+static inline uint32_t can_sim_random(uint32_t *seed) {
+    uint32_t x = *seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *seed = x;
+
+    return x;
+}
+
+/**
+ * @brief Initialize the traffic generator.
+ *
+ * @param traffic The generator.
+ * @param ids IDs registered in can_list.
+ * @param id_count Number of IDs.
+ * @param dist ID distribution.
+ * @param unmatched_pct Percent of frames whose ID is not registered.
+ * @param rate_hz Frame rate on the bus.
+ */
+void can_sim_traffic_init(can_sim_traffic_t *traffic, const uint32_t *ids,
+                          uint32_t id_count, can_sim_dist_t dist,
+                          uint32_t unmatched_pct, uint32_t rate_hz) {
+    traffic->ids = ids;
+    traffic->id_count = id_count;
+    traffic->dist = dist;
+    traffic->unmatched_pct = (unmatched_pct > 100) ? 100 : unmatched_pct;
+    traffic->rate_hz = (rate_hz == 0) ? 1 : rate_hz;
+    traffic->time_ns = 0;
+    traffic->seed = 0x2024B11DU;
+}
+
+/**
+ * @brief Get the ID of the next frame, and advance the simulated bus time.
+ *
+ * @param traffic The generator.
+ * @return The ID. The unmatched ID is `0x7FF`, which is never registered by
+ *         the benchmark.
+ */
+uint32_t can_sim_traffic_next(can_sim_traffic_t *traffic) {
+    uint32_t r = can_sim_random(&traffic->seed);
+    uint32_t count = traffic->id_count;
+
+    traffic->time_ns += 1000000000ULL / traffic->rate_hz;
+
+    if ((count == 0) || (r % 100 < traffic->unmatched_pct)) {
+        return 0x7FFU;
+    }
+
+    r = can_sim_random(&traffic->seed);
+
+    if (traffic->dist == can_sim_dist_hot) {
+        uint32_t hot = (count + 4) / 5;
+        if (r % 100 < 80) {
+            return traffic->ids[(r >> 8) % hot];
+        }
+    }
+
+    return traffic->ids[(r >> 8) % count];
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,169 @@
+/**
+ * @file    can_sim.h
+ * @author  Deadline039
+ * @brief   Simulated bxCAN on the host, the host port of can_list.
+ * @version 1.0
+ * @date    2024-11-24
+ * @note    Each simulated CAN has two 3-level receive FIFOs like bxCAN. The
+ *          frames are injected into the FIFO, then `can_sim_irq` acts as the
+ *          receive interrupt and calls `can_list_rx_process` until the FIFO is
+ *          empty. Unlike bxCAN, the simulator also receives FD frames, and
+ *          gives the bus time of classic and FD frames.
+ */
+
+#ifndef __CAN_SIM_H
+#define __CAN_SIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "can_list/can_list.h"
+
+#if CAN_LIST_USE_RTOS
+#error "The host port does not support CAN_LIST_USE_RTOS. "
+#endif /* CAN_LIST_USE_RTOS */
+
+/* Hardware FIFO level of bxCAN. */
+#define CAN_SIM_FIFO_LEVEL 3
+
+/**
+ * @brief Frame in the simulated FIFO.
+ */
+typedef struct {
+    can_rx_header_t header;          /*!< Frame header.  */
+    uint8_t data[CAN_FRAME_MAX_LEN]; /*!< Frame data.    */
+} can_sim_frame_t;
+
+/**
+ * @brief Receive FIFO of the simulated CAN.
+ */
+typedef struct {
+    can_sim_frame_t frames[CAN_SIM_FIFO_LEVEL]; /*!< FIFO mailboxes.      */
+    uint32_t head;                              /*!< Oldest frame index.  */
+    uint32_t level;                             /*!< Frames in the FIFO.  */
+    uint8_t overrun;                            /*!< FOVR flag.           */
+} can_sim_fifo_t;
+
+/**
+ * @brief Simulated CAN, used as `can_list_handle_t`.
+ */
+typedef struct can_sim {
+    can_selected_t can_select; /*!< Which CAN this is.            */
+    can_sim_fifo_t fifo[2];    /*!< FIFO0 and FIFO1.              */
+    uint8_t tx_error_count;    /*!< Simulated TEC.                */
+    uint8_t rx_error_count;    /*!< Simulated REC.                */
+    uint8_t last_error_code;   /*!< Simulated LEC.                */
+    uint32_t fifo0_filters;    /*!< Filters routing to FIFO0.     */
+} can_sim_t;
+
+typedef can_sim_t can_list_handle_t;
+
+#define CAN_LIST_DATA_SIZE CAN_FRAME_MAX_LEN
+#define CAN_LIST_RX_ID_STD CAN_ID_STD
+#define CAN_LIST_RX_FIFO0  CAN_RX_FIFO0
+#define CAN_LIST_DMB()     __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define CAN_LIST_IN_ISR()  (can_sim_in_irq != 0U)
+
+/* Set while `can_sim_irq` is running, stands for the IPSR. */
+extern volatile uint8_t can_sim_in_irq;
+
+/**
+ * @brief Atomic add, same as the LDREX/STREX loop of the MCU port.
+ *
+ * @param ptr The variable to add.
+ * @param value The value to add, `(uint32_t)-1` to subtract.
+ */
+static inline void can_list_port_atomic_add(volatile uint32_t *ptr,
+                                            uint32_t value) {
+    __atomic_fetch_add(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+uint8_t can_list_port_identify(can_list_handle_t *hcan);
+uint8_t can_list_port_read(can_list_handle_t *hcan, uint32_t rx_fifo,
+                           can_rx_header_t *header, uint8_t *data);
+uint8_t can_list_port_check_overrun(can_list_handle_t *hcan,
+                                    uint32_t rx_fifo);
+void can_list_port_get_error(can_selected_t can_select,
+                             can_list_bus_stats_t *stats);
+uint8_t can_list_port_filter_add(can_selected_t can_select, uint32_t id_type,
+                                 uint32_t id, uint32_t id_mask);
+void can_list_port_filter_remove(can_selected_t can_select, uint32_t id_type,
+                                 uint32_t id, uint32_t id_mask);
+
+void can_sim_init(can_sim_t *sim, can_selected_t can_select);
+uint8_t can_sim_inject(can_sim_t *sim, uint32_t rx_fifo, uint32_t id,
+                       uint32_t id_type, uint8_t len, const uint8_t *data);
+uint8_t can_sim_inject_fd(can_sim_t *sim, uint32_t rx_fifo, uint32_t id,
+                          uint32_t id_type, uint8_t flags, uint8_t len,
+                          const uint8_t *data);
+void can_sim_irq(can_sim_t *sim, uint32_t rx_fifo);
+
+size_t can_sim_heap_used(void);
+size_t can_sim_heap_peak(void);
+
+/*****************************************************************************
+ * @defgroup Bus time.
+ * @{
+ */
+
+/**
+ * @brief Bits of a frame on the bus, split by the bit rate.
+ */
+typedef struct {
+    uint32_t nominal; /*!< Bits at the nominal (arbitration) bit rate.  */
+    uint32_t data;    /*!< Bits at the data bit rate, BRS frames only.  */
+    uint32_t stuff;   /*!< Stuff bits, include the FD fixed stuff bits. */
+} can_sim_bits_t;
+
+uint8_t can_sim_fd_len(uint8_t len);
+void can_sim_frame_bits(uint32_t id_type, uint32_t id, uint8_t flags,
+                        uint8_t len, const uint8_t *data,
+                        can_sim_bits_t *bits);
+uint64_t can_sim_frame_time_ns(const can_sim_bits_t *bits,
+                               uint32_t nominal_rate, uint32_t data_rate);
+
+/**
+ * @}
+ */
+
+/*****************************************************************************
+ * @defgroup Traffic generator.
+ * @{
+ */
+
+/**
+ * @brief ID distribution of the traffic.
+ */
+typedef enum {
+    can_sim_dist_uniform = 0U, /*!< Every ID has the same rate.          */
+    can_sim_dist_hot           /*!< 80% of frames use 20% of the IDs.    */
+} can_sim_dist_t;
+
+/**
+ * @brief Traffic generator.
+ */
+typedef struct {
+    const uint32_t *ids;     /*!< IDs registered.                          */
+    uint32_t id_count;       /*!< Number of IDs.                           */
+    can_sim_dist_t dist;     /*!< ID distribution.                         */
+    uint32_t unmatched_pct;  /*!< Percent of frames with unknown ID.       */
+    uint32_t rate_hz;        /*!< Frame rate, decide the simulated time.   */
+    uint64_t time_ns;        /*!< Simulated bus time of the next frame.    */
+    uint32_t seed;           /*!< Random seed.                             */
+} can_sim_traffic_t;
+
+void can_sim_traffic_init(can_sim_traffic_t *traffic, const uint32_t *ids,
+                          uint32_t id_count, can_sim_dist_t dist,
+                          uint32_t unmatched_pct, uint32_t rate_hz);
+uint32_t can_sim_traffic_next(can_sim_traffic_t *traffic);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __CAN_SIM_H */
@@ -0,0 +1,199 @@
+/**
+ * @file    can_trace_conv.c
+ * @author  Deadline039
+ * @brief   Convert the binary CAN trace to candump log or Vector ASC.
+ * @version 1.0
+ * @date    2024-12-10
+ * @note    The candump log is read by `canplayer` and `log2asc` of can-utils,
+ *          the ASC by CANalyzer, PCAN-View and python-can. The time of the
+ *          candump log is offset by `-t`, the ASC is relative to the first
+ *          frame.
+ *
+ *          Usage: can_trace_conv [-f candump|asc] [-t epoch_sec]
+ *                                [-o output] [input]
+ */
+
+#include "can_trace_reader.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief Output format.
+ */
+typedef enum {
+    conv_candump = 0, /*!< `(sec.usec) canN ID#DATA`. */
+    conv_asc          /*!< Vector ASC.                */
+} conv_format_t;
+
+/**
+ * @brief Write a frame in candump log format.
+ *
+ * @param out Output stream.
+ * @param frame The frame.
+ * @param epoch_us Time added to the frame, unit: us.
+ */
+static void conv_candump_frame(FILE *out, const can_trace_frame_t *frame,
+                               uint64_t epoch_us) {
+    uint64_t time_us = frame->time_us + epoch_us;
+
+    fprintf(out, "(%llu.%06llu) can%u ",
+            (unsigned long long)(time_us / 1000000),
+            (unsigned long long)(time_us % 1000000), frame->can);
+    fprintf(out, frame->ext ? "%08X#" : "%03X#", frame->id);
+
+    if (frame->rtr) {
+        fprintf(out, "R%u\n", frame->dlc);
+        return;
+    }
+
+    for (uint32_t i = 0; i < frame->dlc; ++i) {
+        fprintf(out, "%02X", frame->data[i]);
+    }
+    fputc('\n', out);
+}
+
+/**
+ * @brief Write the header of the ASC file.
+ *
+ * @param out Output stream.
+ * @param epoch_sec Start time written into the header.
+ */
+static void conv_asc_header(FILE *out, time_t epoch_sec) {
+    char date[64];
+
+    strftime(date, sizeof(date), "%a %b %d %I:%M:%S.000 %p %Y",
+             localtime(&epoch_sec));
+    fprintf(out, "date %s\n", date);
+    fprintf(out, "base hex  timestamps absolute\n");
+    fprintf(out, "internal events logged\n");
+    fprintf(out, "Begin Triggerblock %s\n", date);
+    fprintf(out, "   0.000000 Start of measurement\n");
+}
+
+/**
+ * @brief Write a frame in ASC format, the channel starts from 1.
+ *
+ * @param out Output stream.
+ * @param frame The frame.
+ * @param start_us Time of the first frame, unit: us.
+ */
+static void conv_asc_frame(FILE *out, const can_trace_frame_t *frame,
+                           uint64_t start_us) {
+    uint64_t time_us = frame->time_us - start_us;
+    char id[16];
+
+    snprintf(id, sizeof(id), frame->ext ? "%Xx" : "%X", frame->id);
+    fprintf(out, "%4llu.%06llu %u  %-15s %s   ",
+            (unsigned long long)(time_us / 1000000),
+            (unsigned long long)(time_us % 1000000), frame->can + 1U, id,
+            frame->tx ? "Tx" : "Rx");
+
+    if (frame->rtr) {
+        fprintf(out, "r %X\n", frame->dlc);
+        return;
+    }
+
+    fprintf(out, "d %X", frame->dlc);
+    for (uint32_t i = 0; i < frame->dlc; ++i) {
+        fprintf(out, " %02X", frame->data[i]);
+    }
+    fputc('\n', out);
+}
+
+int main(int argc, char *argv[]) {
+    conv_format_t format = conv_candump;
+    uint64_t epoch_sec = 0;
+    const char *output = NULL;
+    int usage = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:t:o:h")) != -1) {
+        switch (opt) {
+            case 'f': {
+                if (strcmp(optarg, "candump") == 0) {
+                    format = conv_candump;
+                } else if (strcmp(optarg, "asc") == 0) {
+                    format = conv_asc;
+                } else {
+                    usage = 1;
+                }
+            } break;
+
+            case 't': {
+                epoch_sec = strtoull(optarg, NULL, 0);
+            } break;
+
+            case 'o': {
+                output = optarg;
+            } break;
+
+            default: {
+                usage = 1;
+            } break;
+        }
+    }
+
+    if (usage || (argc - optind > 1)) {
+        fprintf(stderr,
+                "Usage: %s [-f candump|asc] [-t epoch_sec] [-o output] "
+                "[input]\n",
+                argv[0]);
+        return 1;
+    }
+
+    FILE *in = stdin;
+    FILE *out = stdout;
+
+    if ((optind < argc) && ((in = fopen(argv[optind], "rb")) == NULL)) {
+        perror(argv[optind]);
+        return 1;
+    }
+
+    if ((output != NULL) && ((out = fopen(output, "w")) == NULL)) {
+        perror(output);
+        return 1;
+    }
+
+    can_trace_reader_t reader;
+    can_trace_frame_t frame;
+    uint64_t start_us = 0;
+
+    can_trace_reader_init(&reader, in);
+
+    if (format == conv_asc) {
+        conv_asc_header(out, (time_t)epoch_sec);
+    }
+
+    while (can_trace_reader_next(&reader, &frame)) {
+        if (format == conv_candump) {
+            conv_candump_frame(out, &frame, epoch_sec * 1000000);
+            continue;
+        }
+
+        if (reader.frames == 1) {
+            start_us = frame.time_us;
+        }
+        conv_asc_frame(out, &frame, start_us);
+    }
+
+    if (format == conv_asc) {
+        fprintf(out, "End TriggerBlock\n");
+    }
+
+    fprintf(stderr,
+            "%u frames, %u with dropped frames before, %u resync, "
+            "%u bytes skipped\n",
+            reader.frames, reader.lost, reader.resync, reader.skipped);
+
+    if (in != stdin) {
+        fclose(in);
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    return 0;
+}
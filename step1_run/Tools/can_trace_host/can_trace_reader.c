@@ -0,0 +1,157 @@
+/**
+ * @file    can_trace_reader.c
+ * @author  Deadline039
+ * @brief   Reader of the binary CAN trace stream.
+ * @version 1.0
+ * @date    2024-12-10
+ */
+
+#include "can_trace_reader.h"
+
+#include <string.h>
+
+/**
+ * @brief Read a little endian value from the record.
+ */
+static uint32_t reader_u32(const uint8_t *buf) {
+    return (uint32_t)buf[0] | ((uint32_t)buf[1] << 8) |
+           ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
+/**
+ * @brief Whether the record in the buffer is a time record.
+ */
+static int reader_is_time(const uint8_t *buf) {
+    return (buf[0] == 0) && (buf[1] == 0) && (buf[2] == CAN_TRACE_TIME) &&
+           (buf[3] == 8) && (reader_u32(&buf[4]) == CAN_TRACE_MAGIC);
+}
+
+/**
+ * @brief Whether the record in the buffer is a valid frame. The CSP clears
+ *        the bytes after the data length, they must be zero.
+ */
+static int reader_is_frame(const uint8_t *buf) {
+    uint8_t flags = buf[2];
+    uint8_t dlc = buf[3];
+    uint32_t id = reader_u32(&buf[4]);
+
+    if ((flags & (0x80U | CAN_TRACE_TIME)) || ((flags & 0x03U) == 0x03U) ||
+        (dlc > 8)) {
+        return 0;
+    }
+
+    if (id > ((flags & CAN_TRACE_EXT) ? 0x1FFFFFFFU : 0x7FFU)) {
+        return 0;
+    }
+
+    for (uint32_t i = (flags & CAN_TRACE_RTR) ? 0 : dlc; i < 8; ++i) {
+        if (buf[8 + i] != 0) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Search the stream byte by byte for a time record.
+ *
+ * @param reader The reader, `buf` holds the record that failed.
+ * @return 1 if found, 0 at the end of the stream.
+ */
+static int reader_search(can_trace_reader_t *reader) {
+    int c;
+
+    while (!reader_is_time(reader->buf)) {
+        if ((c = fgetc(reader->file)) == EOF) {
+            return 0;
+        }
+
+        memmove(reader->buf, &reader->buf[1], CAN_TRACE_RECORD_SIZE - 1);
+        reader->buf[CAN_TRACE_RECORD_SIZE - 1] = (uint8_t)c;
+        ++reader->skipped;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Take the absolute time of the time record in the buffer.
+ */
+static void reader_take_time(can_trace_reader_t *reader) {
+    uint64_t time_us = 0;
+
+    for (uint32_t i = 0; i < 8; ++i) {
+        time_us |= (uint64_t)reader->buf[8 + i] << (8 * i);
+    }
+    reader->time_us = time_us;
+    reader->synced = 1;
+    ++reader->records;
+}
+
+/**
+ * @brief Initialize the reader.
+ *
+ * @param reader The reader.
+ * @param file Input stream, opened in binary mode. Read sequentially, can
+ *             be a pipe or a serial port.
+ */
+void can_trace_reader_init(can_trace_reader_t *reader, FILE *file) {
+    memset(reader, 0, sizeof(can_trace_reader_t));
+    reader->file = file;
+}
+
+/**
+ * @brief Read the next frame. Time records are consumed here, the frames
+ *        before the first time record are skipped.
+ *
+ * @param reader The reader.
+ * @param[out] frame The frame.
+ * @return 1 if a frame is read, 0 at the end of the stream.
+ */
+int can_trace_reader_next(can_trace_reader_t *reader,
+                          can_trace_frame_t *frame) {
+    for (;;) {
+        if (fread(reader->buf, 1, CAN_TRACE_RECORD_SIZE, reader->file) !=
+            CAN_TRACE_RECORD_SIZE) {
+            return 0;
+        }
+
+        if (reader_is_time(reader->buf)) {
+            reader_take_time(reader);
+            continue;
+        }
+
+        if (!reader->synced || !reader_is_frame(reader->buf)) {
+            if (reader->synced) {
+                ++reader->resync;
+            }
+            reader->synced = 0;
+
+            if (!reader_search(reader)) {
+                return 0;
+            }
+
+            reader_take_time(reader);
+            continue;
+        }
+
+        const uint8_t *buf = reader->buf;
+        reader->time_us += (uint32_t)buf[0] | ((uint32_t)buf[1] << 8);
+        frame->time_us = reader->time_us;
+        frame->can = buf[2] & 0x03U;
+        frame->tx = (buf[2] & CAN_TRACE_TX) ? 1 : 0;
+        frame->ext = (buf[2] & CAN_TRACE_EXT) ? 1 : 0;
+        frame->rtr = (buf[2] & CAN_TRACE_RTR) ? 1 : 0;
+        frame->lost = (buf[2] & CAN_TRACE_LOST) ? 1 : 0;
+        frame->dlc = buf[3];
+        frame->id = reader_u32(&buf[4]);
+        memcpy(frame->data, &buf[8], 8);
+
+        ++reader->records;
+        ++reader->frames;
+        reader->lost += frame->lost;
+
+        return 1;
+    }
+}
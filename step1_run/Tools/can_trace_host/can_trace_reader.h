@@ -0,0 +1,74 @@
+/**
+ * @file    can_trace_reader.h
+ * @author  Deadline039
+ * @brief   Reader of the binary CAN trace stream.
+ * @version 1.0
+ * @date    2024-12-10
+ * @note    The record layout is the same as `can_trace_record_t` in
+ *          `CAN_STM32F4xx.h`. The stream captured from the UART may start in
+ *          the middle of a record or lose bytes, the reader only trusts the
+ *          frames after a time record and searches for the next one when a
+ *          record is invalid.
+ */
+
+#ifndef __CAN_TRACE_READER_H
+#define __CAN_TRACE_READER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* Same value as the CSP. */
+#define CAN_TRACE_TX    0x04U
+#define CAN_TRACE_EXT   0x08U
+#define CAN_TRACE_RTR   0x10U
+#define CAN_TRACE_TIME  0x20U
+#define CAN_TRACE_LOST  0x40U
+#define CAN_TRACE_MAGIC 0x544E4143U
+
+/* Size of a record in the stream. */
+#define CAN_TRACE_RECORD_SIZE 16
+
+/**
+ * @brief A frame of the trace.
+ */
+typedef struct {
+    uint64_t time_us; /*!< Absolute time, unit: us.              */
+    uint8_t can;      /*!< CAN, 0 for CAN1.                      */
+    uint8_t tx;       /*!< 1: transmitted by the node.           */
+    uint8_t ext;      /*!< 1: extended ID.                       */
+    uint8_t rtr;      /*!< 1: remote frame.                      */
+    uint8_t lost;     /*!< 1: frames were dropped before it.     */
+    uint8_t dlc;      /*!< Data length.                          */
+    uint32_t id;      /*!< Message ID.                           */
+    uint8_t data[8];  /*!< Message content.                      */
+} can_trace_frame_t;
+
+/**
+ * @brief Reader state.
+ */
+typedef struct {
+    FILE *file;                            /*!< Input stream.            */
+    uint8_t buf[CAN_TRACE_RECORD_SIZE];    /*!< Current record.          */
+    uint8_t synced;                        /*!< Found a time record.     */
+    uint64_t time_us;                      /*!< Time of the last record. */
+
+    uint32_t records; /*!< Valid records, include time records.          */
+    uint32_t frames;  /*!< Frames returned.                              */
+    uint32_t resync;  /*!< Invalid records, searched for the time again. */
+    uint32_t skipped; /*!< Bytes skipped when searching.                 */
+    uint32_t lost;    /*!< Frames with the lost flag.                    */
+} can_trace_reader_t;
+
+void can_trace_reader_init(can_trace_reader_t *reader, FILE *file);
+int can_trace_reader_next(can_trace_reader_t *reader,
+                          can_trace_frame_t *frame);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __CAN_TRACE_READER_H */
@@ -0,0 +1,260 @@
+/**
+ * @file    can_trace_replay.c
+ * @author  Deadline039
+ * @brief   Replay the received frames of a trace into can_list.
+ * @version 1.0
+ * @date    2024-12-10
+ * @note    The frames received by the node are injected into the simulated
+ *          CAN (`Tools/can_list_host`) with the original intervals divided
+ *          by `-s`, 0 for as fast as possible, then dispatched by can_list to
+ *          the callback of each ID. A subscriber is added when an ID is seen
+ *          the first time. Remote frames are not supported by the simulator
+ *          and are counted only, the transmitted frames are skipped unless
+ *          `-t` is given.
+ *
+ *          Usage: can_trace_replay [-s speed] [-c can] [-t] [input]
+ */
+
+#include "can_sim.h"
+#include "can_trace_reader.h"
+
+#include <time.h>
+#include <unistd.h>
+
+#define REPLAY_ID_MAX 256
+
+/**
+ * @brief Statistics of an ID.
+ */
+typedef struct {
+    uint8_t can;           /*!< CAN, 0 for CAN1.                  */
+    uint8_t ext;           /*!< 1: extended ID.                   */
+    uint32_t id;           /*!< Message ID.                       */
+    uint32_t injected;     /*!< Frames injected.                  */
+    uint32_t delivered;    /*!< Frames received by the callback.  */
+    uint32_t mismatch;     /*!< Data differs from the trace.      */
+    uint32_t remote;       /*!< Remote frames, not injected.      */
+    uint64_t first_us;     /*!< Trace time of the first frame.    */
+    uint64_t last_us;      /*!< Trace time of the last frame.     */
+    uint64_t max_gap_us;   /*!< Longest interval in the trace.    */
+    uint8_t expect[8];     /*!< Data of the frame injected.       */
+} replay_id_t;
+
+static replay_id_t replay_ids[REPLAY_ID_MAX];
+static uint32_t replay_id_number;
+static can_sim_t replay_sim[3];
+
+/**
+ * @brief Callback of every ID, check the data against the trace.
+ */
+static void replay_callback(void *node_obj, can_rx_header_t *can_rx_header,
+                            uint8_t *can_msg) {
+    replay_id_t *entry = (replay_id_t *)node_obj;
+
+    ++entry->delivered;
+    if (memcmp(can_msg, entry->expect, can_rx_header->data_length) != 0) {
+        ++entry->mismatch;
+    }
+}
+
+/**
+ * @brief Find the entry of the frame, add a subscriber if it is new.
+ *
+ * @param frame The frame.
+ * @return The entry, `NULL` if the table is full or can_list failed.
+ */
+static replay_id_t *replay_find(const can_trace_frame_t *frame) {
+    for (uint32_t i = 0; i < replay_id_number; ++i) {
+        replay_id_t *entry = &replay_ids[i];
+
+        if ((entry->can == frame->can) && (entry->ext == frame->ext) &&
+            (entry->id == frame->id)) {
+            return entry;
+        }
+    }
+
+    if (replay_id_number == REPLAY_ID_MAX) {
+        return NULL;
+    }
+
+    replay_id_t *entry = &replay_ids[replay_id_number];
+    entry->can = frame->can;
+    entry->ext = frame->ext;
+    entry->id = frame->id;
+    entry->first_us = frame->time_us;
+    entry->last_us = frame->time_us;
+
+    if (can_list_add_new_node((can_selected_t)frame->can, entry, frame->id,
+                              frame->ext ? 0x1FFFFFFF : 0x7FF,
+                              frame->ext ? CAN_ID_EXT : CAN_ID_STD,
+                              replay_callback) != 0) {
+        return NULL;
+    }
+
+    ++replay_id_number;
+    return entry;
+}
+
+/**
+ * @brief Sleep until the time of the frame.
+ *
+ * @param start Host time when the replay started.
+ * @param trace_us Trace time since the first frame, unit: us.
+ * @param speed Speed factor.
+ */
+static void replay_wait(const struct timespec *start, uint64_t trace_us,
+                        double speed) {
+    uint64_t ns = (uint64_t)((double)trace_us * 1000.0 / speed);
+    struct timespec until = {
+        .tv_sec = start->tv_sec + (time_t)(ns / 1000000000),
+        .tv_nsec = start->tv_nsec + (long)(ns % 1000000000)};
+
+    if (until.tv_nsec >= 1000000000) {
+        until.tv_nsec -= 1000000000;
+        ++until.tv_sec;
+    }
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) !=
+           0) {
+    }
+}
+
+int main(int argc, char *argv[]) {
+    double speed = 1.0;
+    int can_filter = -1;
+    int with_tx = 0;
+    int usage = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:c:th")) != -1) {
+        switch (opt) {
+            case 's': {
+                speed = strtod(optarg, NULL);
+            } break;
+
+            case 'c': {
+                can_filter = (int)strtol(optarg, NULL, 0) - 1;
+            } break;
+
+            case 't': {
+                with_tx = 1;
+            } break;
+
+            default: {
+                usage = 1;
+            } break;
+        }
+    }
+
+    if (usage || (speed < 0) || (can_filter < -1) || (can_filter > 2) ||
+        (argc - optind > 1)) {
+        fprintf(stderr, "Usage: %s [-s speed] [-c can] [-t] [input]\n",
+                argv[0]);
+        return 1;
+    }
+
+    FILE *in = stdin;
+
+    if ((optind < argc) && ((in = fopen(argv[optind], "rb")) == NULL)) {
+        perror(argv[optind]);
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < 3; ++i) {
+        can_sim_init(&replay_sim[i], (can_selected_t)i);
+        if (can_list_add_can((can_selected_t)i, 16, 16) != 0) {
+            return 1;
+        }
+    }
+
+    can_trace_reader_t reader;
+    can_trace_frame_t frame;
+    struct timespec start;
+    uint64_t first_us = 0;
+    uint64_t dispatch_ns = 0;
+    uint32_t injected = 0;
+    uint32_t skipped = 0;
+
+    can_trace_reader_init(&reader, in);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    while (can_trace_reader_next(&reader, &frame)) {
+        if (reader.frames == 1) {
+            first_us = frame.time_us;
+        }
+
+        if (((can_filter >= 0) && (frame.can != can_filter)) ||
+            (frame.tx && !with_tx)) {
+            ++skipped;
+            continue;
+        }
+
+        replay_id_t *entry = replay_find(&frame);
+        if (entry == NULL) {
+            ++skipped;
+            continue;
+        }
+
+        if (frame.time_us - entry->last_us > entry->max_gap_us) {
+            entry->max_gap_us = frame.time_us - entry->last_us;
+        }
+        entry->last_us = frame.time_us;
+
+        if (frame.rtr) {
+            ++entry->remote;
+            continue;
+        }
+
+        if (speed > 0) {
+            replay_wait(&start, frame.time_us - first_us, speed);
+        }
+
+        memcpy(entry->expect, frame.data, sizeof(entry->expect));
+        can_sim_inject(&replay_sim[frame.can], CAN_RX_FIFO0, frame.id,
+                       frame.ext ? CAN_ID_EXT : CAN_ID_STD, frame.dlc,
+                       frame.data);
+        uint32_t begin = can_sim_timestamp();
+        can_sim_irq(&replay_sim[frame.can], CAN_RX_FIFO0);
+        dispatch_ns += can_sim_timestamp() - begin;
+        ++entry->injected;
+        ++injected;
+    }
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double wall = (double)(end.tv_sec - start.tv_sec) +
+                  (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("can  id         injected delivered mismatch  remote "
+           "period/ms  max_gap/ms\n");
+    for (uint32_t i = 0; i < replay_id_number; ++i) {
+        const replay_id_t *entry = &replay_ids[i];
+        uint32_t frames = entry->injected + entry->remote;
+        double period =
+            (frames > 1)
+                ? (double)(entry->last_us - entry->first_us) / (frames - 1) /
+                      1000.0
+                : 0.0;
+
+        printf(entry->ext ? "can%u %08X " : "can%u %03X      ",
+               entry->can + 1U, entry->id);
+        printf("%8u %9u %8u %7u %9.3f %11.3f\n", entry->injected,
+               entry->delivered, entry->mismatch, entry->remote, period,
+               (double)entry->max_gap_us / 1000.0);
+    }
+
+    printf("%u frames, %u injected, %u skipped, %u with dropped frames "
+           "before, %u resync\n",
+           reader.frames, injected, skipped, reader.lost, reader.resync);
+    printf("trace %.3f s, replay %.3f s, dispatch %.1f ns/frame\n",
+           (reader.frames > 0)
+               ? (double)(reader.time_us - first_us) / 1e6
+               : 0.0,
+           wall, (injected > 0) ? (double)dispatch_ns / injected : 0.0);
+
+    if (in != stdin) {
+        fclose(in);
+    }
+
+    return 0;
+}
@@ -0,0 +1,168 @@
+/**
+ * @file    host_cmd_send.c
+ * @author  Deadline039
+ * @brief   Encode setpoint lines into host command frames.
+ * @version 1.0
+ * @date    2024-12-12
+ * @note    Every input line is a frame, setpoints separated by `;`:
+ *
+ *              channel mode position speed kp kd torque [; ...]
+ *
+ *          `mode` is 0 for MIT, 1 for position-speed and 2 for speed, the
+ *          fields not used by the mode are ignored by the MCU. Empty lines
+ *          and lines starting with `#` are skipped. The frames are written
+ *          to the output, which can be the serial port, with `-i` ms between
+ *          them.
+ *
+ *          Usage: host_cmd_send [-o output] [-i interval_ms] [input]
+ */
+
+#include "cobs/cobs.h"
+#include "crc32/crc32.h"
+#include "host_cmd/host_cmd_record.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief Parse a line into the frame.
+ *
+ * @param line The line.
+ * @param[out] frame The frame, without the CRC.
+ * @param seq Sequence of the frame.
+ * @return Frame length, 0 if the line is invalid.
+ */
+static size_t send_parse(char *line, uint8_t *frame, uint16_t seq) {
+    host_cmd_header_t header = {
+        .type = (HOST_CMD_VERSION << 4) | HOST_CMD_TYPE_SETPOINT, .seq = seq};
+    size_t len = sizeof(header);
+    char *save = NULL;
+
+    for (char *item = strtok_r(line, ";", &save); item != NULL;
+         item = strtok_r(NULL, ";", &save)) {
+        host_cmd_setpoint_t setpoint = {0};
+        unsigned int channel, mode;
+
+        if (header.count == HOST_CMD_CHANNEL_MAX) {
+            return 0;
+        }
+
+        if ((sscanf(item, "%u %u %f %f %f %f %f", &channel, &mode,
+                    &setpoint.position, &setpoint.speed, &setpoint.kp,
+                    &setpoint.kd, &setpoint.torque) != 7) ||
+            (channel >= HOST_CMD_CHANNEL_MAX) || (mode > 2)) {
+            return 0;
+        }
+
+        setpoint.channel = (uint8_t)channel;
+        setpoint.mode = (uint8_t)mode;
+        memcpy(&frame[len], &setpoint, sizeof(setpoint));
+        len += sizeof(setpoint);
+        ++header.count;
+    }
+
+    if (header.count == 0) {
+        return 0;
+    }
+
+    memcpy(frame, &header, sizeof(header));
+
+    return len;
+}
+
+int main(int argc, char *argv[]) {
+    const char *output = NULL;
+    long interval_ms = 0;
+    int usage = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "o:i:h")) != -1) {
+        switch (opt) {
+            case 'o': {
+                output = optarg;
+            } break;
+
+            case 'i': {
+                interval_ms = strtol(optarg, NULL, 0);
+            } break;
+
+            default: {
+                usage = 1;
+            } break;
+        }
+    }
+
+    if (usage || (interval_ms < 0) || (argc - optind > 1)) {
+        fprintf(stderr, "Usage: %s [-o output] [-i interval_ms] [input]\n",
+                argv[0]);
+        return 1;
+    }
+
+    FILE *in = stdin;
+    FILE *out = stdout;
+
+    if ((optind < argc) && ((in = fopen(argv[optind], "r")) == NULL)) {
+        perror(argv[optind]);
+        return 1;
+    }
+
+    if ((output != NULL) && ((out = fopen(output, "wb")) == NULL)) {
+        perror(output);
+        return 1;
+    }
+
+    uint8_t frame[HOST_CMD_FRAME_MAX];
+    uint8_t encoded[COBS_ENCODE_MAX(HOST_CMD_FRAME_MAX) + 2];
+    char line[1024];
+    uint32_t line_number = 0;
+    uint16_t seq = 0;
+    uint32_t frames = 0;
+
+    while (fgets(line, sizeof(line), in) != NULL) {
+        ++line_number;
+        line[strcspn(line, "\r\n#")] = '\0';
+        if (line[strspn(line, " \t")] == '\0') {
+            continue;
+        }
+
+        size_t len = send_parse(line, frame, seq);
+        if (len == 0) {
+            fprintf(stderr, "line %u: invalid setpoint\n", line_number);
+            continue;
+        }
+
+        uint32_t crc = crc32_bytes(CRC32_INIT, frame, len);
+        memcpy(&frame[len], &crc, sizeof(uint32_t));
+        len += sizeof(uint32_t);
+
+        encoded[0] = 0x00;
+        size_t encoded_len = 1 + cobs_encode(frame, len, &encoded[1]);
+        encoded[encoded_len++] = 0x00;
+
+        fwrite(encoded, 1, encoded_len, out);
+        fflush(out);
+        ++seq;
+        ++frames;
+
+        if (interval_ms > 0) {
+            struct timespec delay = {
+                .tv_sec = interval_ms / 1000,
+                .tv_nsec = (interval_ms % 1000) * 1000000};
+            nanosleep(&delay, NULL);
+        }
+    }
+
+    fprintf(stderr, "%u frames\n", frames);
+
+    if (in != stdin) {
+        fclose(in);
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    return 0;
+}
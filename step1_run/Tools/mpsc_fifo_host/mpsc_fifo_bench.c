@@ -0,0 +1,368 @@
+/**
+ * @file    mpsc_fifo_bench.c
+ * @author  Deadline039
+ * @brief   Contention benchmark of mpsc_fifo on the host.
+ * @version 1.0
+ * @date    2024-12-02
+ * @note    1, 2 and 4 producer threads push frames the size of the CAN TX
+ *          queue frame while one consumer thread drains the FIFO. The same
+ *          run is repeated with a mutex protected ring as the baseline. The
+ *          consumer checks that no frame is lost and each producer keeps its
+ *          order.
+ *
+ *          Usage: mpsc_fifo_bench [-n pushes] [-s size]
+ */
+
+#include "mpsc_fifo/mpsc_fifo.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_MAX_PRODUCER 4
+#define BENCH_MAX_SIZE     1024
+
+static const uint32_t producer_sweep[] = {1, 2, 4};
+
+/**
+ * @brief Element of the benchmark, same size as `can_tx_frame_t`.
+ */
+typedef struct {
+    uint32_t producer; /*!< Producer index.          */
+    uint32_t seq;      /*!< Push order of producer.  */
+    uint32_t pad[5];   /*!< Frame content.           */
+} bench_elem_t;
+
+/**
+ * @brief Queue under test.
+ */
+typedef enum {
+    bench_queue_lockfree = 0U, /*!< mpsc_fifo.                   */
+    bench_queue_mutex          /*!< Ring protected by a mutex.   */
+} bench_queue_t;
+
+/**
+ * @brief Mutex protected ring, the baseline.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t mask;
+    bench_elem_t buf[BENCH_MAX_SIZE];
+} bench_ring_t;
+
+/**
+ * @brief State shared by the threads of one run.
+ */
+typedef struct {
+    bench_queue_t type;         /*!< Queue under test.            */
+    uint32_t producers;         /*!< Producer number.             */
+    uint32_t pushes;            /*!< Pushes of each producer.     */
+    mpsc_fifo_t fifo;           /*!< Lock-free FIFO.              */
+    bench_ring_t ring;          /*!< Baseline ring.               */
+    uint32_t *samples;          /*!< Push latency of all threads. */
+    volatile uint32_t started;  /*!< Producers started.           */
+    volatile uint32_t finished; /*!< Producers finished.          */
+    uint32_t full;              /*!< Pushes failed on full.       */
+    uint32_t error;             /*!< Lost or reordered frames.    */
+} bench_state_t;
+
+typedef struct {
+    bench_state_t *state;
+    uint32_t index;
+} bench_producer_t;
+
+static mpsc_fifo_atomic_t fifo_seq[BENCH_MAX_SIZE];
+static bench_elem_t fifo_buf[BENCH_MAX_SIZE];
+
+/**
+ * @brief Get the timestamp, the host monotonic clock in nanoseconds.
+ *
+ * @return Timestamp.
+ */
+static inline uint32_t bench_timestamp(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL +
+                      (uint64_t)ts.tv_nsec);
+}
+
+/**
+ * @brief Push an element into the queue under test.
+ *
+ * @param state The run state.
+ * @param elem The element.
+ * @return 0: Success, 1: The queue is full.
+ */
+static uint32_t bench_push(bench_state_t *state, const bench_elem_t *elem) {
+    if (state->type == bench_queue_lockfree) {
+        return mpsc_fifo_push(&state->fifo, elem);
+    }
+
+    bench_ring_t *ring = &state->ring;
+    uint32_t res = 1;
+
+    pthread_mutex_lock(&ring->lock);
+    if (ring->tail - ring->head <= ring->mask) {
+        ring->buf[ring->tail & ring->mask] = *elem;
+        ++ring->tail;
+        res = 0;
+    }
+    pthread_mutex_unlock(&ring->lock);
+
+    return res;
+}
+
+/**
+ * @brief Pop an element from the queue under test.
+ *
+ * @param state The run state.
+ * @param[out] elem The element.
+ * @return 0: Success, 1: The queue is empty.
+ */
+static uint32_t bench_pop(bench_state_t *state, bench_elem_t *elem) {
+    if (state->type == bench_queue_lockfree) {
+        return mpsc_fifo_pop(&state->fifo, elem);
+    }
+
+    bench_ring_t *ring = &state->ring;
+    uint32_t res = 1;
+
+    pthread_mutex_lock(&ring->lock);
+    if (ring->tail != ring->head) {
+        *elem = ring->buf[ring->head & ring->mask];
+        ++ring->head;
+        res = 0;
+    }
+    pthread_mutex_unlock(&ring->lock);
+
+    return res;
+}
+
+/**
+ * @brief Producer thread. Retry when the queue is full, only the push that
+ *        succeeded is timed.
+ *
+ * @param arg `bench_producer_t`.
+ * @return NULL.
+ */
+static void *bench_producer(void *arg) {
+    bench_producer_t *producer = arg;
+    bench_state_t *state = producer->state;
+    uint32_t *samples = &state->samples[producer->index * state->pushes];
+    bench_elem_t elem = {.producer = producer->index};
+    uint32_t full = 0;
+
+    __atomic_add_fetch(&state->started, 1, __ATOMIC_SEQ_CST);
+    while (state->started != state->producers) {
+        /* Start together to get the contention. */
+        sched_yield();
+    }
+
+    for (uint32_t i = 0; i < state->pushes; ++i) {
+        elem.seq = i;
+
+        while (1) {
+            uint32_t start = bench_timestamp();
+            uint32_t res = bench_push(state, &elem);
+            uint32_t end = bench_timestamp();
+
+            if (res == 0) {
+                samples[i] = end - start;
+                break;
+            }
+
+            ++full;
+            sched_yield();
+        }
+    }
+
+    __atomic_add_fetch(&state->full, full, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&state->finished, 1, __ATOMIC_SEQ_CST);
+
+    return NULL;
+}
+
+/**
+ * @brief Consumer, drain the queue and check the order of each producer.
+ *
+ * @param state The run state.
+ */
+static void bench_consumer(bench_state_t *state) {
+    uint32_t expect[BENCH_MAX_PRODUCER] = {0};
+    uint64_t total = (uint64_t)state->producers * state->pushes;
+    uint64_t received = 0;
+    bench_elem_t elem;
+
+    while (received < total) {
+        if (bench_pop(state, &elem) != 0) {
+            if (state->finished == state->producers &&
+                (state->type == bench_queue_mutex ||
+                 mpsc_fifo_count(&state->fifo) == 0)) {
+                break;
+            }
+            sched_yield();
+            continue;
+        }
+
+        if (elem.producer >= state->producers ||
+            elem.seq != expect[elem.producer]) {
+            ++state->error;
+        } else {
+            ++expect[elem.producer];
+        }
+        ++received;
+    }
+
+    if (received != total) {
+        state->error += (uint32_t)(total - received);
+    }
+}
+
+/**
+ * @brief Compare function of `qsort`.
+ */
+static int bench_compare(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Get the percentile of the sorted samples.
+ *
+ * @param samples Sorted samples.
+ * @param count Number of samples.
+ * @param permille Percentile in permille.
+ * @return The sample.
+ */
+static uint32_t bench_percentile(const uint32_t *samples, uint32_t count,
+                                 uint32_t permille) {
+    uint64_t index = (uint64_t)count * permille / 1000;
+    if (index >= count) {
+        index = count - 1;
+    }
+
+    return samples[index];
+}
+
+/**
+ * @brief Run one configuration and print the result.
+ *
+ * @param type Queue under test.
+ * @param producers Producer number.
+ * @param pushes Pushes of each producer.
+ * @param size Queue size.
+ * @return 0 if success.
+ */
+static int bench_run(bench_queue_t type, uint32_t producers, uint32_t pushes,
+                     uint32_t size) {
+    static bench_state_t state;
+    pthread_t thread[BENCH_MAX_PRODUCER];
+    bench_producer_t producer[BENCH_MAX_PRODUCER];
+    uint32_t count = producers * pushes;
+    uint64_t sum = 0;
+
+    memset(&state, 0, sizeof(state));
+    state.type = type;
+    state.producers = producers;
+    state.pushes = pushes;
+    state.samples = malloc(count * sizeof(uint32_t));
+    if (state.samples == NULL) {
+        return 1;
+    }
+
+    mpsc_fifo_init(&state.fifo, fifo_seq, fifo_buf, size,
+                   sizeof(bench_elem_t));
+    pthread_mutex_init(&state.ring.lock, NULL);
+    state.ring.mask = size - 1;
+
+    uint32_t start = bench_timestamp();
+
+    for (uint32_t i = 0; i < producers; ++i) {
+        producer[i].state = &state;
+        producer[i].index = i;
+        if (pthread_create(&thread[i], NULL, bench_producer, &producer[i]) !=
+            0) {
+            return 1;
+        }
+    }
+
+    bench_consumer(&state);
+
+    for (uint32_t i = 0; i < producers; ++i) {
+        pthread_join(thread[i], NULL);
+    }
+
+    uint32_t elapsed = bench_timestamp() - start;
+
+    pthread_mutex_destroy(&state.ring.lock);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        sum += state.samples[i];
+    }
+    qsort(state.samples, count, sizeof(uint32_t), bench_compare);
+
+    printf("%-8s %9u %9.1f %7u %7u %7u %9u %8u %9.2f %6u\n",
+           (type == bench_queue_lockfree) ? "lockfree" : "mutex", producers,
+           (double)sum / count, bench_percentile(state.samples, count, 500),
+           bench_percentile(state.samples, count, 990),
+           bench_percentile(state.samples, count, 999),
+           state.samples[count - 1], state.full,
+           (double)count * 1000.0 / elapsed, state.error);
+
+    free(state.samples);
+
+    return (state.error == 0) ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t pushes = 200000;
+    uint32_t size = 16;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:s:h")) != -1) {
+        switch (opt) {
+            case 'n': {
+                pushes = (uint32_t)strtoul(optarg, NULL, 0);
+            } break;
+
+            case 's': {
+                size = (uint32_t)strtoul(optarg, NULL, 0);
+            } break;
+
+            default: {
+                pushes = 0;
+            } break;
+        }
+    }
+
+    if (pushes == 0 || size < 2 || size > BENCH_MAX_SIZE ||
+        (size & (size - 1)) != 0) {
+        fprintf(stderr, "Usage: %s [-n pushes] [-s size]\n", argv[0]);
+        fprintf(stderr, "size must be power of 2, %u at most.\n",
+                BENCH_MAX_SIZE);
+        return 1;
+    }
+
+    printf("pushes %u per producer, size %u, %ld CPUs\n", pushes, size,
+           sysconf(_SC_NPROCESSORS_ONLN));
+    printf("queue    producers   mean/ns  p50/ns  p99/ns p999/ns    max/ns "
+           "    full  Mpush/s  error\n");
+
+    int res = 0;
+    for (size_t i = 0;
+         i < sizeof(producer_sweep) / sizeof(producer_sweep[0]); ++i) {
+        res |= bench_run(bench_queue_lockfree, producer_sweep[i], pushes, size);
+        res |= bench_run(bench_queue_mutex, producer_sweep[i], pushes, size);
+    }
+
+    return res;
+}
@@ -0,0 +1,373 @@
+/**
+ * @file    telemetry_decode.c
+ * @author  Deadline039
+ * @brief   Decode the binary telemetry stream to CSV or column files.
+ * @version 1.0
+ * @date    2024-12-11
+ * @note    The stream is split at 0x00, every segment is COBS decoded and
+ *          checked by the length and the CRC. Segments that fail are
+ *          skipped, they are usually text printed to the same UART, and are
+ *          echoed to stderr with `-v`. The time is extended to 64 bits and
+ *          the frames lost are counted from the sequence number.
+ *
+ *          CSV has a row per motor per frame. With `-c dir` every column is
+ *          written to `dir/<name>.bin` as a raw little endian array with the
+ *          same rows, and `dir/schema.txt` lists the name, the type and the
+ *          row count, e.g. `numpy.fromfile("position.bin", "<f4")`.
+ *
+ *          The records are copied into the structures of the MCU, the host
+ *          must be little endian.
+ *
+ *          Usage: telemetry_decode [-c dir] [-o output] [-v] [input]
+ */
+
+#include "cobs/cobs.h"
+#include "crc32/crc32.h"
+#include "telemetry/telemetry_record.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Longest segment of a valid frame. */
+#define DECODE_SEGMENT_MAX COBS_ENCODE_MAX(TELEMETRY_FRAME_MAX)
+
+/**
+ * @brief A decoded row, a motor of a frame.
+ */
+typedef struct {
+    uint64_t time_us;
+    uint32_t seq;
+    telemetry_motor_t motor;
+} decode_row_t;
+
+/**
+ * @brief A column of the output.
+ */
+typedef struct {
+    const char *name; /*!< Column name, also the file name. */
+    const char *type; /*!< numpy type string.               */
+    size_t offset;    /*!< Offset in `decode_row_t`.         */
+    size_t size;      /*!< Size of the value.                */
+    FILE *file;       /*!< Column file.                      */
+} decode_column_t;
+
+#define DECODE_COLUMN(name, field, type)                                       \
+    {#name, type, offsetof(decode_row_t, field),                               \
+     sizeof(((decode_row_t *)0)->field), NULL}
+
+static decode_column_t decode_columns[] = {
+    DECODE_COLUMN(time_us, time_us, "<u8"),
+    DECODE_COLUMN(seq, seq, "<u4"),
+    DECODE_COLUMN(channel, motor.channel, "u1"),
+    DECODE_COLUMN(mode, motor.mode, "u1"),
+    DECODE_COLUMN(error, motor.error, "u1"),
+    DECODE_COLUMN(enabled, motor.enabled, "u1"),
+    DECODE_COLUMN(mos_temperature, motor.mos_temperature, "<i2"),
+    DECODE_COLUMN(motor_temperature, motor.motor_temperature, "<i2"),
+    DECODE_COLUMN(position, motor.position, "<f4"),
+    DECODE_COLUMN(speed, motor.speed, "<f4"),
+    DECODE_COLUMN(torque, motor.torque, "<f4"),
+    DECODE_COLUMN(set_position, motor.set_position, "<f4"),
+    DECODE_COLUMN(set_speed, motor.set_speed, "<f4"),
+    DECODE_COLUMN(set_kp, motor.set_kp, "<f4"),
+    DECODE_COLUMN(set_kd, motor.set_kd, "<f4"),
+    DECODE_COLUMN(set_torque, motor.set_torque, "<f4"),
+};
+
+#define DECODE_COLUMN_NUMBER                                                   \
+    (sizeof(decode_columns) / sizeof(decode_columns[0]))
+
+/**
+ * @brief Decoder state.
+ */
+typedef struct {
+    uint8_t synced;    /*!< A frame is decoded.               */
+    uint16_t seq;      /*!< Sequence of the last frame.       */
+    uint32_t time_us;  /*!< Time of the last frame.           */
+    uint64_t time64;   /*!< Time extended to 64 bits.         */
+    uint64_t first_us; /*!< Time of the first frame.          */
+
+    uint32_t frames;   /*!< Valid frames.                     */
+    uint32_t rows;     /*!< Motor records.                    */
+    uint32_t lost;     /*!< Frames lost by the sequence.      */
+    uint32_t crc_err;  /*!< Segments with a wrong CRC.        */
+    uint32_t invalid;  /*!< Other segments skipped.           */
+    uint64_t skipped;  /*!< Bytes of the segments skipped.    */
+} decode_state_t;
+
+/**
+ * @brief Write a row as CSV.
+ */
+static void decode_csv_row(FILE *out, const decode_row_t *row) {
+    const telemetry_motor_t *m = &row->motor;
+
+    fprintf(out, "%llu,%u,%u,%u,%u,%u,%.1f,%.1f,",
+            (unsigned long long)row->time_us, row->seq, m->channel, m->mode,
+            m->error, m->enabled, m->mos_temperature / 10.0,
+            m->motor_temperature / 10.0);
+    fprintf(out, "%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g\n", m->position,
+            m->speed, m->torque, m->set_position, m->set_speed, m->set_kp,
+            m->set_kd, m->set_torque);
+}
+
+/**
+ * @brief Write a row to the column files.
+ */
+static void decode_column_row(const decode_row_t *row) {
+    for (size_t i = 0; i < DECODE_COLUMN_NUMBER; ++i) {
+        fwrite((const uint8_t *)row + decode_columns[i].offset,
+               decode_columns[i].size, 1, decode_columns[i].file);
+    }
+}
+
+/**
+ * @brief Open the column files.
+ *
+ * @param dir Output directory, created if not exist.
+ * @return 0 on success.
+ */
+static int decode_column_open(const char *dir) {
+    char path[4096];
+
+    if ((mkdir(dir, 0777) != 0) && (errno != EEXIST)) {
+        perror(dir);
+        return 1;
+    }
+
+    for (size_t i = 0; i < DECODE_COLUMN_NUMBER; ++i) {
+        snprintf(path, sizeof(path), "%s/%s.bin", dir,
+                 decode_columns[i].name);
+        if ((decode_columns[i].file = fopen(path, "wb")) == NULL) {
+            perror(path);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Close the column files and write the schema.
+ *
+ * @param dir Output directory.
+ * @param rows Row count.
+ */
+static void decode_column_close(const char *dir, uint32_t rows) {
+    char path[4096];
+    FILE *schema;
+
+    for (size_t i = 0; i < DECODE_COLUMN_NUMBER; ++i) {
+        fclose(decode_columns[i].file);
+    }
+
+    snprintf(path, sizeof(path), "%s/schema.txt", dir);
+    if ((schema = fopen(path, "w")) == NULL) {
+        perror(path);
+        return;
+    }
+
+    fprintf(schema, "# name type rows\n");
+    for (size_t i = 0; i < DECODE_COLUMN_NUMBER; ++i) {
+        fprintf(schema, "%s %s %u\n", decode_columns[i].name,
+                decode_columns[i].type, rows);
+    }
+    fclose(schema);
+}
+
+/**
+ * @brief Decode a segment between two delimiters.
+ *
+ * @param state Decoder state.
+ * @param segment The segment, without the delimiter.
+ * @param len Segment length.
+ * @param out CSV output, `NULL` to write the column files.
+ * @param verbose Echo the segments skipped to stderr.
+ */
+static void decode_segment(decode_state_t *state, const uint8_t *segment,
+                           size_t len, FILE *out, int verbose) {
+    static uint32_t frame[TELEMETRY_FRAME_MAX / sizeof(uint32_t)];
+    telemetry_header_t header;
+    size_t frame_len = 0;
+
+    if (len <= DECODE_SEGMENT_MAX) {
+        frame_len =
+            cobs_decode(segment, len, (uint8_t *)frame, sizeof(frame));
+    }
+
+    if (frame_len >= sizeof(header) + sizeof(uint32_t)) {
+        memcpy(&header, frame, sizeof(header));
+    }
+
+    if ((frame_len < sizeof(header) + sizeof(uint32_t)) ||
+        (header.type !=
+         ((TELEMETRY_VERSION << 4) | TELEMETRY_TYPE_MOTOR)) ||
+        (header.count > TELEMETRY_CHANNEL_MAX) ||
+        (frame_len != sizeof(header) +
+                          header.count * sizeof(telemetry_motor_t) +
+                          sizeof(uint32_t))) {
+        ++state->invalid;
+        state->skipped += len;
+        if (verbose) {
+            while ((len > 0) && ((segment[len - 1] == '\r') ||
+                                 (segment[len - 1] == '\n'))) {
+                --len;
+            }
+            fprintf(stderr, "skip: %.*s\n", (int)len, (const char *)segment);
+        }
+        return;
+    }
+
+    uint32_t crc;
+    memcpy(&crc, (const uint8_t *)frame + frame_len - sizeof(uint32_t),
+           sizeof(uint32_t));
+    if (crc32_bytes(CRC32_INIT, (const uint8_t *)frame,
+                    frame_len - sizeof(uint32_t)) != crc) {
+        ++state->crc_err;
+        state->skipped += len;
+        return;
+    }
+
+    if (state->synced) {
+        state->lost += (uint16_t)(header.seq - state->seq - 1);
+        state->time64 += header.time_us - state->time_us;
+    } else {
+        state->time64 = header.time_us;
+        state->first_us = header.time_us;
+        state->synced = 1;
+    }
+    state->seq = header.seq;
+    state->time_us = header.time_us;
+    ++state->frames;
+
+    decode_row_t row = {.time_us = state->time64, .seq = header.seq};
+    const uint8_t *record = (const uint8_t *)frame + sizeof(header);
+
+    for (uint32_t i = 0; i < header.count; ++i) {
+        memcpy(&row.motor, record, sizeof(telemetry_motor_t));
+        record += sizeof(telemetry_motor_t);
+
+        if (out != NULL) {
+            decode_csv_row(out, &row);
+        } else {
+            decode_column_row(&row);
+        }
+        ++state->rows;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const char *column_dir = NULL;
+    const char *output = NULL;
+    int verbose = 0;
+    int usage = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:o:vh")) != -1) {
+        switch (opt) {
+            case 'c': {
+                column_dir = optarg;
+            } break;
+
+            case 'o': {
+                output = optarg;
+            } break;
+
+            case 'v': {
+                verbose = 1;
+            } break;
+
+            default: {
+                usage = 1;
+            } break;
+        }
+    }
+
+    if (usage || ((column_dir != NULL) && (output != NULL)) ||
+        (argc - optind > 1)) {
+        fprintf(stderr, "Usage: %s [-c dir] [-o output] [-v] [input]\n",
+                argv[0]);
+        return 1;
+    }
+
+    FILE *in = stdin;
+    FILE *out = stdout;
+
+    if ((optind < argc) && ((in = fopen(argv[optind], "rb")) == NULL)) {
+        perror(argv[optind]);
+        return 1;
+    }
+
+    if (column_dir != NULL) {
+        out = NULL;
+        if (decode_column_open(column_dir) != 0) {
+            return 1;
+        }
+    } else if ((output != NULL) && ((out = fopen(output, "w")) == NULL)) {
+        perror(output);
+        return 1;
+    }
+
+    if (out != NULL) {
+        fprintf(out, "time_us,seq,channel,mode,error,enabled,"
+                     "mos_temperature,motor_temperature,position,speed,"
+                     "torque,set_position,set_speed,set_kp,set_kd,"
+                     "set_torque\n");
+    }
+
+    /* Longer segments are not frames, only the length is counted. */
+    static uint8_t segment[DECODE_SEGMENT_MAX + 1];
+    decode_state_t state = {0};
+    size_t len = 0;
+    size_t overflow = 0;
+    int c;
+
+    while ((c = fgetc(in)) != EOF) {
+        if (c != 0) {
+            if (len < sizeof(segment)) {
+                segment[len++] = (uint8_t)c;
+            } else {
+                ++overflow;
+            }
+            continue;
+        }
+
+        if (overflow > 0) {
+            ++state.invalid;
+            state.skipped += len + overflow;
+            if (verbose) {
+                fprintf(stderr, "skip: %zu bytes\n", len + overflow);
+            }
+        } else if (len > 0) {
+            decode_segment(&state, segment, len, out, verbose);
+        }
+        len = 0;
+        overflow = 0;
+    }
+
+    if (column_dir != NULL) {
+        decode_column_close(column_dir, state.rows);
+    }
+
+    double span = (double)(state.time64 - state.first_us) / 1e6;
+    fprintf(stderr,
+            "%u frames, %u rows, %u lost, %u crc error, %u skipped "
+            "(%llu bytes)\n",
+            state.frames, state.rows, state.lost, state.crc_err,
+            state.invalid, (unsigned long long)state.skipped);
+    fprintf(stderr, "%.3f s, %.1f frames/s\n", span,
+            (span > 0) ? (state.frames - 1) / span : 0.0);
+
+    if (in != stdin) {
+        fclose(in);
+    }
+    if ((out != NULL) && (out != stdout)) {
+        fclose(out);
+    }
+
+    return 0;
+}
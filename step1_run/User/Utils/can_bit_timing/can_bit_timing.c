@@ -0,0 +1,202 @@
+/**
+ * @file    can_bit_timing.c
+ * @author  Deadline039
+ * @brief   CAN位时序求解
+ * @version 1.0
+ * @date    2024-12-05
+ */
+
+#include "can_bit_timing.h"
+
+#include <stddef.h>
+
+static inline uint32_t abs_diff(uint32_t a, uint32_t b) {
+    return (a > b) ? (a - b) : (b - a);
+}
+
+static inline uint32_t min_u32(uint32_t a, uint32_t b) {
+    return (a < b) ? a : b;
+}
+
+/* 容差减去波特率误差, 即留给振荡器的余量 */
+static inline int32_t timing_margin(const can_bit_timing_t *timing) {
+    int32_t error = timing->rate_error;
+
+    return (int32_t)timing->tolerance - ((error < 0) ? -error : error);
+}
+
+/**
+ * @brief    比较两个组合
+ * @param[in]    config  求解参数
+ * @param[in]    a       组合a
+ * @param[in]    b       组合b
+ * @retval   执行结果
+ * -         1   a优于b
+ * -         0   a不优于b
+ */
+static uint32_t timing_better(const can_bit_timing_config_t *config,
+                              const can_bit_timing_t *a,
+                              const can_bit_timing_t *b) {
+    uint32_t dist_a = abs_diff(a->sample_point, config->sample_point);
+    uint32_t dist_b = abs_diff(b->sample_point, config->sample_point);
+    uint32_t in_a = (dist_a <= config->sample_range);
+    uint32_t in_b = (dist_b <= config->sample_range);
+    int32_t margin_a = timing_margin(a);
+    int32_t margin_b = timing_margin(b);
+
+    if (in_a != in_b) {
+        return in_a;
+    }
+
+    if (in_a == 0) {
+        /* 都不在范围内, 先接近目标 */
+        if (dist_a != dist_b) {
+            return dist_a < dist_b;
+        }
+        return margin_a > margin_b;
+    }
+
+    if (margin_a != margin_b) {
+        return margin_a > margin_b;
+    }
+    if (dist_a != dist_b) {
+        return dist_a < dist_b;
+    }
+
+    /* tq越多, 重同步的步进越细 */
+    return a->tq_per_bit > b->tq_per_bit;
+}
+
+/**
+ * @brief    计算组合的采样点与容差
+ * @param[in]    timing  已填入分频、BS1、BS2、传播段的组合
+ * @param[in]    sjw_max SJW最大值
+ * @retval   执行结果
+ * -         0   组合有效
+ * -         1   BS1容纳不下传播段
+ */
+static uint32_t timing_evaluate(can_bit_timing_t *timing, uint32_t sjw_max) {
+    uint32_t n = timing->tq_per_bit;
+
+    if (timing->tseg1 <= timing->prop_seg) {
+        return 1;
+    }
+
+    uint32_t phase1 = timing->tseg1 - timing->prop_seg;
+    uint32_t phase2 = timing->tseg2;
+    uint32_t phase = min_u32(phase1, phase2);
+
+    timing->sjw = min_u32(sjw_max, phase);
+    timing->sample_point = ((1 + timing->tseg1) * 2000 + n) / (2 * n);
+
+    /* 条件1: 错误帧期间最长 13 位没有重同步, 累积误差不超过相位段
+       条件2: 两次重同步之间最长 10 位, 累积误差不超过 SJW */
+    uint64_t df1 = (uint64_t)phase * 1000000 / (2 * (13 * n - phase2));
+    uint64_t df2 = (uint64_t)timing->sjw * 1000000 / (20 * n);
+    timing->tolerance = (uint32_t)((df1 < df2) ? df1 : df2);
+
+    return 0;
+}
+
+/**
+ * @brief    把组合按顺序插入结果
+ * @param[in]    config  求解参数
+ * @param[in]    timing  组合
+ * @param[in]    result  结果数组
+ * @param[in]    count   已有的结果数
+ * @param[in]    number  结果数组长度
+ * @retval   执行结果
+ * -         插入后的结果数
+ */
+static uint32_t timing_insert(const can_bit_timing_config_t *config,
+                              const can_bit_timing_t *timing,
+                              can_bit_timing_t *result, uint32_t count,
+                              uint32_t number) {
+    uint32_t pos = count;
+
+    while ((pos > 0) && timing_better(config, timing, &result[pos - 1])) {
+        --pos;
+    }
+
+    if (pos >= number) {
+        return count;
+    }
+
+    if (count < number) {
+        ++count;
+    }
+
+    for (uint32_t i = count - 1; i > pos; --i) {
+        result[i] = result[i - 1];
+    }
+    result[pos] = *timing;
+
+    return count;
+}
+
+uint32_t can_bit_timing_solve(const can_bit_timing_config_t *config,
+                              can_bit_timing_t *result, uint32_t number) {
+    if ((NULL == config) || (NULL == config->limit) || (NULL == result) ||
+        (0 == number) || (0 == config->clock) || (0 == config->bit_rate)) {
+        return 0;
+    }
+
+    const can_bit_timing_limit_t *limit = config->limit;
+    uint32_t n_min = 1 + limit->tseg1_min + limit->tseg2_min;
+    uint32_t n_max = 1 + limit->tseg1_max + limit->tseg2_max;
+    uint32_t count = 0;
+
+    for (uint32_t brp = limit->brp_min; brp <= limit->brp_max; ++brp) {
+        uint64_t tq_clock = config->clock / brp;
+        uint32_t n_ideal = (uint32_t)(tq_clock / config->bit_rate);
+
+        if (n_ideal + 1 < n_min) {
+            /* 分频再大, tq数只会更少 */
+            break;
+        }
+
+        /* 只有最接近的两个tq数可能满足波特率 */
+        for (uint32_t n = n_ideal; n <= n_ideal + 1; ++n) {
+            if ((n < n_min) || (n > n_max)) {
+                continue;
+            }
+
+            uint64_t actual = (uint64_t)config->clock * 1000000 / (brp * n);
+            int64_t error = ((int64_t)actual -
+                             (int64_t)config->bit_rate * 1000000) /
+                            (int64_t)config->bit_rate;
+            if ((error > (int64_t)config->rate_error) ||
+                (error < -(int64_t)config->rate_error)) {
+                continue;
+            }
+
+            can_bit_timing_t timing;
+            timing.prescale = brp;
+            timing.tq_per_bit = n;
+            timing.rate_error = (int32_t)error;
+            /* 信号往返一次的时间, 向上取整 */
+            timing.prop_seg = (uint32_t)(((uint64_t)config->prop_delay * 2 *
+                                              config->clock +
+                                          (uint64_t)brp * 1000000000 - 1) /
+                                         ((uint64_t)brp * 1000000000));
+
+            for (uint32_t tseg2 = limit->tseg2_min; tseg2 <= limit->tseg2_max;
+                 ++tseg2) {
+                if (n < 1 + tseg2 + limit->tseg1_min) {
+                    break;
+                }
+
+                timing.tseg2 = tseg2;
+                timing.tseg1 = n - 1 - tseg2;
+                if ((timing.tseg1 > limit->tseg1_max) ||
+                    (timing_evaluate(&timing, limit->sjw_max) != 0)) {
+                    continue;
+                }
+
+                count = timing_insert(config, &timing, result, count, number);
+            }
+        }
+    }
+
+    return count;
+}
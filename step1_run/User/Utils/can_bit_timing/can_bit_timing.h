@@ -0,0 +1,80 @@
+/**
+ * @file    can_bit_timing.h
+ * @author  Deadline039
+ * @brief   CAN位时序求解
+ * @version 1.0
+ * @date    2024-12-05
+ * @note    遍历所有满足波特率的(分频, BS1, BS2)组合, 要求BS1能容纳传播段,
+ *          按振荡器容差(Bosch CAN 2.0 的两个条件取较小值)减去波特率误差排序.
+ *          采样点在目标范围内的组合排在前面; 范围内没有组合时, 按采样点与目标
+ *          的距离排序. SJW 取 min(SJW上限, 相位段1, 相位段2), 更大的SJW只会
+ *          提高容差, 不需要单独搜索.
+ *
+ *          不依赖芯片库, 可以在主机上编译, 用于生成预计算的时序.
+ */
+
+#ifndef __CAN_BIT_TIMING_H
+#define __CAN_BIT_TIMING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* 位时序的硬件范围 */
+typedef struct {
+    uint32_t brp_min;   /* 分频最小值 */
+    uint32_t brp_max;   /* 分频最大值 */
+    uint32_t tseg1_min; /* BS1最小值(tq), 包括传播段 */
+    uint32_t tseg1_max; /* BS1最大值(tq) */
+    uint32_t tseg2_min; /* BS2最小值(tq) */
+    uint32_t tseg2_max; /* BS2最大值(tq) */
+    uint32_t sjw_max;   /* SJW最大值(tq) */
+} can_bit_timing_limit_t;
+
+/* STM32 bxCAN 的位时序范围 */
+#define CAN_BIT_TIMING_BXCAN                                                   \
+    { 1, 1024, 1, 16, 1, 8, 4 }
+
+/* 求解参数 */
+typedef struct {
+    uint32_t clock;        /* 外设时钟(Hz) */
+    uint32_t bit_rate;     /* 波特率(bps) */
+    uint32_t sample_point; /* 目标采样点(‰) */
+    uint32_t sample_range; /* 采样点允许的偏差(‰) */
+    uint32_t prop_delay;   /* 单程传播延时(ns), 包括线缆与收发器 */
+    uint32_t rate_error;   /* 波特率允许的误差(ppm), 0 为只接受精确的波特率 */
+
+    const can_bit_timing_limit_t *limit; /* 硬件范围 */
+} can_bit_timing_config_t;
+
+/* 求解结果 */
+typedef struct {
+    uint32_t prescale;     /* 分频 */
+    uint32_t tseg1;        /* BS1(tq), 包括传播段 */
+    uint32_t tseg2;        /* BS2(tq) */
+    uint32_t sjw;          /* SJW(tq) */
+    uint32_t tq_per_bit;   /* 每位的tq数 */
+    uint32_t prop_seg;     /* 传播段(tq) */
+    uint32_t sample_point; /* 采样点(‰) */
+    int32_t rate_error;    /* 波特率误差(ppm) */
+    uint32_t tolerance;    /* 振荡器容差(ppm) */
+} can_bit_timing_t;
+
+/**
+ * @brief    求解位时序
+ * @param[in]    config  求解参数
+ * @param[out]   result  存放结果, 按从优到劣排序
+ * @param[in]    number  result的长度
+ * @retval   执行结果
+ * -         存入result的结果数, 0 为没有满足条件的组合或参数错误
+ */
+uint32_t can_bit_timing_solve(const can_bit_timing_config_t *config,
+                              can_bit_timing_t *result, uint32_t number);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CAN_BIT_TIMING_H */
@@ -0,0 +1,69 @@
+/**
+ * @file    cobs.c
+ * @author  Deadline039
+ * @brief   COBS(Consistent Overhead Byte Stuffing)编解码
+ * @version 1.0
+ * @date    2024-12-11
+ */
+
+#include "cobs.h"
+
+size_t cobs_encode(const uint8_t *src, size_t len, uint8_t *dst) {
+    size_t code_index = 0;
+    size_t out = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < len; ++i) {
+        if (src[i] != 0) {
+            dst[out++] = src[i];
+            ++code;
+        }
+
+        /* 遇到 0 或一段满 254 字节时写入长度码, 开始新的一段 */
+        if ((src[i] == 0) || (code == 0xFF)) {
+            dst[code_index] = code;
+            code_index = out++;
+            code = 1;
+
+            /* 最后一段正好满 254 字节且没有后续数据, 不需要空段 */
+            if ((src[i] != 0) && (i + 1 == len)) {
+                return out - 1;
+            }
+        }
+    }
+
+    dst[code_index] = code;
+
+    return out;
+}
+
+size_t cobs_decode(const uint8_t *src, size_t len, uint8_t *dst,
+                   size_t size) {
+    size_t in = 0;
+    size_t out = 0;
+
+    while (in < len) {
+        uint8_t code = src[in++];
+
+        if ((code == 0) || (in + code - 1 > len)) {
+            return 0;
+        }
+
+        for (uint8_t i = 1; i < code; ++i) {
+            if ((src[in] == 0) || (out == size)) {
+                return 0;
+            }
+            dst[out++] = src[in++];
+        }
+
+        /* 长度码小于 0xFF 的段之后原有一个 0, 最后一段除外 */
+        if ((code != 0xFF) && (in < len)) {
+            if (out == size) {
+                return 0;
+            }
+            dst[out++] = 0;
+        }
+    }
+
+    return out;
+}
@@ -0,0 +1,52 @@
+/**
+ * @file    cobs.h
+ * @author  Deadline039
+ * @brief   COBS(Consistent Overhead Byte Stuffing)编解码
+ * @version 1.0
+ * @date    2024-12-11
+ * @note    编码后的数据不含 0x00, 以 0x00 作为帧分隔符. 每 254 字节最多增加
+ *          1 字节开销. 接收端从任意位置开始都能在下一个 0x00 处重新同步,
+ *          适合在串口上传输二进制记录, 同一串口上混入的文本也不会破坏帧边界.
+ */
+
+#ifndef __COBS_H
+#define __COBS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* 编码后的最大长度(不含分隔符) */
+#define COBS_ENCODE_MAX(len) ((len) + ((len) / 254) + 1)
+
+/**
+ * @brief    编码, 不添加帧分隔符
+ * @param[in]    src     原始数据
+ * @param[in]    len     原始数据长度
+ * @param[out]   dst     编码输出, 长度至少为 COBS_ENCODE_MAX(len)
+ * @retval   执行结果
+ * -         编码后的长度
+ */
+size_t cobs_encode(const uint8_t *src, size_t len, uint8_t *dst);
+
+/**
+ * @brief    解码一帧, 输入不含帧分隔符
+ * @param[in]    src     编码数据
+ * @param[in]    len     编码数据长度
+ * @param[out]   dst     解码输出, 可以与 src 相同(原地解码)
+ * @param[in]    size    dst 的长度
+ * @retval   执行结果
+ * -         解码后的长度
+ * -         0   数据中有 0x00, 长度码越界, dst 不足或解码结果为空
+ */
+size_t cobs_decode(const uint8_t *src, size_t len, uint8_t *dst,
+                   size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __COBS_H */
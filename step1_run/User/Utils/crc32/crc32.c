@@ -0,0 +1,38 @@
+/**
+ * @file    crc32.c
+ * @author  Deadline039
+ * @brief   与 STM32 硬件 CRC 单元结果相同的软件 CRC32
+ * @version 1.0
+ * @date    2024-12-11
+ */
+
+#include "crc32.h"
+
+#define CRC32_POLY 0x04C11DB7U
+
+uint32_t crc32_word(uint32_t crc, uint32_t word) {
+    crc ^= word;
+
+    for (uint32_t i = 0; i < 32; ++i) {
+        crc = (crc & 0x80000000U) ? ((crc << 1) ^ CRC32_POLY) : (crc << 1);
+    }
+
+    return crc;
+}
+
+uint32_t crc32_bytes(uint32_t crc, const uint8_t *data, size_t len) {
+    while (len > 0) {
+        uint32_t word = 0;
+        size_t n = (len < 4) ? len : 4;
+
+        for (size_t i = 0; i < n; ++i) {
+            word |= (uint32_t)data[i] << (8 * i);
+        }
+
+        crc = crc32_word(crc, word);
+        data += n;
+        len -= n;
+    }
+
+    return crc;
+}
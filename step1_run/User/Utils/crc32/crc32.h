@@ -0,0 +1,52 @@
+/**
+ * @file    crc32.h
+ * @author  Deadline039
+ * @brief   与 STM32 硬件 CRC 单元结果相同的软件 CRC32
+ * @version 1.0
+ * @date    2024-12-11
+ * @note    STM32F4 的 CRC 单元固定为: 多项式 0x04C11DB7, 初值 0xFFFFFFFF,
+ *          按 32 位字输入, 高位在前, 不反转, 无结果异或. 字节流按小端装入字
+ *          (即 MCU 内存中的顺序), 末尾不足 4 字节补 0.
+ *
+ *          MCU 上使用硬件 CRC 单元, 上位机和没有 CRC 单元的场合用本文件,
+ *          两端对同一段数据的结果相同.
+ */
+
+#ifndef __CRC32_H
+#define __CRC32_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* CRC 初值, 与硬件复位后相同 */
+#define CRC32_INIT 0xFFFFFFFFU
+
+/**
+ * @brief    计算一个 32 位字
+ * @param[in]    crc     上一次的结果, 第一次为 CRC32_INIT
+ * @param[in]    word    输入的字
+ * @retval   执行结果
+ * -         新的 CRC
+ */
+uint32_t crc32_word(uint32_t crc, uint32_t word);
+
+/**
+ * @brief    计算字节流, 按小端装入 32 位字, 末尾补 0
+ * @param[in]    crc     上一次的结果, 第一次为 CRC32_INIT
+ * @param[in]    data    数据
+ * @param[in]    len     数据长度
+ * @retval   执行结果
+ * -         新的 CRC
+ * @note     分多次计算时, 除最后一次外长度必须是 4 的倍数
+ */
+uint32_t crc32_bytes(uint32_t crc, const uint8_t *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CRC32_H */
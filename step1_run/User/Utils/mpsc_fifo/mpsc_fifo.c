@@ -0,0 +1,172 @@
+/**
+ * @file    mpsc_fifo.c
+ * @author  Deadline039
+ * @brief   多生产者单消费者无锁FIFO
+ * @version 1.0
+ * @date    2024-12-02
+ */
+
+#include "mpsc_fifo.h"
+
+#include <string.h>
+
+#if MPSC_FIFO_USE_LDREX
+
+#include "cmsis_compiler.h"
+
+static inline uint32_t mpsc_load(mpsc_fifo_atomic_t *ptr) {
+    uint32_t value = *ptr;
+    __DMB();
+
+    return value;
+}
+
+static inline void mpsc_store(mpsc_fifo_atomic_t *ptr, uint32_t value) {
+    __DMB();
+    *ptr = value;
+}
+
+/* 比较并交换, 失败时 expected 更新为当前值 */
+static inline uint32_t mpsc_cas(mpsc_fifo_atomic_t *ptr, uint32_t *expected,
+                                uint32_t desired) {
+    do {
+        uint32_t value = __LDREXW(ptr);
+        if (value != *expected) {
+            __CLREX();
+            *expected = value;
+            return 0;
+        }
+        /* 被中断打断时 STREX 失败, 重新读取 */
+    } while (__STREXW(desired, ptr) != 0);
+
+    __DMB();
+
+    return 1;
+}
+
+static inline uint32_t mpsc_exchange(mpsc_fifo_atomic_t *ptr,
+                                     uint32_t desired) {
+    uint32_t value;
+
+    do {
+        value = __LDREXW(ptr);
+    } while (__STREXW(desired, ptr) != 0);
+
+    return value;
+}
+
+static inline void mpsc_increase(mpsc_fifo_atomic_t *ptr) {
+    uint32_t value;
+
+    do {
+        value = __LDREXW(ptr);
+    } while (__STREXW(value + 1, ptr) != 0);
+}
+
+#else /* MPSC_FIFO_USE_LDREX */
+
+static inline uint32_t mpsc_load(mpsc_fifo_atomic_t *ptr) {
+    return atomic_load_explicit(ptr, memory_order_acquire);
+}
+
+static inline void mpsc_store(mpsc_fifo_atomic_t *ptr, uint32_t value) {
+    atomic_store_explicit(ptr, value, memory_order_release);
+}
+
+/* 比较并交换, 失败时 expected 更新为当前值 */
+static inline uint32_t mpsc_cas(mpsc_fifo_atomic_t *ptr, uint32_t *expected,
+                                uint32_t desired) {
+    return atomic_compare_exchange_weak_explicit(
+        ptr, expected, desired, memory_order_acq_rel, memory_order_relaxed);
+}
+
+static inline uint32_t mpsc_exchange(mpsc_fifo_atomic_t *ptr,
+                                     uint32_t desired) {
+    return atomic_exchange_explicit(ptr, desired, memory_order_relaxed);
+}
+
+static inline void mpsc_increase(mpsc_fifo_atomic_t *ptr) {
+    atomic_fetch_add_explicit(ptr, 1, memory_order_relaxed);
+}
+
+#endif /* MPSC_FIFO_USE_LDREX */
+
+static inline uint32_t is_pow_of_2(uint32_t n) {
+    return (0 != n) && (0 == (n & (n - 1)));
+}
+
+uint32_t mpsc_fifo_init(mpsc_fifo_t *fifo, mpsc_fifo_atomic_t *seq, void *buf,
+                        uint32_t size, uint32_t elem_size) {
+    if ((NULL == fifo) || (NULL == seq) || (NULL == buf) ||
+        (0 == is_pow_of_2(size)) || (0 == elem_size)) {
+        return 1;
+    }
+
+    /* 单元 i 的序号为 i 时可写, 为 i + 1 时可读 */
+    for (uint32_t i = 0; i < size; ++i) {
+        mpsc_store(&seq[i], i);
+    }
+
+    fifo->head = 0;
+    fifo->mask = size - 1;
+    fifo->elem_size = elem_size;
+    fifo->seq = seq;
+    fifo->buf = buf;
+    mpsc_store(&fifo->dropped, 0);
+    mpsc_store(&fifo->tail, 0);
+
+    return 0;
+}
+
+uint32_t mpsc_fifo_push(mpsc_fifo_t *fifo, const void *elem) {
+    uint32_t pos = mpsc_load(&fifo->tail);
+    uint32_t cell;
+
+    while (1) {
+        cell = pos & fifo->mask;
+        int32_t diff = (int32_t)(mpsc_load(&fifo->seq[cell]) - pos);
+
+        if (diff == 0) {
+            /* 单元可写, 抢占该位置 */
+            if (mpsc_cas(&fifo->tail, &pos, pos + 1)) {
+                break;
+            }
+        } else if (diff < 0) {
+            /* 该单元上一轮的元素还未被读出 */
+            mpsc_increase(&fifo->dropped);
+            return 1;
+        } else {
+            /* 其他生产者已抢占该位置 */
+            pos = mpsc_load(&fifo->tail);
+        }
+    }
+
+    memcpy(fifo->buf + cell * fifo->elem_size, elem, fifo->elem_size);
+    mpsc_store(&fifo->seq[cell], pos + 1);
+
+    return 0;
+}
+
+uint32_t mpsc_fifo_pop(mpsc_fifo_t *fifo, void *elem) {
+    uint32_t pos = fifo->head;
+    uint32_t cell = pos & fifo->mask;
+
+    if ((int32_t)(mpsc_load(&fifo->seq[cell]) - (pos + 1)) < 0) {
+        return 1;
+    }
+
+    memcpy(elem, fifo->buf + cell * fifo->elem_size, fifo->elem_size);
+    /* 下一轮的写入位置为 pos + size */
+    mpsc_store(&fifo->seq[cell], pos + fifo->mask + 1);
+    fifo->head = pos + 1;
+
+    return 0;
+}
+
+uint32_t mpsc_fifo_count(mpsc_fifo_t *fifo) {
+    return mpsc_load(&fifo->tail) - fifo->head;
+}
+
+uint32_t mpsc_fifo_take_dropped(mpsc_fifo_t *fifo) {
+    return mpsc_exchange(&fifo->dropped, 0);
+}
@@ -0,0 +1,108 @@
+/**
+ * @file    mpsc_fifo.h
+ * @author  Deadline039
+ * @brief   多生产者单消费者无锁FIFO
+ * @version 1.0
+ * @date    2024-12-02
+ * @note    固定元素大小的有界队列, 每个单元带一个序号. 生产者用 CAS 抢占写入
+ *          位置, 写完数据后发布序号; 消费者只有一个, 读到未发布的单元即认为
+ *          队列为空. 任务与中断都可以作为生产者, 生产者之间不需要关中断.
+ *
+ *          生产者在抢到位置后、发布前被打断时, 消费者会停在该单元, 直到生产者
+ *          发布后再次读取. 因此生产者发布后应再通知一次消费者.
+ *
+ *          在 Cortex-M3/M4/M7 上使用 LDREX/STREX, 其他平台使用 C11 原子操作.
+ */
+
+#ifndef __MPSC_FIFO_H
+#define __MPSC_FIFO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#ifndef MPSC_FIFO_USE_LDREX
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+#define MPSC_FIFO_USE_LDREX 1
+#else
+#define MPSC_FIFO_USE_LDREX 0
+#endif
+#endif /* MPSC_FIFO_USE_LDREX */
+
+#if MPSC_FIFO_USE_LDREX
+typedef volatile uint32_t mpsc_fifo_atomic_t;
+#else /* MPSC_FIFO_USE_LDREX */
+#include <stdatomic.h>
+typedef _Atomic uint32_t mpsc_fifo_atomic_t;
+#endif /* MPSC_FIFO_USE_LDREX */
+
+/* 多生产者单消费者FIFO结构 */
+typedef struct {
+    mpsc_fifo_atomic_t tail;    /* 生产者指针 */
+    mpsc_fifo_atomic_t dropped; /* 队列满时丢弃的元素数 */
+    uint32_t head;              /* 消费者指针, 只由消费者访问 */
+
+    uint32_t mask;      /* 单元数的掩码 */
+    uint32_t elem_size; /* 元素大小(byte) */
+
+    mpsc_fifo_atomic_t *seq; /* 每个单元的序号 */
+    uint8_t *buf;            /* 元素缓冲区 */
+} mpsc_fifo_t;
+
+/**
+ * @brief    初始化FIFO
+ * @param[in]    fifo        FIFO句柄
+ * @param[in]    seq         序号数组, 长度为size
+ * @param[in]    buf         元素缓冲区, 长度为size * elem_size
+ * @param[in]    size        单元数, 必须为2的幂次方
+ * @param[in]    elem_size   元素大小(byte)
+ * @retval   执行结果
+ * -         0   成功
+ * -         1   参数错误
+ */
+uint32_t mpsc_fifo_init(mpsc_fifo_t *fifo, mpsc_fifo_atomic_t *seq, void *buf,
+                        uint32_t size, uint32_t elem_size);
+
+/**
+ * @brief    写入一个元素(多生产者无锁, 可重入)
+ * @param[in]    fifo    FIFO句柄
+ * @param[in]    elem    待写入元素
+ * @retval   执行结果
+ * -         0   成功
+ * -         1   队列满, 元素被丢弃并计入丢弃数
+ */
+uint32_t mpsc_fifo_push(mpsc_fifo_t *fifo, const void *elem);
+
+/**
+ * @brief    读出一个元素(单消费者)
+ * @param[in]    fifo    FIFO句柄
+ * @param[out]   elem    存放读出的元素
+ * @retval   执行结果
+ * -         0   成功
+ * -         1   队列空, 或最早的元素还未发布
+ */
+uint32_t mpsc_fifo_pop(mpsc_fifo_t *fifo, void *elem);
+
+/**
+ * @brief    获取FIFO中的元素数(包括未发布的元素)
+ * @param[in]    fifo    FIFO句柄
+ * @retval   执行结果
+ * -         元素数
+ */
+uint32_t mpsc_fifo_count(mpsc_fifo_t *fifo);
+
+/**
+ * @brief    读取并清零丢弃数
+ * @param[in]    fifo    FIFO句柄
+ * @retval   执行结果
+ * -         上次读取后丢弃的元素数
+ */
+uint32_t mpsc_fifo_take_dropped(mpsc_fifo_t *fifo);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MPSC_FIFO_H */